@@ -0,0 +1,172 @@
+#include "./axis_data.hpp"
+
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "./fixed_point.h"
+
+namespace fanuc {
+
+namespace {
+
+struct KindInfo {
+  const char *name;
+  short cls;
+  short type;
+};
+
+/* indexed by AxisKind */
+const KindInfo kind_info[] = {
+    {"absolute", 1, 0},   {"machine", 1, 1},       {"relative", 1, 2},     {"distance", 1, 3},
+    {"handle_input", 1, 4}, {"handle_output", 1, 5}, {"servo_load", 2, 0},  {"servo_current", 2, 1},
+    {"spindle_load", 3, 0}, {"spindle_speed", 3, 1},
+};
+
+const KindInfo &info(AxisKind kind) { return kind_info[static_cast<int>(kind)]; }
+
+}  // namespace
+
+const char *axis_kind_name(AxisKind kind) { return info(kind).name; }
+
+AxisDataReader::Read64 AxisDataReader::lookup_read64() {
+#ifdef _WIN32
+  HMODULE lib = GetModuleHandleA("Fwlib32.dll");
+  return lib != NULL ? reinterpret_cast<Read64>(GetProcAddress(lib, "cnc_rdaxisdata64")) : nullptr;
+#else
+  /* the Linux library 1.0.5 does not export it, newer ones may */
+  return reinterpret_cast<Read64>(dlsym(RTLD_DEFAULT, "cnc_rdaxisdata64"));
+#endif
+}
+
+AxisDataReader::AxisDataReader(std::vector<AxisKind> kinds, Read32 read32, Read64 read64)
+    : read32_(read32), read64_(read64) {
+  std::vector<short> classes;
+
+  for (AxisKind kind : kinds) {
+    bool seen = std::any_of(columns_.begin(), columns_.end(),
+                            [kind](const AxisColumn &c) { return c.kind == kind; });
+    if (seen) continue;
+    AxisColumn column;
+    column.kind = kind;
+    columns_.push_back(std::move(column));
+    if (std::find(classes.begin(), classes.end(), info(kind).cls) == classes.end())
+      classes.push_back(info(kind).cls);
+  }
+
+  /* one call per class, split when a class has more types than a call takes */
+  names_.resize(classes.size());
+  raw_names_.resize(classes.size());
+  for (std::size_t n = 0; n < classes.size(); n++) {
+    for (std::size_t c = 0; c < columns_.size(); c++) {
+      if (info(columns_[c].kind).cls != classes[n]) continue;
+      if (batches_.empty() || batches_.back().names != (int)n ||
+          batches_.back().types.size() == AXISDATA_MAX_TYPES) {
+        AxisBatch batch;
+        batch.cls = classes[n];
+        batch.len = classes[n] == 3 ? MAX_SPINDLE : MAX_AXIS;
+        batch.names = (int)n;
+        batches_.push_back(std::move(batch));
+      }
+      batches_.back().types.push_back(info(columns_[c].kind).type);
+      batches_.back().columns.push_back((int)c);
+      columns_[c].names = &names_[n];
+    }
+  }
+}
+
+const AxisColumn *AxisDataReader::column(AxisKind kind) const {
+  for (const AxisColumn &c : columns_) {
+    if (c.kind == kind) return &c;
+  }
+  return nullptr;
+}
+
+void AxisDataReader::reset() {
+  wide_ = -1;
+  for (std::string &raw : raw_names_) raw.clear();
+}
+
+short AxisDataReader::read(unsigned short libh) {
+  for (const AxisBatch &batch : batches_) {
+    short ret = read_batch(libh, batch);
+    if (ret != EW_OK) return ret;
+  }
+  return EW_OK;
+}
+
+short AxisDataReader::read_batch(unsigned short libh, const AxisBatch &batch) {
+  std::vector<short> types(batch.types);
+  short num = (short)types.size();
+  short len = batch.len;
+  short ret;
+  std::string raw;
+
+  if (wide_ != 0 && read64_ != nullptr) {
+    buf64_.resize((std::size_t)num * batch.len);
+    ret = read64_(libh, batch.cls, types.data(), num, &len, buf64_.data());
+    if (ret == EW_OK) {
+      wide_ = 1;
+      len = std::min(len, batch.len);
+      for (short t = 0; t < num; t++) {
+        AxisColumn &column = columns_[batch.columns[t]];
+        const ODBAXDT64 *row = &buf64_[(std::size_t)t * batch.len];
+        column.value.resize(len);
+        column.dec.resize(len);
+        column.unit.resize(len);
+        for (short i = 0; i < len; i++) {
+          column.value[i] = row[i].data;
+          column.dec[i] = row[i].dec;
+          column.unit[i] = row[i].unit;
+        }
+      }
+      for (short i = 0; i < len; i++) raw.append(buf64_[i].name, sizeof(buf64_[i].name));
+      set_names(batch.names, std::move(raw));
+      return EW_OK;
+    }
+    /* only the first answer decides, later errors are the controller's */
+    if (wide_ == 1 || (ret != EW_FUNC && ret != EW_NOOPT && ret != EW_VERSION)) return ret;
+    len = batch.len;
+  }
+  wide_ = 0;
+
+  buf32_.resize((std::size_t)num * batch.len);
+  ret = read32_(libh, batch.cls, types.data(), num, &len, buf32_.data());
+  if (ret != EW_OK) return ret;
+  len = std::min(len, batch.len);
+  raw_.resize(len);
+  for (short t = 0; t < num; t++) {
+    AxisColumn &column = columns_[batch.columns[t]];
+    const ODBAXDT *row = &buf32_[(std::size_t)t * batch.len];
+    column.value.resize(len);
+    column.dec.resize(len);
+    column.unit.resize(len);
+    for (short i = 0; i < len; i++) {
+      raw_[i] = (int32_t)row[i].data; /* 32-bit on the wire, long only widens it */
+      column.dec[i] = row[i].dec;
+      column.unit[i] = row[i].unit;
+    }
+    fixed_to_f64(raw_.data(), column.dec.data(), (std::size_t)len, column.value.data());
+  }
+  for (short i = 0; i < len; i++) raw.append(buf32_[i].name, sizeof(buf32_[i].name));
+  set_names(batch.names, std::move(raw));
+  return EW_OK;
+}
+
+void AxisDataReader::set_names(int names, std::string raw) {
+  if (raw == raw_names_[names]) return;
+  std::vector<std::string> &list = names_[names];
+  list.clear();
+  for (std::size_t i = 0; i + 4 <= raw.size(); i += 4) {
+    std::size_t n = 0;
+    while (n < 4 && raw[i + n] != '\0') n++;
+    while (n > 0 && raw[i + n - 1] == ' ') n--;
+    list.emplace_back(raw, i, n);
+  }
+  raw_names_[names] = std::move(raw);
+}
+
+}  // namespace fanuc
@@ -0,0 +1,98 @@
+#ifndef FW_AXIS_DATA_HPP
+#define FW_AXIS_DATA_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fwlib32.h"
+
+namespace fanuc {
+
+/* types the library accepts in one cnc_rdaxisdata call */
+constexpr int AXISDATA_MAX_TYPES = 4;
+
+/* data read through cnc_rdaxisdata, each maps to a (class, type) pair */
+enum class AxisKind {
+  Absolute,
+  Machine,
+  Relative,
+  Distance,      /* distance to go */
+  HandleInput,   /* manual handle interruption, input unit */
+  HandleOutput,  /* manual handle interruption, output unit */
+  ServoLoad,     /* servo load meter */
+  ServoCurrent,  /* load current, % */
+  SpindleLoad,   /* spindle load meter */
+  SpindleSpeed,  /* spindle motor speed */
+};
+
+const char *axis_kind_name(AxisKind kind);
+
+/* one requested kind for every axis (or spindle for the spindle kinds) */
+struct AxisColumn {
+  AxisKind kind;
+  /* owned by the reader, shared by the columns of a class, kept across reads */
+  const std::vector<std::string> *names = nullptr;
+  std::vector<double> value; /* data scaled by dec */
+  std::vector<short> dec;
+  std::vector<short> unit;
+};
+
+/* one call: a class and up to AXISDATA_MAX_TYPES of its types */
+struct AxisBatch {
+  short cls;
+  short len; /* axes or spindles asked for */
+  std::vector<short> types;
+  std::vector<int> columns; /* column filled by each type */
+  int names;                /* name list of the class */
+};
+
+/*
+ * Reads a set of axis data kinds with the fewest cnc_rdaxisdata calls, the
+ * results kept as one column (structure of arrays) per kind. The 64-bit
+ * variant is used when the library exports it and the controller accepts it,
+ * otherwise the reader falls back to cnc_rdaxisdata for that handle. Axis and
+ * spindle names are only rebuilt when the controller reports other ones.
+ */
+class AxisDataReader {
+ public:
+  using Read32 = short (*)(unsigned short, short, short *, short, short *, ODBAXDT *);
+  using Read64 = short (*)(unsigned short, short, short *, short, short *, ODBAXDT64 *);
+
+  /* cnc_rdaxisdata64 of the loaded library, nullptr when it is not exported */
+  static Read64 lookup_read64();
+
+  explicit AxisDataReader(std::vector<AxisKind> kinds, Read32 read32 = cnc_rdaxisdata,
+                          Read64 read64 = lookup_read64());
+
+  /* stops at the first failing call, columns of later batches keep their values */
+  short read(unsigned short libh);
+  /* another handle or a reconnect: probe the 64-bit variant again */
+  void reset();
+
+  const std::vector<AxisBatch> &batches() const { return batches_; }
+  const std::vector<AxisColumn> &columns() const { return columns_; }
+  const AxisColumn *column(AxisKind kind) const;
+  /* -1 not probed yet, 0 cnc_rdaxisdata, 1 cnc_rdaxisdata64 */
+  int wide() const { return wide_; }
+
+ private:
+  short read_batch(unsigned short libh, const AxisBatch &batch);
+  void set_names(int names, std::string raw);
+
+  Read32 read32_;
+  Read64 read64_;
+  int wide_ = -1;
+  std::vector<AxisBatch> batches_;
+  std::vector<AxisColumn> columns_;
+  /* names per class, and the raw 4-byte names they were made from */
+  std::vector<std::vector<std::string>> names_;
+  std::vector<std::string> raw_names_;
+  std::vector<ODBAXDT> buf32_;
+  std::vector<ODBAXDT64> buf64_;
+  std::vector<int32_t> raw_; /* data of one column, narrowed for the conversion */
+};
+
+}  // namespace fanuc
+
+#endif
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "./pmc_capture.hpp"
+#include "./sim.hpp"
+
+using namespace fanuc;
+using namespace std::chrono;
+
+static long env_long(const char *name, long fallback) {
+  const char *tmp = getenv(name);
+  return tmp != NULL && atol(tmp) >= 0 ? atol(tmp) : fallback;
+}
+
+/* D300.0 on or off through the writer's own handle */
+static short write_pulse_bit(unsigned short libh, bool on) {
+  IODBPMC buf;
+  memset(&buf, 0, sizeof(buf));
+  buf.type_a = 9; /* D */
+  buf.type_d = 0;
+  buf.datano_s = 300;
+  buf.datano_e = 300;
+  buf.u.cdata[0] = on ? 1 : 0;
+  return pmc_wrpmcrng(libh, 8 + 1, &buf);
+}
+
+/*
+ * Captures D300 of a simulated machine while another handle pulses D300.0,
+ * BENCH_PULSES pulses of each width, and prints how many were caught next to
+ * the sampling rate and the shortest pulse the capture guarantees.
+ */
+int main() {
+  long pulses = env_long("BENCH_PULSES", 50);
+  long cpu = env_long("BENCH_CPU", -1);
+  const long widths_us[] = {50, 200, 500, 1000, 5000};
+
+  sim::ServerOptions opts;
+  opts.port = 0;
+  opts.count = 1;
+  opts.latency_ms = env_long("SIM_LATENCY_MS", 0);
+  opts.jitter_ms = env_long("SIM_JITTER_MS", 0);
+  sim::Server server(opts);
+  if (server.listen() != EW_OK) return EXIT_FAILURE;
+  std::thread server_thread([&] { server.run(); });
+
+  unsigned short libh;
+  cnc_startupprocess(0, "focas.log");
+  if (cnc_allclibhndl3("127.0.0.1", server.port(0), 10, &libh) != EW_OK) {
+    fprintf(stderr, "Failed to connect to the simulator!\n");
+    return EXIT_FAILURE;
+  }
+
+  PmcCaptureOptions capture_opts;
+  capture_opts.cpu = (int)cpu;
+  PmcCapture capture("127.0.0.1", server.port(0), 10, {{PmcArea::D, 300}}, capture_opts);
+  std::this_thread::sleep_for(milliseconds(50));
+
+  printf("latency %ld ms + 0..%ld ms, %ld pulses per width\n", opts.latency_ms, opts.jitter_ms, pulses);
+  printf("%12s %12s %12s\n", "width us", "sent", "caught");
+  std::vector<pmc_edge> edges(4 * pulses + 16);
+  for (long width : widths_us) {
+    long caught = 0;
+    for (long i = 0; i < pulses; i++) {
+      if (write_pulse_bit(libh, true) != EW_OK) return EXIT_FAILURE;
+      std::this_thread::sleep_for(microseconds(width));
+      if (write_pulse_bit(libh, false) != EW_OK) return EXIT_FAILURE;
+      std::this_thread::sleep_for(milliseconds(5));
+    }
+    std::size_t n = capture.drain(edges.data(), edges.size());
+    for (std::size_t i = 0; i < n; i++) caught += edges[i].new_value;
+    printf("%12ld %12ld %12ld\n", width, pulses, caught);
+  }
+
+  capture.stop();
+  PmcCapture::Stats stats = capture.stats();
+  printf("%.0f samples/s, read max %.3f ms, shortest pulse always caught %.3f ms, %s\n", stats.rate(),
+         duration<double, std::milli>(stats.read_max).count(),
+         duration<double, std::milli>(stats.min_pulse()).count(), stats.pinned ? "pinned" : "not pinned");
+  printf("%lu errors, %lu edges dropped\n", stats.errors, stats.dropped);
+
+  cnc_freelibhndl(libh);
+  server.stop();
+  server_thread.join();
+  return EXIT_SUCCESS;
+}
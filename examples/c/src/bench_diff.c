@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./pmc_diff.h"
+#include "./sync.h"
+
+#define BENCH_MS_DEFAULT 200
+#define EDGES 16
+
+static const char *kernels[] = {"scalar", "sse2", "avx2", "neon"};
+/* an R block of a ladder, a D table, a whole 64 KB area */
+static const size_t sizes[] = {1024, 8192, 65536};
+
+static uint8_t *image[2];
+static pmc_edge out[2 * EDGES];
+static volatile size_t sink;
+
+/* nanoseconds per update, alternating between two images EDGES bits apart when edges is set */
+static double bench(size_t n, int edges, int bench_ms) {
+  uint64_t start = fw_now_ms(), elapsed;
+  size_t rounds = 0, i;
+  pmc_diff d;
+
+  if (pmc_diff_init(&d, 5, 0, n) != 0) return 0;
+  pmc_diff_update(&d, image[0], 0, out, 2 * EDGES);
+  do {
+    for (i = 0; i < 256; i++) sink += pmc_diff_update(&d, image[edges ? i & 1 : 0], i, out, 2 * EDGES);
+    rounds += 256;
+  } while ((elapsed = fw_now_ms() - start) < (uint64_t)bench_ms);
+  pmc_diff_free(&d);
+  return elapsed * 1e6 / (double)rounds;
+}
+
+/* change detection of every kernel the cpu runs against the scalar loop */
+int main(void) {
+  size_t max = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+  int bench_ms = BENCH_MS_DEFAULT;
+  double scalar[2][sizeof(sizes) / sizeof(sizes[0])];
+  size_t k, s, i;
+  int edges;
+  char *tmp;
+
+  if ((tmp = getenv("BENCH_MS")) != NULL && atoi(tmp) > 0) {
+    bench_ms = atoi(tmp);
+  }
+  image[0] = (uint8_t *)malloc(max);
+  image[1] = (uint8_t *)malloc(max);
+  if (!image[0] || !image[1]) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+  srand(1);
+  for (i = 0; i < max; i++) image[0][i] = (uint8_t)rand();
+  memcpy(image[1], image[0], max);
+  /* spread over the first KB so every size sees them all */
+  for (i = 0; i < EDGES; i++) image[1][(size_t)rand() % sizes[0]] ^= (uint8_t)(1u << (rand() % 8));
+
+  pmc_diff_use(NULL);
+  printf("best kernel: %s, %d ms per run\n", pmc_diff_kernel(), bench_ms);
+  printf("%-7s %-9s", "kernel", "cycle");
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) printf(" %12zu bytes", sizes[s]);
+  printf("\n");
+
+  for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!pmc_diff_use(kernels[k])) continue;
+    for (edges = 0; edges < 2; edges++) {
+      printf("%-7s %-9s", kernels[k], edges ? "16 edges" : "no change");
+      for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        double ns = bench(sizes[s], edges, bench_ms);
+        if (k == 0) scalar[edges][s] = ns;
+        printf(" %8.0f ns %4.1fx", ns, scalar[edges][s] / ns);
+      }
+      printf("\n");
+    }
+  }
+
+  free(image[0]);
+  free(image[1]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./fixed_point.h"
+#include "./sync.h"
+
+#define BENCH_MS_DEFAULT 200
+
+static const char *kernels[] = {"scalar", "sse2", "avx2", "neon"};
+/* one machine's axes, a poll of a fleet, a history buffer */
+static const size_t sizes[] = {8, 256, 65536};
+
+static int32_t *values;
+static short *decs;
+static double *out64;
+static float *out32;
+static volatile double sink;
+
+/* nanoseconds per value of a conversion, repeated for bench_ms */
+static double bench(int op, size_t n, int bench_ms) {
+  uint64_t start = fw_now_ms(), elapsed;
+  size_t rounds = 0, i;
+
+  do {
+    for (i = 0; i < 64; i++) {
+      switch (op) {
+        case 0: fixed_to_f64(values, decs, n, out64); break;
+        case 1: fixed_to_f64_uniform(values, 3, n, out64); break;
+        case 2: fixed_to_f32(values, decs, n, out32); break;
+        default: fixed_to_f32_uniform(values, 3, n, out32); break;
+      }
+    }
+    sink += out64[n - 1] + out32[n - 1];
+    rounds += 64;
+  } while ((elapsed = fw_now_ms() - start) < (uint64_t)bench_ms);
+  return elapsed * 1e6 / ((double)rounds * n);
+}
+
+/* value / 10^dec conversions of every kernel the cpu runs against the scalar loop */
+int main(void) {
+  static const char *ops[] = {"f64 per dec", "f64 uniform", "f32 per dec", "f32 uniform"};
+  size_t max = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+  int bench_ms = BENCH_MS_DEFAULT;
+  double scalar[4][sizeof(sizes) / sizeof(sizes[0])];
+  size_t k, s, i;
+  int op;
+  char *tmp;
+
+  if ((tmp = getenv("BENCH_MS")) != NULL && atoi(tmp) > 0) {
+    bench_ms = atoi(tmp);
+  }
+  values = (int32_t *)malloc(max * sizeof(int32_t));
+  decs = (short *)malloc(max * sizeof(short));
+  out64 = (double *)malloc(max * sizeof(double));
+  out32 = (float *)malloc(max * sizeof(float));
+  if (!values || !decs || !out64 || !out32) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+  srand(1);
+  for (i = 0; i < max; i++) {
+    values[i] = rand() % 2000000 - 1000000;
+    decs[i] = (short)(i % 4 == 3 ? 0 : 3); /* axes in um, a spindle in rpm */
+  }
+
+  fixed_use(NULL);
+  printf("best kernel: %s, %d ms per run\n", fixed_kernel(), bench_ms);
+  printf("%-7s %-12s", "kernel", "conversion");
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) printf(" %9zu values", sizes[s]);
+  printf("\n");
+
+  for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!fixed_use(kernels[k])) continue;
+    for (op = 0; op < 4; op++) {
+      printf("%-7s %-12s", kernels[k], ops[op]);
+      for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        double ns = bench(op, sizes[s], bench_ms);
+        if (k == 0) scalar[op][s] = ns;
+        printf(" %6.2f ns %4.1fx", ns, scalar[op][s] / ns);
+      }
+      printf("\n");
+    }
+  }
+
+  free(values);
+  free(decs);
+  free(out64);
+  free(out32);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "./pmc_plan.hpp"
+#include "./sim.hpp"
+
+using namespace fanuc;
+using namespace std::chrono;
+
+static long env_long(const char *name, long fallback) {
+  const char *tmp = getenv(name);
+  return tmp != NULL && atol(tmp) >= 0 ? atol(tmp) : fallback;
+}
+
+/* a ladder's worth of watched signals: interface bits, I/O, keep relays, data tables */
+static std::vector<PmcSignal> watched(long count) {
+  struct {
+    PmcArea area;
+    uint16_t size;
+    uint16_t width;
+    int share;
+  } areas[] = {
+      {PmcArea::G, 768, 1, 15}, {PmcArea::F, 768, 1, 15}, {PmcArea::X, 128, 1, 10},
+      {PmcArea::Y, 128, 1, 10}, {PmcArea::R, 8000, 1, 30}, {PmcArea::D, 10000, 2, 20},
+  };
+  std::mt19937 rng(42);
+  std::vector<PmcSignal> signals;
+
+  for (auto &a : areas) {
+    long n = count * a.share / 100;
+    /* signals come in clusters the way a ladder groups them */
+    std::uniform_int_distribution<int> cluster(0, a.size - 64), step(1, 6);
+    while (n > 0) {
+      int address = cluster(rng);
+      for (int k = 0; k < 8 && n > 0; k++, n--) {
+        std::uniform_int_distribution<int> wide(0, 3);
+        uint16_t width = a.area == PmcArea::D && wide(rng) == 0 ? 4 : a.width;
+        signals.push_back({a.area, (uint16_t)address, width});
+        address += step(rng) * width;
+      }
+    }
+  }
+  return signals;
+}
+
+/* milliseconds per cycle over BENCH_CYCLES cycles */
+template <typename F>
+static double cycle_ms(long cycles, F read) {
+  auto start = steady_clock::now();
+  for (long i = 0; i < cycles; i++) {
+    if (read() != EW_OK) return -1;
+  }
+  return duration<double, std::milli>(steady_clock::now() - start).count() / cycles;
+}
+
+/*
+ * Reads BENCH_SIGNALS scattered PMC addresses from a simulated machine one
+ * pmc_rdpmcrng each, then through the planned ranges, and prints round trips
+ * and time per cycle of both.
+ */
+int main() {
+  long count = env_long("BENCH_SIGNALS", 400);
+  long cycles = env_long("BENCH_CYCLES", 20);
+  std::vector<PmcSignal> signals = watched(count);
+
+  sim::ServerOptions opts;
+  opts.port = 0;
+  opts.count = 1;
+  opts.latency_ms = env_long("SIM_LATENCY_MS", 1);
+  opts.jitter_ms = env_long("SIM_JITTER_MS", 0);
+  sim::Server server(opts);
+  if (server.listen() != EW_OK) return EXIT_FAILURE;
+  std::thread server_thread([&] { server.run(); });
+
+  unsigned short libh;
+  cnc_startupprocess(0, "focas.log");
+  if (cnc_allclibhndl3("127.0.0.1", server.port(0), 10, &libh) != EW_OK) {
+    fprintf(stderr, "Failed to connect to the simulator!\n");
+    return EXIT_FAILURE;
+  }
+  if (cycles < 1) cycles = 1;
+
+  PmcPlanOptions single;
+  single.multi = false;
+  PmcReader multi_reader{PmcPlan(signals)}, single_reader{PmcPlan(signals, single)};
+  printf("%s", multi_reader.plan().describe().c_str());
+  printf("latency %ld ms + 0..%ld ms, %ld cycles\n", opts.latency_ms, opts.jitter_ms, cycles);
+  printf("%-26s %12s %12s\n", "", "round trips", "ms / cycle");
+
+  /* an address watched twice is still read once */
+  std::vector<PmcSignal> distinct;
+  std::set<std::pair<PmcArea, uint16_t>> seen;
+  for (const PmcSignal &s : signals) {
+    if (seen.insert({s.area, s.address}).second) distinct.push_back(s);
+  }
+
+  double ms = cycle_ms(cycles, [&] {
+    IODBPMC buf;
+    for (const PmcSignal &s : distinct) {
+      short ret = pmc_rdpmcrng(libh, static_cast<short>(s.area), 0, s.address, s.address + s.width - 1,
+                               (unsigned short)(8 + s.width), &buf);
+      if (ret != EW_OK) return ret;
+    }
+    return (short)EW_OK;
+  });
+  printf("%-26s %12zu %12.2f\n", "one by one", distinct.size(), ms);
+
+  ms = cycle_ms(cycles, [&] { return single_reader.read(libh); });
+  printf("%-26s %12zu %12.2f\n", "planned, pmc_rdpmcrng", single_reader.round_trips(), ms);
+  ms = cycle_ms(cycles, [&] { return multi_reader.read(libh); });
+  printf("%-26s %12zu %12.2f\n", multi_reader.multi() == 1 ? "planned, pmc_rdwrpmcrng" : "planned, fallback",
+         multi_reader.round_trips(), ms);
+
+  cnc_freelibhndl(libh);
+  server.stop();
+  server_thread.join();
+  return EXIT_SUCCESS;
+}
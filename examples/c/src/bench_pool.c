@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./config.c"
+#include "./metadata.c"
+#include "./pool.c"
+#include "./util.c"
+#include "fwlib32.h"
+
+#define BENCH_READS_DEFAULT 100
+
+/* compares connect-per-read (retrieve_id) with pooled handles */
+int main(int argc, char *argv[]) {
+  char cncID[40];
+  Config conf;
+  Pool pool;
+  int reads = BENCH_READS_DEFAULT;
+  int i;
+  uint64_t start;
+  double connect_ms, pooled_ms;
+  char *tmp;
+
+  if (read_config(argc, argv, &conf)) {
+    fprintf(stderr,
+            "usage: %s --config=<path_to_config> --port=<device port> "
+            "--ip=<device ip>\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+  if ((tmp = getenv("BENCH_READS")) != NULL && atoi(tmp) > 0) {
+    reads = atoi(tmp);
+  }
+
+  start = fw_now_ms();
+  for (i = 0; i < reads; i++) {
+    if (retrieve_id(&conf, cncID)) {
+      return EXIT_FAILURE;
+    }
+  }
+  connect_ms = (double)(fw_now_ms() - start);
+
+  if (pool_init(&pool)) {
+    return EXIT_FAILURE;
+  }
+  start = fw_now_ms();
+  for (i = 0; i < reads; i++) {
+    if (retrieve_id_pooled(&pool, &conf, cncID)) {
+      pool_destroy(&pool);
+      return EXIT_FAILURE;
+    }
+  }
+  pooled_ms = (double)(fw_now_ms() - start);
+  pool_destroy(&pool);
+
+  if (connect_ms < 1) connect_ms = 1;
+  if (pooled_ms < 1) pooled_ms = 1;
+  printf("machine id: %s\n", cncID);
+  printf("connect per read: %d reads in %.0f ms (%.1f reads/s)\n", reads,
+         connect_ms, reads * 1000.0 / connect_ms);
+  printf("pooled handle:    %d reads in %.0f ms (%.1f reads/s)\n", reads,
+         pooled_ms, reads * 1000.0 / pooled_ms);
+  printf("speedup: %.1fx\n", connect_ms / pooled_ms);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./scheduler.hpp"
+#include "./sim.hpp"
+
+using namespace fanuc;
+using namespace std::chrono;
+
+static long env_long(const char *name, long fallback) {
+  const char *tmp = getenv(name);
+  return tmp != NULL && atol(tmp) >= 0 ? atol(tmp) : fallback;
+}
+
+static short read_position(unsigned short libh) {
+  ODBDY2 dy;
+  return cnc_rddynamic2(libh, ALL_AXES, sizeof(dy), &dy);
+}
+
+static short read_modal(unsigned short libh) {
+  ODBMDL modal;
+  ODBGCD gcode[32];
+  short num = 32;
+  short ret;
+
+  if ((ret = cnc_modal(libh, -1, 1, &modal)) != EW_OK) return ret;
+  return cnc_rdgcode(libh, -1, 1, &num, gcode);
+}
+
+/* tool life is not wrapped by the Context nor the simulator, list programs instead */
+static short read_programs(unsigned short libh) {
+  PRGDIR3 dir[16];
+  long top = 0;
+  short num = 16;
+  return cnc_rdprogdir3(libh, 2, &top, &num, dir);
+}
+
+/*
+ * Multi-rate polling of simulated machines through the Scheduler: positions
+ * every POSITION_MS, modal state every MODAL_MS and a slow group every SLOW_MS
+ * on every machine, BENCH_WORKERS reads in flight. Prints the deadline misses
+ * and the release jitter of every group.
+ */
+int main() {
+  long machines = env_long("SIM_MACHINES", 20);
+  long seconds = env_long("BENCH_SECONDS", 10);
+  long workers = env_long("BENCH_WORKERS", machines);
+  struct {
+    const char *name;
+    long period_ms;
+    short (*read)(unsigned short);
+  } groups[] = {
+      {"position", env_long("POSITION_MS", 50), read_position},
+      {"modal", env_long("MODAL_MS", 1000), read_modal},
+      {"programs", env_long("SLOW_MS", 60000), read_programs},
+  };
+
+  if (machines < 1) machines = 1;
+  sim::ServerOptions opts;
+  opts.port = 0;
+  opts.count = (int)machines;
+  opts.latency_ms = env_long("SIM_LATENCY_MS", 2);
+  opts.jitter_ms = env_long("SIM_JITTER_MS", 3);
+  sim::Server server(opts);
+  if (server.listen() != EW_OK) return EXIT_FAILURE;
+  std::thread server_thread([&] { server.run(); });
+
+  cnc_startupprocess(0, "focas.log");
+  std::vector<unsigned short> handles((size_t)machines);
+  for (int i = 0; i < machines; i++) {
+    if (cnc_allclibhndl3("127.0.0.1", server.port(i), 10, &handles[i]) != EW_OK) {
+      fprintf(stderr, "Failed to connect to machine %d!\n", i);
+      handles[i] = 0;
+    }
+  }
+
+  printf("%ld machines, %ld workers, latency %ld ms + 0..%ld ms\n", machines, workers,
+         opts.latency_ms, opts.jitter_ms);
+  std::unique_ptr<Scheduler> scheduler(new Scheduler((unsigned)workers));
+  for (int i = 0; i < machines; i++) {
+    if (handles[i] == 0) continue;
+    unsigned short libh = handles[i];
+    for (auto &g : groups) {
+      auto read = g.read;
+      scheduler->add(i, g.name, milliseconds(g.period_ms), [read, libh] { return read(libh); });
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  scheduler->stop();
+
+  std::map<std::string, Scheduler::Stats> totals;
+  for (int id = 0; id < (int)scheduler->groups(); id++) {
+    Scheduler::Stats s = scheduler->stats(id);
+    Scheduler::Stats &t = totals[scheduler->name(id)];
+    t.runs += s.runs;
+    t.missed += s.missed;
+    t.skipped += s.skipped;
+    t.errors += s.errors;
+    t.jitter_total += s.jitter_total;
+    if (s.jitter_max > t.jitter_max) t.jitter_max = s.jitter_max;
+  }
+  scheduler.reset();
+
+  printf("%-9s %8s %7s %7s %7s %10s %10s\n", "group", "runs", "missed", "skipped", "errors",
+         "jitter ms", "max ms");
+  for (auto &g : groups) {
+    Scheduler::Stats &t = totals[g.name];
+    double mean = t.runs > 0 ? duration<double, std::milli>(t.jitter_total).count() / t.runs : 0;
+    printf("%-9s %8lu %7lu %7lu %7lu %10.2f %10.2f\n", g.name, t.runs, t.missed, t.skipped,
+           t.errors, mean, duration<double, std::milli>(t.jitter_max).count());
+  }
+
+  for (int i = 0; i < machines; i++) {
+    if (handles[i] != 0) cnc_freelibhndl(handles[i]);
+  }
+  server.stop();
+  server_thread.join();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./focas_client.hpp"
+#include "./sim.hpp"
+
+using namespace fanuc;
+using Clock = std::chrono::steady_clock;
+
+static long env_long(const char *name, long fallback) {
+  const char *tmp = getenv(name);
+  return tmp != NULL && atol(tmp) >= 0 ? atol(tmp) : fallback;
+}
+
+/* one cnc_rddynamic2 packet, the usual per-cycle read of a poller */
+static std::vector<proto::SubRequest> dynamic_packet() {
+  std::vector<proto::SubRequest> reqs(9);
+  uint16_t commands[] = {proto::CMD_ALARM, proto::CMD_PRGNUM, proto::CMD_SEQNUM,
+                         proto::CMD_ACTF, proto::CMD_ACTS};
+
+  for (int i = 0; i < 5; i++) reqs[i].command = commands[i];
+  for (int t = 0; t < 4; t++) {
+    reqs[5 + t].command = proto::CMD_POSITION;
+    reqs[5 + t].args[0] = t;
+    reqs[5 + t].args[1] = ALL_AXES;
+  }
+  return reqs;
+}
+
+struct Bench {
+  FocasClient client;
+  std::vector<proto::SubRequest> packet = dynamic_packet();
+  std::vector<uint32_t> latencies_us; /* loop thread only */
+  std::atomic<bool> done{false};
+  std::atomic<long> errors{0};
+  std::atomic<int> in_flight{0};
+
+  /* closed loop: every machine has exactly one request outstanding */
+  void issue(unsigned short libh) {
+    Clock::time_point start = Clock::now();
+    in_flight++;
+    client.request(libh, packet, [this, libh, start](short ret, std::vector<proto::SubResponse> &) {
+      auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+      if (ret == EW_OK)
+        latencies_us.push_back((uint32_t)us.count());
+      else
+        errors++;
+      in_flight--;
+      if (!done && ret == EW_OK) issue(libh);
+    });
+  }
+};
+
+static double percentile(const std::vector<uint32_t> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t i = (size_t)(p / 100.0 * (sorted.size() - 1));
+  return sorted[i] / 1000.0;
+}
+
+/*
+ * Throughput and tail latency of FocasClient against simulated machines.
+ * BENCH_PORT targets a running fanuc_sim (BENCH_IP, ports BENCH_PORT..+n),
+ * otherwise SIM_MACHINES machines are started in process.
+ */
+int main() {
+  long machines = env_long("SIM_MACHINES", 100);
+  long seconds = env_long("BENCH_SECONDS", 5);
+  long external_port = env_long("BENCH_PORT", 0);
+  const char *ip = getenv("BENCH_IP") != NULL ? getenv("BENCH_IP") : "127.0.0.1";
+  std::unique_ptr<sim::Server> server;
+  std::thread server_thread;
+  std::vector<unsigned short> ports;
+
+  if (machines < 1) machines = 1;
+  if (external_port == 0) {
+    sim::ServerOptions opts;
+    opts.port = 0;
+    opts.count = (int)machines;
+    opts.latency_ms = env_long("SIM_LATENCY_MS", 0);
+    opts.jitter_ms = env_long("SIM_JITTER_MS", 0);
+    server.reset(new sim::Server(opts));
+    if (server->listen() != EW_OK) return EXIT_FAILURE;
+    for (int i = 0; i < machines; i++) ports.push_back(server->port(i));
+    server_thread = std::thread([&] { server->run(); });
+    printf("simulator: %ld machines, latency %ld ms + 0..%ld ms\n", machines, opts.latency_ms,
+           opts.jitter_ms);
+  } else {
+    for (int i = 0; i < machines; i++) ports.push_back((unsigned short)(external_port + i));
+  }
+
+  Bench bench;
+  std::thread loop([&] { bench.client.run(); });
+  std::atomic<int> connected{0}, failed{0};
+  std::vector<unsigned short> handles((size_t)machines);
+
+  for (int i = 0; i < machines; i++) {
+    bench.client.connect(ip, ports[i], 10, [&, i](short ret, unsigned short libh) {
+      handles[i] = libh;
+      if (ret == EW_OK)
+        connected++;
+      else
+        failed++;
+    });
+  }
+  while (connected + failed < machines) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  if (failed > 0) fprintf(stderr, "%d machine(s) failed to connect\n", failed.load());
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < machines; i++) {
+    if (handles[i] != 0) bench.issue(handles[i]);
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  bench.done = true;
+  while (bench.in_flight > 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  for (int i = 0; i < machines; i++) {
+    if (handles[i] != 0) bench.client.close(handles[i]);
+  }
+  while (bench.client.sessions() > 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  bench.client.stop();
+  loop.join();
+  if (server) {
+    server->stop();
+    server_thread.join();
+  }
+
+  std::vector<uint32_t> &lat = bench.latencies_us;
+  std::sort(lat.begin(), lat.end());
+  printf("%d machines, %zu rddynamic2 packets in %.1f s (%.0f/s), %ld errors\n",
+         connected.load(), lat.size(), elapsed, lat.size() / elapsed, bench.errors.load());
+  printf("latency ms: p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+         percentile(lat, 50), percentile(lat, 90), percentile(lat, 99), percentile(lat, 99.9),
+         percentile(lat, 100));
+
+  return connected > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,261 @@
+#include "./breaker.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* errors that mean the machine did not answer at all */
+#define BREAKER_TRANSPORT(ret) ((ret) == EW_SOCKET || (ret) == EW_HANDLE)
+
+void breaker_init(Breaker *b, const char *ip, unsigned short port,
+                  const BreakerOptions *opts) {
+  memset(b, 0, sizeof(Breaker));
+  snprintf(b->ip, sizeof(b->ip), "%s", ip);
+  b->port = port;
+  b->opts = *opts;
+  b->state = BREAKER_CLOSED;
+  b->timeout = opts->max_timeout;
+  fw_mutex_init(&b->lock);
+}
+
+void breaker_destroy(Breaker *b) {
+  if (b->connected && cnc_freelibhndl(b->libh) != EW_OK)
+    fprintf(stderr, "Failed to free library handle!\n");
+  b->connected = 0;
+  fw_mutex_destroy(&b->lock);
+}
+
+/* caller holds the lock */
+static void breaker_drop_handle(Breaker *b) {
+  if (b->connected && cnc_freelibhndl(b->libh) != EW_OK)
+    fprintf(stderr, "Failed to free library handle!\n");
+  b->connected = 0;
+}
+
+/* caller holds the lock */
+static void breaker_failure(Breaker *b) {
+  breaker_drop_handle(b);
+  if (++b->failures >= b->opts.failures && b->state == BREAKER_CLOSED) {
+    b->state = BREAKER_OPEN;
+    b->opened_ms = fw_now_ms();
+    b->stats.trips++;
+  }
+}
+
+/* caller holds the lock */
+static uint64_t breaker_p99_locked(Breaker *b) {
+  unsigned long need = b->samples - b->samples / 100;
+  unsigned long seen = 0;
+  int i;
+
+  for (i = 0; i < BREAKER_BUCKETS; i++) {
+    seen += b->hist[i];
+    if (seen >= need) break;
+  }
+  if (i == BREAKER_BUCKETS) i--;
+
+  return (uint64_t)1 << i;
+}
+
+uint64_t breaker_p99_ms(Breaker *b) {
+  uint64_t p99;
+
+  fw_mutex_lock(&b->lock);
+  p99 = b->samples == 0 ? 0 : breaker_p99_locked(b);
+  fw_mutex_unlock(&b->lock);
+
+  return p99;
+}
+
+/* caller holds the lock, cnc_settimeout only has whole seconds */
+static void breaker_adapt_timeout(Breaker *b) {
+  uint64_t ms;
+  long timeout;
+
+  if (b->samples < b->opts.min_samples) return;
+  ms = breaker_p99_locked(b) * b->opts.headroom;
+  timeout = (long)((ms + 999) / 1000);
+  if (timeout < b->opts.min_timeout) timeout = b->opts.min_timeout;
+  if (timeout > b->opts.max_timeout) timeout = b->opts.max_timeout;
+  if (timeout == b->timeout) return;
+
+  if (b->connected && cnc_settimeout(b->libh, timeout) != EW_OK) {
+    fprintf(stderr, "Failed to set timeout of %s:%d!\n", b->ip, b->port);
+    return;
+  }
+  b->timeout = timeout;
+  b->stats.timeout_changes++;
+}
+
+static void breaker_record(Breaker *b, uint64_t latency_ms) {
+  int bucket = 0;
+  int i;
+
+  while (bucket < BREAKER_BUCKETS - 1 && latency_ms >= ((uint64_t)1 << bucket))
+    bucket++;
+  b->hist[bucket]++;
+  if (++b->samples >= BREAKER_DECAY) {
+    /* keep following the machine instead of its whole history */
+    b->samples = 0;
+    for (i = 0; i < BREAKER_BUCKETS; i++) {
+      b->hist[i] /= 2;
+      b->samples += b->hist[i];
+    }
+  }
+}
+
+/*
+ * Hand out the machine's handle. While the breaker is open (or a probe is
+ * running) this fails with EW_SOCKET right away instead of blocking the
+ * caller for a connect timeout, so one poller can cycle over healthy and
+ * dead machines alike. The handle has one holder at a time: while it is out
+ * or being connected other callers get EW_BUSY, so a failure can free it
+ * without pulling it from under someone else. Every successful acquire must
+ * be followed by breaker_release with the result of the FOCAS call.
+ */
+short breaker_acquire(Breaker *b, unsigned short *libh) {
+  unsigned short h;
+  long timeout;
+  short ret;
+
+  fw_mutex_lock(&b->lock);
+  if (b->state != BREAKER_CLOSED) {
+    b->stats.rejected++;
+    fw_mutex_unlock(&b->lock);
+    return EW_SOCKET;
+  }
+  if (b->busy) {
+    b->stats.contended++;
+    fw_mutex_unlock(&b->lock);
+    return EW_BUSY;
+  }
+  b->busy = 1;
+  if (b->connected) {
+    *libh = b->libh;
+    fw_mutex_unlock(&b->lock);
+    return EW_OK;
+  }
+  timeout = b->timeout;
+  fw_mutex_unlock(&b->lock);
+
+  ret = cnc_allclibhndl4(b->ip, b->port, timeout, 0, &h);
+
+  fw_mutex_lock(&b->lock);
+  if (ret == EW_OK) {
+    b->libh = h;
+    b->connected = 1;
+    *libh = h;
+  } else {
+    b->busy = 0;
+    breaker_failure(b);
+  }
+  fw_mutex_unlock(&b->lock);
+
+  return ret;
+}
+
+/* record the result and duration of a call made with the acquired handle */
+void breaker_release(Breaker *b, short ret, uint64_t latency_ms) {
+  fw_mutex_lock(&b->lock);
+  b->busy = 0;
+  if (BREAKER_TRANSPORT(ret)) {
+    breaker_failure(b);
+  } else {
+    b->failures = 0;
+    breaker_record(b, latency_ms);
+    breaker_adapt_timeout(b);
+  }
+  fw_mutex_unlock(&b->lock);
+}
+
+/*
+ * Half-open probe: once open_ms has passed, try one connect and a status
+ * read. Success closes the breaker and keeps the probed handle, failure
+ * restarts the open period. Returns 1 if the breaker closed.
+ */
+int breaker_probe(Breaker *b) {
+  unsigned short h;
+  ODBST st;
+  short ret;
+  int closed = 0;
+
+  fw_mutex_lock(&b->lock);
+  if (b->state != BREAKER_OPEN || fw_now_ms() - b->opened_ms < b->opts.open_ms) {
+    fw_mutex_unlock(&b->lock);
+    return 0;
+  }
+  b->state = BREAKER_HALF_OPEN;
+  b->stats.probes++;
+  fw_mutex_unlock(&b->lock);
+
+  if ((ret = cnc_allclibhndl4(b->ip, b->port, b->opts.probe_timeout, 0, &h)) == EW_OK &&
+      (ret = cnc_statinfo(h, &st)) != EW_OK) {
+    cnc_freelibhndl(h);
+  }
+
+  fw_mutex_lock(&b->lock);
+  if (ret == EW_OK) {
+    b->libh = h;
+    b->connected = 1;
+    b->state = BREAKER_CLOSED;
+    b->failures = 0;
+    b->stats.recoveries++;
+    if (cnc_settimeout(h, b->timeout) != EW_OK)
+      fprintf(stderr, "Failed to set timeout of %s:%d!\n", b->ip, b->port);
+    closed = 1;
+  } else {
+    b->state = BREAKER_OPEN;
+    b->opened_ms = fw_now_ms();
+  }
+  fw_mutex_unlock(&b->lock);
+
+  return closed;
+}
+
+static void *breaker_monitor_main(void *arg) {
+  BreakerMonitor *m = (BreakerMonitor *)arg;
+  int stop;
+  int i;
+
+  for (;;) {
+    fw_mutex_lock(&m->lock);
+    stop = m->stop;
+    fw_mutex_unlock(&m->lock);
+    if (stop) break;
+
+    for (i = 0; i < m->count; i++) {
+      breaker_probe(m->breakers[i]);
+    }
+    fw_sleep_ms(m->interval_ms);
+  }
+
+  return NULL;
+}
+
+/* probe the given breakers from a background thread every interval_ms */
+int breaker_monitor_start(BreakerMonitor *m, Breaker **breakers, int n,
+                          uint64_t interval_ms) {
+  if (n > BREAKER_MAX) {
+    fprintf(stderr, "Too many machines for one monitor!\n");
+    return 1;
+  }
+  memcpy(m->breakers, breakers, sizeof(Breaker *) * n);
+  m->count = n;
+  m->interval_ms = interval_ms;
+  m->stop = 0;
+  fw_mutex_init(&m->lock);
+  if (fw_thread_create(&m->thread, breaker_monitor_main, m) != 0) {
+    fprintf(stderr, "Failed to start breaker monitor!\n");
+    fw_mutex_destroy(&m->lock);
+    return 1;
+  }
+
+  return 0;
+}
+
+void breaker_monitor_stop(BreakerMonitor *m) {
+  fw_mutex_lock(&m->lock);
+  m->stop = 1;
+  fw_mutex_unlock(&m->lock);
+  fw_thread_join(m->thread);
+  fw_mutex_destroy(&m->lock);
+}
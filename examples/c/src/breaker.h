@@ -0,0 +1,76 @@
+#ifndef FW_BREAKER_H
+#define FW_BREAKER_H
+
+#include <stdint.h>
+
+#include "./sync.h"
+#include "fwlib32.h"
+
+#define BREAKER_BUCKETS 20     /* latency histogram, bucket i counts reads < 2^i ms */
+#define BREAKER_DECAY 10000    /* halve the histogram after this many samples */
+#define BREAKER_MAX 64         /* machines watched by one monitor */
+
+enum breaker_state { BREAKER_CLOSED, BREAKER_OPEN, BREAKER_HALF_OPEN };
+
+struct breaker_options {
+  int failures;              /* consecutive EW_SOCKET / EW_HANDLE before tripping */
+  uint64_t open_ms;          /* time between half-open probes */
+  long min_timeout;          /* bounds for cnc_settimeout, seconds */
+  long max_timeout;
+  int headroom;              /* timeout = p99 read latency * headroom */
+  unsigned long min_samples; /* reads needed before the timeout is adapted */
+  long probe_timeout;        /* cnc_allclibhndl4 timeout of a probe, seconds */
+};
+
+typedef struct breaker_options BreakerOptions;
+
+static const BreakerOptions default_breaker_options = {3, 5000, 1, 10, 4, 50, 2};
+
+typedef struct breaker_stats {
+  unsigned long trips;
+  unsigned long rejected;    /* calls failed fast while not closed */
+  unsigned long probes;
+  unsigned long recoveries;
+  unsigned long timeout_changes;
+  unsigned long contended;   /* acquires refused with EW_BUSY */
+} BreakerStats;
+
+typedef struct breaker {
+  char ip[100];
+  unsigned short port;
+  unsigned short libh;
+  int connected;
+  int busy;                  /* handle handed out or being connected */
+  enum breaker_state state;
+  int failures;
+  uint64_t opened_ms;
+  uint32_t hist[BREAKER_BUCKETS];
+  unsigned long samples;
+  long timeout;              /* seconds, currently applied to the handle */
+  BreakerOptions opts;
+  BreakerStats stats;
+  fw_mutex_t lock;
+} Breaker;
+
+typedef struct breaker_monitor {
+  Breaker *breakers[BREAKER_MAX];
+  int count;
+  uint64_t interval_ms;
+  int stop;
+  fw_mutex_t lock;
+  fw_thread_t thread;
+} BreakerMonitor;
+
+void breaker_init(Breaker *b, const char *ip, unsigned short port,
+                  const BreakerOptions *opts);
+void breaker_destroy(Breaker *b);
+short breaker_acquire(Breaker *b, unsigned short *libh);
+void breaker_release(Breaker *b, short ret, uint64_t latency_ms);
+uint64_t breaker_p99_ms(Breaker *b);
+int breaker_probe(Breaker *b);
+
+int breaker_monitor_start(BreakerMonitor *m, Breaker **breakers, int n,
+                          uint64_t interval_ms);
+void breaker_monitor_stop(BreakerMonitor *m);
+
+#endif
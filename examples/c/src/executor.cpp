@@ -0,0 +1,144 @@
+#include "./executor.hpp"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace fanuc {
+
+Executor::Executor(std::string ip, unsigned short port, long timeout)
+    : ip_(std::move(ip)), port_(port), timeout_(timeout), head_(&stub_), tail_(&stub_) {
+  worker_ = std::thread(&Executor::run, this);
+}
+
+Executor::~Executor() {
+  {
+    std::lock_guard<std::mutex> lock(wake_lock_);
+    stop_.store(true);
+  }
+  wake_.notify_one();
+  worker_.join();
+}
+
+void Executor::push(Task *task) {
+  task->next.store(nullptr, std::memory_order_relaxed);
+  Task *prev = head_.exchange(task, std::memory_order_acq_rel);
+  prev->next.store(task, std::memory_order_release);
+
+  std::size_t depth = depth_.fetch_add(1, std::memory_order_acq_rel) + 1;
+  std::size_t seen = max_depth_.load(std::memory_order_relaxed);
+  while (depth > seen && !max_depth_.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {
+  }
+  if (depth == 1) {
+    /* the worker may be parked, taking the lock orders us after its check */
+    { std::lock_guard<std::mutex> lock(wake_lock_); }
+    wake_.notify_one();
+  }
+}
+
+/* single consumer side, returns nullptr when empty or a push is half done */
+Executor::Task *Executor::pop() {
+  Task *tail = tail_;
+  Task *next = tail->next.load(std::memory_order_acquire);
+
+  if (tail == &stub_) {
+    if (next == nullptr) return nullptr;
+    tail_ = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+
+  stub_.next.store(nullptr, std::memory_order_relaxed);
+  Task *prev = head_.exchange(&stub_, std::memory_order_acq_rel);
+  prev->next.store(&stub_, std::memory_order_release);
+
+  next = tail->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  return nullptr;
+}
+
+short Executor::ensure_connected() {
+  short ret;
+
+  if (connected_) return EW_OK;
+  if ((ret = cnc_allclibhndl3(ip_.c_str(), port_, timeout_, &libh_)) != EW_OK) {
+    return ret;
+  }
+  connected_ = true;
+  return EW_OK;
+}
+
+void Executor::run() {
+  for (;;) {
+    Task *task = nullptr;
+
+    if (depth_.load(std::memory_order_acquire) == 0) {
+      std::unique_lock<std::mutex> lock(wake_lock_);
+      wake_.wait(lock, [this] {
+        return depth_.load(std::memory_order_acquire) > 0 || stop_.load();
+      });
+      if (depth_.load(std::memory_order_acquire) == 0) break;  // stopping, queue drained
+    }
+    while ((task = pop()) == nullptr) {
+      std::this_thread::yield();  // producer between exchange and link
+    }
+    depth_.fetch_sub(1, std::memory_order_acq_rel);
+
+    /* connect first, argument evaluation order would let run() see a stale libh_ */
+    short conn = ensure_connected();
+    short ret = task->run(libh_, conn);
+
+    /* transport failures drop the handle, the next request reconnects */
+    if (connected_ && (ret == EW_SOCKET || ret == EW_HANDLE)) {
+      cnc_freelibhndl(libh_);
+      connected_ = false;
+      drops_.fetch_add(1, std::memory_order_relaxed);
+    }
+    completed_.fetch_add(1, std::memory_order_relaxed);
+    task->finish();
+    delete task;
+  }
+
+  if (connected_) {
+    cnc_freelibhndl(libh_);
+    connected_ = false;
+  }
+}
+
+std::future<Reply<ODBST>> Executor::statinfo() {
+  return call<ODBST>([](unsigned short libh, ODBST &out) { return cnc_statinfo(libh, &out); });
+}
+
+std::future<Reply<ODBDY2>> Executor::rddynamic2(short axis) {
+  return call<ODBDY2>([axis](unsigned short libh, ODBDY2 &out) {
+    return cnc_rddynamic2(libh, axis, sizeof(ODBDY2), &out);
+  });
+}
+
+std::future<Reply<ODBSPEED>> Executor::rdspeed(short type) {
+  return call<ODBSPEED>([type](unsigned short libh, ODBSPEED &out) {
+    return cnc_rdspeed(libh, type, &out);
+  });
+}
+
+std::future<Reply<std::string>> Executor::rdcncid() {
+  return call<std::string>([](unsigned short libh, std::string &out) {
+    uint32_t ids[4];
+    char buf[40];
+    short ret = cnc_rdcncid(libh, (unsigned long *)ids);
+    if (ret == EW_OK) {
+      snprintf(buf, sizeof(buf), "%08x-%08x-%08x-%08x", ids[0], ids[1], ids[2], ids[3]);
+      out = buf;
+    }
+    return ret;
+  });
+}
+
+}  // namespace fanuc
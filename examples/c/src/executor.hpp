@@ -0,0 +1,114 @@
+#ifndef FW_EXECUTOR_HPP
+#define FW_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "fwlib32.h"
+
+namespace fanuc {
+
+/* result of one FOCAS call made on the executor thread */
+template <typename T>
+struct Reply {
+  short ret = EW_OK;
+  T data{};
+};
+
+/*
+ * Owns one library handle and makes every FOCAS call on a single worker
+ * thread, so any number of application threads can share a connection.
+ * Requests are pushed through a lock-free multi-producer queue; producers only
+ * touch the mutex to wake the worker when the queue was empty.
+ * cnc_startupprocess must have been called before the first executor starts.
+ */
+class Executor {
+ public:
+  Executor(std::string ip, unsigned short port, long timeout = 10);
+  ~Executor();
+
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  /* fn(libh, out) -> FOCAS return code, runs on the executor thread */
+  template <typename T, typename F>
+  std::future<Reply<T>> call(F fn) {
+    auto *task = new Call<T, F>(std::move(fn));
+    std::future<Reply<T>> result = task->promise.get_future();
+    push(task);
+    return result;
+  }
+
+  std::future<Reply<ODBST>> statinfo();
+  std::future<Reply<ODBDY2>> rddynamic2(short axis = ALL_AXES);
+  std::future<Reply<ODBSPEED>> rdspeed(short type = -1);
+  std::future<Reply<std::string>> rdcncid();
+
+  /* requests queued but not yet started, and the highest value seen */
+  std::size_t depth() const { return depth_.load(std::memory_order_relaxed); }
+  std::size_t max_depth() const { return max_depth_.load(std::memory_order_relaxed); }
+  unsigned long completed() const { return completed_.load(std::memory_order_relaxed); }
+  /* handles discarded after EW_SOCKET / EW_HANDLE */
+  unsigned long drops() const { return drops_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Task {
+    std::atomic<Task *> next{nullptr};
+    virtual ~Task() = default;
+    /* ret != EW_OK means no handle is available and libh must not be used */
+    virtual short run(unsigned short libh, short ret) = 0;
+    /* hand the reply to the waiting future, after the executor's bookkeeping */
+    virtual void finish() = 0;
+  };
+
+  template <typename T, typename F>
+  struct Call : Task {
+    explicit Call(F f) : fn(std::move(f)) {}
+    short run(unsigned short libh, short ret) override {
+      reply.ret = ret == EW_OK ? fn(libh, reply.data) : ret;
+      return reply.ret;
+    }
+    void finish() override { promise.set_value(std::move(reply)); }
+    F fn;
+    Reply<T> reply;
+    std::promise<Reply<T>> promise;
+  };
+
+  void push(Task *task);
+  Task *pop();
+  void run();
+  short ensure_connected();
+
+  std::string ip_;
+  unsigned short port_;
+  long timeout_;
+  unsigned short libh_ = 0;
+  bool connected_ = false;
+
+  /* intrusive mpsc queue (Vyukov), head_ is shared by producers */
+  std::atomic<Task *> head_;
+  Task *tail_;
+  struct Stub : Task {
+    short run(unsigned short, short ret) override { return ret; }
+    void finish() override {}
+  } stub_;
+
+  std::atomic<std::size_t> depth_{0};
+  std::atomic<std::size_t> max_depth_{0};
+  std::atomic<unsigned long> completed_{0};
+  std::atomic<unsigned long> drops_{0};
+  std::atomic<bool> stop_{false};
+  std::mutex wake_lock_;
+  std::condition_variable wake_;
+  std::thread worker_;
+};
+
+}  // namespace fanuc
+
+#endif
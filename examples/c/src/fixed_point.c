@@ -0,0 +1,329 @@
+#include "./fixed_point.h"
+
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FIXED_SSE2 1
+#define FIXED_AVX2 1
+#define FIXED_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <emmintrin.h>
+#define FIXED_SSE2 1
+#define FIXED_TARGET(isa)
+#elif defined(__ARM_NEON)
+/* only built when the compiler may use NEON anyway (-mfpu=neon, aarch64) */
+#include <arm_neon.h>
+#define FIXED_NEON 1
+#endif
+
+typedef struct {
+  const char *name;
+  void (*to_f64)(const int32_t *, const short *, size_t, double *);
+  void (*to_f64_uniform)(const int32_t *, short, size_t, double *);
+  void (*to_f32)(const int32_t *, const short *, size_t, float *);
+  void (*to_f32_uniform)(const int32_t *, short, size_t, float *);
+} FixedKernels;
+
+static const double fixed_pow10[FIXED_MAX_DEC + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+};
+
+static const float fixed_scale10[FIXED_MAX_DEC + 1] = {
+    1e0f, 1e-1f, 1e-2f, 1e-3f, 1e-4f,  1e-5f,  1e-6f,  1e-7f,
+    1e-8f, 1e-9f, 1e-10f, 1e-11f, 1e-12f, 1e-13f, 1e-14f, 1e-15f,
+};
+
+/* negative dec multiplies, controllers do not send them but nothing forbids it */
+static double fixed_divisor_slow(short dec) {
+  double d = 1;
+  for (; dec > 0; dec--) d *= 10;
+  for (; dec < 0; dec++) d /= 10;
+  return d;
+}
+
+static inline double fixed_divisor(short dec) {
+  return (unsigned short)dec <= FIXED_MAX_DEC ? fixed_pow10[dec] : fixed_divisor_slow(dec);
+}
+
+static inline float fixed_scale(short dec) {
+  return (unsigned short)dec <= FIXED_MAX_DEC ? fixed_scale10[dec]
+                                              : (float)(1 / fixed_divisor_slow(dec));
+}
+
+/* scalar: the reference, and the tail of the vector kernels */
+
+static void scalar_to_f64(const int32_t *value, const short *dec, size_t n, double *out) {
+  size_t i;
+  for (i = 0; i < n; i++) out[i] = value[i] / fixed_divisor(dec[i]);
+}
+
+static void scalar_to_f64_uniform(const int32_t *value, short dec, size_t n, double *out) {
+  double d = fixed_divisor(dec);
+  size_t i;
+  for (i = 0; i < n; i++) out[i] = value[i] / d;
+}
+
+static void scalar_to_f32(const int32_t *value, const short *dec, size_t n, float *out) {
+  size_t i;
+  for (i = 0; i < n; i++) out[i] = (float)value[i] * fixed_scale(dec[i]);
+}
+
+static void scalar_to_f32_uniform(const int32_t *value, short dec, size_t n, float *out) {
+  float s = fixed_scale(dec);
+  size_t i;
+  for (i = 0; i < n; i++) out[i] = (float)value[i] * s;
+}
+
+static const FixedKernels fixed_scalar = {
+    "scalar", scalar_to_f64, scalar_to_f64_uniform, scalar_to_f32, scalar_to_f32_uniform,
+};
+
+#ifdef FIXED_SSE2
+FIXED_TARGET("sse2")
+static void sse2_to_f64(const int32_t *value, const short *dec, size_t n, double *out) {
+  size_t i;
+  for (i = 0; i + 2 <= n; i += 2) {
+    __m128d v = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)(value + i)));
+    __m128d d = _mm_set_pd(fixed_divisor(dec[i + 1]), fixed_divisor(dec[i]));
+    _mm_storeu_pd(out + i, _mm_div_pd(v, d));
+  }
+  scalar_to_f64(value + i, dec + i, n - i, out + i);
+}
+
+FIXED_TARGET("sse2")
+static void sse2_to_f64_uniform(const int32_t *value, short dec, size_t n, double *out) {
+  __m128d d = _mm_set1_pd(fixed_divisor(dec));
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(value + i));
+    _mm_storeu_pd(out + i, _mm_div_pd(_mm_cvtepi32_pd(v), d));
+    _mm_storeu_pd(out + i + 2, _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), d));
+  }
+  scalar_to_f64_uniform(value + i, dec, n - i, out + i);
+}
+
+FIXED_TARGET("sse2")
+static void sse2_to_f32(const int32_t *value, const short *dec, size_t n, float *out) {
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    __m128 v = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(value + i)));
+    __m128 s = _mm_set_ps(fixed_scale(dec[i + 3]), fixed_scale(dec[i + 2]), fixed_scale(dec[i + 1]),
+                          fixed_scale(dec[i]));
+    _mm_storeu_ps(out + i, _mm_mul_ps(v, s));
+  }
+  scalar_to_f32(value + i, dec + i, n - i, out + i);
+}
+
+FIXED_TARGET("sse2")
+static void sse2_to_f32_uniform(const int32_t *value, short dec, size_t n, float *out) {
+  __m128 s = _mm_set1_ps(fixed_scale(dec));
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    __m128 v = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(value + i)));
+    _mm_storeu_ps(out + i, _mm_mul_ps(v, s));
+  }
+  scalar_to_f32_uniform(value + i, dec, n - i, out + i);
+}
+
+static const FixedKernels fixed_sse2 = {
+    "sse2", sse2_to_f64, sse2_to_f64_uniform, sse2_to_f32, sse2_to_f32_uniform,
+};
+#endif
+
+#ifdef FIXED_AVX2
+FIXED_TARGET("avx2")
+static void avx2_to_f64(const int32_t *value, const short *dec, size_t n, double *out) {
+  const __m256d all_ones = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    /* widen the decimals and gather their powers, out of table ones lane by lane */
+    __m128i e = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)(dec + i)));
+    __m256d v = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(value + i)));
+    __m256d d;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_min_epu32(e, _mm_set1_epi32(FIXED_MAX_DEC)), e)) == 0xffff) {
+      /* the masked form, the plain one leaves its source operand undefined */
+      d = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), fixed_pow10, e, all_ones, 8);
+    } else {
+      d = _mm256_set_pd(fixed_divisor(dec[i + 3]), fixed_divisor(dec[i + 2]),
+                        fixed_divisor(dec[i + 1]), fixed_divisor(dec[i]));
+    }
+    _mm256_storeu_pd(out + i, _mm256_div_pd(v, d));
+  }
+  /* the tail is SSE code, leaving the upper halves dirty slows every SSE instruction after it */
+  _mm256_zeroupper();
+  scalar_to_f64(value + i, dec + i, n - i, out + i);
+}
+
+FIXED_TARGET("avx2")
+static void avx2_to_f64_uniform(const int32_t *value, short dec, size_t n, double *out) {
+  __m256d d = _mm256_set1_pd(fixed_divisor(dec));
+  size_t i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(value + i));
+    _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), d));
+    _mm256_storeu_pd(out + i + 4, _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), d));
+  }
+  _mm256_zeroupper();
+  scalar_to_f64_uniform(value + i, dec, n - i, out + i);
+}
+
+FIXED_TARGET("avx2")
+static void avx2_to_f32(const int32_t *value, const short *dec, size_t n, float *out) {
+  size_t i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    __m256i d = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(dec + i)));
+    __m256i max = _mm256_set1_epi32(FIXED_MAX_DEC);
+    __m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(value + i)));
+    __m256 s;
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_min_epu32(d, max), d)) == -1) {
+      s = _mm256_i32gather_ps(fixed_scale10, d, 4);
+    } else {
+      s = _mm256_set_ps(fixed_scale(dec[i + 7]), fixed_scale(dec[i + 6]), fixed_scale(dec[i + 5]),
+                        fixed_scale(dec[i + 4]), fixed_scale(dec[i + 3]), fixed_scale(dec[i + 2]),
+                        fixed_scale(dec[i + 1]), fixed_scale(dec[i]));
+    }
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(v, s));
+  }
+  _mm256_zeroupper();
+  scalar_to_f32(value + i, dec + i, n - i, out + i);
+}
+
+FIXED_TARGET("avx2")
+static void avx2_to_f32_uniform(const int32_t *value, short dec, size_t n, float *out) {
+  __m256 s = _mm256_set1_ps(fixed_scale(dec));
+  size_t i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(value + i)));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(v, s));
+  }
+  _mm256_zeroupper();
+  scalar_to_f32_uniform(value + i, dec, n - i, out + i);
+}
+
+static const FixedKernels fixed_avx2 = {
+    "avx2", avx2_to_f64, avx2_to_f64_uniform, avx2_to_f32, avx2_to_f32_uniform,
+};
+#endif
+
+#ifdef FIXED_NEON
+#ifdef __aarch64__
+static void neon_to_f64(const int32_t *value, const short *dec, size_t n, double *out) {
+  size_t i;
+  for (i = 0; i + 2 <= n; i += 2) {
+    float64x2_t v = vcvtq_f64_s64(vmovl_s32(vld1_s32(value + i)));
+    double d[2] = {fixed_divisor(dec[i]), fixed_divisor(dec[i + 1])};
+    vst1q_f64(out + i, vdivq_f64(v, vld1q_f64(d)));
+  }
+  scalar_to_f64(value + i, dec + i, n - i, out + i);
+}
+
+static void neon_to_f64_uniform(const int32_t *value, short dec, size_t n, double *out) {
+  float64x2_t d = vdupq_n_f64(fixed_divisor(dec));
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    int32x4_t v = vld1q_s32(value + i);
+    vst1q_f64(out + i, vdivq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v))), d));
+    vst1q_f64(out + i + 2, vdivq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(v))), d));
+  }
+  scalar_to_f64_uniform(value + i, dec, n - i, out + i);
+}
+#else
+/* armv7 NEON has no double lanes, VFP does those one by one */
+#define neon_to_f64 scalar_to_f64
+#define neon_to_f64_uniform scalar_to_f64_uniform
+#endif
+
+static void neon_to_f32(const int32_t *value, const short *dec, size_t n, float *out) {
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    float s[4] = {fixed_scale(dec[i]), fixed_scale(dec[i + 1]), fixed_scale(dec[i + 2]),
+                  fixed_scale(dec[i + 3])};
+    vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(value + i)), vld1q_f32(s)));
+  }
+  scalar_to_f32(value + i, dec + i, n - i, out + i);
+}
+
+static void neon_to_f32_uniform(const int32_t *value, short dec, size_t n, float *out) {
+  float32x4_t s = vdupq_n_f32(fixed_scale(dec));
+  size_t i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(value + i)), s));
+    vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vld1q_s32(value + i + 4)), s));
+  }
+  scalar_to_f32_uniform(value + i, dec, n - i, out + i);
+}
+
+static const FixedKernels fixed_neon = {
+    "neon", neon_to_f64, neon_to_f64_uniform, neon_to_f32, neon_to_f32_uniform,
+};
+#endif
+
+static int fixed_supported(const FixedKernels *k) {
+#if defined(FIXED_SSE2) && defined(FIXED_AVX2)
+  __builtin_cpu_init();
+  if (k == &fixed_avx2) return __builtin_cpu_supports("avx2");
+  if (k == &fixed_sse2) return __builtin_cpu_supports("sse2");
+#endif
+  return 1;
+}
+
+/* best first */
+static const FixedKernels *const fixed_all[] = {
+#ifdef FIXED_AVX2
+    &fixed_avx2,
+#endif
+#ifdef FIXED_SSE2
+    &fixed_sse2,
+#endif
+#ifdef FIXED_NEON
+    &fixed_neon,
+#endif
+    &fixed_scalar,
+};
+
+/* detection always ends on the same kernel, threads racing on the first call store the same pointer */
+static const FixedKernels *fixed_active = NULL;
+
+static const FixedKernels *fixed_kernels(void) {
+  size_t i;
+  if (fixed_active == NULL) {
+    for (i = 0; fixed_active == NULL; i++) {
+      if (fixed_supported(fixed_all[i])) fixed_active = fixed_all[i];
+    }
+  }
+  return fixed_active;
+}
+
+void fixed_to_f64(const int32_t *value, const short *dec, size_t n, double *out) {
+  fixed_kernels()->to_f64(value, dec, n, out);
+}
+
+void fixed_to_f64_uniform(const int32_t *value, short dec, size_t n, double *out) {
+  fixed_kernels()->to_f64_uniform(value, dec, n, out);
+}
+
+void fixed_to_f32(const int32_t *value, const short *dec, size_t n, float *out) {
+  fixed_kernels()->to_f32(value, dec, n, out);
+}
+
+void fixed_to_f32_uniform(const int32_t *value, short dec, size_t n, float *out) {
+  fixed_kernels()->to_f32_uniform(value, dec, n, out);
+}
+
+const char *fixed_kernel(void) { return fixed_kernels()->name; }
+
+int fixed_use(const char *name) {
+  size_t i;
+  if (name == NULL) {
+    fixed_active = NULL;
+    return 1;
+  }
+  for (i = 0; i < sizeof(fixed_all) / sizeof(fixed_all[0]); i++) {
+    if (strcmp(fixed_all[i]->name, name) == 0 && fixed_supported(fixed_all[i])) {
+      fixed_active = fixed_all[i];
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef FW_FIXED_POINT_H
+#define FW_FIXED_POINT_H
+
+/*
+ * FOCAS returns values as integers next to a number of decimal places (dec of
+ * ODBAXDT, ODBSPEED, IODBPSD, cnc_getfigure ...). These convert whole arrays of
+ * them to floating point, value / 10^dec, with the best SIMD kernel of the cpu
+ * picked on first use. Every kernel gives bit for bit the result of the scalar
+ * one, so results do not depend on the machine that computed them.
+ *
+ * Values are int32: FOCAS carries 32-bit data, a 64-bit Linux long only widens
+ * it. Callers holding longs narrow them while gathering them out of the
+ * library's structures.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* decimals looked up in a table, others are computed (slower, same result) */
+#define FIXED_MAX_DEC 15
+
+/* out[i] = value[i] / 10^dec[i] */
+void fixed_to_f64(const int32_t *value, const short *dec, size_t n, double *out);
+/* out[i] = value[i] / 10^dec */
+void fixed_to_f64_uniform(const int32_t *value, short dec, size_t n, double *out);
+/*
+ * out[i] = value[i] * 10^-dec[i] in single precision, multiplied rather than
+ * divided since armv7 NEON has no division, can be 1 ulp off value / 10^dec
+ */
+void fixed_to_f32(const int32_t *value, const short *dec, size_t n, float *out);
+void fixed_to_f32_uniform(const int32_t *value, short dec, size_t n, float *out);
+
+/* name of the kernel in use: "avx2", "sse2", "neon" or "scalar" */
+const char *fixed_kernel(void);
+/* use the named kernel (tests, benchmarks), NULL for the best one, 0 if unsupported */
+int fixed_use(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+#include "./fleet.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+struct fleet_pass {
+  FleetMachine *machines;
+  int *todo;
+  int count;
+  int next;
+  long timeout;
+  fw_mutex_t lock;
+};
+
+static void *fleet_worker(void *arg) {
+  struct fleet_pass *pass = (struct fleet_pass *)arg;
+  FleetMachine *m;
+  uint64_t start;
+  int i;
+
+  for (;;) {
+    fw_mutex_lock(&pass->lock);
+    i = pass->next++;
+    fw_mutex_unlock(&pass->lock);
+    if (i >= pass->count) break;
+
+    m = &pass->machines[pass->todo[i]];
+    start = fw_now_ms();
+    m->ret = cnc_allclibhndl3(m->ip, m->port, pass->timeout, &m->libh);
+    m->latency_ms = fw_now_ms() - start;
+    m->attempts++;
+  }
+
+  return NULL;
+}
+
+/* connect every machine in todo using at most `workers` threads */
+static void fleet_run(FleetMachine *machines, int *todo, int count,
+                      long timeout, int workers) {
+  fw_thread_t threads[FLEET_MAX_WORKERS];
+  struct fleet_pass pass;
+  int started = 0;
+  int i;
+
+  pass.machines = machines;
+  pass.todo = todo;
+  pass.count = count;
+  pass.next = 0;
+  pass.timeout = timeout;
+  fw_mutex_init(&pass.lock);
+
+  if (workers > count) workers = count;
+  if (workers > FLEET_MAX_WORKERS) workers = FLEET_MAX_WORKERS;
+  for (i = 0; i < workers; i++) {
+    if (fw_thread_create(&threads[started], fleet_worker, &pass) == 0)
+      started++;
+  }
+  /* no threads at all, still make progress on the calling thread */
+  if (started == 0) fleet_worker(&pass);
+  for (i = 0; i < started; i++) {
+    fw_thread_join(threads[i]);
+  }
+
+  fw_mutex_destroy(&pass.lock);
+}
+
+/*
+ * Open handles to all machines in parallel. Every machine first gets
+ * probe_timeout; machines whose probe ran out of time (rather than being
+ * refused outright) get a second pass with the full timeout. Dead machines
+ * therefore cost at most probe_timeout + timeout in total instead of adding
+ * up one after another. Returns the number of machines connected.
+ */
+int fleet_connect(FleetMachine *machines, int n, const FleetOptions *opts) {
+  int *todo;
+  int count = 0;
+  int connected = 0;
+  int i;
+
+  if (n <= 0) return 0;
+  if ((todo = (int *)malloc(sizeof(int) * n)) == NULL) {
+    fprintf(stderr, "Failed to allocate fleet work list!\n");
+    return 0;
+  }
+
+  for (i = 0; i < n; i++) {
+    machines[i].libh = 0;
+    machines[i].ret = EW_SOCKET;
+    machines[i].attempts = 0;
+    machines[i].latency_ms = 0;
+    todo[count++] = i;
+  }
+  fleet_run(machines, todo, count, opts->probe_timeout, opts->workers);
+
+  count = 0;
+  for (i = 0; i < n; i++) {
+    if (machines[i].ret == EW_SOCKET && machines[i].latency_ms >= opts->refused_ms)
+      todo[count++] = i;
+  }
+  if (count > 0 && opts->timeout > opts->probe_timeout)
+    fleet_run(machines, todo, count, opts->timeout, opts->workers);
+
+  for (i = 0; i < n; i++) {
+    if (machines[i].ret == EW_OK) connected++;
+  }
+  free(todo);
+
+  return connected;
+}
+
+void fleet_disconnect(FleetMachine *machines, int n) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    if (machines[i].ret == EW_OK && cnc_freelibhndl(machines[i].libh) != EW_OK)
+      fprintf(stderr, "Failed to free library handle!\n");
+    machines[i].ret = EW_SOCKET;
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef FW_FLEET_H
+#define FW_FLEET_H
+
+#include <stdint.h>
+
+#include "./sync.h"
+#include "fwlib32.h"
+
+#define FLEET_MAX_WORKERS 64
+
+typedef struct fleet_machine {
+  char ip[100];
+  unsigned short port;
+  /* filled in by fleet_connect */
+  unsigned short libh;
+  short ret;           /* result of the last cnc_allclibhndl3 */
+  int attempts;        /* 1 = answered the probe, 2 = needed the long timeout */
+  uint64_t latency_ms; /* duration of the last connect attempt */
+} FleetMachine;
+
+struct fleet_options {
+  int workers;        /* parallel connects */
+  long probe_timeout; /* first pass, seconds */
+  long timeout;       /* second pass for machines that timed out, seconds */
+  uint64_t refused_ms; /* failures faster than this are not retried */
+};
+
+typedef struct fleet_options FleetOptions;
+
+static const FleetOptions default_fleet_options = {16, 2, 10, 500};
+
+int fleet_connect(FleetMachine *machines, int n, const FleetOptions *opts);
+void fleet_disconnect(FleetMachine *machines, int n);
+
+#endif
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./fleet.c"
+#include "fwlib32.h"
+
+/* connect to every machine given as ip[:port] and print per-machine latency */
+int main(int argc, char *argv[]) {
+  FleetMachine *machines;
+  FleetOptions opts = default_fleet_options;
+  uint64_t start;
+  int connected;
+  int n = argc - 1;
+  int i;
+  char *sep;
+
+  if (n < 1) {
+    fprintf(stderr, "usage: %s <ip[:port]> [<ip[:port]> ...]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if ((machines = (FleetMachine *)calloc(n, sizeof(FleetMachine))) == NULL) {
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < n; i++) {
+    snprintf(machines[i].ip, sizeof(machines[i].ip), "%s", argv[i + 1]);
+    machines[i].port = 8193;
+    if ((sep = strchr(machines[i].ip, ':')) != NULL) {
+      *sep = '\0';
+      machines[i].port = (unsigned short)atoi(sep + 1);
+    }
+  }
+
+#ifndef _WIN32
+  if (cnc_startupprocess(0, "focas.log") != EW_OK) {
+    fprintf(stderr, "Failed to create required log file!\n");
+    free(machines);
+    return EXIT_FAILURE;
+  }
+#endif
+
+  start = fw_now_ms();
+  connected = fleet_connect(machines, n, &opts);
+  printf("connected %d/%d machines in %llu ms\n", connected, n,
+         (unsigned long long)(fw_now_ms() - start));
+  for (i = 0; i < n; i++) {
+    printf("%s:%d ret=%d attempts=%d latency=%llums\n", machines[i].ip,
+           machines[i].port, machines[i].ret, machines[i].attempts,
+           (unsigned long long)machines[i].latency_ms);
+  }
+
+  fleet_disconnect(machines, n);
+  free(machines);
+#ifndef _WIN32
+  cnc_exitprocess();
+#endif
+
+  return connected == n ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,472 @@
+#include "./focas_client.hpp"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace fanuc {
+
+static uint64_t now_ms() {
+  using namespace std::chrono;
+  return (uint64_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/* protocol version the open request asks for, the controller echoes it */
+static const uint16_t OPEN_PROTOCOL = 2;
+
+FocasClient::FocasClient() {
+  epfd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epfd_ < 0 || wakefd_ < 0) {
+    fprintf(stderr, "Failed to create FOCAS event loop!\n");
+    return;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u64 = 0; /* handles start at 1 */
+  epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+}
+
+FocasClient::~FocasClient() {
+  drain_posted();
+  while (!sessions_.empty()) {
+    unsigned short libh = sessions_.begin()->first;
+    fail(*sessions_.begin()->second, EW_SOCKET);
+    auto it = sessions_.find(libh);
+    if (it != sessions_.end()) destroy(*it->second);
+  }
+  if (wakefd_ >= 0) ::close(wakefd_);
+  if (epfd_ >= 0) ::close(epfd_);
+}
+
+void FocasClient::post(std::function<void()> fn) {
+  uint64_t one = 1;
+
+  {
+    std::lock_guard<std::mutex> lock(posted_lock_);
+    posted_.push_back(std::move(fn));
+  }
+  if (write(wakefd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    fprintf(stderr, "Failed to wake FOCAS event loop!\n");
+  }
+}
+
+void FocasClient::drain_posted() {
+  std::vector<std::function<void()>> batch;
+  uint64_t count;
+
+  if (read(wakefd_, &count, sizeof(count)) < 0 && errno != EAGAIN) return;
+  {
+    std::lock_guard<std::mutex> lock(posted_lock_);
+    batch.swap(posted_);
+  }
+  for (auto &fn : batch) fn();
+}
+
+void FocasClient::connect(const std::string &ip, unsigned short port, long timeout,
+                          ConnectCallback cb) {
+  post([this, ip, port, timeout, cb = std::move(cb)]() mutable {
+    start_connect(ip, port, timeout, std::move(cb));
+  });
+}
+
+void FocasClient::request(unsigned short libh, std::vector<proto::SubRequest> reqs,
+                          RequestCallback cb) {
+  post([this, libh, reqs = std::move(reqs), cb = std::move(cb)]() mutable {
+    start_request(libh, reqs, cb);
+  });
+}
+
+void FocasClient::set_timeout(unsigned short libh, long timeout, CloseCallback cb) {
+  post([this, libh, timeout, cb = std::move(cb)]() {
+    auto it = sessions_.find(libh);
+    if (it != sessions_.end()) it->second->timeout_ms = timeout * 1000;
+    if (cb) cb(it == sessions_.end() ? EW_HANDLE : EW_OK);
+  });
+}
+
+void FocasClient::close(unsigned short libh, CloseCallback cb) {
+  post([this, libh, cb = std::move(cb)]() mutable { start_close(libh, cb); });
+}
+
+void FocasClient::stop() {
+  stop_ = true;
+  post([] {});
+}
+
+void FocasClient::run() {
+  struct epoll_event events[256];
+
+  while (!stop_) {
+    int n = epoll_wait(epfd_, events, 256, next_timeout(now_ms()));
+    if (n < 0 && errno != EINTR) {
+      fprintf(stderr, "FOCAS event loop failed: %s\n", strerror(errno));
+      return;
+    }
+
+    for (int i = 0; i < n; i++) {
+      unsigned short libh = (unsigned short)events[i].data.u64;
+      if (libh == 0) {
+        drain_posted();
+        continue;
+      }
+      /* an earlier event or callback may have closed it */
+      auto it = sessions_.find(libh);
+      if (it != sessions_.end() && it->second->fd >= 0) on_event(*it->second, events[i].events);
+    }
+    expire(now_ms());
+  }
+}
+
+unsigned short FocasClient::next_handle() {
+  if (sessions_.size() >= 0xffff) return 0;
+  do {
+    last_handle_ = (unsigned short)(last_handle_ + 1);
+  } while (last_handle_ == 0 || sessions_.count(last_handle_));
+  return last_handle_;
+}
+
+void FocasClient::start_connect(const std::string &ip, unsigned short port, long timeout,
+                                ConnectCallback cb) {
+  struct sockaddr_in addr;
+  unsigned short libh = next_handle();
+  int one = 1;
+  int fd;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (libh == 0 || inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+    cb(EW_SOCKET, 0);
+    return;
+  }
+  if ((fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+    cb(EW_SOCKET, 0);
+    return;
+  }
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+    ::close(fd);
+    cb(EW_SOCKET, 0);
+    return;
+  }
+
+  std::unique_ptr<Session> owned(new Session());
+  Session &s = *owned;
+  s.libh = libh;
+  s.fd = fd;
+  s.timeout_ms = timeout * 1000;
+  s.on_connect = std::move(cb);
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLOUT;
+  ev.data.u64 = libh;
+  if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    ::close(fd);
+    s.on_connect(EW_SOCKET, 0);
+    return;
+  }
+  s.writable = true;
+  sessions_.emplace(libh, std::move(owned));
+  sessions_count_++;
+  arm(s);
+}
+
+void FocasClient::start_request(unsigned short libh, std::vector<proto::SubRequest> &reqs,
+                                RequestCallback &cb) {
+  std::vector<proto::SubResponse> none;
+  auto it = sessions_.find(libh);
+
+  if (it == sessions_.end() || it->second->state == State::Closing ||
+      it->second->state == State::Connecting || it->second->state == State::Opening) {
+    cb(EW_HANDLE, none);
+    return;
+  }
+  Session &s = *it->second;
+  if (s.fd < 0) {
+    /* lost connection, the handle stays valid until it is freed */
+    cb(EW_SOCKET, none);
+    return;
+  }
+  if (reqs.empty()) {
+    cb(EW_OK, none);
+    return;
+  }
+
+  Pending p;
+  proto::encode_frame(proto::VAR_REQ, proto::encode_requests(reqs), p.packet);
+  if (p.packet.size() > proto::HEADER_SIZE + proto::MAX_BODY) {
+    cb(EW_LENGTH, none);
+    return;
+  }
+  p.cb = std::move(cb);
+  s.queue.push_back(std::move(p));
+  if (!s.in_flight) send_next(s);
+}
+
+void FocasClient::start_close(unsigned short libh, CloseCallback &cb) {
+  std::vector<proto::SubResponse> none;
+  auto it = sessions_.find(libh);
+
+  if (it == sessions_.end() || it->second->state == State::Closing) {
+    if (cb) cb(EW_HANDLE);
+    return;
+  }
+  Session &s = *it->second;
+  s.on_close = std::move(cb);
+  if (s.fd < 0) {
+    destroy(s);
+    return;
+  }
+  if (s.state != State::Ready) {
+    fail(s, EW_HANDLE); /* still connecting, the connect callback gets EW_HANDLE */
+    return;
+  }
+
+  s.state = State::Closing;
+  /* the request on the wire finishes first, everything behind it is dropped */
+  std::deque<Pending> dropped;
+  if (s.in_flight) {
+    dropped.assign(std::make_move_iterator(s.queue.begin() + 1),
+                   std::make_move_iterator(s.queue.end()));
+    s.queue.resize(1);
+  } else {
+    dropped.swap(s.queue);
+    send_next(s);
+  }
+  for (Pending &p : dropped) p.cb(EW_HANDLE, none);
+}
+
+void FocasClient::send_next(Session &s) {
+  if (s.state == State::Closing) {
+    arm(s);
+    send(s, proto::CLOSE_REQ, std::vector<uint8_t>());
+    return;
+  }
+  if (s.queue.empty()) return;
+
+  s.in_flight = true;
+  s.wbuf.insert(s.wbuf.end(), s.queue.front().packet.begin(), s.queue.front().packet.end());
+  s.queue.front().packet.clear();
+  arm(s);
+  flush(s);
+}
+
+void FocasClient::send(Session &s, uint16_t type, const std::vector<uint8_t> &body) {
+  proto::encode_frame(type, body, s.wbuf);
+  flush(s);
+}
+
+void FocasClient::flush(Session &s) {
+  while (s.woff < s.wbuf.size()) {
+    ssize_t n = ::send(s.fd, s.wbuf.data() + s.woff, s.wbuf.size() - s.woff, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      fail(s, EW_SOCKET);
+      return;
+    }
+    s.woff += (size_t)n;
+  }
+  if (s.woff == s.wbuf.size()) {
+    s.wbuf.clear();
+    s.woff = 0;
+  }
+  watch(s, !s.wbuf.empty());
+}
+
+void FocasClient::watch(Session &s, bool writable) {
+  struct epoll_event ev;
+
+  if (s.writable == writable) return;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | (writable ? (uint32_t)EPOLLOUT : 0);
+  ev.data.u64 = s.libh;
+  epoll_ctl(epfd_, EPOLL_CTL_MOD, s.fd, &ev);
+  s.writable = writable;
+}
+
+void FocasClient::on_event(Session &s, uint32_t events) {
+  if (s.state == State::Connecting) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+
+    if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) return;
+    getsockopt(s.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+      fail(s, EW_SOCKET);
+      return;
+    }
+    std::vector<uint8_t> body;
+    proto::Writer w(body);
+    w.u16(OPEN_PROTOCOL);
+    s.state = State::Opening;
+    send(s, proto::OPEN_REQ, body);
+    return;
+  }
+
+  if (events & EPOLLOUT) {
+    unsigned short libh = s.libh;
+    flush(s);
+    auto it = sessions_.find(libh);
+    if (it == sessions_.end() || it->second->fd < 0) return;
+  }
+  if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP))) return;
+
+  uint8_t chunk[16384];
+  for (;;) {
+    ssize_t n = recv(s.fd, chunk, sizeof(chunk), 0);
+    if (n > 0) {
+      s.rbuf.insert(s.rbuf.end(), chunk, chunk + n);
+      if ((size_t)n < sizeof(chunk)) break;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    fail(s, EW_SOCKET); /* reset or closed by the controller */
+    return;
+  }
+
+  size_t off = 0;
+  unsigned short libh = s.libh;
+  for (;;) {
+    proto::Frame frame;
+    long used = proto::decode_frame(s.rbuf.data() + off, s.rbuf.size() - off, frame);
+    if (used == 0) break;
+    if (used < 0) {
+      fail(s, EW_SOCKET);
+      return;
+    }
+    off += (size_t)used;
+    on_frame(s, frame);
+    /* callbacks only post, but a protocol error may have ended the session */
+    auto it = sessions_.find(libh);
+    if (it == sessions_.end() || it->second->fd < 0) return;
+  }
+  s.rbuf.erase(s.rbuf.begin(), s.rbuf.begin() + off);
+}
+
+void FocasClient::on_frame(Session &s, proto::Frame &frame) {
+  if (s.state == State::Opening && frame.type == proto::OPEN_RESP) {
+    ConnectCallback cb = std::move(s.on_connect);
+    s.state = State::Ready;
+    disarm(s);
+    cb(EW_OK, s.libh);
+    send_next(s);
+    return;
+  }
+
+  if (s.in_flight && frame.type == proto::VAR_RESP) {
+    std::vector<proto::SubResponse> resps;
+    if (!proto::decode_responses(frame.body, resps)) {
+      fail(s, EW_SOCKET);
+      return;
+    }
+    Pending p = std::move(s.queue.front());
+    s.queue.pop_front();
+    s.in_flight = false;
+    disarm(s);
+    send_next(s);
+    p.cb(EW_OK, resps);
+    return;
+  }
+
+  if (s.state == State::Closing && frame.type == proto::CLOSE_RESP) {
+    destroy(s);
+    return;
+  }
+
+  fail(s, EW_SOCKET); /* out of sequence */
+}
+
+void FocasClient::arm(Session &s) {
+  disarm(s);
+  if (s.timeout_ms <= 0) return;
+  s.timer = timers_.emplace(now_ms() + (uint64_t)s.timeout_ms, s.libh);
+  s.timer_armed = true;
+}
+
+void FocasClient::disarm(Session &s) {
+  if (!s.timer_armed) return;
+  timers_.erase(s.timer);
+  s.timer_armed = false;
+}
+
+void FocasClient::expire(uint64_t now) {
+  while (!timers_.empty() && timers_.begin()->first <= now) {
+    unsigned short libh = timers_.begin()->second;
+    timers_.erase(timers_.begin());
+
+    auto it = sessions_.find(libh);
+    if (it == sessions_.end()) continue;
+    it->second->timer_armed = false;
+    fail(*it->second, EW_SOCKET);
+  }
+}
+
+int FocasClient::next_timeout(uint64_t now) const {
+  if (timers_.empty()) return -1;
+  uint64_t due = timers_.begin()->first;
+  if (due <= now) return 0;
+  return due - now > 60000 ? 60000 : (int)(due - now);
+}
+
+/*
+ * A failed connect or close releases the handle. A handle that was open stays
+ * allocated, like one from the closed library, and answers EW_SOCKET until the
+ * caller frees it.
+ */
+void FocasClient::fail(Session &s, short ret) {
+  std::vector<proto::SubResponse> none;
+
+  std::deque<Pending> dropped;
+  dropped.swap(s.queue);
+
+  if (s.state != State::Ready) {
+    ConnectCallback cb = std::move(s.on_connect);
+    destroy(s);
+    if (cb) cb(ret, 0);
+    for (Pending &p : dropped) p.cb(ret, none);
+    return;
+  }
+
+  disarm(s);
+  epoll_ctl(epfd_, EPOLL_CTL_DEL, s.fd, NULL);
+  ::close(s.fd);
+  s.fd = -1;
+  s.in_flight = false;
+  s.rbuf.clear();
+  s.wbuf.clear();
+  s.woff = 0;
+  for (Pending &p : dropped) p.cb(ret, none);
+}
+
+void FocasClient::destroy(Session &s) {
+  auto it = sessions_.find(s.libh);
+  if (it == sessions_.end()) return;
+
+  std::unique_ptr<Session> owned = std::move(it->second);
+  sessions_.erase(it);
+  sessions_count_--;
+  disarm(s);
+  if (s.fd >= 0) {
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, s.fd, NULL);
+    ::close(s.fd);
+  }
+  if (s.on_close) s.on_close(EW_OK);
+}
+
+}  // namespace fanuc
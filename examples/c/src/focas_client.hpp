@@ -0,0 +1,116 @@
+#ifndef FW_FOCAS_CLIENT_HPP
+#define FW_FOCAS_CLIENT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./focas_proto.hpp"
+
+namespace fanuc {
+
+/*
+ * Open-source FOCAS2/Ethernet client. A single thread calling run() drives
+ * every connection through epoll: sockets are non-blocking, each connection
+ * has at most one request on the wire (the controller answers in order) and
+ * further requests wait in its queue. connect(), request() and close() may be
+ * called from any thread; callbacks always run on the loop thread and must
+ * not block. Linux only, the address must be an IPv4 literal.
+ */
+class FocasClient {
+ public:
+  using ConnectCallback = std::function<void(short ret, unsigned short libh)>;
+  using RequestCallback = std::function<void(short ret, std::vector<proto::SubResponse> &resps)>;
+  using CloseCallback = std::function<void(short ret)>;
+
+  FocasClient();
+  ~FocasClient();
+
+  FocasClient(const FocasClient &) = delete;
+  FocasClient &operator=(const FocasClient &) = delete;
+
+  /* timeout in seconds like cnc_allclibhndl3, 0 waits forever */
+  void connect(const std::string &ip, unsigned short port, long timeout, ConnectCallback cb);
+  /* one packet carrying every sub-request; EW_HANDLE for unknown handles */
+  void request(unsigned short libh, std::vector<proto::SubRequest> reqs, RequestCallback cb);
+  void set_timeout(unsigned short libh, long timeout, CloseCallback cb = nullptr);
+  /* queued requests fail with EW_HANDLE, the controller is told to close */
+  void close(unsigned short libh, CloseCallback cb = nullptr);
+
+  /* processes events until stop() */
+  void run();
+  void stop();
+
+  /* open connections, including ones still connecting */
+  std::size_t sessions() const { return sessions_count_.load(std::memory_order_relaxed); }
+
+ private:
+  enum class State { Connecting, Opening, Ready, Closing };
+
+  struct Pending {
+    std::vector<uint8_t> packet;
+    RequestCallback cb;
+  };
+
+  struct Session {
+    unsigned short libh = 0;
+    int fd = -1;
+    State state = State::Connecting;
+    long timeout_ms = 0;
+    bool writable = false; /* EPOLLOUT is armed */
+    ConnectCallback on_connect;
+    CloseCallback on_close;
+    std::deque<Pending> queue;
+    bool in_flight = false;
+    std::vector<uint8_t> rbuf;
+    std::vector<uint8_t> wbuf;
+    std::size_t woff = 0;
+    bool timer_armed = false;
+    std::multimap<uint64_t, unsigned short>::iterator timer;
+  };
+
+  void post(std::function<void()> fn);
+  void drain_posted();
+
+  void start_connect(const std::string &ip, unsigned short port, long timeout, ConnectCallback cb);
+  void start_request(unsigned short libh, std::vector<proto::SubRequest> &reqs, RequestCallback &cb);
+  void start_close(unsigned short libh, CloseCallback &cb);
+  void send_next(Session &s);
+  void send(Session &s, uint16_t type, const std::vector<uint8_t> &body);
+  void flush(Session &s);
+  void on_event(Session &s, uint32_t events);
+  void on_frame(Session &s, proto::Frame &frame);
+  void arm(Session &s);
+  void disarm(Session &s);
+  void expire(uint64_t now);
+  int next_timeout(uint64_t now) const;
+  void watch(Session &s, bool writable);
+  void fail(Session &s, short ret);
+  void destroy(Session &s);
+  unsigned short next_handle();
+
+  int epfd_ = -1;
+  int wakefd_ = -1;
+  std::atomic<bool> stop_{false};
+
+  std::mutex posted_lock_;
+  std::vector<std::function<void()>> posted_;
+
+  /* loop thread only */
+  std::unordered_map<unsigned short, std::unique_ptr<Session>> sessions_;
+  std::multimap<uint64_t, unsigned short> timers_;
+  unsigned short last_handle_ = 0;
+  std::atomic<std::size_t> sessions_count_{0};
+};
+
+}  // namespace fanuc
+
+#endif
@@ -0,0 +1,327 @@
+#include <cstddef>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <utility>
+
+#include "./focas_client.hpp"
+
+/*
+ * fwlib32.h signatures on top of FocasClient, built as libfwlib32_open. Every
+ * call blocks its own thread only: the requests of all handles share one
+ * background event loop, so unlike the closed library any number of threads
+ * may call in parallel. Calls must not be made from client callbacks.
+ */
+using fanuc::proto::Reader;
+using fanuc::proto::SubRequest;
+using fanuc::proto::SubResponse;
+namespace proto = fanuc::proto;
+
+namespace {
+
+struct Runtime {
+  fanuc::FocasClient client;
+  std::thread loop;
+
+  Runtime() : loop([this] { client.run(); }) {}
+  ~Runtime() {
+    client.stop();
+    loop.join();
+  }
+};
+
+fanuc::FocasClient &client() {
+  static Runtime runtime;
+  return runtime.client;
+}
+
+SubRequest sub(uint16_t command, int32_t a0 = 0, int32_t a1 = 0, int32_t a2 = 0, int32_t a3 = 0) {
+  SubRequest q;
+  q.command = command;
+  q.args[0] = a0;
+  q.args[1] = a1;
+  q.args[2] = a2;
+  q.args[3] = a3;
+  return q;
+}
+
+/* EW_OK when the answer has n sub-responses and none of them failed */
+short check(const std::vector<SubResponse> &resps, size_t n) {
+  if (resps.size() != n) return EW_FUNC;
+  for (const SubResponse &r : resps) {
+    if (r.error != EW_OK) return r.error;
+  }
+  return EW_OK;
+}
+
+/* decode(resps) -> ret runs on the loop thread while the caller waits */
+template <typename F>
+short call(unsigned short libh, std::vector<SubRequest> reqs, F decode) {
+  std::promise<short> done;
+  std::future<short> result = done.get_future();
+  size_t n = reqs.size();
+
+  client().request(libh, std::move(reqs), [&](short ret, std::vector<SubResponse> &resps) {
+    if (ret == EW_OK) ret = check(resps, n);
+    if (ret == EW_OK) ret = decode(resps);
+    done.set_value(ret);
+  });
+
+  return result.get();
+}
+
+long get_long(const SubResponse &r) {
+  Reader rd(r.data);
+  return rd.i32();
+}
+
+/* fills up to max values, returns how many the controller sent */
+short get_longs(const SubResponse &r, long *out, short max) {
+  Reader rd(r.data);
+  short n = 0;
+
+  while (n < max && rd.left() >= 4) out[n++] = rd.i32();
+  return n;
+}
+
+}  // namespace
+
+namespace Fwlib32 {
+
+#ifndef _WIN32
+short cnc_startupprocess(long level, const char *filename) {
+  (void)level;
+  (void)filename;
+  client();
+  return EW_OK;
+}
+
+short cnc_exitprocess() { return EW_OK; }
+#endif
+
+short cnc_allclibhndl3(const char *ip, unsigned short port, long timeout, unsigned short *libh) {
+  std::promise<short> done;
+  std::future<short> result = done.get_future();
+
+  client().connect(ip, port, timeout, [&](short ret, unsigned short h) {
+    *libh = h;
+    done.set_value(ret);
+  });
+
+  return result.get();
+}
+
+short cnc_freelibhndl(unsigned short libh) {
+  std::promise<short> done;
+  std::future<short> result = done.get_future();
+
+  client().close(libh, [&](short ret) { done.set_value(ret); });
+  return result.get();
+}
+
+short cnc_settimeout(unsigned short libh, long timeout) {
+  std::promise<short> done;
+  std::future<short> result = done.get_future();
+
+  client().set_timeout(libh, timeout, [&](short ret) { done.set_value(ret); });
+  return result.get();
+}
+
+/* the examples pass uint32_t[4], so that is what is written */
+short cnc_rdcncid(unsigned short libh, unsigned long *cncid) {
+  return call(libh, {sub(proto::CMD_CNCID)}, [&](std::vector<SubResponse> &r) -> short {
+    uint32_t ids[4];
+    if (!proto::get_cncid(r[0].data, ids)) return EW_FUNC;
+    memcpy(cncid, ids, sizeof(ids));
+    return EW_OK;
+  });
+}
+
+short cnc_statinfo(unsigned short libh, ODBST *statinfo) {
+  return call(libh, {sub(proto::CMD_STATINFO)}, [&](std::vector<SubResponse> &r) -> short {
+    return proto::get_status(r[0].data, *statinfo) ? EW_OK : EW_FUNC;
+  });
+}
+
+/* one packet with 9 sub-requests instead of the closed library's several */
+short cnc_rddynamic2(unsigned short libh, short axis, short length, ODBDY2 *dynamic) {
+  if (length < 0 || (axis != ALL_AXES && (axis < 1 || axis > MAX_AXIS))) return EW_ATTRIB;
+
+  std::vector<SubRequest> reqs = {sub(proto::CMD_ALARM), sub(proto::CMD_PRGNUM),
+                                  sub(proto::CMD_SEQNUM), sub(proto::CMD_ACTF),
+                                  sub(proto::CMD_ACTS)};
+  for (int32_t t = proto::POS_ABSOLUTE; t <= proto::POS_DISTANCE; t++) {
+    reqs.push_back(sub(proto::CMD_POSITION, t, axis));
+  }
+
+  return call(libh, std::move(reqs), [&](std::vector<SubResponse> &r) -> short {
+    ODBDY2 out;
+    Reader prg(r[1].data);
+    short n = 1;
+
+    memset(&out, 0, sizeof(out));
+    out.alarm = get_long(r[0]);
+    out.prgnum = prg.i32();
+    out.prgmnum = prg.i32();
+    out.seqnum = get_long(r[2]);
+    out.actf = get_long(r[3]);
+    out.acts = get_long(r[4]);
+    if (axis == ALL_AXES) {
+      n = get_longs(r[5], out.pos.faxis.absolute, MAX_AXIS);
+      get_longs(r[6], out.pos.faxis.machine, MAX_AXIS);
+      get_longs(r[7], out.pos.faxis.relative, MAX_AXIS);
+      get_longs(r[8], out.pos.faxis.distance, MAX_AXIS);
+    } else {
+      out.pos.oaxis.absolute = get_long(r[5]);
+      out.pos.oaxis.machine = get_long(r[6]);
+      out.pos.oaxis.relative = get_long(r[7]);
+      out.pos.oaxis.distance = get_long(r[8]);
+    }
+    out.axis = axis == ALL_AXES ? n : axis;
+    memcpy(dynamic, &out, (size_t)length < sizeof(out) ? (size_t)length : sizeof(out));
+    return EW_OK;
+  });
+}
+
+short cnc_rdspeed(unsigned short libh, short type, ODBSPEED *speed) {
+  if (type < -1 || type > 1) return EW_ATTRIB;
+
+  return call(libh, {sub(proto::CMD_SPEED, type)}, [&](std::vector<SubResponse> &r) -> short {
+    Reader rd(r[0].data);
+    if (type != 1 && !proto::get_speed(rd, speed->actf)) return EW_FUNC;
+    if (type != 0 && !proto::get_speed(rd, speed->acts)) return EW_FUNC;
+    return EW_OK;
+  });
+}
+
+short cnc_rdspload(unsigned short libh, short sp_no, ODBSPN *serialspindle) {
+  return call(libh, {sub(proto::CMD_SPLOAD, sp_no)}, [&](std::vector<SubResponse> &r) -> short {
+    Reader rd(r[0].data);
+    memset(serialspindle, 0, sizeof(ODBSPN));
+    serialspindle->datano = sp_no;
+    for (int i = 0; i < MAX_SPINDLE && rd.left() >= 2; i++) serialspindle->data[i] = rd.i16();
+    return EW_OK;
+  });
+}
+
+short cnc_rdgcode(unsigned short libh, short type, short block, short *num, ODBGCD *gcode) {
+  if (*num <= 0) return EW_LENGTH;
+
+  return call(libh, {sub(proto::CMD_GCODE, type, block, *num)},
+              [&](std::vector<SubResponse> &r) -> short {
+                *num = proto::get_gcodes(r[0].data, gcode, *num);
+                return EW_OK;
+              });
+}
+
+short cnc_modal(unsigned short libh, short type, short block, ODBMDL *modal) {
+  return call(libh, {sub(proto::CMD_MODAL, type, block)}, [&](std::vector<SubResponse> &r) -> short {
+    return proto::get_modal(r[0].data, *modal) ? EW_OK : EW_FUNC;
+  });
+}
+
+/* type 0: numbers, 1: with comments, 2: with comments and lengths */
+short cnc_rdprogdir3(unsigned short libh, short type, long *top_prog, short *num_prog,
+                     PRGDIR3 *buf) {
+  if (type < 0 || type > 2) return EW_ATTRIB;
+  if (*num_prog <= 0) return EW_LENGTH;
+
+  return call(libh, {sub(proto::CMD_PRGDIR, (int32_t)*top_prog, *num_prog, type)},
+              [&](std::vector<SubResponse> &r) -> short {
+                *num_prog = proto::get_prgdir(r[0].data, buf, *num_prog);
+                for (short i = 0; i < *num_prog; i++) {
+                  if (type < 1) memset(buf[i].comment, 0, sizeof(buf[i].comment));
+                  if (type < 2) buf[i].length = 0;
+                }
+                return EW_OK;
+              });
+}
+
+/* length covers the 8 byte header plus the values, like the closed library */
+short pmc_rdpmcrng(unsigned short libh, short adr_type, short data_type, unsigned short s_number,
+                   unsigned short e_number, unsigned short length, IODBPMC *buf) {
+  size_t header = offsetof(IODBPMC, u);
+  size_t width = proto::pmc_width(data_type);
+  size_t elem = data_type == 2 ? sizeof(long) : width;
+
+  if (width == 0) return EW_TYPE;
+  if (e_number < s_number) return EW_NUMBER;
+  size_t count = (e_number - s_number) / width + 1;
+  if (length < header + count * elem) return EW_LENGTH;
+
+  SubRequest q = sub(proto::CMD_PMC_READ, s_number, e_number, adr_type, data_type);
+  q.ncpmc = proto::TARGET_PMC;
+
+  return call(libh, {q}, [&](std::vector<SubResponse> &r) -> short {
+    buf->type_a = adr_type;
+    buf->type_d = data_type;
+    buf->datano_s = s_number;
+    buf->datano_e = e_number;
+    proto::get_pmc(r[0].data, data_type, (char *)buf + header, count);
+    return EW_OK;
+  });
+}
+
+
+/* length covers the 8 byte header plus the values, as for pmc_rdpmcrng */
+short pmc_wrpmcrng(unsigned short libh, unsigned short length, IODBPMC *buf) {
+  size_t header = offsetof(IODBPMC, u);
+  size_t width = proto::pmc_width(buf->type_d);
+  size_t elem = buf->type_d == 2 ? sizeof(long) : width;
+
+  if (width == 0) return EW_TYPE;
+  if ((unsigned short)buf->datano_e < (unsigned short)buf->datano_s) return EW_NUMBER;
+  size_t count = ((unsigned short)buf->datano_e - (unsigned short)buf->datano_s) / width + 1;
+  if (length < header + count * elem) return EW_LENGTH;
+
+  SubRequest q = sub(proto::CMD_PMC_WRITE, (unsigned short)buf->datano_s, (unsigned short)buf->datano_e,
+                     buf->type_a, buf->type_d);
+  q.ncpmc = proto::TARGET_PMC;
+  proto::put_pmc(q.payload, buf->type_d, (const char *)buf + header, count);
+
+  return call(libh, {q}, [](std::vector<SubResponse> &) -> short { return EW_OK; });
+}
+
+/*
+ * every entry is a sub-request of one frame. length counts PMC bytes, data
+ * holds the values in the host types of IODBPMC.u. An entry the controller
+ * rejects gets the error in err_code while the others are still done, the call
+ * then returns EW_DATA.
+ */
+short pmc_rdwrpmcrng(unsigned short libh, short num, IODBRWPMC *buf) {
+  std::vector<SubRequest> reqs;
+
+  if (num <= 0) return EW_LENGTH;
+  for (short i = 0; i < num; i++) {
+    const IODBRWPMC &e = buf[i];
+    size_t width = proto::pmc_width(e.type_d);
+    if (e.type_rw != 0 && e.type_rw != 1) return EW_ATTRIB;
+    if (width == 0) return EW_TYPE;
+    if (e.length <= 0 || (size_t)e.length % width != 0) return EW_LENGTH;
+
+    SubRequest q = sub(e.type_rw == 0 ? proto::CMD_PMC_READ : proto::CMD_PMC_WRITE, e.datano_s,
+                       e.datano_s + e.length - 1, e.type_a, e.type_d);
+    q.ncpmc = proto::TARGET_PMC;
+    if (e.type_rw == 1) proto::put_pmc(q.payload, e.type_d, e.data, e.length / width);
+    reqs.push_back(std::move(q));
+  }
+
+  std::promise<short> done;
+  std::future<short> result = done.get_future();
+  client().request(libh, std::move(reqs), [&](short ret, std::vector<SubResponse> &resps) {
+    if (ret == EW_OK && resps.size() != (size_t)num) ret = EW_FUNC;
+    for (short i = 0; ret == EW_OK && i < num; i++) {
+      buf[i].err_code = resps[i].error;
+      if (buf[i].type_rw == 0 && resps[i].error == EW_OK)
+        proto::get_pmc(resps[i].data, buf[i].type_d, buf[i].data,
+                       buf[i].length / proto::pmc_width(buf[i].type_d));
+    }
+    for (short i = 0; ret == EW_OK && i < num; i++) {
+      if (buf[i].err_code != EW_OK) ret = EW_DATA;
+    }
+    done.set_value(ret);
+  });
+  return result.get();
+}
+
+}  // namespace Fwlib32
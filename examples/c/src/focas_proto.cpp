@@ -0,0 +1,436 @@
+#include "./focas_proto.hpp"
+
+#include <cstring>
+
+namespace fanuc {
+namespace proto {
+
+const size_t SUBREQ_HEADER = 28;
+const size_t SUBRESP_HEADER = 16;
+
+void Writer::u16(uint16_t v) {
+  out_.push_back((uint8_t)(v >> 8));
+  out_.push_back((uint8_t)v);
+}
+
+void Writer::u32(uint32_t v) {
+  u16((uint16_t)(v >> 16));
+  u16((uint16_t)v);
+}
+
+void Writer::bytes(const void *p, size_t n) {
+  const uint8_t *b = (const uint8_t *)p;
+  out_.insert(out_.end(), b, b + n);
+}
+
+bool Reader::need(size_t n) {
+  if (!ok_ || n_ - pos_ < n) {
+    ok_ = false;
+    return false;
+  }
+  return true;
+}
+
+uint8_t Reader::u8() {
+  if (!need(1)) return 0;
+  return p_[pos_++];
+}
+
+uint16_t Reader::u16() {
+  if (!need(2)) return 0;
+  uint16_t v = (uint16_t)((p_[pos_] << 8) | p_[pos_ + 1]);
+  pos_ += 2;
+  return v;
+}
+
+uint32_t Reader::u32() {
+  uint32_t hi = u16();
+  return (hi << 16) | u16();
+}
+
+void Reader::bytes(void *p, size_t n) {
+  if (!need(n)) return;
+  memcpy(p, p_ + pos_, n);
+  pos_ += n;
+}
+
+void Reader::skip(size_t n) {
+  if (need(n)) pos_ += n;
+}
+
+void encode_frame(uint16_t type, const std::vector<uint8_t> &body, std::vector<uint8_t> &out) {
+  Writer w(out);
+  w.u32(MAGIC);
+  w.u16(VERSION);
+  w.u16(type);
+  w.u16((uint16_t)body.size());
+  w.bytes(body.data(), body.size());
+}
+
+long decode_frame(const uint8_t *p, size_t n, Frame &frame) {
+  if (n < HEADER_SIZE) {
+    /* reject garbage early instead of waiting for a full header */
+    for (size_t i = 0; i < n && i < 4; i++) {
+      if (p[i] != 0xa0) return -1;
+    }
+    return 0;
+  }
+
+  Reader r(p, n);
+  if (r.u32() != MAGIC) return -1;
+  frame.version = r.u16();
+  frame.type = r.u16();
+  size_t length = r.u16();
+  if (n - HEADER_SIZE < length) return 0;
+  frame.body.assign(p + HEADER_SIZE, p + HEADER_SIZE + length);
+
+  return (long)(HEADER_SIZE + length);
+}
+
+std::vector<uint8_t> encode_requests(const std::vector<SubRequest> &reqs) {
+  std::vector<uint8_t> body;
+  Writer w(body);
+
+  w.u16((uint16_t)reqs.size());
+  for (const SubRequest &q : reqs) {
+    w.u16((uint16_t)(SUBREQ_HEADER + q.payload.size()));
+    w.u16(q.ncpmc);
+    w.u16(q.group);
+    w.u16(q.command);
+    for (int32_t a : q.args) w.i32(a);
+    w.bytes(q.payload.data(), q.payload.size());
+  }
+
+  return body;
+}
+
+bool decode_requests(const std::vector<uint8_t> &body, std::vector<SubRequest> &reqs) {
+  Reader r(body);
+  uint16_t count = r.u16();
+
+  reqs.clear();
+  for (uint16_t i = 0; i < count && r.ok(); i++) {
+    SubRequest q;
+    size_t length = r.u16();
+    if (length < SUBREQ_HEADER) return false;
+    q.ncpmc = r.u16();
+    q.group = r.u16();
+    q.command = r.u16();
+    for (int32_t &a : q.args) a = r.i32();
+    q.payload.resize(length - SUBREQ_HEADER);
+    r.bytes(q.payload.data(), q.payload.size());
+    reqs.push_back(std::move(q));
+  }
+
+  return r.ok() && r.left() == 0;
+}
+
+std::vector<uint8_t> encode_responses(const std::vector<SubResponse> &resps) {
+  std::vector<uint8_t> body;
+  Writer w(body);
+
+  w.u16((uint16_t)resps.size());
+  for (const SubResponse &s : resps) {
+    w.u16((uint16_t)(SUBRESP_HEADER + s.data.size()));
+    w.u16(s.ncpmc);
+    w.u16(s.group);
+    w.u16(s.command);
+    w.i16(s.error);
+    w.zeros(4);
+    w.u16((uint16_t)s.data.size());
+    w.bytes(s.data.data(), s.data.size());
+  }
+
+  return body;
+}
+
+bool decode_responses(const std::vector<uint8_t> &body, std::vector<SubResponse> &resps) {
+  Reader r(body);
+  uint16_t count = r.u16();
+
+  resps.clear();
+  for (uint16_t i = 0; i < count && r.ok(); i++) {
+    SubResponse s;
+    size_t length = r.u16();
+    s.ncpmc = r.u16();
+    s.group = r.u16();
+    s.command = r.u16();
+    s.error = r.i16();
+    r.skip(4);
+    size_t size = r.u16();
+    if (length != SUBRESP_HEADER + size) return false;
+    s.data.resize(size);
+    r.bytes(s.data.data(), size);
+    resps.push_back(std::move(s));
+  }
+
+  return r.ok() && r.left() == 0;
+}
+
+void put_cncid(std::vector<uint8_t> &out, const uint32_t ids[4]) {
+  Writer w(out);
+  for (int i = 0; i < 4; i++) w.u32(ids[i]);
+}
+
+bool get_cncid(const std::vector<uint8_t> &data, uint32_t ids[4]) {
+  Reader r(data);
+  for (int i = 0; i < 4; i++) ids[i] = r.u32();
+  return r.ok();
+}
+
+void put_status(std::vector<uint8_t> &out, const ODBST &st) {
+  Writer w(out);
+  w.i16(st.hdck);
+  w.i16(st.tmmode);
+  w.i16(st.aut);
+  w.i16(st.run);
+  w.i16(st.motion);
+  w.i16(st.mstb);
+  w.i16(st.emergency);
+  w.i16(st.alarm);
+  w.i16(st.edit);
+}
+
+bool get_status(const std::vector<uint8_t> &data, ODBST &st) {
+  Reader r(data);
+  st.hdck = r.i16();
+  st.tmmode = r.i16();
+  st.aut = r.i16();
+  st.run = r.i16();
+  st.motion = r.i16();
+  st.mstb = r.i16();
+  st.emergency = r.i16();
+  st.alarm = r.i16();
+  st.edit = r.i16();
+  return r.ok();
+}
+
+void put_speed(std::vector<uint8_t> &out, const SPEEDELM &e) {
+  Writer w(out);
+  w.i32((int32_t)e.data);
+  w.i16(e.dec);
+  w.i16(e.unit);
+  w.i16(e.reserve);
+  w.u8((uint8_t)e.name);
+  w.u8((uint8_t)e.suff);
+}
+
+bool get_speed(Reader &r, SPEEDELM &e) {
+  e.data = r.i32();
+  e.dec = r.i16();
+  e.unit = r.i16();
+  e.reserve = r.i16();
+  e.name = (char)r.u8();
+  e.suff = (char)r.u8();
+  return r.ok();
+}
+
+void put_gcodes(std::vector<uint8_t> &out, const ODBGCD *codes, short n) {
+  Writer w(out);
+  for (short i = 0; i < n; i++) {
+    w.i16(codes[i].group);
+    w.i16(codes[i].flag);
+    w.bytes(codes[i].code, sizeof(codes[i].code));
+  }
+}
+
+short get_gcodes(const std::vector<uint8_t> &data, ODBGCD *codes, short max) {
+  Reader r(data);
+  short n = 0;
+
+  while (n < max && r.left() >= 12) {
+    codes[n].group = r.i16();
+    codes[n].flag = r.i16();
+    r.bytes(codes[n].code, sizeof(codes[n].code));
+    n++;
+  }
+
+  return n;
+}
+
+void put_prgdir(std::vector<uint8_t> &out, const PRGDIR3 *dir, short n) {
+  Writer w(out);
+  for (short i = 0; i < n; i++) {
+    w.i32((int32_t)dir[i].number);
+    w.i32((int32_t)dir[i].length);
+    w.bytes(dir[i].comment, sizeof(dir[i].comment));
+  }
+}
+
+short get_prgdir(const std::vector<uint8_t> &data, PRGDIR3 *dir, short max) {
+  const size_t size = 8 + sizeof(dir[0].comment);
+  Reader r(data);
+  short n = 0;
+
+  while (n < max && r.left() >= size) {
+    memset(&dir[n], 0, sizeof(dir[n]));
+    dir[n].number = r.i32();
+    dir[n].length = r.i32();
+    r.bytes(dir[n].comment, sizeof(dir[n].comment));
+    n++;
+  }
+
+  return n;
+}
+
+/* which member of ODBMDL.modal a cnc_modal type fills, and how many of it */
+static size_t modal_layout(short type, bool &aux) {
+  ODBMDL m;
+
+  aux = false;
+  if ((type >= 0 && type <= 20) || type == 300) return 1;
+  if (type == -1) return sizeof(m.modal.g_rdata);
+  if (type == -4) return sizeof(m.modal.g_1shot);
+  aux = true;
+  if (type == -2) return sizeof(m.modal.raux1) / sizeof(m.modal.raux1[0]);
+  if (type == -3) return sizeof(m.modal.raux2) / sizeof(m.modal.raux2[0]);
+  return 1; /* 100..126, 200..207 */
+}
+
+/* aux, raux1 and raux2 are different anonymous structs with the same layout */
+template <typename E>
+static void put_aux(Writer &w, const E *e, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    w.i32((int32_t)e[i].aux_data);
+    w.u8((uint8_t)e[i].flag1);
+    w.u8((uint8_t)e[i].flag2);
+  }
+}
+
+template <typename E>
+static void get_aux(Reader &r, E *e, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    e[i].aux_data = r.i32();
+    e[i].flag1 = (char)r.u8();
+    e[i].flag2 = (char)r.u8();
+  }
+}
+
+void put_modal(std::vector<uint8_t> &out, const ODBMDL &mdl) {
+  Writer w(out);
+  bool aux;
+  size_t n = modal_layout(mdl.type, aux);
+
+  w.i16(mdl.datano);
+  w.i16(mdl.type);
+  if (!aux) {
+    w.bytes(mdl.modal.g_rdata, n);
+    return;
+  }
+  if (mdl.type == -3)
+    put_aux(w, mdl.modal.raux2, n);
+  else if (mdl.type == -2)
+    put_aux(w, mdl.modal.raux1, n);
+  else
+    put_aux(w, &mdl.modal.aux, n);
+}
+
+bool get_modal(const std::vector<uint8_t> &data, ODBMDL &mdl) {
+  Reader r(data);
+  bool aux;
+
+  memset(&mdl, 0, sizeof(mdl));
+  mdl.datano = r.i16();
+  mdl.type = r.i16();
+  if (!r.ok()) return false;
+  size_t n = modal_layout(mdl.type, aux);
+  if (!aux) {
+    r.bytes(mdl.modal.g_rdata, n);
+    return r.ok();
+  }
+  if (mdl.type == -3)
+    get_aux(r, mdl.modal.raux2, n);
+  else if (mdl.type == -2)
+    get_aux(r, mdl.modal.raux1, n);
+  else
+    get_aux(r, &mdl.modal.aux, n);
+  return r.ok();
+}
+
+size_t pmc_width(short data_type) {
+  switch (data_type) {
+    case 0:
+      return 1;
+    case 1:
+      return 2;
+    case 2:
+    case 4:
+      return 4;
+    case 5:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+/*
+ * values are in the layout of IODBPMC.u for data_type: char, short, long
+ * (8 bytes on LP64), float or double. On the wire they are 1/2/4/4/8 bytes.
+ */
+void put_pmc(std::vector<uint8_t> &out, short data_type, const void *values, size_t count) {
+  Writer w(out);
+
+  for (size_t i = 0; i < count; i++) {
+    switch (data_type) {
+      case 0:
+        w.u8(((const uint8_t *)values)[i]);
+        break;
+      case 1:
+        w.i16(((const short *)values)[i]);
+        break;
+      case 2:
+        w.i32((int32_t)((const long *)values)[i]);
+        break;
+      case 4: {
+        uint32_t bits;
+        memcpy(&bits, &((const float *)values)[i], 4);
+        w.u32(bits);
+        break;
+      }
+      case 5: {
+        uint64_t bits;
+        memcpy(&bits, &((const double *)values)[i], 8);
+        w.u32((uint32_t)(bits >> 32));
+        w.u32((uint32_t)bits);
+        break;
+      }
+    }
+  }
+}
+
+size_t get_pmc(const std::vector<uint8_t> &data, short data_type, void *values, size_t max) {
+  size_t width = pmc_width(data_type);
+  Reader r(data);
+  size_t n = 0;
+
+  if (width == 0) return 0;
+  for (; n < max && r.left() >= width; n++) {
+    switch (data_type) {
+      case 0:
+        ((uint8_t *)values)[n] = r.u8();
+        break;
+      case 1:
+        ((short *)values)[n] = r.i16();
+        break;
+      case 2:
+        ((long *)values)[n] = r.i32();
+        break;
+      case 4: {
+        uint32_t bits = r.u32();
+        memcpy(&((float *)values)[n], &bits, 4);
+        break;
+      }
+      case 5: {
+        uint64_t bits = (uint64_t)r.u32() << 32;
+        bits |= r.u32();
+        memcpy(&((double *)values)[n], &bits, 8);
+        break;
+      }
+    }
+  }
+
+  return n;
+}
+
+}  // namespace proto
+}  // namespace fanuc
@@ -0,0 +1,158 @@
+#ifndef FW_FOCAS_PROTO_HPP
+#define FW_FOCAS_PROTO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fwlib32.h"
+
+/*
+ * FOCAS2 Ethernet framing (TCP 8193) as seen on the wire:
+ *
+ *   a0 a0 a0 a0 | version:2 | type:2 | length:2 | body[length]
+ *
+ * every integer is big endian. A variable request body is a count followed by
+ * that many 28 byte sub-requests (length:2 ncpmc:2 group:2 command:2 args:5*4,
+ * plus optional payload); a response body mirrors it with error code and data.
+ * Command codes and payload layouts come from packet captures, not from FANUC
+ * documentation, and have only been checked against fanuc_sim.
+ */
+namespace fanuc {
+namespace proto {
+
+const uint32_t MAGIC = 0xa0a0a0a0;
+const uint16_t VERSION = 1;
+const size_t HEADER_SIZE = 10;
+const size_t MAX_BODY = 0xffff;
+
+enum FrameType : uint16_t {
+  OPEN_REQ = 0x0101,
+  OPEN_RESP = 0x0102,
+  CLOSE_REQ = 0x0201,
+  CLOSE_RESP = 0x0202,
+  VAR_REQ = 0x2101,
+  VAR_RESP = 0x2102,
+};
+
+/* ncpmc of a sub-request */
+const uint16_t TARGET_CNC = 1;
+const uint16_t TARGET_PMC = 2;
+
+enum Command : uint16_t {
+  CMD_SYSINFO = 0x0018,
+  CMD_STATINFO = 0x0019,
+  CMD_ALARM = 0x001a,
+  CMD_PRGNUM = 0x001c,
+  CMD_SEQNUM = 0x001d,
+  CMD_MODAL = 0x0020,
+  CMD_ACTF = 0x0024,
+  CMD_ACTS = 0x0025,
+  CMD_POSITION = 0x0026, /* arg0 = POS_*, arg1 = axis or ALL_AXES */
+  CMD_GCODE = 0x0030,
+  CMD_SPLOAD = 0x0040,   /* arg0 = spindle or -1 */
+  CMD_CNCID = 0x0090,
+  CMD_SPEED = 0x00a4,
+  CMD_PRGDIR = 0x00b0,   /* arg0 first program number, arg1 max entries */
+  CMD_PMC_READ = 0x8001, /* TARGET_PMC: arg0 start, arg1 end, arg2 adr_type, arg3 data_type */
+  CMD_PMC_WRITE = 0x8002, /* same args, values as payload */
+};
+
+enum PositionType { POS_ABSOLUTE = 0, POS_MACHINE = 1, POS_RELATIVE = 2, POS_DISTANCE = 3 };
+
+struct Frame {
+  uint16_t version = VERSION;
+  uint16_t type = 0;
+  std::vector<uint8_t> body;
+};
+
+struct SubRequest {
+  uint16_t ncpmc = TARGET_CNC;
+  uint16_t group = 1;
+  uint16_t command = 0;
+  int32_t args[5] = {0, 0, 0, 0, 0};
+  std::vector<uint8_t> payload;
+};
+
+struct SubResponse {
+  uint16_t ncpmc = TARGET_CNC;
+  uint16_t group = 1;
+  uint16_t command = 0;
+  int16_t error = EW_OK;
+  std::vector<uint8_t> data;
+};
+
+/* appends big endian values */
+class Writer {
+ public:
+  explicit Writer(std::vector<uint8_t> &out) : out_(out) {}
+  void u8(uint8_t v) { out_.push_back(v); }
+  void u16(uint16_t v);
+  void u32(uint32_t v);
+  void i16(int16_t v) { u16((uint16_t)v); }
+  void i32(int32_t v) { u32((uint32_t)v); }
+  void bytes(const void *p, size_t n);
+  void zeros(size_t n) { out_.insert(out_.end(), n, 0); }
+
+ private:
+  std::vector<uint8_t> &out_;
+};
+
+/* reads big endian values, ok() turns false on the first short read */
+class Reader {
+ public:
+  Reader(const uint8_t *p, size_t n) : p_(p), n_(n) {}
+  explicit Reader(const std::vector<uint8_t> &v) : p_(v.data()), n_(v.size()) {}
+  uint8_t u8();
+  uint16_t u16();
+  uint32_t u32();
+  int16_t i16() { return (int16_t)u16(); }
+  int32_t i32() { return (int32_t)u32(); }
+  void bytes(void *p, size_t n);
+  void skip(size_t n);
+  size_t left() const { return n_ - pos_; }
+  bool ok() const { return ok_; }
+
+ private:
+  bool need(size_t n);
+  const uint8_t *p_;
+  size_t n_;
+  size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+void encode_frame(uint16_t type, const std::vector<uint8_t> &body, std::vector<uint8_t> &out);
+/* > 0: bytes consumed into frame, 0: need more data, < 0: not a FOCAS stream */
+long decode_frame(const uint8_t *p, size_t n, Frame &frame);
+
+std::vector<uint8_t> encode_requests(const std::vector<SubRequest> &reqs);
+bool decode_requests(const std::vector<uint8_t> &body, std::vector<SubRequest> &reqs);
+std::vector<uint8_t> encode_responses(const std::vector<SubResponse> &resps);
+bool decode_responses(const std::vector<uint8_t> &body, std::vector<SubResponse> &resps);
+
+/*
+ * Payload codecs, shared by the client (get_*) and the simulator (put_*).
+ * get_* return false when the data is shorter than the layout requires.
+ */
+void put_cncid(std::vector<uint8_t> &out, const uint32_t ids[4]);
+bool get_cncid(const std::vector<uint8_t> &data, uint32_t ids[4]);
+void put_status(std::vector<uint8_t> &out, const ODBST &st);
+bool get_status(const std::vector<uint8_t> &data, ODBST &st);
+void put_speed(std::vector<uint8_t> &out, const SPEEDELM &e);
+bool get_speed(Reader &r, SPEEDELM &e);
+void put_gcodes(std::vector<uint8_t> &out, const ODBGCD *codes, short n);
+short get_gcodes(const std::vector<uint8_t> &data, ODBGCD *codes, short max);
+void put_modal(std::vector<uint8_t> &out, const ODBMDL &mdl);
+bool get_modal(const std::vector<uint8_t> &data, ODBMDL &mdl);
+/* program directory entries: number, length, 52 byte comment */
+void put_prgdir(std::vector<uint8_t> &out, const PRGDIR3 *dir, short n);
+short get_prgdir(const std::vector<uint8_t> &data, PRGDIR3 *dir, short max);
+/* PMC values in data_type width (0 byte, 1 word, 2 long, 4 float, 5 double) */
+size_t pmc_width(short data_type);
+void put_pmc(std::vector<uint8_t> &out, short data_type, const void *values, size_t count);
+size_t get_pmc(const std::vector<uint8_t> &data, short data_type, void *values, size_t max);
+
+}  // namespace proto
+}  // namespace fanuc
+
+#endif
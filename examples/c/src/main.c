@@ -3,6 +3,8 @@
 #include <string.h>
 
 #include "./config.c"
+#include "./metadata.c"
+#include "./pool.c"
 #include "./util.c"
 #include "fwlib32.h"
 
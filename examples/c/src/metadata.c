@@ -0,0 +1,50 @@
+#include "./metadata.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+short read_cnc_id(unsigned short libh, char *cnc_id) {
+  uint32_t cnc_ids[4];
+  short ret;
+
+  if ((ret = cnc_rdcncid(libh, (unsigned long *)cnc_ids)) != EW_OK) {
+    return ret;
+  }
+
+  snprintf(cnc_id, 40, "%08x-%08x-%08x-%08x", cnc_ids[0], cnc_ids[1],
+           cnc_ids[2], cnc_ids[3]);
+
+  return EW_OK;
+}
+
+/*
+ * Read everything in Metadata with one round trip each. The id is required;
+ * the rest is left zeroed when the controller does not support the call, but
+ * a transport error aborts so a half loaded cache is never marked loaded.
+ */
+short metadata_load(unsigned short libh, Metadata *meta) {
+  short ret;
+
+  memset(meta, 0, sizeof(Metadata));
+  if ((ret = read_cnc_id(libh, meta->cnc_id)) != EW_OK) return ret;
+
+  ret = cnc_sysinfo(libh, &meta->sysinfo);
+  if (ret == EW_SOCKET || ret == EW_HANDLE) return ret;
+
+  ret = cnc_rdsyssoft(libh, &meta->syssoft);
+  if (ret == EW_SOCKET || ret == EW_HANDLE) return ret;
+
+  meta->naxes = MAX_AXIS;
+  ret = cnc_rdaxisname(libh, &meta->naxes, meta->axes);
+  if (ret == EW_SOCKET || ret == EW_HANDLE) return ret;
+  if (ret != EW_OK) meta->naxes = 0;
+
+  meta->nspindles = MAX_SPINDLE;
+  ret = cnc_rdspdlname(libh, &meta->nspindles, meta->spindles);
+  if (ret == EW_SOCKET || ret == EW_HANDLE) return ret;
+  if (ret != EW_OK) meta->nspindles = 0;
+
+  meta->loaded = 1;
+  return EW_OK;
+}
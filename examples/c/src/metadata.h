@@ -0,0 +1,21 @@
+#ifndef FW_METADATA_H
+#define FW_METADATA_H
+
+#include "fwlib32.h"
+
+/* data that does not change while a connection is open */
+typedef struct metadata {
+  int loaded;
+  char cnc_id[40];
+  ODBSYS sysinfo;
+  ODBSYSS syssoft;
+  short naxes;
+  ODBAXISNAME axes[MAX_AXIS];
+  short nspindles;
+  ODBSPDLNAME spindles[MAX_SPINDLE];
+} Metadata;
+
+short read_cnc_id(unsigned short libh, char *cnc_id);
+short metadata_load(unsigned short libh, Metadata *meta);
+
+#endif
@@ -0,0 +1,232 @@
+#include "./paths.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATHS_TRANSPORT(ret) ((ret) == EW_SOCKET || (ret) == EW_HANDLE)
+
+/* all pending reads of one path */
+struct path_group {
+  PathScheduler *sched;
+  PathRead *reads;
+  int *order; /* indices into reads */
+  int count;
+  PathSnapshot *snap;
+  int switches;
+};
+
+void paths_init(PathScheduler *s, const char *ip, unsigned short port,
+                long timeout, int parallel) {
+  memset(s, 0, sizeof(PathScheduler));
+  snprintf(s->ip, sizeof(s->ip), "%s", ip);
+  s->port = port;
+  s->timeout = timeout;
+  s->parallel = parallel;
+}
+
+void paths_close(PathScheduler *s) {
+  int p;
+
+  if (s->connected && cnc_freelibhndl(s->libh) != EW_OK)
+    fprintf(stderr, "Failed to free library handle!\n");
+  s->connected = 0;
+  for (p = 1; p <= PATHS_MAX; p++) {
+    if (s->open[p] && cnc_freelibhndl(s->handles[p]) != EW_OK)
+      fprintf(stderr, "Failed to free library handle!\n");
+    s->open[p] = 0;
+  }
+}
+
+static void paths_fail(struct path_group *g, short ret) {
+  int i;
+
+  for (i = 0; i < g->count; i++) {
+    g->reads[g->order[i]].ret = ret;
+  }
+  g->snap->failed = g->count;
+  g->snap->done_ms = fw_now_ms();
+}
+
+/* returns the first transport error seen, EW_OK otherwise */
+static short paths_run(struct path_group *g, unsigned short libh) {
+  short lost = EW_OK;
+  PathRead *r;
+  int i;
+
+  for (i = 0; i < g->count; i++) {
+    r = &g->reads[g->order[i]];
+    if (lost != EW_OK) {
+      r->ret = lost;
+    } else {
+      r->ret = r->fn(libh, r->arg);
+      if (PATHS_TRANSPORT(r->ret)) lost = r->ret;
+    }
+    if (r->ret != EW_OK) g->snap->failed++;
+  }
+  g->snap->done_ms = fw_now_ms();
+
+  return lost;
+}
+
+/* parallel mode: every path owns a handle that keeps its path selected */
+static void *paths_worker(void *arg) {
+  struct path_group *g = (struct path_group *)arg;
+  PathScheduler *s = g->sched;
+  short path = g->snap->path;
+  unsigned short libh;
+  short ret;
+
+  if (!s->open[path]) {
+    if ((ret = cnc_allclibhndl3(s->ip, s->port, s->timeout, &libh)) != EW_OK) {
+      paths_fail(g, ret);
+      return NULL;
+    }
+    g->switches++;
+    if ((ret = cnc_setpath(libh, path)) != EW_OK) {
+      cnc_freelibhndl(libh);
+      paths_fail(g, ret);
+      return NULL;
+    }
+    s->handles[path] = libh;
+    s->open[path] = 1;
+  }
+
+  if (paths_run(g, s->handles[path]) != EW_OK) {
+    cnc_freelibhndl(s->handles[path]);
+    s->open[path] = 0;
+  }
+
+  return NULL;
+}
+
+static void paths_poll_parallel(struct path_group *groups, int ngroups) {
+  fw_thread_t threads[PATHS_MAX];
+  int started[PATHS_MAX];
+  int i;
+
+  for (i = 0; i < ngroups; i++) {
+    started[i] = fw_thread_create(&threads[i], paths_worker, &groups[i]) == 0;
+    if (!started[i]) paths_worker(&groups[i]);
+  }
+  for (i = 0; i < ngroups; i++) {
+    if (started[i]) fw_thread_join(threads[i]);
+  }
+}
+
+/*
+ * serial mode: the path that is already selected goes first, every other
+ * path costs exactly one cnc_setpath per cycle
+ */
+static void paths_poll_serial(PathScheduler *s, struct path_group *groups, int ngroups) {
+  short max_path;
+  short ret = EW_OK;
+  int first = 0;
+  int i, k;
+
+  if (!s->connected) {
+    if ((ret = cnc_allclibhndl3(s->ip, s->port, s->timeout, &s->libh)) == EW_OK &&
+        (ret = cnc_getpath(s->libh, &s->current, &max_path)) != EW_OK) {
+      cnc_freelibhndl(s->libh);
+    }
+    if (ret != EW_OK) {
+      for (i = 0; i < ngroups; i++) paths_fail(&groups[i], ret);
+      return;
+    }
+    s->connected = 1;
+  }
+
+  for (i = 0; i < ngroups; i++) {
+    if (groups[i].snap->path == s->current) first = i;
+  }
+  for (k = 0; k < ngroups; k++) {
+    struct path_group *g = &groups[(first + k) % ngroups];
+
+    if (!s->connected) {
+      paths_fail(g, ret);
+      continue;
+    }
+    if (g->snap->path != s->current) {
+      g->switches++;
+      if ((ret = cnc_setpath(s->libh, g->snap->path)) != EW_OK) {
+        paths_fail(g, ret);
+        if (!PATHS_TRANSPORT(ret)) continue;
+      } else {
+        s->current = g->snap->path;
+        ret = paths_run(g, s->libh);
+      }
+    } else {
+      ret = paths_run(g, s->libh);
+    }
+    if (PATHS_TRANSPORT(ret)) {
+      cnc_freelibhndl(s->libh);
+      s->connected = 0;
+    }
+  }
+}
+
+/*
+ * Run every read with its path selected. Reads are grouped by path so each
+ * path is visited once per cycle whatever order they were queued in. All
+ * snapshots share the cycle's timestamp; cycle->paths is ordered by path.
+ * Returns the number of reads that failed.
+ */
+int paths_poll(PathScheduler *s, PathRead *reads, int n, PathCycle *cycle) {
+  struct path_group groups[PATHS_MAX];
+  int counts[PATHS_MAX + 1] = {0};
+  int starts[PATHS_MAX + 1];
+  int *order;
+  int ngroups = 0;
+  int failed = 0;
+  int i, p;
+
+  memset(cycle, 0, sizeof(PathCycle));
+  cycle->timestamp_ms = fw_now_ms();
+  if (n <= 0) return 0;
+  if ((order = (int *)malloc(sizeof(int) * n)) == NULL) {
+    fprintf(stderr, "Failed to allocate path read order!\n");
+    return n;
+  }
+
+  for (i = 0; i < n; i++) {
+    if (reads[i].path < 1 || reads[i].path > PATHS_MAX) {
+      reads[i].ret = EW_PATH;
+      failed++;
+    } else {
+      counts[reads[i].path]++;
+    }
+  }
+  for (p = 1, i = 0; p <= PATHS_MAX; p++) {
+    if (counts[p] == 0) continue;
+    starts[p] = i;
+    groups[ngroups].sched = s;
+    groups[ngroups].reads = reads;
+    groups[ngroups].order = order + i;
+    groups[ngroups].count = counts[p];
+    groups[ngroups].snap = &cycle->paths[ngroups];
+    groups[ngroups].switches = 0;
+    cycle->paths[ngroups].path = (short)p;
+    cycle->paths[ngroups].reads = counts[p];
+    i += counts[p];
+    ngroups++;
+  }
+  /* stable: reads of a path keep the order they were queued in */
+  for (i = 0; i < n; i++) {
+    p = reads[i].path;
+    if (p >= 1 && p <= PATHS_MAX) order[starts[p]++] = i;
+  }
+  cycle->npaths = ngroups;
+
+  if (s->parallel)
+    paths_poll_parallel(groups, ngroups);
+  else
+    paths_poll_serial(s, groups, ngroups);
+
+  for (i = 0; i < ngroups; i++) {
+    cycle->switches += groups[i].switches;
+    failed += cycle->paths[i].failed;
+  }
+  free(order);
+
+  return failed;
+}
@@ -0,0 +1,52 @@
+#ifndef FW_PATHS_H
+#define FW_PATHS_H
+
+#include <stdint.h>
+
+#include "./sync.h"
+#include "fwlib32.h"
+
+#define PATHS_MAX 16 /* path numbers 1..PATHS_MAX */
+
+/* one read, made with the given path selected on libh */
+typedef struct path_read {
+  short path;
+  short (*fn)(unsigned short libh, void *arg);
+  void *arg;
+  short ret; /* filled in by paths_poll */
+} PathRead;
+
+typedef struct path_snapshot {
+  short path;
+  int reads;
+  int failed;
+  uint64_t done_ms; /* when the last read of this path returned */
+} PathSnapshot;
+
+typedef struct path_cycle {
+  uint64_t timestamp_ms; /* shared by every snapshot of the cycle */
+  int switches;          /* cnc_setpath calls made */
+  int npaths;
+  PathSnapshot paths[PATHS_MAX];
+} PathCycle;
+
+typedef struct path_scheduler {
+  char ip[100];
+  unsigned short port;
+  long timeout;
+  int parallel; /* one handle (and thread) per path */
+  /* serial mode: one handle, path switched as needed */
+  unsigned short libh;
+  int connected;
+  short current;
+  /* parallel mode: handles[p] always has path p selected */
+  unsigned short handles[PATHS_MAX + 1];
+  int open[PATHS_MAX + 1];
+} PathScheduler;
+
+void paths_init(PathScheduler *s, const char *ip, unsigned short port,
+                long timeout, int parallel);
+void paths_close(PathScheduler *s);
+int paths_poll(PathScheduler *s, PathRead *reads, int n, PathCycle *cycle);
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef FW_PMC_ADDRESS_HPP
+#define FW_PMC_ADDRESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "./pmc_plan.hpp"
+
+/*
+ * PMC addresses written the ladder way, "R100.3", "D2000:L", "F0.5", parsed
+ * into area (type_a), byte, bit and data type (type_d) by constexpr code. An
+ * address given through FW_PMC is parsed and checked by the compiler: a typo is
+ * a build error and nothing is left to do at run time, no string handling and
+ * no pmc_convert_from_string_to_address round trip. pmc_parse() takes the same
+ * syntax at run time, for addresses from configuration files.
+ *
+ *   address = area number ["." bit] [":" type]
+ *   area    = G F Y X A R T K C D M N E
+ *   type    = B byte (default), W word, L long, F float, D double
+ *
+ * Bits are bits of a byte address. Values are read from byte images of the
+ * area (type_d 0), PMC memory is little endian.
+ */
+namespace fanuc {
+
+/* type_d of pmc_rdpmcrng */
+enum class PmcType : short { Byte = 0, Word = 1, Long = 2, Float = 4, Double = 5 };
+
+struct PmcAddress {
+  PmcArea area = PmcArea::G;
+  uint16_t byte = 0;
+  int8_t bit = -1; /* -1: the whole value */
+  PmcType type = PmcType::Byte;
+
+  constexpr uint16_t width() const {
+    return type == PmcType::Word ? 2 : type == PmcType::Long || type == PmcType::Float ? 4
+                                   : type == PmcType::Double ? 8 : 1;
+  }
+  constexpr bool is_bit() const { return bit >= 0; }
+  /* what a PmcPlan has to read for it */
+  constexpr PmcSignal signal() const { return PmcSignal{area, byte, width()}; }
+
+  /* the same as pmc_convert_from_string_to_address would answer, for calls that want it */
+  ODBPMCADRINFO info() const {
+    ODBPMCADRINFO i;
+    std::memset(&i, 0, sizeof(i));
+    i.sAdrType = static_cast<short>(area);
+    i.iAdrNum = byte;
+    i.sBitPos = bit;
+    i.sDataType = static_cast<short>(type);
+    return i;
+  }
+
+  /* one integer, to pass an address as a template argument */
+  constexpr uint64_t code() const {
+    return (uint64_t)static_cast<uint16_t>(area) | (uint64_t)byte << 16 | (uint64_t)(uint8_t)(bit + 1) << 32 |
+           (uint64_t)static_cast<uint16_t>(type) << 40;
+  }
+  static constexpr PmcAddress from_code(uint64_t c) {
+    PmcAddress a;
+    a.area = static_cast<PmcArea>((short)(c & 0xffff));
+    a.byte = (uint16_t)(c >> 16);
+    a.bit = (int8_t)((int)(c >> 32 & 0xff) - 1);
+    a.type = static_cast<PmcType>((short)(c >> 40 & 0xffff));
+    return a;
+  }
+};
+
+constexpr bool operator==(const PmcAddress &a, const PmcAddress &b) { return a.code() == b.code(); }
+constexpr bool operator!=(const PmcAddress &a, const PmcAddress &b) { return a.code() != b.code(); }
+
+namespace detail {
+
+constexpr int pmc_area_index(char c) {
+  const char *areas = "GFYXARTKCDMNE";
+  if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+  for (int i = 0; areas[i] != 0; i++) {
+    if (areas[i] == c) return i;
+  }
+  return -1;
+}
+
+constexpr int pmc_type_code(char c) {
+  switch (c) {
+    case 'B': case 'b': return 0;
+    case 'W': case 'w': return 1;
+    case 'L': case 'l': return 2;
+    case 'F': case 'f': return 4;
+    case 'D': case 'd': return 5;
+    default: return -1;
+  }
+}
+
+}  // namespace detail
+
+/* false for anything that is not a complete, valid address */
+constexpr bool pmc_parse(const char *text, PmcAddress *out) {
+  PmcAddress a;
+  const char *p = text;
+  long number = 0;
+  int area = 0;
+
+  if (p == nullptr || (area = detail::pmc_area_index(*p++)) < 0) return false;
+  a.area = static_cast<PmcArea>(area);
+  if (*p < '0' || *p > '9') return false;
+  for (; *p >= '0' && *p <= '9'; p++) {
+    number = number * 10 + (*p - '0');
+    if (number > 0xffff) return false;
+  }
+  a.byte = (uint16_t)number;
+  if (*p == '.') {
+    p++;
+    if (*p < '0' || *p > '7' || (p[1] >= '0' && p[1] <= '9')) return false;
+    a.bit = (int8_t)(*p++ - '0');
+  }
+  if (*p == ':') {
+    int type = detail::pmc_type_code(p[1]);
+    if (type < 0) return false;
+    a.type = static_cast<PmcType>(type);
+    p += 2;
+  }
+  if (*p != 0) return false;
+  if (a.is_bit() && a.type != PmcType::Byte) return false;
+  if ((long)a.byte + a.width() - 1 > 0xffff) return false;
+  *out = a;
+  return true;
+}
+
+/* throws at run time; in a constant expression a bad address does not compile */
+constexpr PmcAddress pmc_address(const char *text) {
+  PmcAddress a;
+  if (!pmc_parse(text, &a)) throw std::invalid_argument("not a PMC address");
+  return a;
+}
+
+template <uint64_t Code>
+struct PmcConstant {
+  static constexpr PmcAddress value = PmcAddress::from_code(Code);
+};
+
+/* an address parsed by the compiler, FW_PMC("R100.3") */
+#define FW_PMC(text) (::fanuc::PmcConstant<::fanuc::pmc_address(text).code()>::value)
+
+/* C++ type of the values of a PmcType */
+template <PmcType T> struct PmcValueOf;
+template <> struct PmcValueOf<PmcType::Byte> { using type = uint8_t; };
+template <> struct PmcValueOf<PmcType::Word> { using type = int16_t; };
+template <> struct PmcValueOf<PmcType::Long> { using type = int32_t; };
+template <> struct PmcValueOf<PmcType::Float> { using type = float; };
+template <> struct PmcValueOf<PmcType::Double> { using type = double; };
+
+/* a little endian value at p, one load on little endian hosts */
+template <typename T>
+inline T pmc_load(const uint8_t *p) {
+  T value;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  uint8_t bytes[sizeof(T)];
+  for (std::size_t i = 0; i < sizeof(T); i++) bytes[i] = p[sizeof(T) - 1 - i];
+  std::memcpy(&value, bytes, sizeof(T));
+#else
+  std::memcpy(&value, p, sizeof(T));
+#endif
+  return value;
+}
+
+template <>
+inline bool pmc_load<bool>(const uint8_t *p) {
+  return *p != 0;
+}
+
+/* size bytes of an area from address start, e.g. the cdata of a pmc_rdpmcrng byte read */
+struct PmcBuffer {
+  PmcArea area;
+  uint16_t start;
+  const uint8_t *data;
+  std::size_t size;
+
+  constexpr bool holds(PmcAddress a) const {
+    return a.area == area && a.byte >= start && (std::size_t)(a.byte - start) + a.width() <= size;
+  }
+  /* the caller checked holds() once, these do not */
+  bool bit(PmcAddress a) const { return data[a.byte - start] >> a.bit & 1; }
+  template <typename T>
+  T get(PmcAddress a) const {
+    return pmc_load<T>(data + (a.byte - start));
+  }
+};
+
+/*
+ * An address bound to its bytes in a PmcReader's image. The lookup is done
+ * once; get() then reads the image of the last read(). T is bool for bit
+ * addresses, otherwise the type of the address (PmcValueOf).
+ */
+template <typename T>
+class PmcValue {
+ public:
+  PmcValue() = default;
+  PmcValue(const PmcReader &reader, PmcAddress a) : bit_(a.bit) {
+    bool fits = a.is_bit() ? std::is_same<T, bool>::value : sizeof(T) == a.width();
+    std::size_t offset = reader.plan().locate(a.area, a.byte, a.width());
+    if (fits && offset != PmcPlan::npos) p_ = reader.image() + offset;
+  }
+
+  /* false when the plan does not read the address or T does not fit it */
+  bool valid() const { return p_ != nullptr; }
+  T get() const { return bit_ >= 0 ? (T)(*p_ >> bit_ & 1) : pmc_load<T>(p_); }
+
+ private:
+  const uint8_t *p_ = nullptr;
+  int bit_ = -1;
+};
+
+}  // namespace fanuc
+
+#endif
@@ -0,0 +1,180 @@
+#include "./pmc_capture.hpp"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace fanuc {
+
+/* one pmc_rdpmcrng per range, the capture never probes pmc_rdwrpmcrng */
+static PmcPlanOptions range_reads() {
+  PmcPlanOptions opts;
+  opts.multi = false;
+  return opts;
+}
+
+static uint64_t nanoseconds(PmcCapture::Clock::time_point t) {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+double PmcCapture::Stats::rate() const {
+  if (samples < 2 || elapsed <= Clock::duration::zero()) return 0;
+  return (samples - 1) / std::chrono::duration<double>(elapsed).count();
+}
+
+PmcCapture::PmcCapture(std::string ip, unsigned short port, long timeout,
+                       std::vector<PmcSignal> signals, PmcCaptureOptions opts,
+                       PmcReader::ReadRange rdrng)
+    : ip_(std::move(ip)),
+      port_(port),
+      timeout_(timeout),
+      opts_(opts),
+      reader_(PmcPlan(std::move(signals), range_reads()), nullptr, rdrng) {
+  const PmcPlan &p = reader_.plan();
+  std::size_t ring = 1;
+
+  diffs_.resize(p.ranges().size());
+  for (std::size_t r = 0; r < diffs_.size(); r++) {
+    const PmcRange &range = p.ranges()[r];
+    pmc_diff_init(&diffs_[r], static_cast<short>(range.area), range.start, range.bytes());
+  }
+  watched_.assign(p.bytes(), 0);
+  for (std::size_t i = 0; i < p.signals().size(); i++) {
+    std::fill_n(watched_.begin() + p.offset(i), p.signals()[i].width, 1);
+  }
+  scratch_.resize(64);
+
+  while (ring < opts_.ring) ring <<= 1;
+  ring_.resize(ring);
+  worker_ = std::thread(&PmcCapture::run, this);
+}
+
+PmcCapture::~PmcCapture() {
+  stop();
+  worker_.join();
+  for (pmc_diff &d : diffs_) pmc_diff_free(&d);
+}
+
+void PmcCapture::stop() { stop_.store(true); }
+
+std::size_t PmcCapture::drain(pmc_edge *out, std::size_t max) {
+  std::size_t tail = tail_.load(std::memory_order_relaxed);
+  std::size_t head = head_.load(std::memory_order_acquire);
+  std::size_t n = std::min(max, head - tail);
+
+  for (std::size_t i = 0; i < n; i++) out[i] = ring_[(tail + i) & (ring_.size() - 1)];
+  tail_.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+PmcCapture::Stats PmcCapture::stats() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return stats_;
+}
+
+bool PmcCapture::pin(int cpu) {
+  if (cpu < 0) return false;
+#if defined(_WIN32)
+  if (cpu >= (int)sizeof(DWORD_PTR) * 8) return false;
+  return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+  cpu_set_t set;
+  if (cpu >= CPU_SETSIZE) return false;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+/* the ring is full when the consumer is a whole ring behind, newer edges are dropped */
+void PmcCapture::push(const pmc_edge &edge) {
+  std::size_t head = head_.load(std::memory_order_relaxed);
+
+  if (head - tail_.load(std::memory_order_acquire) == ring_.size()) {
+    stats_.dropped++;
+    return;
+  }
+  ring_[head & (ring_.size() - 1)] = edge;
+  head_.store(head + 1, std::memory_order_release);
+  stats_.edges++;
+}
+
+/* lock_ held */
+void PmcCapture::sample(Clock::time_point start, Clock::time_point end) {
+  const PmcPlan &p = reader_.plan();
+  uint64_t time = nanoseconds(start + (end - start) / 2);
+
+  for (std::size_t r = 0; r < diffs_.size(); r++) {
+    std::size_t offset = p.ranges()[r].offset, n;
+    do {
+      n = pmc_diff_update(&diffs_[r], reader_.image() + offset, time, scratch_.data(), scratch_.size());
+      for (std::size_t i = 0; i < n; i++) {
+        if (watched_[offset + scratch_[i].address - diffs_[r].start]) push(scratch_[i]);
+      }
+    } while (n == scratch_.size());
+  }
+
+  if (stats_.samples == 0) first_ = start;
+  stats_.samples++;
+  stats_.elapsed = end - first_;
+  stats_.read_max = std::max(stats_.read_max, end - start);
+  if (continuous_) stats_.window_max = std::max(stats_.window_max, end - prev_start_);
+  prev_start_ = start;
+}
+
+void PmcCapture::run() {
+  unsigned short libh = 0;
+  bool connected = false;
+  bool pinned = pin(opts_.cpu);
+
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stats_.pinned = pinned;
+  }
+  while (!stop_.load(std::memory_order_relaxed)) {
+    short ret = EW_OK;
+
+    if (!connected && (ret = cnc_allclibhndl3(ip_.c_str(), port_, timeout_, &libh)) != EW_OK) {
+      {
+        std::lock_guard<std::mutex> lock(lock_);
+        stats_.last_ret = ret;
+        stats_.errors++;
+        continuous_ = false;
+      }
+      /* a refused connect returns at once, do not hammer the controller */
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      continue;
+    }
+    connected = true;
+    Clock::time_point start = Clock::now();
+    ret = reader_.read(libh);
+    Clock::time_point end = Clock::now();
+
+    std::lock_guard<std::mutex> lock(lock_);
+    stats_.last_ret = ret;
+    if (ret == EW_OK) {
+      sample(start, end);
+      continuous_ = true;
+      continue;
+    }
+    stats_.errors++;
+    continuous_ = false;
+    /* transport failures drop the handle, the next round reconnects */
+    if (ret == EW_SOCKET || ret == EW_HANDLE) {
+      cnc_freelibhndl(libh);
+      connected = false;
+      stats_.reconnects++;
+    }
+  }
+
+  if (connected) cnc_freelibhndl(libh);
+}
+
+}  // namespace fanuc
@@ -0,0 +1,110 @@
+#ifndef FW_PMC_CAPTURE_HPP
+#define FW_PMC_CAPTURE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./pmc_diff.h"
+#include "./pmc_plan.hpp"
+
+namespace fanuc {
+
+struct PmcCaptureOptions {
+  /* edges kept until drained, rounded up to a power of two */
+  std::size_t ring = 4096;
+  /* cpu the capture thread is pinned to, -1 leaves it to the scheduler */
+  int cpu = -1;
+};
+
+/*
+ * Samples a few PMC bytes as fast as one handle answers, for pulses a poll
+ * cycle would miss (cycle start, door switches, M code finish). The capture
+ * thread opens its own handle, reads the planned ranges with pmc_rdpmcrng back
+ * to back and turns every flipped bit of a watched byte into a pmc_edge in a
+ * single-producer ring that other threads drain.
+ *
+ * Edge times are nanoseconds of steady_clock at the middle of the read that saw
+ * the new value. A pulse is caught when at least one read lands inside it: the
+ * controller takes its sample somewhere in the round trip, so a pulse longer
+ * than the time from the start of a read to the end of the next one is always
+ * seen. Stats::min_pulse() is the longest such window measured so far; pulses
+ * shorter than a ladder scan never reach the interface at all.
+ */
+class PmcCapture {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats {
+    unsigned long samples = 0;
+    unsigned long errors = 0;     /* failed reads */
+    unsigned long reconnects = 0; /* handles dropped after EW_SOCKET / EW_HANDLE */
+    unsigned long edges = 0;
+    unsigned long dropped = 0;    /* edges lost to a full ring */
+    short last_ret = 0;
+    bool pinned = false;
+    /* from the first sample to the last */
+    Clock::duration elapsed{0};
+    Clock::duration read_max{0};
+    /* start of a read to the end of the next one, not counted across failed reads */
+    Clock::duration window_max{0};
+
+    double rate() const;
+    Clock::duration min_pulse() const { return window_max; }
+  };
+
+  PmcCapture(std::string ip, unsigned short port, long timeout, std::vector<PmcSignal> signals,
+             PmcCaptureOptions opts = PmcCaptureOptions(),
+             PmcReader::ReadRange rdrng = pmc_rdpmcrng);
+  ~PmcCapture();
+
+  PmcCapture(const PmcCapture &) = delete;
+  PmcCapture &operator=(const PmcCapture &) = delete;
+
+  /* ends the capture after the read in flight */
+  void stop();
+
+  /* moves up to max edges out of the ring, oldest first; one consumer at a time */
+  std::size_t drain(pmc_edge *out, std::size_t max);
+  Stats stats() const;
+  const PmcPlan &plan() const { return reader_.plan(); }
+
+  /* pins the calling thread, false where it is not supported or refused */
+  static bool pin(int cpu);
+
+ private:
+  void run();
+  void sample(Clock::time_point start, Clock::time_point end);
+  void push(const pmc_edge &edge);
+
+  std::string ip_;
+  unsigned short port_;
+  long timeout_;
+  PmcCaptureOptions opts_;
+  PmcReader reader_;
+  std::vector<pmc_diff> diffs_;   /* one per range of the plan */
+  std::vector<uint8_t> watched_;  /* per image byte, gap bytes are read but not reported */
+  std::vector<pmc_edge> scratch_;
+
+  /* spsc ring, head_ written by the capture thread only, tail_ by the consumer */
+  std::vector<pmc_edge> ring_;
+  std::atomic<std::size_t> head_{0};
+  std::atomic<std::size_t> tail_{0};
+
+  mutable std::mutex lock_;
+  Stats stats_;
+  Clock::time_point first_;
+  Clock::time_point prev_start_;
+  bool continuous_ = false; /* the previous read succeeded */
+  std::atomic<bool> stop_{false};
+  std::thread worker_;
+};
+
+}  // namespace fanuc
+
+#endif
@@ -0,0 +1,217 @@
+#include "./pmc_diff.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DIFF_SSE2 1
+#define DIFF_AVX2 1
+#define DIFF_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <emmintrin.h>
+#define DIFF_SSE2 1
+#define DIFF_TARGET(isa)
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DIFF_NEON 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static inline unsigned diff_ctz(uint32_t x) {
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return (unsigned)i;
+}
+#else
+static inline unsigned diff_ctz(uint32_t x) { return (unsigned)__builtin_ctz(x); }
+#endif
+
+typedef struct {
+  const char *name;
+  size_t (*find)(const uint8_t *, const uint8_t *, size_t, size_t);
+} DiffKernel;
+
+/* scalar: a word at a time, also the tail of the vector kernels */
+
+static size_t scalar_find(const uint8_t *a, const uint8_t *b, size_t i, size_t n) {
+  uint64_t x, y;
+  for (; i + 8 <= n; i += 8) {
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    if (x != y) break;
+  }
+  for (; i < n; i++) {
+    if (a[i] != b[i]) return i;
+  }
+  return n;
+}
+
+static const DiffKernel diff_scalar = {"scalar", scalar_find};
+
+#ifdef DIFF_SSE2
+/* 32 bytes per round, the masks are only looked at once something differs */
+DIFF_TARGET("sse2")
+static size_t sse2_find(const uint8_t *a, const uint8_t *b, size_t i, size_t n) {
+  for (; i + 32 <= n; i += 32) {
+    __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                _mm_loadu_si128((const __m128i *)(b + i)));
+    __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i + 16)),
+                                _mm_loadu_si128((const __m128i *)(b + i + 16)));
+    if (_mm_movemask_epi8(_mm_and_si128(e0, e1)) != 0xffff) {
+      uint32_t m = (uint32_t)_mm_movemask_epi8(e0) | (uint32_t)_mm_movemask_epi8(e1) << 16;
+      return i + diff_ctz(~m);
+    }
+  }
+  return scalar_find(a, b, i, n);
+}
+
+static const DiffKernel diff_sse2 = {"sse2", sse2_find};
+#endif
+
+#ifdef DIFF_AVX2
+DIFF_TARGET("avx2")
+static size_t avx2_find(const uint8_t *a, const uint8_t *b, size_t i, size_t n) {
+  for (; i + 64 <= n; i += 64) {
+    __m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                   _mm256_loadu_si256((const __m256i *)(b + i)));
+    __m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i + 32)),
+                                   _mm256_loadu_si256((const __m256i *)(b + i + 32)));
+    if ((uint32_t)_mm256_movemask_epi8(_mm256_and_si256(e0, e1)) != 0xffffffffu) {
+      uint32_t m0 = ~(uint32_t)_mm256_movemask_epi8(e0);
+      uint32_t m1 = ~(uint32_t)_mm256_movemask_epi8(e1);
+      _mm256_zeroupper();
+      return m0 != 0 ? i + diff_ctz(m0) : i + 32 + diff_ctz(m1);
+    }
+  }
+  /* the upper halves are left dirty otherwise, and the sse tail pays for it */
+  _mm256_zeroupper();
+  return sse2_find(a, b, i, n);
+}
+
+static const DiffKernel diff_avx2 = {"avx2", avx2_find};
+#endif
+
+#ifdef DIFF_NEON
+static inline int neon_any(uint8x16_t x) {
+#ifdef __aarch64__
+  return vmaxvq_u8(x) != 0;
+#else
+  uint64x2_t w = vreinterpretq_u64_u8(x);
+  return (vgetq_lane_u64(w, 0) | vgetq_lane_u64(w, 1)) != 0;
+#endif
+}
+
+/* 32 bytes per round, the scalar loop finds the byte within the round that differs */
+static size_t neon_find(const uint8_t *a, const uint8_t *b, size_t i, size_t n) {
+  for (; i + 32 <= n; i += 32) {
+    uint8x16_t x0 = veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    uint8x16_t x1 = veorq_u8(vld1q_u8(a + i + 16), vld1q_u8(b + i + 16));
+    if (neon_any(vorrq_u8(x0, x1))) break;
+  }
+  return scalar_find(a, b, i, n);
+}
+
+static const DiffKernel diff_neon = {"neon", neon_find};
+#endif
+
+static int diff_supported(const DiffKernel *k) {
+#if defined(DIFF_SSE2) && defined(DIFF_AVX2)
+  __builtin_cpu_init();
+  if (k == &diff_avx2) return __builtin_cpu_supports("avx2");
+  if (k == &diff_sse2) return __builtin_cpu_supports("sse2");
+#endif
+  return 1;
+}
+
+/* best first */
+static const DiffKernel *const diff_all[] = {
+#ifdef DIFF_AVX2
+    &diff_avx2,
+#endif
+#ifdef DIFF_SSE2
+    &diff_sse2,
+#endif
+#ifdef DIFF_NEON
+    &diff_neon,
+#endif
+    &diff_scalar,
+};
+
+static const DiffKernel *diff_active = NULL;
+
+static const DiffKernel *diff_kernel(void) {
+  size_t i;
+  if (diff_active == NULL) {
+    for (i = 0; diff_active == NULL; i++) {
+      if (diff_supported(diff_all[i])) diff_active = diff_all[i];
+    }
+  }
+  return diff_active;
+}
+
+int pmc_diff_init(pmc_diff *d, short area, uint16_t start, size_t size) {
+  memset(d, 0, sizeof(*d));
+  if (size == 0 || (size_t)start + size > 65536) return -1;
+  if ((d->prev = (uint8_t *)calloc(size, 1)) == NULL) return -1;
+  d->area = area;
+  d->start = start;
+  d->size = size;
+  return 0;
+}
+
+void pmc_diff_free(pmc_diff *d) {
+  free(d->prev);
+  d->prev = NULL;
+  d->size = 0;
+  d->primed = 0;
+}
+
+size_t pmc_diff_update(pmc_diff *d, const uint8_t *cur, uint64_t time, pmc_edge *out, size_t max) {
+  size_t (*find)(const uint8_t *, const uint8_t *, size_t, size_t) = diff_kernel()->find;
+  size_t i = 0, n = 0;
+
+  if (!d->primed) {
+    memcpy(d->prev, cur, d->size);
+    d->primed = 1;
+    return 0;
+  }
+  while (n < max && (i = find(d->prev, cur, i, d->size)) < d->size) {
+    uint32_t x = (uint32_t)(d->prev[i] ^ cur[i]);
+    for (; x != 0 && n < max; x &= x - 1) {
+      unsigned bit = diff_ctz(x);
+      pmc_edge *e = &out[n++];
+      e->time = time;
+      e->address = (uint16_t)(d->start + i);
+      e->area = d->area;
+      e->bit = (uint8_t)bit;
+      e->old_value = (uint8_t)(d->prev[i] >> bit & 1);
+      e->new_value = (uint8_t)(cur[i] >> bit & 1);
+      d->prev[i] ^= (uint8_t)(1u << bit);
+    }
+    i++;
+  }
+  return n;
+}
+
+size_t pmc_diff_find(const uint8_t *a, const uint8_t *b, size_t from, size_t n) {
+  return from >= n ? n : diff_kernel()->find(a, b, from, n);
+}
+
+const char *pmc_diff_kernel(void) { return diff_kernel()->name; }
+
+int pmc_diff_use(const char *name) {
+  size_t i;
+  if (name == NULL) {
+    diff_active = NULL;
+    return 1;
+  }
+  for (i = 0; i < sizeof(diff_all) / sizeof(diff_all[0]); i++) {
+    if (strcmp(diff_all[i]->name, name) == 0 && diff_supported(diff_all[i])) {
+      diff_active = diff_all[i];
+      return 1;
+    }
+  }
+  return 0;
+}
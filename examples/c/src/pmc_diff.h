@@ -0,0 +1,62 @@
+#ifndef FW_PMC_DIFF_H
+#define FW_PMC_DIFF_H
+
+/*
+ * Bit level change detection on PMC areas. The previous image of an area is
+ * kept and every new read is compared with it 16 to 64 bytes at a time with the
+ * best SIMD kernel of the cpu, so a read without changes costs a pass over the
+ * memory and nothing else. Changed bytes are then split into one edge per
+ * flipped bit.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* one bit that flipped between two reads, 16 bytes */
+typedef struct {
+  uint64_t time;    /* as passed by the caller, the clock the read was taken on */
+  uint16_t address; /* byte address in the area */
+  short area;       /* adr_type of pmc_rdpmcrng */
+  uint8_t bit;
+  uint8_t old_value;
+  uint8_t new_value;
+} pmc_edge;
+
+/* the previous image of size bytes of an area from address start */
+typedef struct {
+  short area;
+  uint16_t start;
+  size_t size;
+  uint8_t *prev;
+  int primed; /* 0 until the first image came in */
+} pmc_diff;
+
+/* 0 on success, -1 when the image cannot be allocated or does not fit the area */
+int pmc_diff_init(pmc_diff *d, short area, uint16_t start, size_t size);
+void pmc_diff_free(pmc_diff *d);
+
+/*
+ * Compares cur (d->size bytes) with the previous image and writes at most max
+ * edges, in address and bit order, to out. Reported bits become part of the
+ * previous image. Returning max means more edges may be left: call again with
+ * the same image. The first image only primes and gives no edges.
+ */
+size_t pmc_diff_update(pmc_diff *d, const uint8_t *cur, uint64_t time, pmc_edge *out, size_t max);
+
+/* first index from from on where a and b differ, n when they are equal */
+size_t pmc_diff_find(const uint8_t *a, const uint8_t *b, size_t from, size_t n);
+
+/* name of the kernel in use: "avx2", "sse2", "neon" or "scalar" */
+const char *pmc_diff_kernel(void);
+/* use the named kernel (tests, benchmarks), NULL for the best one, 0 if unsupported */
+int pmc_diff_use(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
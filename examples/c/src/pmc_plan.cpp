@@ -0,0 +1,215 @@
+#include "./pmc_plan.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace fanuc {
+
+namespace {
+
+const char *area_names[] = {"G", "F", "Y", "X", "A", "R", "T", "K", "C", "D", "M", "N", "E"};
+
+/* last byte of a signal, widths past the end of the area are cut */
+uint16_t last_byte(const PmcSignal &s) {
+  std::size_t end = (std::size_t)s.address + std::max<uint16_t>(s.width, 1) - 1;
+  return (uint16_t)std::min<std::size_t>(end, 0xffff);
+}
+
+}  // namespace
+
+const char *pmc_area_name(PmcArea area) {
+  short i = static_cast<short>(area);
+  return i >= 0 && i < (short)(sizeof(area_names) / sizeof(area_names[0])) ? area_names[i] : "?";
+}
+
+PmcPlan::PmcPlan(std::vector<PmcSignal> signals, PmcPlanOptions opts)
+    : opts_(opts), signals_(std::move(signals)), offsets_(signals_.size(), 0) {
+  std::vector<std::size_t> order(signals_.size());
+  std::vector<int> owner(signals_.size(), -1); /* range of each signal */
+  std::size_t gap_max = opts_.multi ? opts_.entry_bytes : opts_.round_trip_bytes;
+  std::size_t range_max = std::max<std::size_t>(opts_.max_range_bytes, 1);
+
+  for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+    const PmcSignal &x = signals_[a], &y = signals_[b];
+    return x.area != y.area ? x.area < y.area : x.address < y.address;
+  });
+
+  /* grow a range while the gap to the next address is cheaper than a request */
+  for (std::size_t n = 0; n < order.size(); n++) {
+    const PmcSignal &s = signals_[order[n]];
+    uint16_t end = last_byte(s);
+
+    if (n == 0 || signals_[order[n - 1]].area != s.area || signals_[order[n - 1]].address != s.address)
+      naive_++;
+    if (!ranges_.empty()) {
+      PmcRange &r = ranges_.back();
+      bool near = (std::size_t)s.address <= (std::size_t)r.end + 1 + gap_max;
+      std::size_t merged = (std::size_t)std::max(r.end, end) - r.start + 1;
+      if (r.area == s.area && near && merged <= range_max) {
+        r.end = std::max(r.end, end);
+        owner[order[n]] = (int)ranges_.size() - 1;
+        continue;
+      }
+    }
+    ranges_.push_back(PmcRange{s.area, s.address, end, 0});
+    owner[order[n]] = (int)ranges_.size() - 1;
+  }
+
+  for (PmcRange &r : ranges_) {
+    r.offset = bytes_;
+    bytes_ += r.bytes();
+  }
+  std::vector<bool> used(bytes_, false);
+  for (std::size_t i = 0; i < signals_.size(); i++) {
+    const PmcRange &r = ranges_[owner[i]];
+    offsets_[i] = r.offset + (signals_[i].address - r.start);
+    for (std::size_t b = 0; b <= (std::size_t)(last_byte(signals_[i]) - signals_[i].address); b++)
+      used[offsets_[i] + b] = true;
+  }
+  wasted_ = (std::size_t)std::count(used.begin(), used.end(), false);
+
+  /* first fit decreasing: the largest ranges open the calls, small ones fill them up */
+  std::vector<int> by_size(ranges_.size());
+  for (std::size_t i = 0; i < by_size.size(); i++) by_size[i] = (int)i;
+  std::stable_sort(by_size.begin(), by_size.end(),
+                   [this](int a, int b) { return ranges_[a].bytes() > ranges_[b].bytes(); });
+
+  for (int r : by_size) {
+    std::size_t bytes = ranges_[r].bytes();
+    auto fits = [&](const PmcCall &c) {
+      return opts_.multi && c.ranges.size() < opts_.max_entries && c.bytes + bytes <= opts_.max_call_bytes;
+    };
+    auto call = std::find_if(calls_.begin(), calls_.end(), fits);
+    if (call == calls_.end()) call = calls_.insert(calls_.end(), PmcCall());
+    call->ranges.push_back(r);
+    call->bytes += bytes;
+  }
+  for (PmcCall &c : calls_) std::sort(c.ranges.begin(), c.ranges.end());
+}
+
+std::size_t PmcPlan::locate(PmcArea area, uint16_t address, uint16_t width) const {
+  std::size_t last = (std::size_t)address + std::max<uint16_t>(width, 1) - 1;
+  auto after = std::upper_bound(ranges_.begin(), ranges_.end(), std::make_pair(area, address),
+                                [](const std::pair<PmcArea, uint16_t> &k, const PmcRange &r) {
+                                  return k.first != r.area ? k.first < r.area : k.second < r.start;
+                                });
+
+  /* ranges are sorted by start, one cut at max_range_bytes may overlap the next */
+  for (auto r = after; r != ranges_.begin() && (r - 1)->area == area;) {
+    --r;
+    if (last <= r->end) return r->offset + (address - r->start);
+  }
+  return npos;
+}
+
+std::string PmcPlan::describe() const {
+  std::string out;
+  char line[160];
+
+  snprintf(line, sizeof(line), "%zu signals: %zu round trips one by one, %zu planned (%s)\n",
+           signals_.size(), naive_, calls_.size(), opts_.multi ? "pmc_rdwrpmcrng" : "pmc_rdpmcrng");
+  out += line;
+  snprintf(line, sizeof(line), "%zu ranges, %zu bytes of which %zu read through gaps\n", ranges_.size(),
+           bytes_, wasted_);
+  out += line;
+  for (std::size_t c = 0; c < calls_.size(); c++) {
+    snprintf(line, sizeof(line), "call %zu: %zu bytes", c, calls_[c].bytes);
+    out += line;
+    for (int i : calls_[c].ranges) {
+      const PmcRange &r = ranges_[i];
+      snprintf(line, sizeof(line), " %s%u-%u", pmc_area_name(r.area), r.start, r.end);
+      out += line;
+    }
+    out += "\n";
+  }
+  return out;
+}
+
+PmcReader::PmcReader(PmcPlan plan, ReadWrite rdwr, ReadRange rdrng)
+    : plan_(std::move(plan)), rdwr_(rdwr), rdrng_(rdrng) {
+  std::size_t largest = 0;
+
+  for (const PmcRange &r : plan_.ranges()) largest = std::max(largest, r.bytes());
+  image_.assign(plan_.bytes(), 0);
+  range_buf_.resize((offsetof(IODBPMC, u) + largest) / sizeof(IODBPMC) + 1);
+  reset();
+}
+
+void PmcReader::reset() { multi_ = plan_.options().multi && rdwr_ != nullptr ? -1 : 0; }
+
+short PmcReader::read(unsigned short libh) {
+  short ret = EW_OK;
+
+  trips_ = 0;
+  for (const PmcCall &call : plan_.calls()) {
+    ret = multi_ != 0 ? read_call(libh, call) : read_ranges(libh, call);
+    if (ret != EW_OK) break;
+  }
+  return ret;
+}
+
+short PmcReader::read_call(unsigned short libh, const PmcCall &call) {
+  entries_.resize(call.ranges.size());
+  for (std::size_t i = 0; i < call.ranges.size(); i++) {
+    const PmcRange &r = plan_.ranges()[call.ranges[i]];
+    IODBRWPMC &e = entries_[i];
+    std::memset(&e, 0, sizeof(e));
+    e.type_rw = 0;
+    e.type_a = static_cast<short>(r.area);
+    e.type_d = 0;
+    e.datano_s = r.start;
+    e.length = (short)r.bytes();
+    e.data = image_.data() + r.offset;
+  }
+
+  short ret = rdwr_(libh, (short)entries_.size(), entries_.data());
+  trips_++;
+  if (multi_ < 0 && (ret == EW_FUNC || ret == EW_NOOPT)) {
+    multi_ = 0;
+    return read_ranges(libh, call);
+  }
+  if (ret == EW_OK) {
+    multi_ = 1;
+    return EW_OK;
+  }
+  for (const IODBRWPMC &e : entries_) {
+    if (e.err_code != EW_OK) return e.err_code;
+  }
+  return ret;
+}
+
+/* the calls of a plan made for pmc_rdwrpmcrng, one round trip per range */
+short PmcReader::read_ranges(unsigned short libh, const PmcCall &call) {
+  IODBPMC *buf = range_buf_.data();
+  std::size_t header = offsetof(IODBPMC, u);
+
+  for (int i : call.ranges) {
+    const PmcRange &r = plan_.ranges()[i];
+    short ret = rdrng_(libh, static_cast<short>(r.area), 0, r.start, r.end,
+                       (unsigned short)(header + r.bytes()), buf);
+    trips_++;
+    if (ret != EW_OK) return ret;
+    std::memcpy(image_.data() + r.offset, (const char *)buf + header, r.bytes());
+  }
+  return EW_OK;
+}
+
+bool PmcReader::bit(std::size_t signal, int bit) const {
+  return (image_[plan_.offset(signal) + bit / 8] >> (bit % 8)) & 1;
+}
+
+int16_t PmcReader::word(std::size_t signal) const {
+  const uint8_t *p = image_.data() + plan_.offset(signal);
+  return (int16_t)(p[0] | p[1] << 8);
+}
+
+int32_t PmcReader::dword(std::size_t signal) const {
+  const uint8_t *p = image_.data() + plan_.offset(signal);
+  return (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+}
+
+}  // namespace fanuc
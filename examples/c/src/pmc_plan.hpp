@@ -0,0 +1,151 @@
+#ifndef FW_PMC_PLAN_HPP
+#define FW_PMC_PLAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fwlib32.h"
+
+namespace fanuc {
+
+/* adr_type of pmc_rdpmcrng */
+enum class PmcArea : short { G = 0, F, Y, X, A, R, T, K, C, D, M, N, E };
+
+/* "G", "F", ... or "?" */
+const char *pmc_area_name(PmcArea area);
+
+/* a watched address: width bytes from address, 1 for bits and bytes, 2 words, 4 longs */
+struct PmcSignal {
+  PmcArea area;
+  uint16_t address;
+  uint16_t width = 1;
+};
+
+struct PmcPlanOptions {
+  /*
+   * bytes one more round trip is worth: a gap up to this many bytes between two
+   * addresses is read through rather than fetched by another pmc_rdpmcrng
+   */
+  std::size_t round_trip_bytes = 512;
+  /* the same for one more entry of a pmc_rdwrpmcrng call (its IODBRWPMC on the wire) */
+  std::size_t entry_bytes = 32;
+  /*
+   * per-call limits of the library. The defaults keep a call inside one
+   * Ethernet frame; lower them when a controller answers EW_LENGTH.
+   */
+  std::size_t max_range_bytes = 1400;
+  std::size_t max_call_bytes = 1400;
+  std::size_t max_entries = 20;
+  /* pack ranges into pmc_rdwrpmcrng calls, false: one pmc_rdpmcrng per range */
+  bool multi = true;
+};
+
+/* contiguous bytes of an area, read as byte data (type_d 0) */
+struct PmcRange {
+  PmcArea area;
+  uint16_t start;
+  uint16_t end;       /* last byte, inclusive */
+  std::size_t offset; /* of start in the image */
+
+  std::size_t bytes() const { return (std::size_t)end - start + 1; }
+};
+
+/* ranges fetched by one round trip */
+struct PmcCall {
+  std::vector<int> ranges;
+  std::size_t bytes = 0;
+};
+
+/*
+ * Plans the reads of a set of scattered PMC addresses. Addresses of an area are
+ * merged into one range while the bytes in between cost less than another
+ * request, then ranges are packed first fit decreasing into calls under the
+ * size limits. Everything is read as bytes into one image, so words, longs and
+ * bits of an area merge freely and are decoded from the image afterwards.
+ */
+class PmcPlan {
+ public:
+  static constexpr std::size_t npos = (std::size_t)-1;
+
+  explicit PmcPlan(std::vector<PmcSignal> signals, PmcPlanOptions opts = PmcPlanOptions());
+
+  const PmcPlanOptions &options() const { return opts_; }
+  const std::vector<PmcSignal> &signals() const { return signals_; }
+  const std::vector<PmcRange> &ranges() const { return ranges_; }
+  const std::vector<PmcCall> &calls() const { return calls_; }
+
+  /* one pmc_rdpmcrng per distinct address, what reading them one by one costs */
+  std::size_t round_trips_naive() const { return naive_; }
+  std::size_t round_trips() const { return calls_.size(); }
+  /* image size, and the part of it nobody asked for */
+  std::size_t bytes() const { return bytes_; }
+  std::size_t wasted_bytes() const { return wasted_; }
+  /* where the first byte of signal i lands in the image */
+  std::size_t offset(std::size_t signal) const { return offsets_[signal]; }
+  /* image offset of width bytes from address, npos when the plan does not read all of them */
+  std::size_t locate(PmcArea area, uint16_t address, uint16_t width = 1) const;
+
+  /* round trips before and after, then one line per call */
+  std::string describe() const;
+
+ private:
+  PmcPlanOptions opts_;
+  std::vector<PmcSignal> signals_;
+  std::vector<PmcRange> ranges_;
+  std::vector<PmcCall> calls_;
+  std::vector<std::size_t> offsets_;
+  std::size_t naive_ = 0;
+  std::size_t bytes_ = 0;
+  std::size_t wasted_ = 0;
+};
+
+/*
+ * Runs a plan every cycle. The calls go through pmc_rdwrpmcrng, a library or
+ * controller that refuses it (EW_FUNC, EW_NOOPT) makes the reader fall back to
+ * one pmc_rdpmcrng per range for that handle.
+ */
+class PmcReader {
+ public:
+  using ReadWrite = short (*)(unsigned short, short, IODBRWPMC *);
+  using ReadRange = short (*)(unsigned short, short, short, unsigned short, unsigned short,
+                              unsigned short, IODBPMC *);
+
+  explicit PmcReader(PmcPlan plan, ReadWrite rdwr = pmc_rdwrpmcrng, ReadRange rdrng = pmc_rdpmcrng);
+
+  /* stops at the first failing call, err_code of a refused entry is returned as is */
+  short read(unsigned short libh);
+  /* another handle or a reconnect: try pmc_rdwrpmcrng again */
+  void reset();
+
+  const PmcPlan &plan() const { return plan_; }
+  const uint8_t *image() const { return image_.data(); }
+  /* round trips of the last read() */
+  std::size_t round_trips() const { return trips_; }
+  /* -1 not probed yet, 0 pmc_rdpmcrng, 1 pmc_rdwrpmcrng */
+  int multi() const { return multi_; }
+
+  /* values of signal i as of the last read, PMC memory is little endian */
+  bool bit(std::size_t signal, int bit) const;
+  uint8_t byte(std::size_t signal) const { return image_[plan_.offset(signal)]; }
+  int16_t word(std::size_t signal) const;
+  int32_t dword(std::size_t signal) const;
+
+ private:
+  short read_call(unsigned short libh, const PmcCall &call);
+  short read_ranges(unsigned short libh, const PmcCall &call);
+
+  PmcPlan plan_;
+  ReadWrite rdwr_;
+  ReadRange rdrng_;
+  int multi_;
+  std::size_t trips_ = 0;
+  std::vector<uint8_t> image_;
+  std::vector<IODBRWPMC> entries_;
+  std::vector<IODBPMC> range_buf_; /* room for the header and the largest range */
+};
+
+}  // namespace fanuc
+
+#endif
@@ -0,0 +1,191 @@
+#include "./pmc_write.hpp"
+
+#include <algorithm>
+
+namespace fanuc {
+
+PmcWriteBatch::PmcWriteBatch(PmcPlanOptions opts, bool verify, PmcReader::ReadWrite rdwr,
+                             PmcReader::ReadRange rdrng, WriteRange wrrng)
+    : opts_(opts), verify_(verify), rdwr_(rdwr), rdrng_(rdrng), wrrng_(wrrng) {
+  opts_.max_range_bytes = std::max<std::size_t>(opts_.max_range_bytes, 1);
+  range_buf_.resize((offsetof(IODBPMC, u) + opts_.max_range_bytes) / sizeof(IODBPMC) + 1);
+  reset();
+}
+
+bool PmcWriteBatch::set(PmcAddress a, bool on) {
+  if (!a.is_bit() || a.type != PmcType::Byte) return false;
+  Byte &b = pending_.emplace(std::make_pair(a.area, a.byte), Byte{0, 0}).first->second;
+  uint8_t bit = (uint8_t)(1u << a.bit);
+  b.mask |= bit;
+  b.value = on ? (uint8_t)(b.value | bit) : (uint8_t)(b.value & ~bit);
+  return true;
+}
+
+bool PmcWriteBatch::put_bytes(PmcArea area, uint16_t address, const uint8_t *data, std::size_t size) {
+  if (size == 0 || (std::size_t)address + size > 0x10000) return false;
+  for (std::size_t i = 0; i < size; i++) pending_[std::make_pair(area, (uint16_t)(address + i))] = Byte{data[i], 0xff};
+  return true;
+}
+
+short PmcWriteBatch::commit(unsigned short libh) {
+  if (pending_.empty()) return EW_OK;
+
+  Clock::time_point start = Clock::now();
+  short ret = send(libh);
+  Clock::duration took = Clock::now() - start;
+
+  stats_.batches++;
+  if (ret != EW_OK) stats_.errors++;
+  stats_.bytes = bytes_.size();
+  stats_.ranges = ranges_.size();
+  stats_.round_trips = trips_;
+  stats_.last = took;
+  stats_.max = std::max(stats_.max, took);
+  stats_.total += took;
+  pending_.clear();
+  return ret;
+}
+
+short PmcWriteBatch::send(unsigned short libh) {
+  short ret;
+
+  trips_ = 0;
+  mismatches_.clear();
+  addresses_.clear();
+  bytes_.clear();
+  ranges_.clear();
+  data_.clear();
+  for (const auto &p : pending_) {
+    addresses_.push_back(p.first);
+    bytes_.push_back(p.second);
+  }
+  if ((ret = merge_partial(libh)) != EW_OK) return ret;
+
+  /* only neighbours merge, the bytes in a gap are not ours to write */
+  for (std::size_t i = 0; i < bytes_.size(); i++) {
+    PmcArea area = addresses_[i].first;
+    uint16_t address = addresses_[i].second;
+    if (ranges_.empty() || ranges_.back().area != area ||
+        ranges_.back().start + ranges_.back().size != address || ranges_.back().size == opts_.max_range_bytes)
+      ranges_.push_back(Range{area, address, 0, data_.size()});
+    ranges_.back().size++;
+    data_.push_back(bytes_[i].value);
+  }
+  readback_.assign(data_.size(), 0);
+
+  /* ranges in address order, a call takes them while entries and bytes fit */
+  std::size_t per = verify_ ? 2 : 1, first = 0, entries = 0, bytes = 0;
+  for (std::size_t r = 0; r <= ranges_.size(); r++) {
+    bool full = r == ranges_.size() || (r > first && (entries + per > opts_.max_entries ||
+                                                      bytes + per * ranges_[r].size > opts_.max_call_bytes));
+    if (full && r > first) {
+      ret = multi_ != 0 ? call_multi(libh, first, r - first) : call_single(libh, first, r - first);
+      if (ret != EW_OK) return ret;
+      first = r;
+      entries = bytes = 0;
+    }
+    if (r < ranges_.size()) {
+      entries += per;
+      bytes += per * ranges_[r].size;
+    }
+  }
+
+  for (std::size_t i = 0; verify_ && i < data_.size(); i++) {
+    if (((readback_[i] ^ data_[i]) & bytes_[i].mask) != 0)
+      mismatches_.push_back(PmcSignal{addresses_[i].first, addresses_[i].second, 1});
+  }
+  stats_.mismatches += mismatches_.size();
+  return mismatches_.empty() ? EW_OK : EW_DATA;
+}
+
+/* bytes with some bits written take the others from the controller, one planned read for all */
+short PmcWriteBatch::merge_partial(unsigned short libh) {
+  std::vector<PmcSignal> partial;
+  std::vector<std::size_t> which;
+
+  for (std::size_t i = 0; i < bytes_.size(); i++) {
+    if (bytes_[i].mask == 0xff) continue;
+    partial.push_back(PmcSignal{addresses_[i].first, addresses_[i].second, 1});
+    which.push_back(i);
+  }
+  if (partial.empty()) return EW_OK;
+
+  PmcPlanOptions opts = opts_;
+  opts.multi = multi_ != 0;
+  PmcReader reader(PmcPlan(partial, opts), multi_ != 0 ? rdwr_ : nullptr, rdrng_);
+  short ret = reader.read(libh);
+  trips_ += reader.round_trips();
+  if (multi_ < 0 && reader.multi() >= 0) multi_ = reader.multi();
+  if (ret != EW_OK) return ret;
+
+  for (std::size_t k = 0; k < which.size(); k++) {
+    Byte &b = bytes_[which[k]];
+    b.value = (uint8_t)((reader.byte(k) & ~b.mask) | (b.value & b.mask));
+  }
+  return EW_OK;
+}
+
+short PmcWriteBatch::call_multi(unsigned short libh, std::size_t first, std::size_t count) {
+  entries_.clear();
+  for (std::size_t r = first; r < first + count; r++) {
+    IODBRWPMC e;
+    std::memset(&e, 0, sizeof(e));
+    e.type_rw = 1;
+    e.type_a = static_cast<short>(ranges_[r].area);
+    e.type_d = 0;
+    e.datano_s = ranges_[r].start;
+    e.length = (short)ranges_[r].size;
+    e.data = data_.data() + ranges_[r].offset;
+    entries_.push_back(e);
+    if (verify_) {
+      e.type_rw = 0;
+      e.data = readback_.data() + ranges_[r].offset;
+      entries_.push_back(e);
+    }
+  }
+
+  short ret = rdwr_(libh, (short)entries_.size(), entries_.data());
+  trips_++;
+  if (multi_ < 0 && (ret == EW_FUNC || ret == EW_NOOPT)) {
+    multi_ = 0;
+    return call_single(libh, first, count);
+  }
+  if (ret == EW_OK) {
+    multi_ = 1;
+    return EW_OK;
+  }
+  for (const IODBRWPMC &e : entries_) {
+    if (e.err_code != EW_OK) return e.err_code;
+  }
+  return ret;
+}
+
+short PmcWriteBatch::call_single(unsigned short libh, std::size_t first, std::size_t count) {
+  IODBPMC *buf = range_buf_.data();
+  std::size_t header = offsetof(IODBPMC, u);
+  short ret;
+
+  for (std::size_t r = first; r < first + count; r++) {
+    const Range &range = ranges_[r];
+    unsigned short end = (unsigned short)(range.start + range.size - 1);
+    unsigned short length = (unsigned short)(header + range.size);
+
+    buf->type_a = static_cast<short>(range.area);
+    buf->type_d = 0;
+    buf->datano_s = (short)range.start;
+    buf->datano_e = (short)end;
+    std::memcpy((char *)buf + header, data_.data() + range.offset, range.size);
+    ret = wrrng_(libh, length, buf);
+    trips_++;
+    if (ret != EW_OK) return ret;
+
+    if (!verify_) continue;
+    ret = rdrng_(libh, static_cast<short>(range.area), 0, range.start, end, length, buf);
+    trips_++;
+    if (ret != EW_OK) return ret;
+    std::memcpy(readback_.data() + range.offset, (const char *)buf + header, range.size);
+  }
+  return EW_OK;
+}
+
+}  // namespace fanuc
@@ -0,0 +1,126 @@
+#ifndef FW_PMC_WRITE_HPP
+#define FW_PMC_WRITE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "./pmc_address.hpp"
+#include "./pmc_plan.hpp"
+
+namespace fanuc {
+
+/*
+ * Collects PMC writes and sends them together. Bytes written by the batch are
+ * merged per area into contiguous ranges, several bits of a byte into one byte,
+ * and the ranges are packed into pmc_rdwrpmcrng calls under the limits of
+ * PmcPlanOptions (or pmc_wrpmcrng per range without it).
+ *
+ * A bit write keeps the other bits of its byte: bytes only partly written are
+ * read first, all of them in one planned read, which makes a batch with bits
+ * two round trips instead of one. The ladder may still change a neighbour bit
+ * between that read and the write, as with any read-modify-write over FOCAS.
+ *
+ * With verify every range is read back in the same call right after it is
+ * written and the written bits are compared.
+ */
+class PmcWriteBatch {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using WriteRange = short (*)(unsigned short, unsigned short, IODBPMC *);
+
+  struct Stats {
+    unsigned long batches = 0;
+    unsigned long errors = 0;     /* commits that did not return EW_OK */
+    unsigned long mismatches = 0; /* bytes that did not read back as written */
+    /* of the last batch */
+    std::size_t bytes = 0;
+    std::size_t ranges = 0;
+    std::size_t round_trips = 0;
+    /* commit() from first call to last answer */
+    Clock::duration last{0};
+    Clock::duration max{0};
+    Clock::duration total{0};
+  };
+
+  explicit PmcWriteBatch(PmcPlanOptions opts = PmcPlanOptions(), bool verify = false,
+                         PmcReader::ReadWrite rdwr = pmc_rdwrpmcrng,
+                         PmcReader::ReadRange rdrng = pmc_rdpmcrng, WriteRange wrrng = pmc_wrpmcrng);
+
+  /* a bit address; a later write of the same bit wins */
+  bool set(PmcAddress a, bool on);
+  /* a whole value, sizeof(T) must be the width of the address */
+  template <typename T>
+  bool put(PmcAddress a, T value) {
+    uint8_t bytes[sizeof(T)];
+    if (a.is_bit() || sizeof(T) != a.width()) return false;
+    std::memcpy(bytes, &value, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (std::size_t i = 0; i < sizeof(T) / 2; i++) std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+#endif
+    return put_bytes(a.area, a.byte, bytes, sizeof(T));
+  }
+  bool put_bytes(PmcArea area, uint16_t address, const uint8_t *data, std::size_t size);
+
+  /*
+   * Sends the pending writes, the batch is empty afterwards whatever the
+   * result. EW_DATA when verify found bytes that do not read back as written
+   * (see mismatches()), otherwise the first error of a call.
+   */
+  short commit(unsigned short libh);
+  void clear() { pending_.clear(); }
+  /* another handle or a reconnect: try pmc_rdwrpmcrng again */
+  void reset() { multi_ = opts_.multi && rdwr_ != nullptr ? -1 : 0; }
+
+  std::size_t pending() const { return pending_.size(); }
+  /* bytes of the last commit that read back otherwise */
+  const std::vector<PmcSignal> &mismatches() const { return mismatches_; }
+  const Stats &stats() const { return stats_; }
+  /* -1 not probed yet, 0 pmc_wrpmcrng, 1 pmc_rdwrpmcrng */
+  int multi() const { return multi_; }
+
+ private:
+  struct Byte {
+    uint8_t value;
+    uint8_t mask; /* bits written */
+  };
+  struct Range {
+    PmcArea area;
+    uint16_t start;
+    std::size_t size;
+    std::size_t offset; /* in data_ */
+  };
+
+  short send(unsigned short libh);
+  short merge_partial(unsigned short libh);
+  short call_multi(unsigned short libh, std::size_t first, std::size_t count);
+  short call_single(unsigned short libh, std::size_t first, std::size_t count);
+
+  PmcPlanOptions opts_;
+  bool verify_;
+  PmcReader::ReadWrite rdwr_;
+  PmcReader::ReadRange rdrng_;
+  WriteRange wrrng_;
+  int multi_;
+  std::map<std::pair<PmcArea, uint16_t>, Byte> pending_;
+
+  /* the batch being sent: bytes in address order, their ranges, read back bytes */
+  std::vector<std::pair<PmcArea, uint16_t>> addresses_;
+  std::vector<Byte> bytes_;
+  std::vector<Range> ranges_;
+  std::vector<uint8_t> data_;
+  std::vector<uint8_t> readback_;
+  std::vector<IODBRWPMC> entries_;
+  std::vector<IODBPMC> range_buf_;
+  std::size_t trips_ = 0;
+  std::vector<PmcSignal> mismatches_;
+  Stats stats_;
+};
+
+}  // namespace fanuc
+
+#endif
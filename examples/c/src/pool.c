@@ -0,0 +1,218 @@
+#include "./pool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int pool_init(Pool *pool) {
+  memset(pool->entries, 0, sizeof(pool->entries));
+  memset(&pool->stats, 0, sizeof(pool->stats));
+  pool->timeout = POOL_CONNECT_TIMEOUT;
+  pool->idle_ms = POOL_IDLE_MS;
+  pool->check_ms = POOL_CHECK_MS;
+
+#ifndef _WIN32
+  if (cnc_startupprocess(0, "focas.log") != EW_OK) {
+    fprintf(stderr, "Failed to create required log file!\n");
+    return 1;
+  }
+#endif
+  fw_mutex_init(&pool->lock);
+
+  return 0;
+}
+
+void pool_destroy(Pool *pool) {
+  int i;
+
+  for (i = 0; i < POOL_MAX_HANDLES; i++) {
+    if (pool->entries[i].used && pool->entries[i].libh != 0 &&
+        cnc_freelibhndl(pool->entries[i].libh) != EW_OK)
+      fprintf(stderr, "Failed to free library handle!\n");
+    pool->entries[i].used = 0;
+  }
+  fw_mutex_destroy(&pool->lock);
+#ifndef _WIN32
+  cnc_exitprocess();
+#endif
+}
+
+static void release_slot(Pool *pool, PoolEntry *e) {
+  fw_mutex_lock(&pool->lock);
+  e->used = 0;
+  e->checked_out = 0;
+  e->libh = 0;
+  fw_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Hand out an idle handle for ip:port, opening a new one when none is idle.
+ * Handles that sat unused for longer than check_ms are probed with
+ * cnc_statinfo first and transparently replaced when the probe fails.
+ * Returns EW_BUSY when the machine (or the whole pool) is at capacity.
+ */
+short pool_checkout(Pool *pool, const char *ip, unsigned short port,
+                    unsigned short *libh) {
+  PoolEntry *idle = NULL;
+  PoolEntry *slot = NULL;
+  PoolEntry *victim = NULL;
+  unsigned short stale = 0;
+  int count = 0;
+  int i;
+  short ret;
+  uint64_t now = fw_now_ms();
+  ODBST status;
+
+  fw_mutex_lock(&pool->lock);
+  for (i = 0; i < POOL_MAX_HANDLES; i++) {
+    PoolEntry *e = &pool->entries[i];
+    if (!e->used) {
+      if (slot == NULL) slot = e;
+    } else if (e->port == port && strcmp(e->ip, ip) == 0) {
+      count++;
+      /* prefer the most recently used handle, it is the least likely stale */
+      if (!e->checked_out &&
+          (idle == NULL || e->last_used_ms > idle->last_used_ms))
+        idle = e;
+    } else if (!e->checked_out &&
+               (victim == NULL || e->last_used_ms < victim->last_used_ms)) {
+      victim = e;
+    }
+  }
+
+  if (idle != NULL) {
+    idle->checked_out = 1;
+    slot = idle;
+  } else if (count >= POOL_MAX_PER_MACHINE || (slot == NULL && victim == NULL)) {
+    fw_mutex_unlock(&pool->lock);
+    return EW_BUSY;
+  } else {
+    if (slot == NULL) {
+      /* pool is full, give up the least recently used idle handle */
+      slot = victim;
+      stale = victim->libh;
+      pool->stats.evictions++;
+    }
+    slot->used = 1;
+    slot->checked_out = 1;
+    slot->libh = 0;
+    slot->port = port;
+    snprintf(slot->ip, sizeof(slot->ip), "%s", ip);
+  }
+  fw_mutex_unlock(&pool->lock);
+
+  if (stale != 0 && cnc_freelibhndl(stale) != EW_OK)
+    fprintf(stderr, "Failed to free library handle!\n");
+
+  if (idle != NULL) {
+    if (now - idle->last_used_ms < pool->check_ms ||
+        cnc_statinfo(idle->libh, &status) == EW_OK) {
+      fw_mutex_lock(&pool->lock);
+      pool->stats.reuses++;
+      fw_mutex_unlock(&pool->lock);
+      *libh = idle->libh;
+      return EW_OK;
+    }
+    cnc_freelibhndl(idle->libh);
+    fw_mutex_lock(&pool->lock);
+    pool->stats.failed_checks++;
+    idle->libh = 0;
+    fw_mutex_unlock(&pool->lock);
+  }
+
+  if ((ret = cnc_allclibhndl3(ip, port, pool->timeout, libh)) != EW_OK) {
+    release_slot(pool, slot);
+    return ret;
+  }
+
+  fw_mutex_lock(&pool->lock);
+  slot->libh = *libh;
+  slot->meta.loaded = 0;
+  pool->stats.connects++;
+  fw_mutex_unlock(&pool->lock);
+
+  return EW_OK;
+}
+
+/*
+ * Return a handle to the pool. ret is the result of the last FOCAS call made
+ * with it; handles that saw a transport error are freed instead of reused.
+ */
+void pool_checkin(Pool *pool, unsigned short libh, short ret) {
+  PoolEntry *e = NULL;
+  int i;
+
+  fw_mutex_lock(&pool->lock);
+  for (i = 0; i < POOL_MAX_HANDLES; i++) {
+    if (pool->entries[i].used && pool->entries[i].checked_out &&
+        pool->entries[i].libh == libh) {
+      e = &pool->entries[i];
+      break;
+    }
+  }
+  if (e != NULL && !POOL_BROKEN(ret)) {
+    e->checked_out = 0;
+    e->last_used_ms = fw_now_ms();
+  }
+  fw_mutex_unlock(&pool->lock);
+
+  if (e != NULL && POOL_BROKEN(ret)) {
+    cnc_freelibhndl(libh);
+    release_slot(pool, e);
+  }
+}
+
+/*
+ * Copy the metadata of a checked out handle, reading it from the machine only
+ * the first time the connection is asked for it.
+ */
+short pool_metadata(Pool *pool, unsigned short libh, Metadata *meta) {
+  PoolEntry *e = NULL;
+  short ret;
+  int i;
+
+  fw_mutex_lock(&pool->lock);
+  for (i = 0; i < POOL_MAX_HANDLES; i++) {
+    if (pool->entries[i].used && pool->entries[i].checked_out &&
+        pool->entries[i].libh == libh) {
+      e = &pool->entries[i];
+      break;
+    }
+  }
+  fw_mutex_unlock(&pool->lock);
+  if (e == NULL) return metadata_load(libh, meta);
+
+  /* the caller holds the handle, nobody else touches this entry meanwhile */
+  if (!e->meta.loaded && (ret = metadata_load(libh, &e->meta)) != EW_OK) {
+    return ret;
+  }
+  memcpy(meta, &e->meta, sizeof(Metadata));
+
+  return EW_OK;
+}
+
+/* free handles that have not been used for idle_ms, returns how many */
+int pool_evict_idle(Pool *pool) {
+  unsigned short expired[POOL_MAX_HANDLES];
+  uint64_t now = fw_now_ms();
+  int n = 0;
+  int i;
+
+  fw_mutex_lock(&pool->lock);
+  for (i = 0; i < POOL_MAX_HANDLES; i++) {
+    PoolEntry *e = &pool->entries[i];
+    if (e->used && !e->checked_out && now - e->last_used_ms >= pool->idle_ms) {
+      expired[n++] = e->libh;
+      e->used = 0;
+      e->libh = 0;
+    }
+  }
+  pool->stats.evictions += n;
+  fw_mutex_unlock(&pool->lock);
+
+  for (i = 0; i < n; i++) {
+    if (cnc_freelibhndl(expired[i]) != EW_OK)
+      fprintf(stderr, "Failed to free library handle!\n");
+  }
+
+  return n;
+}
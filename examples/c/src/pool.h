@@ -0,0 +1,53 @@
+#ifndef FW_POOL_H
+#define FW_POOL_H
+
+#include <stdint.h>
+
+#include "./metadata.h"
+#include "./sync.h"
+#include "fwlib32.h"
+
+#define POOL_MAX_HANDLES 64
+#define POOL_MAX_PER_MACHINE 4
+#define POOL_CONNECT_TIMEOUT 10   /* seconds, as passed to cnc_allclibhndl3 */
+#define POOL_IDLE_MS 60000        /* free handles unused for this long */
+#define POOL_CHECK_MS 5000        /* health check handles unused for this long */
+
+/* errors after which a handle must not be handed out again */
+#define POOL_BROKEN(ret) ((ret) == EW_SOCKET || (ret) == EW_HANDLE)
+
+typedef struct pool_entry {
+  char ip[100];
+  unsigned short port;
+  unsigned short libh;
+  int used;       /* slot holds (or is opening) a handle */
+  int checked_out;
+  uint64_t last_used_ms;
+  Metadata meta;  /* loaded on first pool_metadata, reset with the handle */
+} PoolEntry;
+
+typedef struct pool_stats {
+  unsigned long connects;
+  unsigned long reuses;
+  unsigned long failed_checks;
+  unsigned long evictions;
+} PoolStats;
+
+typedef struct pool {
+  PoolEntry entries[POOL_MAX_HANDLES];
+  long timeout;
+  uint64_t idle_ms;
+  uint64_t check_ms;
+  PoolStats stats;
+  fw_mutex_t lock;
+} Pool;
+
+int pool_init(Pool *pool);
+void pool_destroy(Pool *pool);
+short pool_checkout(Pool *pool, const char *ip, unsigned short port,
+                    unsigned short *libh);
+void pool_checkin(Pool *pool, unsigned short libh, short ret);
+short pool_metadata(Pool *pool, unsigned short libh, Metadata *meta);
+int pool_evict_idle(Pool *pool);
+
+#endif
@@ -0,0 +1,123 @@
+#include "./scheduler.hpp"
+
+#include "fwlib32.h"
+
+namespace fanuc {
+
+Scheduler::Scheduler(unsigned workers) {
+  if (workers == 0) workers = 1;
+  for (unsigned i = 0; i < workers; i++) workers_.emplace_back(&Scheduler::run, this);
+}
+
+Scheduler::~Scheduler() {
+  stop();
+  for (std::thread &worker : workers_) worker.join();
+}
+
+int Scheduler::add(int machine, std::string name, Clock::duration period,
+                   std::function<short()> poll, Clock::duration offset) {
+  std::lock_guard<std::mutex> lock(lock_);
+  Group group;
+  int id = (int)groups_.size();
+
+  group.machine = machine;
+  group.name = std::move(name);
+  group.period = period > Clock::duration::zero() ? period : Clock::duration(1);
+  group.poll = std::move(poll);
+  group.next_release = Clock::now() + offset;
+  groups_.push_back(std::move(group));
+  timers_.emplace(groups_[id].next_release, id);
+  wake_.notify_all();
+  return id;
+}
+
+void Scheduler::stop() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+}
+
+Scheduler::Stats Scheduler::stats(int group) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return groups_[group].stats;
+}
+
+std::string Scheduler::name(int group) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return groups_[group].name;
+}
+
+std::size_t Scheduler::groups() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return groups_.size();
+}
+
+/* move every group whose release time has come to the ready set, lock_ held */
+void Scheduler::release(Clock::time_point now) {
+  while (!timers_.empty() && timers_.begin()->first <= now) {
+    int id = timers_.begin()->second;
+    Group &g = groups_[id];
+
+    timers_.erase(timers_.begin());
+    if (g.pending) {
+      g.stats.skipped++;
+    } else {
+      g.pending = true;
+      g.release = g.next_release;
+      ready_.emplace(g.release + g.period, id);
+    }
+    g.next_release += g.period;
+    timers_.emplace(g.next_release, id);
+  }
+}
+
+void Scheduler::run() {
+  std::unique_lock<std::mutex> lock(lock_);
+
+  while (!stop_) {
+    Clock::time_point now = Clock::now();
+    release(now);
+
+    /* earliest deadline first among machines that are not being read */
+    auto next = ready_.begin();
+    while (next != ready_.end() && busy_.count(groups_[next->second].machine) > 0) ++next;
+    if (next == ready_.end()) {
+      if (timers_.empty())
+        wake_.wait(lock);
+      else
+        wake_.wait_until(lock, timers_.begin()->first);
+      continue;
+    }
+
+    Clock::time_point deadline = next->first;
+    int id = next->second;
+    ready_.erase(next);
+    busy_.insert(groups_[id].machine);
+    /* groups_ may grow while unlocked, copy what the read needs */
+    std::function<short()> poll = groups_[id].poll;
+    Clock::time_point released = groups_[id].release;
+
+    lock.unlock();
+    Clock::time_point started = Clock::now();
+    short ret = poll();
+    Clock::time_point finished = Clock::now();
+    lock.lock();
+
+    Group &g = groups_[id];
+    Clock::duration jitter = started - released;
+    g.stats.runs++;
+    g.stats.last_ret = ret;
+    if (ret != EW_OK) g.stats.errors++;
+    if (finished > deadline) g.stats.missed++;
+    if (jitter > g.stats.jitter_max) g.stats.jitter_max = jitter;
+    g.stats.jitter_total += jitter;
+    g.pending = false;
+    busy_.erase(g.machine);
+    /* another worker may be waiting for this machine */
+    wake_.notify_all();
+  }
+}
+
+}  // namespace fanuc
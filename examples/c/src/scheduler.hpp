@@ -0,0 +1,91 @@
+#ifndef FW_SCHEDULER_HPP
+#define FW_SCHEDULER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace fanuc {
+
+/*
+ * Polls groups of signals at their own rate. Every group is released on a
+ * fixed grid (first release + k * period on the monotonic clock), never
+ * relative to when its last read finished, so the period does not drift. A
+ * released read must finish before the next release of its group.
+ *
+ * Workers run the released read with the earliest deadline whose machine is
+ * not busy: reads of one machine never overlap (one handle per machine), reads
+ * of different machines run in parallel up to the worker count. A release that
+ * comes while the previous read of the group is still queued or running is
+ * skipped instead of piling up.
+ */
+class Scheduler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats {
+    unsigned long runs = 0;
+    unsigned long missed = 0;  /* finished after the deadline */
+    unsigned long skipped = 0; /* releases dropped, the previous read was not done */
+    unsigned long errors = 0;  /* poll returned something else than EW_OK */
+    short last_ret = 0;
+    /* start latency after the release */
+    Clock::duration jitter_max{0};
+    Clock::duration jitter_total{0};
+  };
+
+  explicit Scheduler(unsigned workers = 1);
+  ~Scheduler();
+
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  /*
+   * poll() makes the FOCAS calls of the group and returns the FOCAS result.
+   * The first release is offset after now. Returns the group id.
+   */
+  int add(int machine, std::string name, Clock::duration period, std::function<short()> poll,
+          Clock::duration offset = Clock::duration::zero());
+  void stop();
+
+  Stats stats(int group) const;
+  std::string name(int group) const;
+  std::size_t groups() const;
+
+ private:
+  struct Group {
+    int machine;
+    std::string name;
+    Clock::duration period;
+    std::function<short()> poll;
+    Clock::time_point next_release;
+    Clock::time_point release; /* of the read queued or running */
+    bool pending = false;
+    Stats stats;
+  };
+
+  void run();
+  void release(Clock::time_point now);
+
+  mutable std::mutex lock_;
+  std::condition_variable wake_;
+  std::vector<Group> groups_;
+  /* (next release, group) and released reads by (deadline, group) */
+  std::set<std::pair<Clock::time_point, int>> timers_;
+  std::set<std::pair<Clock::time_point, int>> ready_;
+  std::unordered_set<int> busy_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace fanuc
+
+#endif
@@ -0,0 +1,602 @@
+#include "./sim.hpp"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace fanuc {
+namespace sim {
+
+static uint64_t now_ms() {
+  using namespace std::chrono;
+  return (uint64_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t xorshift(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+/* modal G code per group, as cnc_rdgcode would print them after power on */
+static const char *const GCODES[] = {"G01", "G17", "G90", "G22", "G94",   "G21",
+                                     "G40", "G49", "G80", "G98", "G50",   "G67",
+                                     "G97", "G54", "G64", "G69", "G15",   "G40.1",
+                                     "G25", "G160", "G13.1"};
+static const short NGCODES = sizeof(GCODES) / sizeof(GCODES[0]);
+
+/* address types that the simulator overlays with machine state */
+static const short PMC_F = 1;
+static const short PMC_D = 9;
+
+Machine::Machine(const MachineOptions &opts, uint32_t index) : opts_(opts) {
+  ids_[0] = 0x53494d00; /* "SIM" */
+  ids_[1] = index;
+  ids_[2] = opts.seed;
+  ids_[3] = (index + 1) * 2654435761u ^ opts.seed;
+  rng_ = ids_[3] ? ids_[3] : 1;
+
+  for (short i = 0; i < opts.programs; i++) {
+    char comment[32];
+    snprintf(comment, sizeof(comment), "(SIM PART %d)", i + 1);
+    programs_.push_back(Program{1000 + i, opts.blocks, comment});
+  }
+}
+
+void Machine::raise_alarm(long bits) {
+  std::lock_guard<std::mutex> lock(lock_);
+  forced_alarm_ |= bits;
+}
+
+void Machine::clear_alarms() {
+  std::lock_guard<std::mutex> lock(lock_);
+  forced_alarm_ = 0;
+  alarm_ = 0;
+}
+
+long Machine::parts(uint64_t now) {
+  std::lock_guard<std::mutex> lock(lock_);
+  step(now);
+  return parts_;
+}
+
+void Machine::step(uint64_t now) {
+  if (last_ms_ == 0) last_ms_ = now;
+  uint64_t dt = now > last_ms_ ? now - last_ms_ : 0;
+
+  if (opts_.alarms_per_hour > 0) {
+    if (next_alarm_ms_ == 0) {
+      double u = (xorshift(rng_) % 10000 + 1) / 10001.0;
+      next_alarm_ms_ = now + (uint64_t)(-std::log(u) * 3600000.0 / opts_.alarms_per_hour);
+    }
+    if (alarm_ == 0 && now >= next_alarm_ms_) {
+      alarm_ = 1L << (xorshift(rng_) % 8);
+      alarm_until_ms_ = now + (uint64_t)opts_.alarm_ms;
+    } else if (alarm_ != 0 && now >= alarm_until_ms_) {
+      alarm_ = 0;
+      next_alarm_ms_ = 0;
+    }
+  }
+
+  if (alarm_ == 0 && forced_alarm_ == 0) run_ms_ += dt;
+  if (opts_.block_ms > 0 && opts_.blocks > 0) {
+    parts_ = (long)(run_ms_ / ((uint64_t)opts_.block_ms * (uint64_t)opts_.blocks));
+  }
+  last_ms_ = now;
+}
+
+/* axes sweep 0..travel and back, each a third of the travel behind the last */
+long Machine::position(short axis, short type) const {
+  double rate = opts_.feed / 60.0; /* 0.001 mm per ms */
+  double period = 2.0 * opts_.travel;
+  double t = std::fmod(run_ms_ * rate + axis * opts_.travel / 3.0, period);
+  bool up = t < opts_.travel;
+  long machine = (long)(up ? t : period - t);
+  long offset = axis * 10000L;
+
+  switch (type) {
+    case proto::POS_MACHINE:
+      return machine;
+    case proto::POS_DISTANCE:
+      return up ? opts_.travel - machine : machine;
+    default:
+      return machine - offset;
+  }
+}
+
+short Machine::pmc_access(const proto::SubRequest &q, size_t &offset, size_t &bytes) const {
+  long start = q.args[0], end = q.args[1];
+  short type = (short)q.args[2];
+  size_t width = proto::pmc_width((short)q.args[3]);
+
+  if (q.ncpmc != proto::TARGET_PMC) return EW_FUNC;
+  if (type < 0 || type >= PMC_TYPES || width == 0) return EW_TYPE;
+  if (start < 0 || end < start || (size_t)end >= PMC_SIZE) return EW_NUMBER;
+  offset = (size_t)start;
+  bytes = ((size_t)(end - start) / width + 1) * width;
+  if (offset + bytes > PMC_SIZE) return EW_NUMBER;
+  return EW_OK;
+}
+
+proto::SubResponse Machine::answer(const proto::SubRequest &q, uint64_t now) {
+  std::lock_guard<std::mutex> lock(lock_);
+  proto::SubResponse s;
+  proto::Writer w(s.data);
+
+  step(now);
+  bool running = alarm_ == 0 && forced_alarm_ == 0;
+  const Program &prg = programs_.empty() ? Program{0, 0, ""} : programs_[parts_ % programs_.size()];
+  long seqnum = opts_.block_ms > 0 && opts_.blocks > 0
+                    ? (long)(run_ms_ / opts_.block_ms % opts_.blocks + 1) * 10
+                    : 0;
+
+  s.ncpmc = q.ncpmc;
+  s.group = q.group;
+  s.command = q.command;
+  switch (q.command) {
+    case proto::CMD_CNCID:
+      proto::put_cncid(s.data, ids_);
+      break;
+
+    case proto::CMD_STATINFO: {
+      ODBST st;
+      memset(&st, 0, sizeof(st));
+      st.aut = 1;             /* MEM */
+      st.run = running ? 3 : 1; /* STaRT / STOP */
+      st.motion = running ? 1 : 0;
+      st.alarm = running ? 0 : 1;
+      proto::put_status(s.data, st);
+      break;
+    }
+
+    case proto::CMD_ALARM:
+      w.i32((int32_t)(alarm_ | forced_alarm_));
+      break;
+
+    case proto::CMD_PRGNUM:
+      w.i32((int32_t)prg.number);
+      w.i32((int32_t)prg.number);
+      break;
+
+    case proto::CMD_SEQNUM:
+      w.i32((int32_t)seqnum);
+      break;
+
+    case proto::CMD_ACTF:
+      w.i32(running ? (int32_t)opts_.feed : 0);
+      break;
+
+    case proto::CMD_ACTS:
+      w.i32(running ? (int32_t)opts_.speed : 0);
+      break;
+
+    case proto::CMD_POSITION: {
+      short type = (short)q.args[0], axis = (short)q.args[1];
+      if (type < proto::POS_ABSOLUTE || type > proto::POS_DISTANCE ||
+          (axis != ALL_AXES && (axis < 1 || axis > opts_.axes))) {
+        s.error = EW_ATTRIB;
+        break;
+      }
+      for (short a = 1; a <= opts_.axes; a++) {
+        if (axis == ALL_AXES || axis == a) w.i32((int32_t)position(a - 1, type));
+      }
+      break;
+    }
+
+    case proto::CMD_SPEED: {
+      SPEEDELM f, sp;
+      memset(&f, 0, sizeof(f));
+      memset(&sp, 0, sizeof(sp));
+      f.data = running ? opts_.feed : 0;
+      f.name = 'F';
+      sp.data = running ? opts_.speed : 0;
+      sp.name = 'S';
+      if (q.args[0] < -1 || q.args[0] > 1) {
+        s.error = EW_ATTRIB;
+        break;
+      }
+      if (q.args[0] != 1) proto::put_speed(s.data, f);
+      if (q.args[0] != 0) proto::put_speed(s.data, sp);
+      break;
+    }
+
+    case proto::CMD_SPLOAD: {
+      short sp = (short)q.args[0];
+      if (sp != -1 && (sp < 1 || sp > opts_.spindles)) {
+        s.error = EW_NUMBER;
+        break;
+      }
+      for (short i = 1; i <= opts_.spindles; i++) {
+        if (sp != -1 && sp != i) continue;
+        double load = 35 + 25 * std::sin(run_ms_ / 3000.0 + i) + xorshift(rng_) % 5;
+        w.i16(running ? (int16_t)load : 0);
+      }
+      break;
+    }
+
+    case proto::CMD_GCODE: {
+      short type = (short)q.args[0], num = (short)q.args[2];
+      ODBGCD codes[NGCODES];
+      short n = 0;
+      if (type != -1 && (type < 0 || type >= NGCODES)) {
+        s.error = EW_ATTRIB;
+        break;
+      }
+      for (short g = 0; g < NGCODES && n < num; g++) {
+        if (type != -1 && type != g) continue;
+        memset(&codes[n], 0, sizeof(codes[n]));
+        codes[n].group = g;
+        snprintf(codes[n].code, sizeof(codes[n].code), "%s", GCODES[g]);
+        n++;
+      }
+      proto::put_gcodes(s.data, codes, n);
+      break;
+    }
+
+    case proto::CMD_MODAL: {
+      ODBMDL mdl;
+      short type = (short)q.args[0];
+      memset(&mdl, 0, sizeof(mdl));
+      mdl.datano = type;
+      mdl.type = type;
+      if (type >= 0 && type < NGCODES) {
+        mdl.modal.g_data = (char)atoi(GCODES[type] + 1);
+      } else if (type == -1) {
+        for (short g = 0; g < NGCODES && g < (short)sizeof(mdl.modal.g_rdata); g++) {
+          mdl.modal.g_rdata[g] = (char)atoi(GCODES[g] + 1);
+        }
+      } else if (type == 107) {
+        mdl.modal.aux.aux_data = running ? opts_.speed : 0; /* S */
+      } else if (type == 109) {
+        mdl.modal.aux.aux_data = running ? opts_.feed : 0; /* F */
+      } else if (!(type >= -4 && type <= -2) && !(type >= 100 && type <= 126) &&
+                 !(type >= 200 && type <= 207)) {
+        s.error = EW_ATTRIB;
+        break;
+      }
+      proto::put_modal(s.data, mdl);
+      break;
+    }
+
+    case proto::CMD_PRGDIR: {
+      std::vector<PRGDIR3> dir;
+      for (const Program &p : programs_) {
+        if (p.number < q.args[0] || (int32_t)dir.size() >= q.args[1]) continue;
+        PRGDIR3 e;
+        memset(&e, 0, sizeof(e));
+        e.number = p.number;
+        e.length = p.blocks * 20;
+        snprintf(e.comment, sizeof(e.comment), "%s", p.comment.c_str());
+        dir.push_back(e);
+      }
+      proto::put_prgdir(s.data, dir.data(), (short)dir.size());
+      break;
+    }
+
+    /* PMC memory is little endian like the controller's, the wire is big endian */
+    case proto::CMD_PMC_READ: {
+      size_t offset, bytes, width = proto::pmc_width((short)q.args[3]);
+      short type = (short)q.args[2];
+      if ((s.error = pmc_access(q, offset, bytes)) != EW_OK) break;
+      std::vector<uint8_t> mem(bytes, 0);
+      if (!pmc_[type].empty()) memcpy(mem.data(), pmc_[type].data() + offset, bytes);
+      for (size_t i = 0; type == PMC_F && i < bytes; i++) {
+        if (offset + i == 0) mem[i] = (uint8_t)((mem[i] & ~0x20) | (running ? 0x20 : 0));
+      }
+      for (size_t i = 0; type == PMC_D && i < bytes; i++) {
+        if (offset + i < 4) mem[i] = (uint8_t)((uint32_t)parts_ >> (8 * (offset + i)));
+      }
+      for (size_t i = 0; i < bytes; i += width) {
+        for (size_t k = width; k > 0; k--) w.u8(mem[i + k - 1]);
+      }
+      break;
+    }
+
+    case proto::CMD_PMC_WRITE: {
+      size_t offset, bytes, width = proto::pmc_width((short)q.args[3]);
+      short type = (short)q.args[2];
+      if ((s.error = pmc_access(q, offset, bytes)) != EW_OK) break;
+      if (q.payload.size() != bytes) {
+        s.error = EW_LENGTH;
+        break;
+      }
+      if (pmc_[type].empty()) pmc_[type].assign(PMC_SIZE, 0);
+      for (size_t i = 0; i < bytes; i += width) {
+        for (size_t k = 0; k < width; k++) pmc_[type][offset + i + k] = q.payload[i + width - 1 - k];
+      }
+      break;
+    }
+
+    default:
+      s.error = EW_FUNC;
+  }
+
+  return s;
+}
+
+Server::Server(const ServerOptions &opts) : opts_(opts), rng_(opts.machine.seed | 1) {
+  for (int i = 0; i < opts.count; i++) {
+    machines_.emplace_back(new Machine(opts.machine, (uint32_t)i));
+  }
+  epfd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epfd_ < 0 || wakefd_ < 0) {
+    fprintf(stderr, "Failed to create simulator event loop!\n");
+    return;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u64 = (uint64_t)-1;
+  epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+}
+
+Server::~Server() {
+  for (auto &it : conns_) ::close(it.first);
+  for (int fd : listeners_) ::close(fd);
+  if (wakefd_ >= 0) ::close(wakefd_);
+  if (epfd_ >= 0) ::close(epfd_);
+}
+
+/* listeners are tagged with bit 32 so they cannot collide with connection fds */
+static const uint64_t LISTENER = 1ULL << 32;
+
+short Server::listen() {
+  for (int i = 0; i < opts_.count; i++) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int one = 1;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opts_.port == 0 ? 0 : (unsigned short)(opts_.port + i));
+    if (inet_pton(AF_INET, opts_.ip.c_str(), &addr.sin_addr) != 1 ||
+        (fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+      return EW_SOCKET;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(fd, 512) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+      fprintf(stderr, "Failed to listen on %s:%d: %s\n", opts_.ip.c_str(),
+              ntohs(addr.sin_port), strerror(errno));
+      ::close(fd);
+      return EW_SOCKET;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = LISTENER | (uint64_t)listeners_.size();
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+    listeners_.push_back(fd);
+    ports_.push_back(ntohs(addr.sin_port));
+  }
+
+  return EW_OK;
+}
+
+void Server::stop() {
+  uint64_t one = 1;
+
+  stop_ = true;
+  if (write(wakefd_, &one, sizeof(one)) < 0) return;
+}
+
+void Server::run() {
+  struct epoll_event events[256];
+
+  while (!stop_) {
+    int n = epoll_wait(epfd_, events, 256, next_timeout(now_ms()));
+    if (n < 0 && errno != EINTR) {
+      fprintf(stderr, "Simulator event loop failed: %s\n", strerror(errno));
+      return;
+    }
+
+    for (int i = 0; i < n; i++) {
+      uint64_t tag = events[i].data.u64;
+      if (tag == (uint64_t)-1) {
+        uint64_t count;
+        if (read(wakefd_, &count, sizeof(count)) < 0) continue;
+      } else if (tag & LISTENER) {
+        accept_all((int)(tag & 0xffffffff));
+      } else {
+        auto it = conns_.find((int)tag);
+        if (it == conns_.end()) continue;
+        Conn &c = *it->second;
+        if ((events[i].events & EPOLLOUT) && !flush(c)) continue;
+        if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) on_readable(c);
+      }
+    }
+    deliver(now_ms());
+  }
+}
+
+void Server::accept_all(int listener) {
+  int one = 1;
+  int fd;
+
+  while ((fd = accept4(listeners_[listener], NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    std::unique_ptr<Conn> c(new Conn());
+    c->fd = fd;
+    c->id = next_conn_++;
+    c->machine = listener;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = (uint64_t)fd;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+    conns_[fd] = std::move(c);
+    connections_++;
+  }
+}
+
+void Server::on_readable(Conn &c) {
+  uint8_t chunk[16384];
+  int fd = c.fd;
+
+  for (;;) {
+    ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n > 0) {
+      c.rbuf.insert(c.rbuf.end(), chunk, chunk + n);
+      if ((size_t)n < sizeof(chunk)) break;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    drop(fd);
+    return;
+  }
+
+  size_t off = 0;
+  for (;;) {
+    proto::Frame frame;
+    long used = proto::decode_frame(c.rbuf.data() + off, c.rbuf.size() - off, frame);
+    if (used == 0) break;
+    if (used < 0 || !on_frame(c, frame)) {
+      drop(fd);
+      return;
+    }
+    off += (size_t)used;
+    if (!conns_.count(fd)) return;
+  }
+  c.rbuf.erase(c.rbuf.begin(), c.rbuf.begin() + off);
+}
+
+bool Server::on_frame(Conn &c, proto::Frame &frame) {
+  switch (frame.type) {
+    case proto::OPEN_REQ:
+      queue(c, proto::OPEN_RESP, frame.body, false);
+      return true;
+
+    case proto::CLOSE_REQ:
+      queue(c, proto::CLOSE_RESP, std::vector<uint8_t>(), true);
+      return true;
+
+    case proto::VAR_REQ: {
+      std::vector<proto::SubRequest> reqs;
+      std::vector<proto::SubResponse> resps;
+      uint64_t now = now_ms();
+
+      if (!proto::decode_requests(frame.body, reqs)) return false;
+      requests_++;
+      for (const proto::SubRequest &q : reqs) {
+        resps.push_back(machines_[c.machine]->answer(q, now));
+      }
+      queue(c, proto::VAR_RESP, proto::encode_responses(resps), false);
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+long Server::delay() {
+  long ms = opts_.latency_ms;
+  if (opts_.jitter_ms > 0) ms += (long)(xorshift(rng_) % (uint32_t)(opts_.jitter_ms + 1));
+  return ms;
+}
+
+void Server::queue(Conn &c, uint16_t type, const std::vector<uint8_t> &body, bool close) {
+  Delayed d;
+
+  d.fd = c.fd;
+  d.conn = c.id;
+  d.close = close;
+  proto::encode_frame(type, body, d.packet);
+
+  if (opts_.latency_ms <= 0 && opts_.jitter_ms <= 0) {
+    c.wbuf.insert(c.wbuf.end(), d.packet.begin(), d.packet.end());
+    c.closing = c.closing || close;
+    flush(c);
+    return;
+  }
+  uint64_t due = std::max(now_ms() + (uint64_t)delay(), c.last_due);
+  c.last_due = due;
+  delayed_.emplace(due, std::move(d));
+}
+
+void Server::deliver(uint64_t now) {
+  while (!delayed_.empty() && delayed_.begin()->first <= now) {
+    Delayed d = std::move(delayed_.begin()->second);
+    delayed_.erase(delayed_.begin());
+
+    auto it = conns_.find(d.fd);
+    if (it == conns_.end() || it->second->id != d.conn) continue;
+    Conn &c = *it->second;
+    c.wbuf.insert(c.wbuf.end(), d.packet.begin(), d.packet.end());
+    c.closing = c.closing || d.close;
+    flush(c);
+  }
+}
+
+int Server::next_timeout(uint64_t now) const {
+  if (delayed_.empty()) return -1;
+  uint64_t due = delayed_.begin()->first;
+  return due <= now ? 0 : (int)std::min<uint64_t>(due - now, 60000);
+}
+
+/* false when the connection was dropped */
+bool Server::flush(Conn &c) {
+  int fd = c.fd;
+
+  while (c.woff < c.wbuf.size()) {
+    ssize_t n = ::send(fd, c.wbuf.data() + c.woff, c.wbuf.size() - c.woff, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      drop(fd);
+      return false;
+    }
+    c.woff += (size_t)n;
+  }
+  if (c.woff == c.wbuf.size()) {
+    c.wbuf.clear();
+    c.woff = 0;
+    if (c.closing) {
+      drop(fd);
+      return false;
+    }
+  }
+
+  bool writable = !c.wbuf.empty();
+  if (writable != c.writable) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | (writable ? (uint32_t)EPOLLOUT : 0);
+    ev.data.u64 = (uint64_t)fd;
+    epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev);
+    c.writable = writable;
+  }
+  return true;
+}
+
+void Server::drop(int fd) {
+  auto it = conns_.find(fd);
+  if (it == conns_.end()) return;
+
+  epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, NULL);
+  ::close(fd);
+  conns_.erase(it);
+  connections_--;
+}
+
+}  // namespace sim
+}  // namespace fanuc
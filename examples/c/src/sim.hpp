@@ -0,0 +1,161 @@
+#ifndef FW_SIM_HPP
+#define FW_SIM_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./focas_proto.hpp"
+
+namespace fanuc {
+namespace sim {
+
+struct MachineOptions {
+  short axes = 3;
+  short spindles = 1;
+  long feed = 1500;         /* mm/min while running */
+  long speed = 8000;        /* rpm */
+  long travel = 400000;     /* 0.001 mm, every axis sweeps 0..travel */
+  short programs = 8;       /* O1000, O1001, ... in storage */
+  long block_ms = 500;      /* time per program block */
+  short blocks = 40;        /* blocks per program */
+  double alarms_per_hour = 0;
+  long alarm_ms = 30000;    /* an alarm clears itself after this */
+  uint32_t seed = 1;
+};
+
+struct Program {
+  long number;
+  long blocks;
+  std::string comment;
+};
+
+/*
+ * A virtual controller whose state is a function of time: axes sweep back and
+ * forth at the feedrate while a program runs, the sequence number walks the
+ * program's blocks and every completed program counts a part. Random alarms
+ * stop the machine until they clear. PMC memory is plain bytes per address
+ * type, D0 (long) holds the part count and F0.5 (STL) follows the run state.
+ */
+class Machine {
+ public:
+  static const int PMC_TYPES = 13; /* G F Y X A R T K C D M N E */
+  static const size_t PMC_SIZE = 65536;
+
+  Machine(const MachineOptions &opts, uint32_t index);
+
+  proto::SubResponse answer(const proto::SubRequest &q, uint64_t now_ms);
+
+  /* for tests and the command line: alarm bits stay until cleared */
+  void raise_alarm(long bits);
+  void clear_alarms();
+  long parts(uint64_t now_ms);
+
+ private:
+  void step(uint64_t now_ms);
+  long position(short axis, short type) const;
+  short pmc_access(const proto::SubRequest &q, size_t &offset, size_t &bytes) const;
+
+  std::mutex lock_;
+  MachineOptions opts_;
+  uint32_t ids_[4];
+  uint32_t rng_;
+  std::vector<Program> programs_;
+
+  uint64_t last_ms_ = 0;
+  uint64_t run_ms_ = 0;       /* time spent running, drives motion */
+  uint64_t next_alarm_ms_ = 0;
+  uint64_t alarm_until_ms_ = 0;
+  long alarm_ = 0;            /* random alarms */
+  long forced_alarm_ = 0;     /* raise_alarm() */
+  long parts_ = 0;
+  std::vector<uint8_t> pmc_[PMC_TYPES];
+};
+
+struct ServerOptions {
+  std::string ip = "127.0.0.1";
+  unsigned short port = 8193; /* machine i listens on port + i, 0 picks free ports */
+  int count = 1;
+  long latency_ms = 0;        /* added to every variable response */
+  long jitter_ms = 0;         /* plus uniform 0..jitter_ms */
+  MachineOptions machine;
+};
+
+/*
+ * Serves count machines from one epoll thread, one listening socket each.
+ * Responses are held back by latency_ms + jitter so client timeouts and tail
+ * latency can be exercised on loopback.
+ */
+class Server {
+ public:
+  explicit Server(const ServerOptions &opts);
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  /* binds every port, EW_SOCKET if one of them is taken */
+  short listen();
+  void run();
+  void stop();
+
+  Machine &machine(int i) { return *machines_[i]; }
+  unsigned short port(int i) const { return ports_[i]; }
+  unsigned long requests() const { return requests_.load(std::memory_order_relaxed); }
+  std::size_t connections() const { return connections_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Conn {
+    int fd;
+    uint64_t id;
+    int machine;
+    std::vector<uint8_t> rbuf;
+    std::vector<uint8_t> wbuf;
+    std::size_t woff = 0;
+    bool writable = false;
+    uint64_t last_due = 0; /* responses leave in request order */
+    bool closing = false;  /* drop once wbuf is sent */
+  };
+
+  struct Delayed {
+    int fd;
+    uint64_t conn;
+    std::vector<uint8_t> packet;
+    bool close;
+  };
+
+  void accept_all(int listener);
+  void on_readable(Conn &c);
+  bool on_frame(Conn &c, proto::Frame &frame);
+  void queue(Conn &c, uint16_t type, const std::vector<uint8_t> &body, bool close);
+  void deliver(uint64_t now);
+  int next_timeout(uint64_t now) const;
+  bool flush(Conn &c);
+  void drop(int fd);
+  long delay();
+
+  ServerOptions opts_;
+  int epfd_ = -1;
+  int wakefd_ = -1;
+  std::vector<int> listeners_;
+  std::vector<unsigned short> ports_;
+  std::vector<std::unique_ptr<Machine>> machines_;
+  std::unordered_map<int, std::unique_ptr<Conn>> conns_;
+  std::multimap<uint64_t, Delayed> delayed_;
+  uint64_t next_conn_ = 1;
+  uint32_t rng_;
+  std::atomic<bool> stop_{false};
+  std::atomic<unsigned long> requests_{0};
+  std::atomic<std::size_t> connections_{0};
+};
+
+}  // namespace sim
+}  // namespace fanuc
+
+#endif
@@ -0,0 +1,93 @@
+#include <getopt.h>
+#include <signal.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "./sim.hpp"
+
+static fanuc::sim::Server *running_server;
+
+static void on_signal(int sig) {
+  (void)sig;
+  if (running_server != NULL) running_server->stop();
+}
+
+static struct option options[] = {{"ip", required_argument, NULL, 'h'},
+                                  {"port", required_argument, NULL, 'p'},
+                                  {"count", required_argument, NULL, 'n'},
+                                  {"axes", required_argument, NULL, 'a'},
+                                  {"spindles", required_argument, NULL, 's'},
+                                  {"latency-ms", required_argument, NULL, 'l'},
+                                  {"jitter-ms", required_argument, NULL, 'j'},
+                                  {"alarms-per-hour", required_argument, NULL, 'r'},
+                                  {"seed", required_argument, NULL, 'x'},
+                                  {NULL, 0, NULL, 0}};
+
+/* serve count virtual machines on port, port + 1, ... until SIGINT / SIGTERM */
+int main(int argc, char *argv[]) {
+  fanuc::sim::ServerOptions opts;
+  int c;
+  int i = 0;
+
+  while ((c = getopt_long(argc, argv, "", options, &i)) != -1) {
+    switch (c) {
+      case 'h':
+        opts.ip = optarg;
+        break;
+      case 'p':
+        opts.port = (unsigned short)atoi(optarg);
+        break;
+      case 'n':
+        opts.count = atoi(optarg);
+        break;
+      case 'a':
+        opts.machine.axes = (short)atoi(optarg);
+        break;
+      case 's':
+        opts.machine.spindles = (short)atoi(optarg);
+        break;
+      case 'l':
+        opts.latency_ms = atol(optarg);
+        break;
+      case 'j':
+        opts.jitter_ms = atol(optarg);
+        break;
+      case 'r':
+        opts.machine.alarms_per_hour = atof(optarg);
+        break;
+      case 'x':
+        opts.machine.seed = (uint32_t)strtoul(optarg, NULL, 10);
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [--ip=127.0.0.1] [--port=8193] [--count=1] [--axes=3] "
+                "[--spindles=1] [--latency-ms=0] [--jitter-ms=0] [--alarms-per-hour=0] "
+                "[--seed=1]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (opts.count < 1 || opts.machine.axes < 1 || opts.machine.axes > MAX_AXIS ||
+      opts.machine.spindles < 1 || opts.machine.spindles > MAX_SPINDLE) {
+    fprintf(stderr, "invalid machine count, axes or spindles\n");
+    return EXIT_FAILURE;
+  }
+
+  fanuc::sim::Server server(opts);
+  if (server.listen() != EW_OK) {
+    return EXIT_FAILURE;
+  }
+  printf("simulating %d machine(s) on %s:%d-%d\n", opts.count, opts.ip.c_str(), server.port(0),
+         server.port(opts.count - 1));
+  fflush(stdout);
+
+  running_server = &server;
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  server.run();
+  running_server = NULL;
+
+  printf("served %lu requests\n", server.requests());
+  return EXIT_SUCCESS;
+}
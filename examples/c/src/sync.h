@@ -0,0 +1,87 @@
+#ifndef FW_SYNC_H
+#define FW_SYNC_H
+
+/* minimal thread / locking / clock shims so the same code builds with msvc and gcc */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef CRITICAL_SECTION fw_mutex_t;
+typedef HANDLE fw_thread_t;
+
+struct fw_thread_start {
+  void *(*fn)(void *);
+  void *arg;
+};
+
+static DWORD WINAPI fw_thread_main(LPVOID p) {
+  struct fw_thread_start start = *(struct fw_thread_start *)p;
+  free(p);
+  start.fn(start.arg);
+  return 0;
+}
+
+static inline int fw_thread_create(fw_thread_t *t, void *(*fn)(void *), void *arg) {
+  struct fw_thread_start *start =
+      (struct fw_thread_start *)malloc(sizeof(struct fw_thread_start));
+  if (start == NULL) return 1;
+  start->fn = fn;
+  start->arg = arg;
+  if ((*t = CreateThread(NULL, 0, fw_thread_main, start, 0, NULL)) == NULL) {
+    free(start);
+    return 1;
+  }
+  return 0;
+}
+
+static inline void fw_thread_join(fw_thread_t t) {
+  WaitForSingleObject(t, INFINITE);
+  CloseHandle(t);
+}
+
+static inline void fw_mutex_init(fw_mutex_t *m) { InitializeCriticalSection(m); }
+static inline void fw_mutex_destroy(fw_mutex_t *m) { DeleteCriticalSection(m); }
+static inline void fw_mutex_lock(fw_mutex_t *m) { EnterCriticalSection(m); }
+static inline void fw_mutex_unlock(fw_mutex_t *m) { LeaveCriticalSection(m); }
+
+static inline uint64_t fw_now_ms(void) { return (uint64_t)GetTickCount64(); }
+static inline void fw_sleep_ms(uint64_t ms) { Sleep((DWORD)ms); }
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+typedef pthread_mutex_t fw_mutex_t;
+typedef pthread_t fw_thread_t;
+
+static inline int fw_thread_create(fw_thread_t *t, void *(*fn)(void *), void *arg) {
+  return pthread_create(t, NULL, fn, arg) != 0;
+}
+
+static inline void fw_thread_join(fw_thread_t t) { pthread_join(t, NULL); }
+
+static inline void fw_mutex_init(fw_mutex_t *m) { pthread_mutex_init(m, NULL); }
+static inline void fw_mutex_destroy(fw_mutex_t *m) { pthread_mutex_destroy(m); }
+static inline void fw_mutex_lock(fw_mutex_t *m) { pthread_mutex_lock(m); }
+static inline void fw_mutex_unlock(fw_mutex_t *m) { pthread_mutex_unlock(m); }
+
+/* monotonic milliseconds, unaffected by wall clock changes */
+static inline uint64_t fw_now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline void fw_sleep_ms(uint64_t ms) {
+  struct timespec ts;
+  ts.tv_sec = (time_t)(ms / 1000);
+  ts.tv_nsec = (long)(ms % 1000) * 1000000;
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
+#endif
+
+#endif
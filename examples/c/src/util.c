@@ -1,6 +1,5 @@
 #include "./util.h"
 
-#include <stdint.h>
 #include <stdio.h>
 
 #include "./config.h"
@@ -9,7 +8,6 @@ int retrieve_id(Config *conf, char *cnc_id) {
   int allocated = 0;
   int ret = 0;
   unsigned short libh;
-  uint32_t cnc_ids[4];
 
 #ifndef _WIN32
   if (cnc_startupprocess(0, "focas.log") != EW_OK) {
@@ -26,15 +24,12 @@ int retrieve_id(Config *conf, char *cnc_id) {
   }
   allocated = 1;
 
-  if (cnc_rdcncid(libh, (unsigned long *)cnc_ids) != EW_OK) {
+  if (read_cnc_id(libh, cnc_id) != EW_OK) {
     fprintf(stderr, "Failed to read cnc id!\n");
     ret = 1;
     goto cleanup;
   }
 
-  snprintf(cnc_id, 40, "%08x-%08x-%08x-%08x", cnc_ids[0], cnc_ids[1],
-           cnc_ids[2], cnc_ids[3]);
-
 cleanup:
   if (allocated && cnc_freelibhndl(libh) != EW_OK)
     fprintf(stderr, "Failed to free library handle!\n");
@@ -44,3 +39,26 @@ cleanup:
 
   return ret;
 }
+
+/* same as retrieve_id, but borrows a live handle instead of connecting */
+int retrieve_id_pooled(Pool *pool, Config *conf, char *cnc_id) {
+  unsigned short libh;
+  Metadata meta;
+  short ret;
+
+  if ((ret = pool_checkout(pool, conf->ip, conf->port, &libh)) != EW_OK) {
+    fprintf(stderr, "Failed to connect to cnc! (%d)\n", ret);
+    return 1;
+  }
+
+  /* the id is read once per connection, later calls are served from cache */
+  ret = pool_metadata(pool, libh, &meta);
+  pool_checkin(pool, libh, ret);
+  if (ret != EW_OK) {
+    fprintf(stderr, "Failed to read cnc id! (%d)\n", ret);
+    return 1;
+  }
+  snprintf(cnc_id, 40, "%s", meta.cnc_id);
+
+  return 0;
+}
@@ -3,20 +3,15 @@
 
 #include "./config.h"
 
-/* unclear why this is required (else "error: overloaded function with no
- * contextual type information")*/
-#ifndef TESTING
 #include "fwlib32.h"
-#else
-#define EW_OK 0
-#ifndef _WIN32
-short cnc_startupprocess(long, const char *);
-short cnc_exitprocess();
-#endif
-short cnc_rdcncid(unsigned short, unsigned long *);
-short cnc_allclibhndl3(const char *, unsigned short, long, unsigned short *);
-short cnc_freelibhndl(unsigned short);
-#endif
+#include "./pool.h"
 
+/*
+ * Connects, reads the id and disconnects, no metadata cache. Kept for one-shot
+ * callers like main.c that read a single id per process, where a pool or cache
+ * would never be hit, and as the connect-per-read baseline of bench_pool.
+ */
 int retrieve_id(Config *, char *);
+/* reads the id through pool_metadata, repeated calls reuse the handle and cache */
+int retrieve_id_pooled(Pool *, Config *, char *);
 #endif
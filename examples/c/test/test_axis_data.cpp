@@ -0,0 +1,164 @@
+#include "../src/axis_data.cpp"
+
+#include <cstring>
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, cnc_rdaxisdata, unsigned short, short, short *, short, short *, ODBAXDT *);
+}  // namespace Fwlib32
+FAKE_VALUE_FUNC(short, rdaxisdata64, unsigned short, short, short *, short, short *, ODBAXDT64 *);
+
+using namespace fanuc;
+
+/* types of every call, the reader's buffer is reused between calls */
+static std::vector<std::vector<short>> calls;
+static const char *axis_names[] = {"X", "Y", "Z1"};
+
+static short fake_rdaxisdata(unsigned short libh, short cls, short *types, short num, short *len,
+                             ODBAXDT *data) {
+  calls.emplace_back(types, types + num);
+  short stride = *len;
+  for (short t = 0; t < num; t++) {
+    for (short i = 0; i < 3; i++) {
+      ODBAXDT &d = data[t * stride + i];
+      std::memset(d.name, 0, sizeof(d.name));
+      std::strncpy(d.name, axis_names[i], sizeof(d.name));
+      d.data = cls * 100000 + types[t] * 1000 + i;
+      d.dec = 3;
+      d.unit = cls;
+    }
+  }
+  *len = 3;
+  return EW_OK;
+}
+
+static short fake_rdaxisdata64(unsigned short libh, short cls, short *types, short num, short *len,
+                               ODBAXDT64 *data) {
+  calls.emplace_back(types, types + num);
+  short stride = *len;
+  for (short t = 0; t < num; t++) {
+    for (short i = 0; i < 2; i++) {
+      ODBAXDT64 &d = data[t * stride + i];
+      std::memset(d.name, 0, sizeof(d.name));
+      std::strncpy(d.name, axis_names[i], sizeof(d.name));
+      d.data = cls + types[t] * 0.5 + i;
+      d.dec = 4;
+      d.unit = 0;
+    }
+  }
+  *len = 2;
+  return EW_OK;
+}
+
+class AxisDataTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    RESET_FAKE(cnc_rdaxisdata);
+    RESET_FAKE(rdaxisdata64);
+    FFF_RESET_HISTORY();
+    calls.clear();
+    cnc_rdaxisdata_fake.custom_fake = fake_rdaxisdata;
+    rdaxisdata64_fake.custom_fake = fake_rdaxisdata64;
+  }
+};
+
+TEST_F(AxisDataTest, FewestCallsPerClass) {
+  AxisDataReader reader({AxisKind::Absolute, AxisKind::ServoLoad, AxisKind::Machine,
+                         AxisKind::Relative, AxisKind::Distance, AxisKind::HandleInput,
+                         AxisKind::SpindleSpeed, AxisKind::Absolute},
+                        cnc_rdaxisdata, nullptr);
+
+  /* five position types need two calls, then servo and spindle */
+  ASSERT_EQ(reader.batches().size(), 4u);
+  EXPECT_EQ(reader.batches()[0].cls, 1);
+  EXPECT_EQ(reader.batches()[0].types, std::vector<short>({0, 1, 2, 3}));
+  EXPECT_EQ(reader.batches()[1].types, std::vector<short>({4}));
+  EXPECT_EQ(reader.batches()[2].cls, 2);
+  EXPECT_EQ(reader.batches()[3].cls, 3);
+  EXPECT_EQ(reader.batches()[3].len, MAX_SPINDLE);
+  EXPECT_EQ(reader.columns().size(), 7u);
+
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(cnc_rdaxisdata_fake.call_count, 4u);
+  EXPECT_EQ(reader.wide(), 0);
+  EXPECT_EQ(cnc_rdaxisdata_fake.arg1_history[3], 3);
+}
+
+TEST_F(AxisDataTest, ColumnsAreScaled) {
+  AxisDataReader reader({AxisKind::Machine, AxisKind::ServoCurrent}, cnc_rdaxisdata, nullptr);
+  ASSERT_EQ(reader.read(1), EW_OK);
+
+  const AxisColumn *machine = reader.column(AxisKind::Machine);
+  ASSERT_NE(machine, nullptr);
+  ASSERT_EQ(machine->value.size(), 3u);
+  EXPECT_EQ(machine->value[2], 101.002);
+  EXPECT_EQ(machine->dec[0], 3);
+  EXPECT_EQ(machine->unit[0], 1);
+  EXPECT_EQ(*machine->names, std::vector<std::string>({"X", "Y", "Z1"}));
+
+  const AxisColumn *current = reader.column(AxisKind::ServoCurrent);
+  EXPECT_DOUBLE_EQ(current->value[1], 201.001);
+  EXPECT_EQ(reader.column(AxisKind::SpindleLoad), nullptr);
+}
+
+TEST_F(AxisDataTest, PrefersTheWideVariant) {
+  AxisDataReader reader({AxisKind::Absolute, AxisKind::SpindleLoad}, cnc_rdaxisdata,
+                        rdaxisdata64);
+  ASSERT_EQ(reader.read(1), EW_OK);
+
+  EXPECT_EQ(reader.wide(), 1);
+  EXPECT_EQ(rdaxisdata64_fake.call_count, 2u);
+  EXPECT_EQ(cnc_rdaxisdata_fake.call_count, 0u);
+  const AxisColumn *absolute = reader.column(AxisKind::Absolute);
+  ASSERT_EQ(absolute->value.size(), 2u);
+  EXPECT_DOUBLE_EQ(absolute->value[1], 2.0);
+  EXPECT_EQ(absolute->dec[1], 4);
+}
+
+TEST_F(AxisDataTest, FallsBackWhenTheControllerRefuses) {
+  rdaxisdata64_fake.custom_fake = NULL;
+  rdaxisdata64_fake.return_val = EW_NOOPT;
+  AxisDataReader reader({AxisKind::Absolute, AxisKind::ServoLoad}, cnc_rdaxisdata, rdaxisdata64);
+
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(reader.wide(), 0);
+  EXPECT_EQ(rdaxisdata64_fake.call_count, 1u);
+  EXPECT_EQ(cnc_rdaxisdata_fake.call_count, 2u);
+
+  /* remembered until the reader is reset */
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(rdaxisdata64_fake.call_count, 1u);
+  reader.reset();
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(rdaxisdata64_fake.call_count, 2u);
+}
+
+TEST_F(AxisDataTest, ControllerErrorsAreReturned) {
+  rdaxisdata64_fake.custom_fake = NULL;
+  rdaxisdata64_fake.return_val = EW_SOCKET;
+  AxisDataReader reader({AxisKind::Absolute, AxisKind::ServoLoad}, cnc_rdaxisdata, rdaxisdata64);
+
+  EXPECT_EQ(reader.read(1), EW_SOCKET);
+  EXPECT_EQ(reader.wide(), -1);
+  EXPECT_EQ(rdaxisdata64_fake.call_count, 1u);
+  EXPECT_EQ(cnc_rdaxisdata_fake.call_count, 0u);
+}
+
+TEST_F(AxisDataTest, NamesAreKeptWhileUnchanged) {
+  AxisDataReader reader({AxisKind::Absolute, AxisKind::Machine}, cnc_rdaxisdata, nullptr);
+  ASSERT_EQ(reader.read(1), EW_OK);
+  const std::vector<std::string> *names = reader.column(AxisKind::Absolute)->names;
+  EXPECT_EQ(names, reader.column(AxisKind::Machine)->names);
+  const std::string *first = &(*names)[0];
+
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(&(*names)[0], first);
+
+  axis_names[1] = "B";
+  ASSERT_EQ(reader.read(1), EW_OK);
+  axis_names[1] = "Y";
+  EXPECT_EQ((*names)[1], "B");
+}
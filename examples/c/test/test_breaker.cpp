@@ -0,0 +1,195 @@
+extern "C" {
+  #include "../src/breaker.c"
+}
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, cnc_allclibhndl4, const char *, unsigned short, long, unsigned long, unsigned short *);
+FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+FAKE_VALUE_FUNC(short, cnc_settimeout, unsigned short, long);
+FAKE_VALUE_FUNC(short, cnc_statinfo, unsigned short, ODBST *);
+}  // namespace Fwlib32
+
+static short fake_connect(const char *ip, unsigned short port, long timeout, unsigned long id,
+                          unsigned short *libh) {
+  *libh = 5;
+  return EW_OK;
+}
+
+class BreakerTest : public testing::Test {
+ protected:
+  Breaker b;
+  BreakerOptions opts = default_breaker_options;
+
+  void SetUp() override {
+    RESET_FAKE(cnc_allclibhndl4);
+    RESET_FAKE(cnc_freelibhndl);
+    RESET_FAKE(cnc_settimeout);
+    RESET_FAKE(cnc_statinfo);
+    FFF_RESET_HISTORY();
+    cnc_allclibhndl4_fake.custom_fake = fake_connect;
+  }
+
+  void TearDown() override { breaker_destroy(&b); }
+
+  void trip() {
+    unsigned short libh;
+    for (int i = 0; i < opts.failures; i++) {
+      ASSERT_EQ(breaker_acquire(&b, &libh), EW_OK);
+      breaker_release(&b, EW_SOCKET, 0);
+    }
+    ASSERT_EQ(b.state, BREAKER_OPEN);
+  }
+};
+
+TEST_F(BreakerTest, AdaptsTimeoutToP99Latency) {
+  unsigned short libh;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+
+  ASSERT_EQ(breaker_acquire(&b, &libh), EW_OK);
+  EXPECT_EQ(cnc_allclibhndl4_fake.arg2_val, opts.max_timeout) << "nothing learned yet";
+  for (int i = 0; i < 99; i++) breaker_release(&b, EW_OK, 20);
+  breaker_release(&b, EW_OK, 900);
+
+  EXPECT_EQ(breaker_p99_ms(&b), 32u);
+  EXPECT_EQ(cnc_settimeout_fake.call_count, 1);
+  EXPECT_EQ(cnc_settimeout_fake.arg0_val, 5);
+  EXPECT_EQ(cnc_settimeout_fake.arg1_val, opts.min_timeout);
+  EXPECT_EQ(b.timeout, opts.min_timeout);
+}
+
+TEST_F(BreakerTest, SlowMachineGetsLongerTimeout) {
+  unsigned short libh;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+
+  ASSERT_EQ(breaker_acquire(&b, &libh), EW_OK);
+  for (int i = 0; i < 100; i++) breaker_release(&b, EW_OK, 700);
+
+  EXPECT_EQ(breaker_p99_ms(&b), 1024u);
+  EXPECT_EQ(b.timeout, 5) << "1024ms * headroom 4, rounded up to seconds";
+}
+
+TEST_F(BreakerTest, OpenBreakerFailsFast) {
+  unsigned short libh;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+  trip();
+
+  EXPECT_EQ(breaker_acquire(&b, &libh), EW_SOCKET);
+  EXPECT_EQ(cnc_allclibhndl4_fake.call_count, opts.failures) << "no connect while open";
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, opts.failures);
+  EXPECT_EQ(b.stats.trips, 1u);
+  EXPECT_EQ(b.stats.rejected, 1u);
+}
+
+TEST_F(BreakerTest, ApplicationErrorsDoNotTrip) {
+  unsigned short libh;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+
+  ASSERT_EQ(breaker_acquire(&b, &libh), EW_OK);
+  breaker_release(&b, EW_SOCKET, 0);
+  ASSERT_EQ(breaker_acquire(&b, &libh), EW_OK);
+  breaker_release(&b, EW_SOCKET, 0);
+  ASSERT_EQ(breaker_acquire(&b, &libh), EW_OK);
+  breaker_release(&b, EW_NUMBER, 3);
+  ASSERT_EQ(breaker_acquire(&b, &libh), EW_OK);
+  breaker_release(&b, EW_SOCKET, 0);
+
+  EXPECT_EQ(b.state, BREAKER_CLOSED) << "the machine answered in between";
+}
+
+static std::atomic<bool> connecting;
+
+static short slow_connect(const char *ip, unsigned short port, long timeout, unsigned long id,
+                          unsigned short *libh) {
+  connecting = true;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  *libh = 5;
+  return EW_OK;
+}
+
+TEST_F(BreakerTest, OneHolderAtATime) {
+  unsigned short libh, other;
+  short first = -1;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+  cnc_allclibhndl4_fake.custom_fake = slow_connect;
+  connecting = false;
+
+  std::thread t([&] { first = breaker_acquire(&b, &libh); });
+  while (!connecting) std::this_thread::yield();
+  EXPECT_EQ(breaker_acquire(&b, &other), EW_BUSY) << "connect in progress";
+  t.join();
+  ASSERT_EQ(first, EW_OK);
+  EXPECT_EQ(breaker_acquire(&b, &other), EW_BUSY) << "handle is out";
+  EXPECT_EQ(cnc_allclibhndl4_fake.call_count, 1);
+  EXPECT_EQ(b.stats.contended, 2u);
+
+  breaker_release(&b, EW_OK, 10);
+  ASSERT_EQ(breaker_acquire(&b, &other), EW_OK);
+  EXPECT_EQ(other, libh);
+  breaker_release(&b, EW_OK, 10);
+}
+
+TEST_F(BreakerTest, ProbeClosesBreaker) {
+  unsigned short libh;
+  opts.open_ms = 0;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+  trip();
+
+  EXPECT_EQ(breaker_probe(&b), 1);
+  EXPECT_EQ(b.state, BREAKER_CLOSED);
+  EXPECT_EQ(cnc_allclibhndl4_fake.arg2_val, opts.probe_timeout);
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 1);
+
+  int connects = cnc_allclibhndl4_fake.call_count;
+  EXPECT_EQ(breaker_acquire(&b, &libh), EW_OK);
+  EXPECT_EQ(cnc_allclibhndl4_fake.call_count, connects) << "probe handle is kept";
+  EXPECT_EQ(b.stats.recoveries, 1u);
+}
+
+TEST_F(BreakerTest, FailedProbeStaysOpen) {
+  opts.open_ms = 0;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+  trip();
+  cnc_statinfo_fake.return_val = EW_SOCKET;
+
+  EXPECT_EQ(breaker_probe(&b), 0);
+  EXPECT_EQ(b.state, BREAKER_OPEN);
+  EXPECT_EQ(cnc_freelibhndl_fake.arg0_val, 5) << "probe handle freed";
+  EXPECT_FALSE(b.connected);
+}
+
+TEST_F(BreakerTest, ProbeWaitsForOpenPeriod) {
+  opts.open_ms = 60000;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+  trip();
+
+  EXPECT_EQ(breaker_probe(&b), 0);
+  EXPECT_EQ(b.stats.probes, 0u);
+}
+
+TEST_F(BreakerTest, MonitorProbesInBackground) {
+  BreakerMonitor m;
+  Breaker *all[] = {&b};
+  opts.open_ms = 0;
+  breaker_init(&b, "1.2.3.4", 8193, &opts);
+  trip();
+
+  ASSERT_EQ(breaker_monitor_start(&m, all, 1, 5), 0);
+  for (int i = 0; i < 200; i++) {
+    fw_mutex_lock(&b.lock);
+    bool closed = b.state == BREAKER_CLOSED;
+    fw_mutex_unlock(&b.lock);
+    if (closed) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  breaker_monitor_stop(&m);
+
+  EXPECT_EQ(b.state, BREAKER_CLOSED);
+}
@@ -0,0 +1,125 @@
+#include "../src/executor.cpp"
+
+#include <thread>
+#include <vector>
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, cnc_allclibhndl3, const char *, unsigned short, long, unsigned short *);
+FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+FAKE_VALUE_FUNC(short, cnc_statinfo, unsigned short, ODBST *);
+FAKE_VALUE_FUNC(short, cnc_rddynamic2, unsigned short, short, short, ODBDY2 *);
+FAKE_VALUE_FUNC(short, cnc_rdspeed, unsigned short, short, ODBSPEED *);
+FAKE_VALUE_FUNC(short, cnc_rdcncid, unsigned short, unsigned long *);
+}  // namespace Fwlib32
+
+static std::thread::id focas_thread;
+static bool wrong_thread;
+
+static void check_thread() {
+  if (focas_thread == std::thread::id()) focas_thread = std::this_thread::get_id();
+  if (focas_thread != std::this_thread::get_id()) wrong_thread = true;
+}
+
+static short fake_connect(const char *ip, unsigned short port, long timeout, unsigned short *libh) {
+  check_thread();
+  *libh = 7;
+  return EW_OK;
+}
+
+static short fake_statinfo(unsigned short libh, ODBST *st) {
+  check_thread();
+  st->run = 3;
+  return libh == 7 ? EW_OK : EW_HANDLE;
+}
+
+static short fake_rddynamic2(unsigned short libh, short axis, short length, ODBDY2 *dy) {
+  check_thread();
+  dy->seqnum = 42;
+  return EW_OK;
+}
+
+class ExecutorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    RESET_FAKE(cnc_allclibhndl3);
+    RESET_FAKE(cnc_freelibhndl);
+    RESET_FAKE(cnc_statinfo);
+    RESET_FAKE(cnc_rddynamic2);
+    RESET_FAKE(cnc_rdspeed);
+    RESET_FAKE(cnc_rdcncid);
+    FFF_RESET_HISTORY();
+    focas_thread = std::thread::id();
+    wrong_thread = false;
+    cnc_allclibhndl3_fake.custom_fake = fake_connect;
+    cnc_statinfo_fake.custom_fake = fake_statinfo;
+    cnc_rddynamic2_fake.custom_fake = fake_rddynamic2;
+  }
+};
+
+TEST_F(ExecutorTest, ReturnsTypedReplies) {
+  fanuc::Executor cnc("1.2.3.4", 8193);
+
+  auto st = cnc.statinfo();
+  auto dy = cnc.rddynamic2();
+
+  fanuc::Reply<ODBST> status = st.get();
+  fanuc::Reply<ODBDY2> dynamic = dy.get();
+  EXPECT_EQ(status.ret, EW_OK);
+  EXPECT_EQ(status.data.run, 3);
+  EXPECT_EQ(dynamic.ret, EW_OK);
+  EXPECT_EQ(dynamic.data.seqnum, 42);
+  EXPECT_EQ(cnc_rddynamic2_fake.arg2_val, (short)sizeof(ODBDY2));
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1) << "connects once, lazily";
+}
+
+TEST_F(ExecutorTest, SerializesCallsFromManyThreads) {
+  std::vector<std::thread> producers;
+  std::atomic<int> ok{0};
+  {
+    fanuc::Executor cnc("1.2.3.4", 8193);
+    for (int t = 0; t < 8; t++) {
+      producers.emplace_back([&] {
+        std::vector<std::future<fanuc::Reply<ODBST>>> pending;
+        for (int i = 0; i < 250; i++) pending.push_back(cnc.statinfo());
+        for (auto &f : pending) {
+          if (f.get().ret == EW_OK) ok++;
+        }
+      });
+    }
+    for (auto &p : producers) p.join();
+
+    EXPECT_EQ(cnc.completed(), 2000u);
+    EXPECT_EQ(cnc.depth(), 0u);
+    EXPECT_GE(cnc.max_depth(), 1u);
+  }
+
+  EXPECT_EQ(ok.load(), 2000);
+  EXPECT_FALSE(wrong_thread) << "all FOCAS calls must run on the executor thread";
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 2000);
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 1) << "handle freed on destruction";
+}
+
+TEST_F(ExecutorTest, ReconnectsAfterTransportError) {
+  fanuc::Executor cnc("1.2.3.4", 8193);
+
+  cnc_rdspeed_fake.return_val = EW_SOCKET;
+  EXPECT_EQ(cnc.rdspeed().get().ret, EW_SOCKET);
+  EXPECT_EQ(cnc.statinfo().get().ret, EW_OK);
+
+  EXPECT_EQ(cnc.drops(), 1u);
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 1);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 2);
+}
+
+TEST_F(ExecutorTest, FailsRequestsWhenConnectFails) {
+  cnc_allclibhndl3_fake.custom_fake = NULL;
+  cnc_allclibhndl3_fake.return_val = EW_SOCKET;
+  fanuc::Executor cnc("1.2.3.4", 8193);
+
+  EXPECT_EQ(cnc.statinfo().get().ret, EW_SOCKET);
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 0);
+}
@@ -0,0 +1,95 @@
+extern "C" {
+  #include "../src/fixed_point.c"
+}
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/* every kernel compiled in, the ones the cpu lacks are skipped */
+static const char *kernels[] = {"scalar", "sse2", "avx2", "neon"};
+
+class FixedPointTest : public testing::TestWithParam<const char *> {
+ protected:
+  std::vector<int32_t> value;
+  std::vector<short> dec;
+
+  void SetUp() override {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int32_t> any(INT32_MIN, INT32_MAX);
+    value.resize(67);
+    dec.resize(67);
+    for (std::size_t i = 0; i < value.size(); i++) {
+      value[i] = any(rng);
+      dec[i] = (short)(i % 5);
+    }
+    /* past the table and negative, in the middle of a vector */
+    dec[9] = 16;
+    dec[10] = -2;
+    dec[33] = 20;
+    if (!fixed_use(GetParam())) GTEST_SKIP() << GetParam() << " not supported here";
+  }
+
+  void TearDown() override { fixed_use(NULL); }
+};
+
+TEST_P(FixedPointTest, MatchesScalarBitForBit) {
+  for (std::size_t n = 0; n <= value.size(); n++) {
+    std::vector<double> f64(n + 1, -1), ref64(n + 1, -1);
+    std::vector<float> f32(n + 1, -1), ref32(n + 1, -1);
+
+    fixed_to_f64(value.data(), dec.data(), n, f64.data());
+    scalar_to_f64(value.data(), dec.data(), n, ref64.data());
+    EXPECT_EQ(std::memcmp(f64.data(), ref64.data(), (n + 1) * sizeof(double)), 0) << n;
+
+    fixed_to_f32(value.data(), dec.data(), n, f32.data());
+    scalar_to_f32(value.data(), dec.data(), n, ref32.data());
+    EXPECT_EQ(std::memcmp(f32.data(), ref32.data(), (n + 1) * sizeof(float)), 0) << n;
+
+    for (short d : {0, 3, 15, 16, -1}) {
+      fixed_to_f64_uniform(value.data(), d, n, f64.data());
+      scalar_to_f64_uniform(value.data(), d, n, ref64.data());
+      EXPECT_EQ(std::memcmp(f64.data(), ref64.data(), (n + 1) * sizeof(double)), 0) << n << " " << d;
+
+      fixed_to_f32_uniform(value.data(), d, n, f32.data());
+      scalar_to_f32_uniform(value.data(), d, n, ref32.data());
+      EXPECT_EQ(std::memcmp(f32.data(), ref32.data(), (n + 1) * sizeof(float)), 0) << n << " " << d;
+    }
+  }
+}
+
+TEST_P(FixedPointTest, DividesByPowersOfTen) {
+  const int32_t v[] = {100002, -1500, 7, 42, 123456789};
+  const short d[] = {3, 2, 0, -1, 9};
+  double out[5];
+  float out32[5];
+
+  fixed_to_f64(v, d, 5, out);
+  EXPECT_EQ(out[0], 100.002);
+  EXPECT_EQ(out[1], -15.0);
+  EXPECT_EQ(out[2], 7.0);
+  EXPECT_DOUBLE_EQ(out[3], 420.0);
+  EXPECT_EQ(out[4], 0.123456789);
+
+  fixed_to_f32_uniform(v, 3, 5, out32);
+  EXPECT_FLOAT_EQ(out32[0], 100.002f);
+  EXPECT_FLOAT_EQ(out32[1], -1.5f);
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, FixedPointTest, testing::ValuesIn(kernels),
+                         [](const testing::TestParamInfo<const char *> &info) {
+                           return std::string(info.param);
+                         });
+
+TEST(FixedPointSelect, PicksASupportedKernel) {
+  fixed_use(NULL);
+  EXPECT_EQ(fixed_use("scalar"), 1);
+  EXPECT_STREQ(fixed_kernel(), "scalar");
+  EXPECT_EQ(fixed_use("altivec"), 0);
+  EXPECT_STREQ(fixed_kernel(), "scalar");
+  fixed_use(NULL);
+  EXPECT_NE(fixed_kernel(), nullptr);
+}
@@ -0,0 +1,105 @@
+extern "C" {
+  #include "../src/fleet.c"
+}
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, cnc_allclibhndl3, const char *, unsigned short, long, unsigned short *);
+FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+}  // namespace Fwlib32
+
+static std::atomic<int> in_flight;
+static std::atomic<int> max_in_flight;
+static std::atomic<int> handles;
+static std::atomic<int> calls;  // fff counters are not thread safe
+
+// every connect takes 50ms, "10.0.0.2" is only reachable with the long
+// timeout and "10.0.0.3" never answers
+static short fake_connect(const char *ip, unsigned short port, long timeout, unsigned short *libh) {
+  int now = ++in_flight;
+  ++calls;
+  int seen = max_in_flight.load();
+  while (now > seen && !max_in_flight.compare_exchange_weak(seen, now)) {
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  --in_flight;
+
+  if (strcmp(ip, "10.0.0.2") == 0 && timeout < 10) return EW_SOCKET;
+  if (strcmp(ip, "10.0.0.3") == 0) return EW_SOCKET;
+  *libh = (unsigned short)++handles;
+  return EW_OK;
+}
+
+class FleetTest : public testing::Test {
+ protected:
+  FleetMachine machines[8];
+  FleetOptions opts = default_fleet_options;
+
+  void SetUp() override {
+    RESET_FAKE(cnc_allclibhndl3);
+    RESET_FAKE(cnc_freelibhndl);
+    FFF_RESET_HISTORY();
+    in_flight = 0;
+    max_in_flight = 0;
+    handles = 0;
+    calls = 0;
+    cnc_allclibhndl3_fake.custom_fake = fake_connect;
+    memset(machines, 0, sizeof(machines));
+    for (int i = 0; i < 8; i++) {
+      snprintf(machines[i].ip, sizeof(machines[i].ip), "10.0.1.%d", i);
+      machines[i].port = 8193;
+    }
+  }
+};
+
+TEST_F(FleetTest, ConnectsInParallel) {
+  opts.workers = 4;
+  auto start = std::chrono::steady_clock::now();
+
+  ASSERT_EQ(fleet_connect(machines, 8, &opts), 8);
+
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(max_in_flight.load(), 4) << "worker count bounds concurrency";
+  EXPECT_LT(elapsed, std::chrono::milliseconds(8 * 50));
+  for (int i = 0; i < 8; i++) {
+    EXPECT_EQ(machines[i].ret, EW_OK);
+    EXPECT_EQ(machines[i].attempts, 1);
+    EXPECT_GE(machines[i].latency_ms, 40u);
+  }
+  EXPECT_EQ(calls.load(), 8);
+
+  fleet_disconnect(machines, 8);
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 8);
+}
+
+TEST_F(FleetTest, RetriesTimedOutMachinesWithLongTimeout) {
+  snprintf(machines[2].ip, sizeof(machines[2].ip), "10.0.0.2");
+  opts.refused_ms = 0;
+
+  ASSERT_EQ(fleet_connect(machines, 8, &opts), 8);
+  EXPECT_EQ(machines[2].attempts, 2);
+  EXPECT_EQ(machines[0].attempts, 1);
+  EXPECT_EQ(calls.load(), 9);
+  EXPECT_EQ(cnc_allclibhndl3_fake.arg2_val, opts.timeout);
+}
+
+TEST_F(FleetTest, DoesNotRetryRefusedMachines) {
+  snprintf(machines[3].ip, sizeof(machines[3].ip), "10.0.0.3");
+  opts.refused_ms = 1000;
+
+  EXPECT_EQ(fleet_connect(machines, 8, &opts), 7);
+  EXPECT_EQ(machines[3].ret, EW_SOCKET);
+  EXPECT_EQ(machines[3].attempts, 1);
+  EXPECT_EQ(calls.load(), 8);
+
+  fleet_disconnect(machines, 8);
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 7) << "only live handles are freed";
+}
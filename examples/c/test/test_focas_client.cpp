@@ -0,0 +1,265 @@
+#include "../src/focas_proto.cpp"
+#include "../src/focas_client.cpp"
+#include "../src/focas_compat.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace fanuc;
+
+/* answers on 127.0.0.1 like a controller with three axes, one thread per connection */
+class LoopbackServer {
+ public:
+  std::atomic<int> packets{0};
+  std::atomic<bool> silent{false};
+  unsigned short port = 0;
+
+  LoopbackServer() {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int one = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr));
+    listen(listen_fd_, 1024);
+    getsockname(listen_fd_, (struct sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+    accept_ = std::thread([this] { accept_loop(); });
+  }
+
+  ~LoopbackServer() {
+    shutdown(listen_fd_, SHUT_RDWR);
+    accept_.join();
+    ::close(listen_fd_);
+    std::lock_guard<std::mutex> lock(lock_);
+    for (int fd : fds_) shutdown(fd, SHUT_RDWR);
+    for (std::thread &t : conns_) t.join();
+    for (int fd : fds_) ::close(fd);
+  }
+
+ private:
+  void accept_loop() {
+    int fd;
+    while ((fd = accept(listen_fd_, NULL, NULL)) >= 0) {
+      std::lock_guard<std::mutex> lock(lock_);
+      fds_.push_back(fd);
+      conns_.emplace_back([this, fd] { serve(fd); });
+    }
+  }
+
+  void serve(int fd) {
+    std::vector<uint8_t> buf;
+    uint8_t chunk[4096];
+    ssize_t n;
+
+    while ((n = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+      buf.insert(buf.end(), chunk, chunk + n);
+      proto::Frame frame;
+      long used;
+      while ((used = proto::decode_frame(buf.data(), buf.size(), frame)) > 0) {
+        buf.erase(buf.begin(), buf.begin() + used);
+        if (!reply(fd, frame)) return;
+      }
+    }
+  }
+
+  bool reply(int fd, proto::Frame &frame) {
+    std::vector<uint8_t> out, body;
+
+    if (frame.type == proto::OPEN_REQ) {
+      proto::encode_frame(proto::OPEN_RESP, frame.body, out);
+    } else if (frame.type == proto::CLOSE_REQ) {
+      proto::encode_frame(proto::CLOSE_RESP, body, out);
+    } else {
+      std::vector<proto::SubRequest> reqs;
+      std::vector<proto::SubResponse> resps;
+      packets++;
+      if (silent) return true;
+      proto::decode_requests(frame.body, reqs);
+      for (proto::SubRequest &q : reqs) resps.push_back(answer(q));
+      proto::encode_frame(proto::VAR_RESP, proto::encode_responses(resps), out);
+    }
+    ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+    return frame.type != proto::CLOSE_REQ;
+  }
+
+  proto::SubResponse answer(const proto::SubRequest &q) {
+    proto::SubResponse s;
+    proto::Writer w(s.data);
+    uint32_t ids[4] = {0x1234, 1, 2, 0xabcdef};
+    ODBST st = {};
+
+    s.command = q.command;
+    switch (q.command) {
+      case proto::CMD_CNCID:
+        proto::put_cncid(s.data, ids);
+        break;
+      case proto::CMD_STATINFO:
+        st.run = 3;
+        st.aut = 1;
+        proto::put_status(s.data, st);
+        break;
+      case proto::CMD_PRGNUM:
+        w.i32(1234);
+        w.i32(1000);
+        break;
+      case proto::CMD_SEQNUM:
+        w.i32(42);
+        break;
+      case proto::CMD_ALARM:
+      case proto::CMD_ACTF:
+      case proto::CMD_ACTS:
+        w.i32(q.command == proto::CMD_ACTS ? 8000 : 0);
+        break;
+      case proto::CMD_POSITION:
+        for (int axis = 1; axis <= 3; axis++) {
+          if (q.args[1] == ALL_AXES || q.args[1] == axis) w.i32(q.args[0] * 100 + axis);
+        }
+        break;
+      default:
+        s.error = EW_FUNC;
+    }
+    return s;
+  }
+
+  int listen_fd_;
+  std::thread accept_;
+  std::mutex lock_;
+  std::vector<int> fds_;
+  std::vector<std::thread> conns_;
+};
+
+class FocasClientTest : public testing::Test {
+ protected:
+  LoopbackServer server;
+};
+
+TEST_F(FocasClientTest, CompatReadsThroughLoopback) {
+  unsigned short libh;
+  uint32_t ids[4];
+  ODBST st;
+  ODBMDL mdl;
+
+  ASSERT_EQ(cnc_startupprocess(0, "focas.log"), EW_OK);
+  ASSERT_EQ(cnc_allclibhndl3("127.0.0.1", server.port, 5, &libh), EW_OK);
+  ASSERT_EQ(cnc_rdcncid(libh, (unsigned long *)ids), EW_OK);
+  EXPECT_EQ(ids[0], 0x1234u);
+  EXPECT_EQ(ids[3], 0xabcdefu);
+  ASSERT_EQ(cnc_statinfo(libh, &st), EW_OK);
+  EXPECT_EQ(st.run, 3);
+  EXPECT_EQ(cnc_modal(libh, 0, 0, &mdl), EW_FUNC) << "sub-request errors are returned";
+  EXPECT_EQ(cnc_freelibhndl(libh), EW_OK);
+  EXPECT_EQ(cnc_statinfo(libh, &st), EW_HANDLE);
+}
+
+TEST_F(FocasClientTest, Rddynamic2IsOnePacket) {
+  unsigned short libh;
+  ODBDY2 dy;
+
+  ASSERT_EQ(cnc_allclibhndl3("127.0.0.1", server.port, 5, &libh), EW_OK);
+  ASSERT_EQ(cnc_rddynamic2(libh, ALL_AXES, sizeof(dy), &dy), EW_OK);
+  EXPECT_EQ(server.packets.load(), 1);
+  EXPECT_EQ(dy.axis, 3);
+  EXPECT_EQ(dy.prgnum, 1234);
+  EXPECT_EQ(dy.prgmnum, 1000);
+  EXPECT_EQ(dy.seqnum, 42);
+  EXPECT_EQ(dy.acts, 8000);
+  EXPECT_EQ(dy.pos.faxis.absolute[2], 3);
+  EXPECT_EQ(dy.pos.faxis.machine[0], 101);
+  EXPECT_EQ(dy.pos.faxis.distance[1], 302);
+
+  ASSERT_EQ(cnc_rddynamic2(libh, 2, sizeof(dy), &dy), EW_OK);
+  EXPECT_EQ(dy.axis, 2);
+  EXPECT_EQ(dy.pos.oaxis.relative, 202);
+  cnc_freelibhndl(libh);
+}
+
+TEST_F(FocasClientTest, ReportsConnectFailure) {
+  unsigned short libh;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+
+  /* a port nobody listens on */
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+  getsockname(fd, (struct sockaddr *)&addr, &len);
+
+  EXPECT_EQ(cnc_allclibhndl3("127.0.0.1", ntohs(addr.sin_port), 1, &libh), EW_SOCKET);
+  EXPECT_EQ(cnc_allclibhndl3("not-an-ip", 8193, 1, &libh), EW_SOCKET);
+  ::close(fd);
+}
+
+TEST_F(FocasClientTest, TimeoutKeepsHandleUntilFreed) {
+  unsigned short libh;
+  ODBST st;
+
+  ASSERT_EQ(cnc_allclibhndl3("127.0.0.1", server.port, 5, &libh), EW_OK);
+  ASSERT_EQ(cnc_settimeout(libh, 1), EW_OK);
+  server.silent = true;
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(cnc_statinfo(libh, &st), EW_SOCKET);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(900));
+  EXPECT_EQ(cnc_statinfo(libh, &st), EW_SOCKET) << "no new round trip on a dead handle";
+  EXPECT_EQ(server.packets.load(), 1);
+  EXPECT_EQ(cnc_freelibhndl(libh), EW_OK);
+}
+
+TEST_F(FocasClientTest, OneLoopDrivesManySessions) {
+  const int count = 200;
+  FocasClient client;
+  std::thread loop([&] { client.run(); });
+  std::atomic<int> connected{0}, answered{0};
+  std::mutex lock;
+  std::vector<unsigned short> handles;
+
+  for (int i = 0; i < count; i++) {
+    client.connect("127.0.0.1", server.port, 5, [&](short ret, unsigned short libh) {
+      if (ret != EW_OK) return;
+      std::lock_guard<std::mutex> guard(lock);
+      handles.push_back(libh);
+      connected++;
+    });
+  }
+  for (int i = 0; i < 500 && connected < count; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(connected.load(), count);
+  EXPECT_EQ(client.sessions(), (size_t)count);
+
+  /* two requests each, queued behind one another on the same connection */
+  for (unsigned short libh : handles) {
+    for (int k = 0; k < 2; k++) {
+      std::vector<proto::SubRequest> reqs(1);
+      reqs[0].command = proto::CMD_STATINFO;
+      client.request(libh, reqs, [&](short ret, std::vector<proto::SubResponse> &resps) {
+        if (ret == EW_OK && resps.size() == 1 && resps[0].error == EW_OK) answered++;
+      });
+    }
+  }
+  for (int i = 0; i < 500 && answered < 2 * count; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(answered.load(), 2 * count);
+  EXPECT_EQ(server.packets.load(), 2 * count);
+
+  for (unsigned short libh : handles) client.close(libh);
+  for (int i = 0; i < 500 && client.sessions() > 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(client.sessions(), 0u);
+  client.stop();
+  loop.join();
+}
@@ -0,0 +1,100 @@
+#include "../src/focas_proto.cpp"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace fanuc::proto;
+
+TEST(FocasProtoTest, FrameRoundTrip) {
+  std::vector<uint8_t> wire;
+  std::vector<uint8_t> body = {1, 2, 3};
+  Frame frame;
+
+  encode_frame(VAR_REQ, body, wire);
+  ASSERT_EQ(wire.size(), HEADER_SIZE + 3);
+  EXPECT_EQ(wire[0], 0xa0);
+  EXPECT_EQ(wire[6], 0x21) << "type is big endian";
+
+  EXPECT_EQ(decode_frame(wire.data(), wire.size() - 1, frame), 0) << "incomplete body";
+  EXPECT_EQ(decode_frame(wire.data(), 4, frame), 0) << "incomplete header";
+  ASSERT_EQ(decode_frame(wire.data(), wire.size(), frame), (long)wire.size());
+  EXPECT_EQ(frame.type, VAR_REQ);
+  EXPECT_EQ(frame.body, body);
+
+  wire[1] = 0x00;
+  EXPECT_LT(decode_frame(wire.data(), wire.size(), frame), 0);
+}
+
+TEST(FocasProtoTest, SubRequestsRoundTrip) {
+  std::vector<SubRequest> reqs(2), out;
+
+  reqs[0].command = CMD_POSITION;
+  reqs[0].args[0] = POS_MACHINE;
+  reqs[0].args[1] = -1;
+  reqs[1].ncpmc = TARGET_PMC;
+  reqs[1].command = CMD_PMC_READ;
+  reqs[1].payload = {9, 8, 7};
+
+  ASSERT_TRUE(decode_requests(encode_requests(reqs), out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].command, CMD_POSITION);
+  EXPECT_EQ(out[0].args[1], -1);
+  EXPECT_EQ(out[1].ncpmc, TARGET_PMC);
+  EXPECT_EQ(out[1].payload, reqs[1].payload);
+
+  std::vector<uint8_t> body = encode_requests(reqs);
+  body.pop_back();
+  EXPECT_FALSE(decode_requests(body, out));
+}
+
+TEST(FocasProtoTest, SubResponsesCarryErrors) {
+  std::vector<SubResponse> resps(2), out;
+
+  resps[0].command = CMD_STATINFO;
+  resps[0].data = {0, 1, 0, 2};
+  resps[1].command = CMD_MODAL;
+  resps[1].error = EW_NOOPT;
+
+  ASSERT_TRUE(decode_responses(encode_responses(resps), out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].data, resps[0].data);
+  EXPECT_EQ(out[1].error, EW_NOOPT);
+  EXPECT_TRUE(out[1].data.empty());
+}
+
+TEST(FocasProtoTest, PayloadsRoundTrip) {
+  std::vector<uint8_t> data;
+  ODBST st = {}, st_out;
+  st.run = 3;
+  st.alarm = 1;
+  put_status(data, st);
+  ASSERT_TRUE(get_status(data, st_out));
+  EXPECT_EQ(st_out.run, 3);
+  EXPECT_EQ(st_out.alarm, 1);
+
+  ODBMDL mdl = {}, mdl_out;
+  mdl.type = -2;
+  mdl.modal.raux1[26].aux_data = -1234567;
+  mdl.modal.raux1[26].flag1 = 1;
+  data.clear();
+  put_modal(data, mdl);
+  ASSERT_TRUE(get_modal(data, mdl_out));
+  EXPECT_EQ(mdl_out.modal.raux1[26].aux_data, -1234567);
+  EXPECT_EQ(mdl_out.modal.raux1[26].flag1, 1);
+
+  double values[3] = {1.5, -2.25, 1e300}, values_out[3];
+  data.clear();
+  put_pmc(data, 5, values, 3);
+  ASSERT_EQ(data.size(), 24u);
+  ASSERT_EQ(get_pmc(data, 5, values_out, 3), 3u);
+  EXPECT_EQ(values_out[2], 1e300);
+
+  long words[2] = {-5, 70000}, words_out[2];
+  data.clear();
+  put_pmc(data, 2, words, 2);
+  ASSERT_EQ(data.size(), 8u) << "long is 4 bytes on the wire";
+  ASSERT_EQ(get_pmc(data, 2, words_out, 2), 2u);
+  EXPECT_EQ(words_out[0], -5);
+  EXPECT_EQ(words_out[1], 70000);
+}
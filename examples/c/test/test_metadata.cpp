@@ -0,0 +1,81 @@
+extern "C" {
+  #include "../src/metadata.c"
+}
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, cnc_rdcncid, unsigned short, unsigned long *);
+FAKE_VALUE_FUNC(short, cnc_sysinfo, unsigned short, ODBSYS *);
+FAKE_VALUE_FUNC(short, cnc_rdsyssoft, unsigned short, ODBSYSS *);
+FAKE_VALUE_FUNC(short, cnc_rdaxisname, unsigned short, short *, ODBAXISNAME *);
+FAKE_VALUE_FUNC(short, cnc_rdspdlname, unsigned short, short *, ODBSPDLNAME *);
+}  // namespace Fwlib32
+
+static short fake_rdcncid(unsigned short libh, unsigned long *ids) {
+  uint32_t *id = (uint32_t *)ids;
+  id[0] = 0x1234;
+  id[1] = 1;
+  id[2] = 2;
+  id[3] = 0xabcdef;
+  return EW_OK;
+}
+
+static short fake_rdaxisname(unsigned short libh, short *num, ODBAXISNAME *axes) {
+  const char names[] = "XZC";
+  for (int i = 0; i < 3; i++) {
+    axes[i].name = names[i];
+    axes[i].suff = ' ';
+  }
+  *num = 3;
+  return EW_OK;
+}
+
+class MetadataTest : public testing::Test {
+ protected:
+  Metadata meta;
+
+  void SetUp() override {
+    RESET_FAKE(cnc_rdcncid);
+    RESET_FAKE(cnc_sysinfo);
+    RESET_FAKE(cnc_rdsyssoft);
+    RESET_FAKE(cnc_rdaxisname);
+    RESET_FAKE(cnc_rdspdlname);
+    FFF_RESET_HISTORY();
+    cnc_rdcncid_fake.custom_fake = fake_rdcncid;
+    cnc_rdaxisname_fake.custom_fake = fake_rdaxisname;
+  }
+};
+
+TEST_F(MetadataTest, LoadsEverything) {
+  ASSERT_EQ(metadata_load(1, &meta), EW_OK);
+
+  EXPECT_TRUE(meta.loaded);
+  EXPECT_STREQ(meta.cnc_id, "00001234-00000001-00000002-00abcdef");
+  EXPECT_EQ(meta.naxes, 3);
+  EXPECT_EQ(meta.axes[2].name, 'C');
+  EXPECT_EQ(cnc_sysinfo_fake.call_count, 1);
+  EXPECT_EQ(cnc_rdsyssoft_fake.call_count, 1);
+  EXPECT_EQ(cnc_rdspdlname_fake.call_count, 1);
+}
+
+TEST_F(MetadataTest, UnsupportedCallsAreSkipped) {
+  cnc_rdsyssoft_fake.return_val = EW_FUNC;
+  cnc_rdspdlname_fake.return_val = EW_NOOPT;
+
+  ASSERT_EQ(metadata_load(1, &meta), EW_OK);
+  EXPECT_TRUE(meta.loaded);
+  EXPECT_EQ(meta.nspindles, 0);
+  EXPECT_EQ(meta.naxes, 3);
+}
+
+TEST_F(MetadataTest, TransportErrorLeavesCacheEmpty) {
+  cnc_rdaxisname_fake.custom_fake = NULL;
+  cnc_rdaxisname_fake.return_val = EW_SOCKET;
+
+  EXPECT_EQ(metadata_load(1, &meta), EW_SOCKET);
+  EXPECT_FALSE(meta.loaded);
+  EXPECT_EQ(cnc_rdspdlname_fake.call_count, 0);
+}
@@ -0,0 +1,158 @@
+extern "C" {
+  #include "../src/paths.c"
+}
+
+#include <atomic>
+#include <vector>
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, cnc_allclibhndl3, const char *, unsigned short, long, unsigned short *);
+FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+FAKE_VALUE_FUNC(short, cnc_setpath, unsigned short, short);
+FAKE_VALUE_FUNC(short, cnc_getpath, unsigned short, short *, short *);
+}  // namespace Fwlib32
+
+static std::atomic<unsigned short> next_handle;
+static short selected[32];  // path selected on each handle
+static std::atomic<int> setpaths;
+
+static short fake_connect(const char *ip, unsigned short port, long timeout, unsigned short *libh) {
+  *libh = ++next_handle;
+  selected[*libh] = 1;
+  return EW_OK;
+}
+
+static short fake_setpath(unsigned short libh, short path) {
+  ++setpaths;
+  selected[libh] = path;
+  return EW_OK;
+}
+
+static short fake_getpath(unsigned short libh, short *path, short *max) {
+  *path = selected[libh];
+  *max = 3;
+  return EW_OK;
+}
+
+/* records the path that was selected when the read ran */
+struct seen {
+  short path;
+  unsigned short libh;
+};
+
+static short read_path(unsigned short libh, void *arg) {
+  struct seen *s = (struct seen *)arg;
+  s->path = selected[libh];
+  s->libh = libh;
+  return EW_OK;
+}
+
+class PathsTest : public testing::Test {
+ protected:
+  PathScheduler sched;
+  PathCycle cycle;
+  seen out[6];
+  PathRead reads[6];
+
+  void SetUp() override {
+    RESET_FAKE(cnc_allclibhndl3);
+    RESET_FAKE(cnc_freelibhndl);
+    RESET_FAKE(cnc_setpath);
+    RESET_FAKE(cnc_getpath);
+    FFF_RESET_HISTORY();
+    next_handle = 0;
+    setpaths = 0;
+    cnc_allclibhndl3_fake.custom_fake = fake_connect;
+    cnc_setpath_fake.custom_fake = fake_setpath;
+    cnc_getpath_fake.custom_fake = fake_getpath;
+
+    /* interleaved the way a naive poller would issue them */
+    short paths[6] = {1, 2, 3, 1, 2, 3};
+    for (int i = 0; i < 6; i++) {
+      reads[i].path = paths[i];
+      reads[i].fn = read_path;
+      reads[i].arg = &out[i];
+      out[i].path = 0;
+    }
+  }
+
+  void TearDown() override { paths_close(&sched); }
+};
+
+TEST_F(PathsTest, SwitchesOncePerPath) {
+  paths_init(&sched, "1.2.3.4", 8193, 10, 0);
+
+  ASSERT_EQ(paths_poll(&sched, reads, 6, &cycle), 0);
+
+  EXPECT_EQ(cycle.switches, 2) << "paths 2 and 3, path 1 was already selected";
+  EXPECT_EQ(setpaths.load(), 2);
+  for (int i = 0; i < 6; i++) {
+    EXPECT_EQ(reads[i].ret, EW_OK);
+    EXPECT_EQ(out[i].path, reads[i].path) << "read " << i << " ran on the wrong path";
+  }
+  ASSERT_EQ(cycle.npaths, 3);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(cycle.paths[i].path, i + 1);
+    EXPECT_EQ(cycle.paths[i].reads, 2);
+    EXPECT_GE(cycle.paths[i].done_ms, cycle.timestamp_ms);
+  }
+}
+
+TEST_F(PathsTest, StartsWithSelectedPath) {
+  paths_init(&sched, "1.2.3.4", 8193, 10, 0);
+
+  ASSERT_EQ(paths_poll(&sched, reads, 6, &cycle), 0);
+  ASSERT_EQ(sched.current, 3);
+  ASSERT_EQ(paths_poll(&sched, reads, 6, &cycle), 0);
+
+  EXPECT_EQ(cycle.switches, 2) << "3 -> 1 -> 2, no switch back to 3 first";
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1);
+  EXPECT_EQ(cnc_getpath_fake.call_count, 1);
+}
+
+TEST_F(PathsTest, InvalidPathFailsOnlyThatRead) {
+  paths_init(&sched, "1.2.3.4", 8193, 10, 0);
+  reads[5].path = 0;
+
+  EXPECT_EQ(paths_poll(&sched, reads, 6, &cycle), 1);
+  EXPECT_EQ(reads[5].ret, EW_PATH);
+  EXPECT_EQ(out[5].path, 0);
+  EXPECT_EQ(reads[2].ret, EW_OK);
+}
+
+TEST_F(PathsTest, TransportErrorReconnectsNextCycle) {
+  paths_init(&sched, "1.2.3.4", 8193, 10, 0);
+  cnc_setpath_fake.custom_fake = NULL;
+  cnc_setpath_fake.return_val = EW_SOCKET;
+
+  EXPECT_EQ(paths_poll(&sched, reads, 6, &cycle), 4);
+  EXPECT_EQ(reads[0].ret, EW_OK);
+  EXPECT_EQ(reads[1].ret, EW_SOCKET);
+  EXPECT_EQ(reads[2].ret, EW_SOCKET);
+  EXPECT_EQ(cnc_setpath_fake.call_count, 1) << "no more round trips on a dead handle";
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 1);
+
+  cnc_setpath_fake.custom_fake = fake_setpath;
+  EXPECT_EQ(paths_poll(&sched, reads, 6, &cycle), 0);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 2);
+}
+
+TEST_F(PathsTest, ParallelKeepsOneHandlePerPath) {
+  paths_init(&sched, "1.2.3.4", 8193, 10, 1);
+
+  ASSERT_EQ(paths_poll(&sched, reads, 6, &cycle), 0);
+  EXPECT_EQ(cycle.switches, 3) << "each new handle selects its path once";
+  ASSERT_EQ(paths_poll(&sched, reads, 6, &cycle), 0);
+  EXPECT_EQ(cycle.switches, 0);
+
+  EXPECT_EQ(next_handle.load(), 3);
+  for (int i = 0; i < 6; i++) {
+    EXPECT_EQ(out[i].path, reads[i].path);
+  }
+  EXPECT_EQ(out[0].libh, out[3].libh);
+  EXPECT_NE(out[0].libh, out[1].libh);
+}
@@ -0,0 +1,91 @@
+#include "../src/pmc_plan.cpp"
+#include "../src/pmc_address.hpp"
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, pmc_rdwrpmcrng, unsigned short, short, IODBRWPMC *);
+FAKE_VALUE_FUNC(short, pmc_rdpmcrng, unsigned short, short, short, unsigned short, unsigned short,
+                unsigned short, IODBPMC *);
+}  // namespace Fwlib32
+
+using namespace fanuc;
+
+/* checked by the compiler, FW_PMC("R100.9") would not build */
+static_assert(FW_PMC("R100.3").area == PmcArea::R, "area");
+static_assert(FW_PMC("R100.3").byte == 100 && FW_PMC("R100.3").bit == 3, "bit address");
+static_assert(FW_PMC("D2000:L").type == PmcType::Long && FW_PMC("D2000:L").width() == 4, "long");
+static_assert(FW_PMC("D2000:L").bit == -1, "whole value");
+static_assert(FW_PMC("f0.5") == pmc_address("F0.5"), "lower case area");
+static_assert(FW_PMC("E65535").byte == 65535, "last byte");
+static_assert(FW_PMC("D8:D").signal().width == 8, "double");
+
+TEST(PmcAddressTest, RejectsMalformedAddresses) {
+  PmcAddress a;
+  for (const char *bad : {"", "Q1", "R", "R.1", "R100.8", "R100.10", "R100.", "R100:", "R100:Q",
+                          "R100:LL", "R100.1:W", "R65536", "D65534:L", "R100 ", "R-1", "1R"}) {
+    EXPECT_FALSE(pmc_parse(bad, &a)) << bad;
+  }
+  EXPECT_THROW(pmc_address("X12.9"), std::invalid_argument);
+
+  a.byte = 12345;
+  EXPECT_FALSE(pmc_parse("G", &a));
+  EXPECT_EQ(a.byte, 12345) << "left alone on failure";
+  ASSERT_TRUE(pmc_parse("Y7.0", &a));
+  EXPECT_EQ(a.bit, 0);
+}
+
+TEST(PmcAddressTest, MatchesTheLibraryCodes) {
+  ODBPMCADRINFO info = FW_PMC("D2000:W").info();
+  EXPECT_EQ(info.sAdrType, 9);
+  EXPECT_EQ(info.iAdrNum, 2000);
+  EXPECT_EQ(info.sBitPos, -1);
+  EXPECT_EQ(info.sDataType, 1);
+  EXPECT_EQ(static_cast<short>(pmc_address("X3").area), 3);
+}
+
+TEST(PmcAddressTest, ReadsFromARangeBuffer) {
+  const uint8_t data[] = {0x08, 0x34, 0x12, 0x00, 0x00, 0x80, 0x3f, 0xff};
+  PmcBuffer buf{PmcArea::D, 100, data, sizeof(data)};
+
+  EXPECT_TRUE(buf.holds(FW_PMC("D100.3")));
+  EXPECT_TRUE(buf.bit(FW_PMC("D100.3")));
+  EXPECT_FALSE(buf.bit(FW_PMC("D100.2")));
+  EXPECT_EQ(buf.get<int16_t>(FW_PMC("D101:W")), 0x1234);
+  EXPECT_EQ(buf.get<float>(FW_PMC("D103:F")), 1.0f);
+  EXPECT_EQ(buf.get<int8_t>(FW_PMC("D107")), -1);
+  EXPECT_FALSE(buf.holds(FW_PMC("D105:L")));
+  EXPECT_FALSE(buf.holds(FW_PMC("R100")));
+  EXPECT_FALSE(buf.holds(FW_PMC("D99")));
+}
+
+static short fake_rdwrpmcrng(unsigned short libh, short num, IODBRWPMC *buf) {
+  for (short i = 0; i < num; i++) {
+    for (short n = 0; n < buf[i].length; n++)
+      ((uint8_t *)buf[i].data)[n] = (uint8_t)(buf[i].datano_s + n);
+  }
+  return EW_OK;
+}
+
+TEST(PmcAddressTest, ValuesBindToTheReaderImage) {
+  RESET_FAKE(pmc_rdwrpmcrng);
+  pmc_rdwrpmcrng_fake.custom_fake = fake_rdwrpmcrng;
+  constexpr PmcAddress start = FW_PMC("R5.2"), count = FW_PMC("D40:L"), mode = FW_PMC("R17:W");
+  PmcReader reader{PmcPlan({start.signal(), count.signal(), mode.signal()})};
+
+  PmcValue<bool> running(reader, start);
+  PmcValue<int32_t> parts(reader, count);
+  PmcValue<int16_t> word(reader, mode);
+  ASSERT_TRUE(running.valid() && parts.valid() && word.valid());
+  EXPECT_FALSE(PmcValue<int16_t>(reader, count).valid()) << "wrong width";
+  EXPECT_FALSE(PmcValue<bool>(reader, FW_PMC("R300.1")).valid()) << "not in the plan";
+  EXPECT_FALSE(PmcValue<int32_t>(reader, FW_PMC("D42:L")).valid()) << "partly in the plan";
+
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_TRUE(running.get()) << "R5 holds 5 here";
+  EXPECT_EQ(parts.get(), 40 | 41 << 8 | 42 << 16 | 43 << 24);
+  EXPECT_EQ(word.get(), 17 | 18 << 8);
+  EXPECT_EQ(reader.plan().locate(PmcArea::D, 41, 2), reader.plan().locate(PmcArea::D, 40) + 1);
+}
@@ -0,0 +1,144 @@
+extern "C" {
+  #include "../src/pmc_diff.c"
+}
+#include "../src/pmc_plan.cpp"
+#include "../src/pmc_capture.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, cnc_allclibhndl3, const char *, unsigned short, long, unsigned short *);
+FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+FAKE_VALUE_FUNC(short, pmc_rdwrpmcrng, unsigned short, short, IODBRWPMC *);
+FAKE_VALUE_FUNC(short, pmc_rdpmcrng, unsigned short, short, short, unsigned short, unsigned short,
+                unsigned short, IODBPMC *);
+}  // namespace Fwlib32
+
+using namespace fanuc;
+using namespace std::chrono;
+
+/* reads made so far, the fake controller's memory is a function of it */
+static std::atomic<int> reads;
+static short (*fail_at)(int read);
+static uint8_t (*memory)(int read, unsigned address);
+static milliseconds read_time;
+
+static short fake_connect(const char *ip, unsigned short port, long timeout, unsigned short *libh) {
+  *libh = 3;
+  return EW_OK;
+}
+
+static short fake_rdpmcrng(unsigned short libh, short adr_type, short data_type, unsigned short s,
+                           unsigned short e, unsigned short length, IODBPMC *buf) {
+  int k = reads++;
+  if (read_time > milliseconds(0)) std::this_thread::sleep_for(read_time);
+  if (fail_at != nullptr && fail_at(k) != EW_OK) return fail_at(k);
+  for (unsigned n = s; n <= e; n++) ((uint8_t *)buf->u.cdata)[n - s] = memory(k, n);
+  return EW_OK;
+}
+
+static uint8_t quiet(int read, unsigned address) { return 0; }
+
+/* waits for the capture thread, a stuck capture fails the test instead of hanging it */
+static PmcCapture::Stats wait_samples(const PmcCapture &capture, unsigned long samples) {
+  auto deadline = steady_clock::now() + seconds(5);
+  while (capture.stats().samples < samples && steady_clock::now() < deadline)
+    std::this_thread::sleep_for(milliseconds(1));
+  return capture.stats();
+}
+
+class PmcCaptureTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    RESET_FAKE(cnc_allclibhndl3);
+    RESET_FAKE(cnc_freelibhndl);
+    RESET_FAKE(pmc_rdwrpmcrng);
+    RESET_FAKE(pmc_rdpmcrng);
+    FFF_RESET_HISTORY();
+    cnc_allclibhndl3_fake.custom_fake = fake_connect;
+    pmc_rdpmcrng_fake.custom_fake = fake_rdpmcrng;
+    reads = 0;
+    fail_at = nullptr;
+    memory = quiet;
+    read_time = milliseconds(0);
+  }
+};
+
+TEST_F(PmcCaptureTest, ReportsEdgesOfWatchedBytes) {
+  /* R10.0 toggles every third read until the 12th, R14.7 comes on at the 5th, R12 is noise */
+  memory = [](int k, unsigned address) -> uint8_t {
+    if (address == 10) return k < 12 ? (k / 3) % 2 : 1;
+    if (address == 14) return k >= 5 ? 0x80 : 0;
+    return address == 12 ? (uint8_t)k : 0;
+  };
+  PmcCapture capture("127.0.0.1", 8193, 10, {{PmcArea::R, 10}, {PmcArea::R, 14}});
+  ASSERT_EQ(capture.plan().ranges().size(), 1u);
+  PmcCapture::Stats stats = wait_samples(capture, 20);
+  capture.stop();
+
+  pmc_edge edges[8];
+  ASSERT_EQ(capture.drain(edges, 8), 4u);
+  EXPECT_EQ(edges[0].address, 10);
+  EXPECT_EQ(edges[0].new_value, 1);
+  EXPECT_EQ(edges[1].address, 14);
+  EXPECT_EQ(edges[1].bit, 7);
+  EXPECT_EQ(edges[1].area, 5);
+  EXPECT_EQ(edges[2].address, 10);
+  EXPECT_EQ(edges[2].new_value, 0);
+  EXPECT_EQ(edges[3].address, 10);
+  for (int i = 1; i < 4; i++) EXPECT_GT(edges[i].time, edges[i - 1].time);
+  EXPECT_EQ(stats.edges, 4u);
+  EXPECT_EQ(stats.errors, 0u);
+  EXPECT_EQ(capture.drain(edges, 8), 0u);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.call_count, 0u) << "range reads only";
+}
+
+TEST_F(PmcCaptureTest, ReconnectsAfterTransportErrors) {
+  fail_at = [](int k) -> short { return k == 3 ? EW_SOCKET : k == 6 ? EW_DATA : EW_OK; };
+  {
+    PmcCapture capture("127.0.0.1", 8193, 10, {{PmcArea::G, 4}});
+    PmcCapture::Stats stats = wait_samples(capture, 10);
+    EXPECT_EQ(stats.errors, 2u);
+    EXPECT_EQ(stats.reconnects, 1u);
+    EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 2u);
+  }
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 2u) << "dropped handle and the last one";
+}
+
+TEST_F(PmcCaptureTest, DropsEdgesWhenTheRingIsFull) {
+  memory = [](int k, unsigned address) -> uint8_t { return k < 10 && k % 2 == 1 ? 0xff : 0; };
+  PmcCaptureOptions opts;
+  opts.ring = 3;
+  PmcCapture capture("127.0.0.1", 8193, 10, {{PmcArea::X, 0}}, opts);
+  PmcCapture::Stats stats = wait_samples(capture, 12);
+
+  pmc_edge edges[8];
+  ASSERT_EQ(capture.drain(edges, 8), 4u) << "rounded up to a power of two";
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(edges[i].bit, i);
+    EXPECT_EQ(edges[i].new_value, 1);
+  }
+  EXPECT_EQ(stats.edges, 4u);
+  EXPECT_EQ(stats.dropped, 10u * 8 - 4);
+}
+
+TEST_F(PmcCaptureTest, MeasuresRateAndShortestPulse) {
+  read_time = milliseconds(2);
+  PmcCaptureOptions opts;
+  opts.cpu = 1 << 20;
+  PmcCapture capture("127.0.0.1", 8193, 10, {{PmcArea::F, 0}}, opts);
+  PmcCapture::Stats stats = wait_samples(capture, 10);
+
+  EXPECT_FALSE(stats.pinned) << "no such cpu";
+  EXPECT_GE(stats.read_max, milliseconds(2));
+  EXPECT_GE(stats.min_pulse(), milliseconds(4)) << "a read and the next one";
+  EXPECT_GT(stats.rate(), 0);
+  EXPECT_LE(stats.rate(), 500);
+  EXPECT_FALSE(PmcCapture::pin(-1));
+}
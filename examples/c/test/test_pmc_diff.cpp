@@ -0,0 +1,119 @@
+extern "C" {
+  #include "../src/pmc_diff.c"
+}
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+static const char *kernels[] = {"scalar", "sse2", "avx2", "neon"};
+
+class PmcDiffTest : public testing::TestWithParam<const char *> {
+ protected:
+  pmc_diff d;
+
+  void SetUp() override {
+    memset(&d, 0, sizeof(d));
+    if (!pmc_diff_use(GetParam())) GTEST_SKIP() << GetParam() << " not supported here";
+    ASSERT_EQ(pmc_diff_init(&d, 5, 1000, 300), 0);
+  }
+
+  void TearDown() override {
+    pmc_diff_free(&d);
+    pmc_diff_use(NULL);
+  }
+};
+
+TEST_P(PmcDiffTest, FindsTheFirstDifferenceAtEveryOffset) {
+  std::vector<uint8_t> a(200, 0x5a), b(200, 0x5a);
+
+  for (std::size_t n = 0; n <= a.size(); n++) {
+    EXPECT_EQ(pmc_diff_find(a.data(), b.data(), 0, n), n);
+  }
+  for (std::size_t i = 0; i < a.size(); i++) {
+    b[i] ^= 0x10;
+    EXPECT_EQ(pmc_diff_find(a.data(), b.data(), 0, a.size()), i);
+    EXPECT_EQ(pmc_diff_find(a.data(), b.data(), i + 1, a.size()), a.size());
+    if (i >= 3) {
+      EXPECT_EQ(pmc_diff_find(a.data(), b.data(), i - 3, i + 1), i);
+    }
+    b[i] ^= 0x10;
+  }
+}
+
+TEST_P(PmcDiffTest, ReportsEveryFlippedBit) {
+  std::mt19937 rng(11);
+  std::vector<uint8_t> image(300), next;
+  pmc_edge out[4096];
+
+  for (uint8_t &v : image) v = (uint8_t)rng();
+  EXPECT_EQ(pmc_diff_update(&d, image.data(), 1, out, 4096), 0u) << "the first image primes";
+  EXPECT_EQ(pmc_diff_update(&d, image.data(), 2, out, 4096), 0u);
+
+  for (int round = 0; round < 20; round++) {
+    next = image;
+    for (int k = 0; k < round * 3; k++) next[rng() % next.size()] ^= (uint8_t)(1u << (rng() % 8));
+
+    std::vector<pmc_edge> expect;
+    for (std::size_t i = 0; i < image.size(); i++) {
+      for (int bit = 0; bit < 8; bit++) {
+        if (((image[i] ^ next[i]) >> bit & 1) == 0) continue;
+        pmc_edge e = {};
+        e.address = (uint16_t)(1000 + i);
+        e.bit = (uint8_t)bit;
+        e.old_value = image[i] >> bit & 1;
+        e.new_value = next[i] >> bit & 1;
+        expect.push_back(e);
+      }
+    }
+
+    std::size_t n = pmc_diff_update(&d, next.data(), 100 + round, out, 4096);
+    ASSERT_EQ(n, expect.size()) << round;
+    for (std::size_t i = 0; i < n; i++) {
+      EXPECT_EQ(out[i].address, expect[i].address);
+      EXPECT_EQ(out[i].bit, expect[i].bit);
+      EXPECT_EQ(out[i].old_value, expect[i].old_value);
+      EXPECT_EQ(out[i].new_value, expect[i].new_value);
+      EXPECT_EQ(out[i].area, 5);
+      EXPECT_EQ(out[i].time, (uint64_t)(100 + round));
+    }
+    image = next;
+  }
+}
+
+TEST_P(PmcDiffTest, ContinuesWhereTheBufferFilledUp) {
+  std::vector<uint8_t> image(300, 0);
+  pmc_edge out[3];
+
+  pmc_diff_update(&d, image.data(), 0, out, 3);
+  image[7] = 0xff;
+  image[299] = 0x80;
+
+  std::size_t total = 0, n;
+  while ((n = pmc_diff_update(&d, image.data(), 1, out, 3)) > 0) {
+    for (std::size_t i = 0; i < n; i++) {
+      EXPECT_EQ(out[i].address, total + i < 8 ? 1007 : 1299);
+      EXPECT_EQ(out[i].bit, total + i < 8 ? total + i : 7u);
+      EXPECT_EQ(out[i].new_value, 1);
+    }
+    total += n;
+  }
+  EXPECT_EQ(total, 9u);
+  EXPECT_EQ(pmc_diff_update(&d, image.data(), 2, out, 3), 0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, PmcDiffTest, testing::ValuesIn(kernels),
+                         [](const testing::TestParamInfo<const char *> &info) {
+                           return std::string(info.param);
+                         });
+
+TEST(PmcDiffInit, RejectsImagesPastTheArea) {
+  pmc_diff d;
+  EXPECT_EQ(pmc_diff_init(&d, 9, 65000, 1000), -1);
+  EXPECT_EQ(pmc_diff_init(&d, 9, 0, 0), -1);
+  ASSERT_EQ(pmc_diff_init(&d, 9, 64536, 1000), 0);
+  pmc_diff_free(&d);
+}
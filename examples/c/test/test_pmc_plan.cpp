@@ -0,0 +1,156 @@
+#include "../src/pmc_plan.cpp"
+
+#include <cstring>
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, pmc_rdwrpmcrng, unsigned short, short, IODBRWPMC *);
+FAKE_VALUE_FUNC(short, pmc_rdpmcrng, unsigned short, short, short, unsigned short, unsigned short,
+                unsigned short, IODBPMC *);
+}  // namespace Fwlib32
+
+using namespace fanuc;
+
+/* PMC memory of the fake controller, byte n of area a holds a * 16 + n */
+static uint8_t mem(short area, unsigned address) { return (uint8_t)(area * 16 + address); }
+
+static short fake_rdwrpmcrng(unsigned short libh, short num, IODBRWPMC *buf) {
+  for (short i = 0; i < num; i++) {
+    buf[i].err_code = buf[i].type_a == 20 ? EW_RANGE : EW_OK;
+    for (short n = 0; n < buf[i].length; n++)
+      ((uint8_t *)buf[i].data)[n] = mem(buf[i].type_a, buf[i].datano_s + n);
+  }
+  return EW_OK;
+}
+
+static short fake_rdpmcrng(unsigned short libh, short adr_type, short data_type, unsigned short s,
+                           unsigned short e, unsigned short length, IODBPMC *buf) {
+  if (length != offsetof(IODBPMC, u) + (e - s + 1)) return EW_LENGTH;
+  for (unsigned n = s; n <= e; n++) ((uint8_t *)buf->u.cdata)[n - s] = mem(adr_type, n);
+  return EW_OK;
+}
+
+class PmcPlanTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    RESET_FAKE(pmc_rdwrpmcrng);
+    RESET_FAKE(pmc_rdpmcrng);
+    FFF_RESET_HISTORY();
+    pmc_rdwrpmcrng_fake.custom_fake = fake_rdwrpmcrng;
+    pmc_rdpmcrng_fake.custom_fake = fake_rdpmcrng;
+  }
+};
+
+static std::vector<PmcSignal> scattered() {
+  return {
+      {PmcArea::R, 100}, {PmcArea::R, 101, 2}, {PmcArea::R, 120}, {PmcArea::R, 900},
+      {PmcArea::D, 0, 4}, {PmcArea::G, 4},     {PmcArea::R, 100}, {PmcArea::F, 0},
+  };
+}
+
+TEST_F(PmcPlanTest, MergesWhenTheGapIsCheaperThanAnEntry) {
+  PmcPlanOptions opts;
+  opts.entry_bytes = 20;
+  PmcPlan plan(scattered(), opts);
+
+  /* R100-R121 share a range, R900 is too far away */
+  ASSERT_EQ(plan.ranges().size(), 5u);
+  EXPECT_EQ(plan.ranges()[0].area, PmcArea::G);
+  EXPECT_EQ(plan.ranges()[2].start, 100);
+  EXPECT_EQ(plan.ranges()[2].end, 120);
+  EXPECT_EQ(plan.ranges()[3].start, 900);
+  EXPECT_EQ(plan.ranges()[4].bytes(), 4u);
+  EXPECT_EQ(plan.bytes(), 1u + 1u + 21u + 1u + 4u);
+  EXPECT_EQ(plan.wasted_bytes(), 17u);
+
+  EXPECT_EQ(plan.round_trips_naive(), 7u) << "R100 twice is one read";
+  EXPECT_EQ(plan.round_trips(), 1u);
+  EXPECT_EQ(plan.offset(1), plan.ranges()[2].offset + 1);
+  EXPECT_NE(plan.describe().find("7 round trips one by one, 1 planned"), std::string::npos);
+}
+
+TEST_F(PmcPlanTest, SingleRangeReadsMergeFarther) {
+  PmcPlanOptions opts;
+  opts.multi = false;
+  opts.round_trip_bytes = 1000;
+  PmcPlan plan(scattered(), opts);
+
+  ASSERT_EQ(plan.ranges().size(), 4u);
+  EXPECT_EQ(plan.ranges()[2].start, 100);
+  EXPECT_EQ(plan.ranges()[2].end, 900);
+  EXPECT_EQ(plan.round_trips(), 4u) << "one pmc_rdpmcrng per range";
+}
+
+TEST_F(PmcPlanTest, KeepsToTheCallLimits) {
+  std::vector<PmcSignal> signals;
+  for (uint16_t a = 0; a < 4000; a += 9) signals.push_back({PmcArea::R, a, 2});
+  for (uint16_t a = 0; a < 400; a += 40) signals.push_back({PmcArea::D, a, 4});
+  PmcPlanOptions opts;
+  opts.max_range_bytes = 100;
+  opts.max_call_bytes = 300;
+  opts.max_entries = 4;
+  PmcPlan plan(signals, opts);
+
+  for (const PmcRange &r : plan.ranges()) EXPECT_LE(r.bytes(), 100u);
+  std::size_t ranges = 0;
+  for (const PmcCall &c : plan.calls()) {
+    EXPECT_LE(c.ranges.size(), 4u);
+    EXPECT_LE(c.bytes, 300u);
+    ranges += c.ranges.size();
+  }
+  EXPECT_EQ(ranges, plan.ranges().size());
+  EXPECT_EQ(plan.round_trips_naive(), signals.size());
+  EXPECT_LT(plan.round_trips(), signals.size() / 10);
+}
+
+TEST_F(PmcPlanTest, ValuesAreDecodedFromTheImage) {
+  PmcReader reader{PmcPlan(scattered())};
+
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(reader.multi(), 1);
+  EXPECT_EQ(reader.round_trips(), 1u);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.call_count, 1u);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.arg1_history[0], 5);
+
+  EXPECT_EQ(reader.byte(0), mem(5, 100));
+  EXPECT_EQ(reader.word(1), (int16_t)(mem(5, 101) | mem(5, 102) << 8));
+  EXPECT_EQ(reader.dword(4), (int32_t)(mem(9, 0) | mem(9, 1) << 8 | mem(9, 2) << 16 | mem(9, 3) << 24));
+  EXPECT_EQ(reader.byte(3), mem(5, 900));
+  EXPECT_EQ(reader.bit(5, 2), (mem(0, 4) >> 2 & 1) != 0);
+  EXPECT_EQ(reader.bit(4, 9), (mem(9, 1) >> 1 & 1) != 0);
+}
+
+TEST_F(PmcPlanTest, FallsBackToRangeReads) {
+  pmc_rdwrpmcrng_fake.custom_fake = NULL;
+  pmc_rdwrpmcrng_fake.return_val = EW_FUNC;
+  PmcReader reader{PmcPlan(scattered())};
+
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(reader.multi(), 0);
+  EXPECT_EQ(pmc_rdpmcrng_fake.call_count, 5u);
+  EXPECT_EQ(reader.round_trips(), 6u);
+  EXPECT_EQ(reader.byte(3), mem(5, 900));
+
+  /* remembered until the reader is reset */
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.call_count, 1u);
+  EXPECT_EQ(reader.round_trips(), 5u);
+  reader.reset();
+  ASSERT_EQ(reader.read(1), EW_OK);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.call_count, 2u);
+}
+
+TEST_F(PmcPlanTest, RefusedEntriesAreReturned) {
+  PmcReader reader(PmcPlan({{PmcArea::R, 0}, {static_cast<PmcArea>(20), 0}}));
+
+  pmc_rdwrpmcrng_fake.custom_fake = [](unsigned short libh, short num, IODBRWPMC *buf) -> short {
+    fake_rdwrpmcrng(libh, num, buf);
+    return EW_DATA;
+  };
+  EXPECT_EQ(reader.read(1), EW_RANGE);
+  EXPECT_EQ(reader.multi(), -1);
+  EXPECT_EQ(pmc_rdpmcrng_fake.call_count, 0u);
+}
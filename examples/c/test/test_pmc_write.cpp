@@ -0,0 +1,185 @@
+#include "../src/pmc_plan.cpp"
+#include "../src/pmc_write.cpp"
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+namespace Fwlib32 {
+FAKE_VALUE_FUNC(short, pmc_rdwrpmcrng, unsigned short, short, IODBRWPMC *);
+FAKE_VALUE_FUNC(short, pmc_rdpmcrng, unsigned short, short, short, unsigned short, unsigned short,
+                unsigned short, IODBPMC *);
+FAKE_VALUE_FUNC(short, pmc_wrpmcrng, unsigned short, unsigned short, IODBPMC *);
+}  // namespace Fwlib32
+
+using namespace fanuc;
+
+/* PMC memory of the fake controller, R30 is stuck at zero */
+static uint8_t mem[13][65536];
+
+static void store(short area, unsigned address, uint8_t value) {
+  if (area != 5 || address != 30) mem[area][address] = value;
+}
+
+static short fake_rdwrpmcrng(unsigned short libh, short num, IODBRWPMC *buf) {
+  for (short i = 0; i < num; i++) {
+    uint8_t *data = (uint8_t *)buf[i].data;
+    for (short n = 0; n < buf[i].length; n++) {
+      if (buf[i].type_rw == 1)
+        store(buf[i].type_a, buf[i].datano_s + n, data[n]);
+      else
+        data[n] = mem[buf[i].type_a][buf[i].datano_s + n];
+    }
+    buf[i].err_code = EW_OK;
+  }
+  return EW_OK;
+}
+
+static short fake_rdpmcrng(unsigned short libh, short adr_type, short data_type, unsigned short s,
+                           unsigned short e, unsigned short length, IODBPMC *buf) {
+  for (unsigned n = s; n <= e; n++) ((uint8_t *)buf->u.cdata)[n - s] = mem[adr_type][n];
+  return EW_OK;
+}
+
+static short fake_wrpmcrng(unsigned short libh, unsigned short length, IODBPMC *buf) {
+  unsigned short s = (unsigned short)buf->datano_s, e = (unsigned short)buf->datano_e;
+  if (length != offsetof(IODBPMC, u) + (e - s + 1)) return EW_LENGTH;
+  for (unsigned n = s; n <= e; n++) store(buf->type_a, n, ((uint8_t *)buf->u.cdata)[n - s]);
+  return EW_OK;
+}
+
+class PmcWriteTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    RESET_FAKE(pmc_rdwrpmcrng);
+    RESET_FAKE(pmc_rdpmcrng);
+    RESET_FAKE(pmc_wrpmcrng);
+    FFF_RESET_HISTORY();
+    pmc_rdwrpmcrng_fake.custom_fake = fake_rdwrpmcrng;
+    pmc_rdpmcrng_fake.custom_fake = fake_rdpmcrng;
+    pmc_wrpmcrng_fake.custom_fake = fake_wrpmcrng;
+    memset(mem, 0, sizeof(mem));
+  }
+};
+
+TEST_F(PmcWriteTest, NeighboursShareARange) {
+  PmcWriteBatch batch;
+
+  EXPECT_TRUE(batch.put<int16_t>(FW_PMC("R10:W"), 0x1234));
+  EXPECT_TRUE(batch.put<uint8_t>(FW_PMC("R12"), 7));
+  EXPECT_TRUE(batch.put<uint8_t>(FW_PMC("R14"), 9));
+  EXPECT_TRUE(batch.put<int32_t>(FW_PMC("D0:L"), -2));
+  EXPECT_FALSE(batch.put<int32_t>(FW_PMC("D4:W"), 1)) << "wrong width";
+  EXPECT_FALSE(batch.set(FW_PMC("D4"), true)) << "not a bit";
+  EXPECT_EQ(batch.pending(), 8u);
+
+  ASSERT_EQ(batch.commit(1), EW_OK);
+  EXPECT_EQ(batch.pending(), 0u);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.call_count, 1u);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.arg1_history[0], 3) << "R10-12, R14, D0-3";
+  EXPECT_EQ(batch.stats().round_trips, 1u);
+  EXPECT_EQ(mem[5][10], 0x34);
+  EXPECT_EQ(mem[5][11], 0x12);
+  EXPECT_EQ(mem[5][12], 7);
+  EXPECT_EQ(mem[5][13], 0);
+  EXPECT_EQ(mem[9][3], 0xff);
+}
+
+TEST_F(PmcWriteTest, BitsKeepTheirNeighbours) {
+  PmcWriteBatch batch;
+  mem[5][20] = 0xf0;
+  mem[5][21] = 0x41;
+
+  batch.set(FW_PMC("R20.0"), true);
+  batch.set(FW_PMC("R20.7"), false);
+  batch.set(FW_PMC("R21.3"), true);
+  batch.set(FW_PMC("R21.0"), true);
+  batch.set(FW_PMC("R21.0"), false);
+  ASSERT_EQ(batch.commit(1), EW_OK);
+
+  EXPECT_EQ(mem[5][20], 0x71);
+  EXPECT_EQ(mem[5][21], 0x48);
+  EXPECT_EQ(batch.stats().round_trips, 2u) << "one read for both bytes, one write";
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.arg1_history[1], 1);
+}
+
+TEST_F(PmcWriteTest, VerifiesInTheSameCall) {
+  PmcWriteBatch batch(PmcPlanOptions(), true);
+
+  batch.put<int16_t>(FW_PMC("R29:W"), 0x0505);
+  batch.put<uint8_t>(FW_PMC("R40"), 1);
+  EXPECT_EQ(batch.commit(1), EW_DATA);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.call_count, 1u);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.arg1_history[0], 4) << "a read after every write";
+  ASSERT_EQ(batch.mismatches().size(), 1u);
+  EXPECT_EQ(batch.mismatches()[0].address, 30);
+  EXPECT_EQ(batch.stats().mismatches, 1u);
+  EXPECT_EQ(batch.stats().errors, 1u);
+
+  /* only written bits are compared, bit 2 of the stuck byte reads back as written */
+  batch.set(FW_PMC("R30.2"), false);
+  EXPECT_EQ(batch.commit(1), EW_OK);
+  EXPECT_TRUE(batch.mismatches().empty());
+}
+
+TEST_F(PmcWriteTest, FallsBackToRangeWrites) {
+  pmc_rdwrpmcrng_fake.custom_fake = NULL;
+  pmc_rdwrpmcrng_fake.return_val = EW_FUNC;
+  PmcWriteBatch batch(PmcPlanOptions(), true);
+  mem[3][2] = 0x0f;
+
+  batch.set(FW_PMC("X2.4"), true);
+  batch.put<int16_t>(FW_PMC("D100:W"), 300);
+  ASSERT_EQ(batch.commit(1), EW_OK);
+  EXPECT_EQ(batch.multi(), 0);
+  EXPECT_EQ(mem[3][2], 0x1f);
+  EXPECT_EQ(mem[9][100] | mem[9][101] << 8, 300);
+  EXPECT_EQ(pmc_wrpmcrng_fake.call_count, 2u);
+  /* probe, read X2, then write and read back both ranges */
+  EXPECT_EQ(batch.stats().round_trips, 6u);
+
+  batch.put<uint8_t>(FW_PMC("G5"), 1);
+  ASSERT_EQ(batch.commit(1), EW_OK);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.call_count, 1u) << "remembered until reset";
+  EXPECT_EQ(batch.stats().round_trips, 2u);
+}
+
+TEST_F(PmcWriteTest, KeepsToTheCallLimits) {
+  PmcPlanOptions opts;
+  opts.max_entries = 4;
+  opts.max_range_bytes = 3;
+  PmcWriteBatch batch(opts, true);
+  const uint8_t ones[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+
+  batch.put_bytes(PmcArea::R, 0, ones, 8);
+  batch.put_bytes(PmcArea::R, 100, ones, 2);
+  ASSERT_EQ(batch.commit(1), EW_OK);
+  /* R0-2, R3-5, R6-7, R100-101: two ranges and their read backs per call */
+  EXPECT_EQ(batch.stats().ranges, 4u);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.call_count, 2u);
+  EXPECT_EQ(pmc_rdwrpmcrng_fake.arg1_history[0], 4);
+  EXPECT_EQ(mem[5][7], 1);
+  EXPECT_EQ(mem[5][8], 0);
+}
+
+TEST_F(PmcWriteTest, CountsBatches) {
+  PmcWriteBatch batch;
+
+  EXPECT_EQ(batch.commit(1), EW_OK);
+  EXPECT_EQ(batch.stats().batches, 0u) << "nothing to send";
+  for (int i = 0; i < 3; i++) {
+    batch.set(FW_PMC("G8.4"), i % 2 == 0);
+    ASSERT_EQ(batch.commit(1), EW_OK);
+  }
+  EXPECT_EQ(batch.stats().batches, 3u);
+  EXPECT_EQ(batch.stats().bytes, 1u);
+  EXPECT_GE(batch.stats().max, batch.stats().last);
+  EXPECT_GE(batch.stats().total, batch.stats().max);
+
+  pmc_rdwrpmcrng_fake.custom_fake = NULL;
+  pmc_rdwrpmcrng_fake.return_val = EW_SOCKET;
+  batch.set(FW_PMC("G8.4"), true);
+  EXPECT_EQ(batch.commit(1), EW_SOCKET);
+  EXPECT_EQ(batch.stats().errors, 1u);
+  EXPECT_EQ(batch.pending(), 0u);
+}
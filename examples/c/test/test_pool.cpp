@@ -0,0 +1,167 @@
+extern "C" {
+  #include "../src/metadata.c"
+  #include "../src/pool.c"
+}
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+
+namespace Fwlib32 {
+#ifndef _WIN32
+FAKE_VALUE_FUNC(short, cnc_startupprocess, long, const char *);
+FAKE_VALUE_FUNC(short, cnc_exitprocess);
+#endif
+FAKE_VALUE_FUNC(short, cnc_allclibhndl3, const char *, unsigned short, long, unsigned short *);
+FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+FAKE_VALUE_FUNC(short, cnc_statinfo, unsigned short, ODBST *);
+FAKE_VALUE_FUNC(short, cnc_rdcncid, unsigned short, unsigned long *);
+FAKE_VALUE_FUNC(short, cnc_sysinfo, unsigned short, ODBSYS *);
+FAKE_VALUE_FUNC(short, cnc_rdsyssoft, unsigned short, ODBSYSS *);
+FAKE_VALUE_FUNC(short, cnc_rdaxisname, unsigned short, short *, ODBAXISNAME *);
+FAKE_VALUE_FUNC(short, cnc_rdspdlname, unsigned short, short *, ODBSPDLNAME *);
+}  // namespace Fwlib32
+
+static unsigned short next_handle;
+
+static short fake_connect(const char *ip, unsigned short port, long timeout, unsigned short *libh) {
+  *libh = ++next_handle;
+  return EW_OK;
+}
+
+class PoolTest : public testing::Test {
+ protected:
+  Pool pool;
+
+  void SetUp() override {
+#ifndef _WIN32
+    RESET_FAKE(cnc_startupprocess);
+    RESET_FAKE(cnc_exitprocess);
+#endif
+    RESET_FAKE(cnc_allclibhndl3);
+    RESET_FAKE(cnc_freelibhndl);
+    RESET_FAKE(cnc_statinfo);
+    RESET_FAKE(cnc_rdcncid);
+    RESET_FAKE(cnc_sysinfo);
+    RESET_FAKE(cnc_rdsyssoft);
+    RESET_FAKE(cnc_rdaxisname);
+    RESET_FAKE(cnc_rdspdlname);
+    FFF_RESET_HISTORY();
+    next_handle = 0;
+    cnc_allclibhndl3_fake.custom_fake = fake_connect;
+    ASSERT_EQ(pool_init(&pool), 0);
+  }
+
+  void TearDown() override { pool_destroy(&pool); }
+};
+
+TEST_F(PoolTest, ReusesIdleHandle) {
+  unsigned short a, b;
+
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &a), EW_OK);
+  pool_checkin(&pool, a, EW_OK);
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &b), EW_OK);
+
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1);
+  EXPECT_EQ(pool.stats.reuses, 1);
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 0) << "fresh handles are not probed";
+}
+
+TEST_F(PoolTest, KeysByAddress) {
+  unsigned short a, b, c;
+
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &a), EW_OK);
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &b), EW_OK);
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8194, &c), EW_OK);
+
+  EXPECT_NE(a, b) << "checked out handles must not be shared";
+  EXPECT_NE(a, c);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 3);
+  EXPECT_EQ(cnc_allclibhndl3_fake.arg1_val, 8194);
+}
+
+TEST_F(PoolTest, LimitsHandlesPerMachine) {
+  unsigned short h;
+
+  for (int i = 0; i < POOL_MAX_PER_MACHINE; i++) {
+    ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &h), EW_OK);
+  }
+  EXPECT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &h), EW_BUSY);
+}
+
+TEST_F(PoolTest, DropsBrokenHandles) {
+  unsigned short a, b;
+
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &a), EW_OK);
+  pool_checkin(&pool, a, EW_SOCKET);
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 1);
+  EXPECT_EQ(cnc_freelibhndl_fake.arg0_val, a);
+
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &b), EW_OK);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 2);
+}
+
+TEST_F(PoolTest, ReplacesHandleFailingHealthCheck) {
+  unsigned short a, b;
+
+  pool.check_ms = 0;
+  cnc_statinfo_fake.return_val = EW_SOCKET;
+
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &a), EW_OK);
+  pool_checkin(&pool, a, EW_OK);
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &b), EW_OK);
+
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 1);
+  EXPECT_EQ(pool.stats.failed_checks, 1);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(cnc_freelibhndl_fake.arg0_val, a);
+}
+
+TEST_F(PoolTest, LoadsMetadataOncePerConnection) {
+  unsigned short a;
+  Metadata meta;
+
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &a), EW_OK);
+    ASSERT_EQ(pool_metadata(&pool, a, &meta), EW_OK);
+    pool_checkin(&pool, a, EW_OK);
+  }
+  EXPECT_TRUE(meta.loaded);
+  EXPECT_EQ(cnc_rdcncid_fake.call_count, 1);
+  EXPECT_EQ(cnc_sysinfo_fake.call_count, 1);
+  EXPECT_EQ(cnc_rdaxisname_fake.call_count, 1);
+
+  /* a new connection may be a different controller behind the same address */
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &a), EW_OK);
+  pool_checkin(&pool, a, EW_SOCKET);
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &a), EW_OK);
+  ASSERT_EQ(pool_metadata(&pool, a, &meta), EW_OK);
+  EXPECT_EQ(cnc_rdcncid_fake.call_count, 2);
+}
+
+TEST_F(PoolTest, EvictsIdleHandles) {
+  unsigned short a, b;
+
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &a), EW_OK);
+  ASSERT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &b), EW_OK);
+  pool_checkin(&pool, a, EW_OK);
+
+  pool.idle_ms = 0;
+  EXPECT_EQ(pool_evict_idle(&pool), 1) << "checked out handles are kept";
+  EXPECT_EQ(cnc_freelibhndl_fake.arg0_val, a);
+}
+
+TEST_F(PoolTest, ReportsConnectFailure) {
+  unsigned short h;
+
+  cnc_allclibhndl3_fake.custom_fake = NULL;
+  cnc_allclibhndl3_fake.return_val = EW_SOCKET;
+
+  EXPECT_EQ(pool_checkout(&pool, "1.2.3.4", 8193, &h), EW_SOCKET);
+  for (int i = 0; i < POOL_MAX_HANDLES; i++) {
+    EXPECT_FALSE(pool.entries[i].used) << "failed connect must release its slot";
+  }
+}
@@ -0,0 +1,118 @@
+#include "../src/scheduler.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace fanuc;
+using namespace std::chrono;
+
+TEST(SchedulerTest, ReleasesOnAFixedGrid) {
+  std::vector<Scheduler::Clock::time_point> starts;
+  std::mutex starts_lock;
+  Scheduler scheduler(1);
+
+  Scheduler::Clock::time_point begin = Scheduler::Clock::now();
+  int id = scheduler.add(0, "position", milliseconds(20), [&] {
+    {
+      std::lock_guard<std::mutex> lock(starts_lock);
+      starts.push_back(Scheduler::Clock::now());
+    }
+    /* a read taking a quarter of the period must not push the next one back */
+    std::this_thread::sleep_for(milliseconds(5));
+    return (short)EW_OK;
+  });
+  std::this_thread::sleep_for(milliseconds(410));
+  scheduler.stop();
+
+  std::lock_guard<std::mutex> lock(starts_lock);
+  ASSERT_GE(starts.size(), 19u);
+  EXPECT_LE(starts.size(), 22u);
+  /* the 20th read starts around 380 ms, not 20 * (20 + 5) ms */
+  EXPECT_LT(starts[19] - begin, milliseconds(380 + 15));
+  Scheduler::Stats stats = scheduler.stats(id);
+  EXPECT_EQ(stats.missed, 0u);
+  EXPECT_EQ(stats.skipped, 0u);
+  EXPECT_EQ(stats.runs, starts.size());
+}
+
+TEST(SchedulerTest, EarliestDeadlineRunsFirst) {
+  std::vector<std::string> order;
+  std::mutex order_lock;
+  Scheduler scheduler(1);
+
+  auto record = [&](const char *name) {
+    return [&, name] {
+      std::lock_guard<std::mutex> lock(order_lock);
+      order.push_back(name);
+      return (short)EW_OK;
+    };
+  };
+  /* the only worker is busy until all three are released */
+  scheduler.add(0, "busy", seconds(10), [] {
+    std::this_thread::sleep_for(milliseconds(40));
+    return (short)EW_OK;
+  });
+  std::this_thread::sleep_for(milliseconds(5));
+  scheduler.add(1, "modal", seconds(1), record("modal"), milliseconds(10));
+  scheduler.add(2, "speed", milliseconds(200), record("speed"), milliseconds(10));
+  scheduler.add(3, "position", milliseconds(100), record("position"), milliseconds(10));
+  std::this_thread::sleep_for(milliseconds(80));
+  scheduler.stop();
+
+  std::lock_guard<std::mutex> lock(order_lock);
+  ASSERT_EQ(order.size(), 3u);
+  EXPECT_EQ(order[0], "position");
+  EXPECT_EQ(order[1], "speed");
+  EXPECT_EQ(order[2], "modal");
+}
+
+TEST(SchedulerTest, CountsMissedAndSkippedReleases) {
+  Scheduler scheduler(2);
+
+  int id = scheduler.add(0, "slow", milliseconds(10), [] {
+    std::this_thread::sleep_for(milliseconds(25));
+    return (short)EW_SOCKET;
+  });
+  std::this_thread::sleep_for(milliseconds(200));
+  scheduler.stop();
+
+  Scheduler::Stats stats = scheduler.stats(id);
+  EXPECT_GE(stats.runs, 5u);
+  EXPECT_LE(stats.runs, 9u) << "overruns do not queue up";
+  EXPECT_EQ(stats.missed, stats.runs);
+  EXPECT_GE(stats.skipped, stats.runs);
+  EXPECT_EQ(stats.errors, stats.runs);
+  EXPECT_EQ(stats.last_ret, EW_SOCKET);
+  EXPECT_GT(stats.jitter_max, milliseconds(0));
+}
+
+TEST(SchedulerTest, SerializesReadsOfOneMachine) {
+  std::atomic<int> inside[2] = {{0}, {0}};
+  std::atomic<bool> overlap{false}, parallel{false};
+  std::atomic<int> total{0};
+  Scheduler scheduler(4);
+
+  for (int machine = 0; machine < 2; machine++) {
+    for (int g = 0; g < 3; g++) {
+      scheduler.add(machine, "group", milliseconds(10), [&, machine] {
+        if (inside[machine]++ > 0) overlap = true;
+        if (inside[1 - machine] > 0) parallel = true;
+        total++;
+        std::this_thread::sleep_for(milliseconds(2));
+        inside[machine]--;
+        return (short)EW_OK;
+      });
+    }
+  }
+  std::this_thread::sleep_for(milliseconds(150));
+  scheduler.stop();
+
+  EXPECT_FALSE(overlap);
+  EXPECT_TRUE(parallel) << "different machines are read in parallel";
+  EXPECT_GT(total, 30);
+  EXPECT_EQ(scheduler.groups(), 6u);
+}
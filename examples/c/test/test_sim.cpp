@@ -0,0 +1,227 @@
+#include "../src/focas_proto.cpp"
+#include "../src/focas_client.cpp"
+#include "../src/focas_compat.cpp"
+#include "../src/sim.cpp"
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+using namespace fanuc;
+
+class SimTest : public testing::Test {
+ protected:
+  std::unique_ptr<sim::Server> server;
+  std::thread loop;
+  unsigned short libh = 0;
+
+  void start(long latency_ms = 0) {
+    sim::ServerOptions opts;
+    opts.port = 0;
+    opts.count = 3;
+    opts.latency_ms = latency_ms;
+    opts.machine.block_ms = 20;
+    opts.machine.blocks = 5;
+    server.reset(new sim::Server(opts));
+    ASSERT_EQ(server->listen(), EW_OK);
+    loop = std::thread([this] { server->run(); });
+    ASSERT_EQ(cnc_allclibhndl3("127.0.0.1", server->port(0), 5, &libh), EW_OK);
+  }
+
+  void TearDown() override {
+    if (libh != 0) cnc_freelibhndl(libh);
+    if (loop.joinable()) {
+      server->stop();
+      loop.join();
+    }
+  }
+};
+
+TEST_F(SimTest, ServesEveryMachineOnItsOwnPort) {
+  uint32_t ids[4];
+  unsigned short other;
+
+  start();
+  ASSERT_EQ(cnc_rdcncid(libh, (unsigned long *)ids), EW_OK);
+  EXPECT_EQ(ids[1], 0u);
+  ASSERT_EQ(cnc_allclibhndl3("127.0.0.1", server->port(2), 5, &other), EW_OK);
+  ASSERT_EQ(cnc_rdcncid(other, (unsigned long *)ids), EW_OK);
+  EXPECT_EQ(ids[1], 2u);
+  EXPECT_EQ(server->connections(), 2u);
+  cnc_freelibhndl(other);
+}
+
+TEST_F(SimTest, AxesMoveWhileRunning) {
+  ODBDY2 a, b;
+  ODBST st;
+  ODBSPN load;
+
+  start();
+  ASSERT_EQ(cnc_rddynamic2(libh, ALL_AXES, sizeof(a), &a), EW_OK);
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  ASSERT_EQ(cnc_rddynamic2(libh, ALL_AXES, sizeof(b), &b), EW_OK);
+
+  EXPECT_EQ(b.axis, 3);
+  EXPECT_NE(a.pos.faxis.machine[0], b.pos.faxis.machine[0]);
+  EXPECT_EQ(b.acts, 8000);
+  EXPECT_GE(b.prgnum, 1000);
+  EXPECT_GT(b.seqnum, 0);
+  ASSERT_EQ(cnc_statinfo(libh, &st), EW_OK);
+  EXPECT_EQ(st.run, 3);
+  ASSERT_EQ(cnc_rdspload(libh, -1, &load), EW_OK);
+  EXPECT_GT(load.data[0], 0);
+}
+
+TEST_F(SimTest, AlarmStopsMachine) {
+  ODBDY2 a, b;
+  ODBST st;
+
+  start();
+  server->machine(0).raise_alarm(1 << 2);
+  ASSERT_EQ(cnc_statinfo(libh, &st), EW_OK);
+  EXPECT_EQ(st.alarm, 1);
+  EXPECT_NE(st.run, 3);
+
+  ASSERT_EQ(cnc_rddynamic2(libh, 1, sizeof(a), &a), EW_OK);
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  ASSERT_EQ(cnc_rddynamic2(libh, 1, sizeof(b), &b), EW_OK);
+  EXPECT_EQ(b.alarm, 4);
+  EXPECT_EQ(b.acts, 0);
+  EXPECT_EQ(a.pos.oaxis.machine, b.pos.oaxis.machine) << "axes hold while alarmed";
+
+  server->machine(0).clear_alarms();
+  ASSERT_EQ(cnc_statinfo(libh, &st), EW_OK);
+  EXPECT_EQ(st.alarm, 0);
+}
+
+TEST_F(SimTest, PmcMemoryReadsBackWrites) {
+  struct {
+    IODBPMC head;
+    short more[16];
+  } buf;
+
+  start();
+  /* written through the client, the sub-request exactly as on the wire */
+  FocasClient client;
+  std::thread client_loop([&] { client.run(); });
+  std::promise<short> opened, written;
+  unsigned short h = 0;
+  client.connect("127.0.0.1", server->port(0), 5, [&](short ret, unsigned short libh) {
+    h = libh;
+    opened.set_value(ret);
+  });
+  ASSERT_EQ(opened.get_future().get(), EW_OK);
+
+  std::vector<proto::SubRequest> reqs(1);
+  short words[2] = {1234, -2};
+  reqs[0].ncpmc = proto::TARGET_PMC;
+  reqs[0].command = proto::CMD_PMC_WRITE;
+  reqs[0].args[0] = 100;
+  reqs[0].args[1] = 103;
+  reqs[0].args[2] = 9; /* D */
+  reqs[0].args[3] = 1; /* word */
+  proto::put_pmc(reqs[0].payload, 1, words, 2);
+  client.request(h, reqs, [&](short ret, std::vector<proto::SubResponse> &resps) {
+    written.set_value(ret == EW_OK ? resps[0].error : ret);
+  });
+  EXPECT_EQ(written.get_future().get(), EW_OK);
+  client.close(h);
+  client.stop();
+  client_loop.join();
+
+  ASSERT_EQ(pmc_rdpmcrng(libh, 9, 1, 100, 103, 8 + 4, &buf.head), EW_OK);
+  EXPECT_EQ(buf.head.u.idata[0], 1234);
+  EXPECT_EQ(buf.head.u.idata[1], -2);
+  ASSERT_EQ(pmc_rdpmcrng(libh, 9, 0, 100, 101, 8 + 2, &buf.head), EW_OK);
+  EXPECT_EQ((uint8_t)buf.head.u.cdata[0], 1234 & 0xff) << "stored little endian";
+
+  ASSERT_EQ(pmc_rdpmcrng(libh, 1, 0, 0, 0, 8 + 1, &buf.head), EW_OK);
+  EXPECT_EQ(buf.head.u.cdata[0] & 0x20, 0x20) << "F0.5 STL while running";
+  std::this_thread::sleep_for(std::chrono::milliseconds(120));
+  ASSERT_EQ(pmc_rdpmcrng(libh, 9, 2, 0, 3, 8 + sizeof(long), &buf.head), EW_OK);
+  EXPECT_GE(buf.head.u.ldata[0], 1) << "D0 counts parts, one per 100 ms here";
+  EXPECT_EQ(pmc_rdpmcrng(libh, 20, 0, 0, 0, 8 + 1, &buf.head), EW_TYPE);
+}
+
+TEST_F(SimTest, PmcMultiRequestsShareAFrame) {
+  short words[2] = {-300, 77};
+  uint8_t bytes[3];
+  short read_words[2] = {0, 0};
+  IODBRWPMC buf[3];
+
+  start();
+  memset(buf, 0, sizeof(buf));
+  buf[0].type_rw = 1;
+  buf[0].type_a = 5; /* R */
+  buf[0].type_d = 1;
+  buf[0].datano_s = 10;
+  buf[0].length = 4;
+  buf[0].data = words;
+  buf[1] = buf[0];
+  buf[1].type_rw = 0;
+  buf[1].data = read_words;
+  buf[2] = buf[1];
+  buf[2].type_d = 0;
+  buf[2].datano_s = 9;
+  buf[2].length = 3;
+  buf[2].data = bytes;
+  ASSERT_EQ(pmc_rdwrpmcrng(libh, 3, buf), EW_OK);
+  EXPECT_EQ(read_words[0], -300);
+  EXPECT_EQ(read_words[1], 77);
+  EXPECT_EQ(bytes[1], (uint8_t)(-300 & 0xff));
+
+  buf[0].type_a = 20;
+  EXPECT_EQ(pmc_rdwrpmcrng(libh, 2, buf), EW_DATA);
+  EXPECT_EQ(buf[0].err_code, EW_TYPE);
+  EXPECT_EQ(buf[1].err_code, EW_OK);
+  EXPECT_EQ(pmc_rdwrpmcrng(libh, 0, buf), EW_LENGTH);
+}
+
+TEST_F(SimTest, PmcRangeWritesReadBack) {
+  struct {
+    IODBPMC head;
+    short more[16];
+  } buf;
+
+  start();
+  memset(&buf, 0, sizeof(buf));
+  buf.head.type_a = 9; /* D */
+  buf.head.type_d = 1;
+  buf.head.datano_s = 200;
+  buf.head.datano_e = 203;
+  buf.head.u.idata[0] = 4321;
+  buf.head.u.idata[1] = -7;
+  ASSERT_EQ(pmc_wrpmcrng(libh, 8 + 4, &buf.head), EW_OK);
+  EXPECT_EQ(pmc_wrpmcrng(libh, 8 + 2, &buf.head), EW_LENGTH);
+
+  memset(&buf, 0, sizeof(buf));
+  ASSERT_EQ(pmc_rdpmcrng(libh, 9, 1, 200, 203, 8 + 4, &buf.head), EW_OK);
+  EXPECT_EQ(buf.head.u.idata[0], 4321);
+  EXPECT_EQ(buf.head.u.idata[1], -7);
+}
+
+TEST_F(SimTest, ListsStoredPrograms) {
+  PRGDIR3 dir[16];
+  long top = 1002;
+  short num = 16;
+
+  start();
+  ASSERT_EQ(cnc_rdprogdir3(libh, 2, &top, &num, dir), EW_OK);
+  ASSERT_EQ(num, 6);
+  EXPECT_EQ(dir[0].number, 1002);
+  EXPECT_EQ(dir[5].number, 1007);
+  EXPECT_STREQ(dir[0].comment, "(SIM PART 3)");
+  EXPECT_GT(dir[0].length, 0);
+}
+
+TEST_F(SimTest, InjectsLatency) {
+  ODBST st;
+
+  start(50);
+  auto begin = std::chrono::steady_clock::now();
+  ASSERT_EQ(cnc_statinfo(libh, &st), EW_OK);
+  EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(50));
+  EXPECT_EQ(server->requests(), 1u);
+}
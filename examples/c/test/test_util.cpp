@@ -1,7 +1,7 @@
-#define TESTING 1
-
 extern "C" {
   #include "../src/config.h"
+  #include "../src/metadata.c"
+  #include "../src/pool.c"
   #include "../src/util.c"
 }
 
@@ -9,6 +9,10 @@ extern "C" {
 #include "gtest/gtest.h"
 
 DEFINE_FFF_GLOBALS;
+
+// fwlib32.h declares the api inside namespace Fwlib32 when compiled as c++,
+// fakes must live there too or every call site becomes ambiguous
+namespace Fwlib32 {
 #ifndef _WIN32
 FAKE_VALUE_FUNC(short, cnc_startupprocess, long, const char *);
 FAKE_VALUE_FUNC(short, cnc_exitprocess);
@@ -16,6 +20,12 @@ FAKE_VALUE_FUNC(short, cnc_exitprocess);
 FAKE_VALUE_FUNC(short, cnc_allclibhndl3, const char *, unsigned short, long, unsigned short *);
 FAKE_VALUE_FUNC(short, cnc_rdcncid, unsigned short, unsigned long *);
 FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+FAKE_VALUE_FUNC(short, cnc_statinfo, unsigned short, ODBST *);
+FAKE_VALUE_FUNC(short, cnc_sysinfo, unsigned short, ODBSYS *);
+FAKE_VALUE_FUNC(short, cnc_rdsyssoft, unsigned short, ODBSYSS *);
+FAKE_VALUE_FUNC(short, cnc_rdaxisname, unsigned short, short *, ODBAXISNAME *);
+FAKE_VALUE_FUNC(short, cnc_rdspdlname, unsigned short, short *, ODBSPDLNAME *);
+}  // namespace Fwlib32
 
 /*
 int retrieve_id(Config *conf, char *cnc_id) {
@@ -78,3 +88,32 @@ TEST(Util, UtilWorks) {
   ASSERT_EQ(cnc_exitprocess_fake.call_count, 1);
 #endif
 }
+
+static short fake_connect(const char *ip, unsigned short port, long timeout, unsigned short *libh) {
+  *libh = 1;
+  return EW_OK;
+}
+
+TEST(Util, PooledUtilReusesHandle) {
+  char id[40];
+  Config c = {"1.2.3.4", 1234};
+  Pool pool;
+
+  RESET_FAKE(cnc_allclibhndl3);
+  RESET_FAKE(cnc_rdcncid);
+  RESET_FAKE(cnc_freelibhndl);
+  /* 0 means no handle to the pool */
+  cnc_allclibhndl3_fake.custom_fake = fake_connect;
+
+  ASSERT_EQ(pool_init(&pool), 0);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(retrieve_id_pooled(&pool, &c, id), 0);
+  }
+
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1) << "handle should be reused";
+  EXPECT_EQ(cnc_rdcncid_fake.call_count, 1) << "id comes from the metadata cache";
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 0);
+
+  pool_destroy(&pool);
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 1);
+}
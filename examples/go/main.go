@@ -12,6 +12,8 @@ import (
 	"fmt"
 	"os"
 	"strconv"
+	"strings"
+	"time"
 	"unsafe"
 )
 
@@ -56,12 +58,86 @@ func main() {
 		}
 	}()
 
+	meta, ret := readMetadata(libh)
+	if ret != C.EW_OK {
+		fmt.Printf("reading metadata failed (%d)\n", ret)
+		return
+	}
+
+	fmt.Printf("machine_id: %s\n", meta.machineID)
+	fmt.Printf("series: %s %s, axes: %v, spindles: %v\n", meta.series, meta.version, meta.axes, meta.spindles)
+	fmt.Printf("software: %v\n", meta.software)
+
+	// the loop only does live reads, everything static comes from meta
+	polls := 0
+	if value, ok := os.LookupEnv("POLL_COUNT"); ok {
+		if d, err := strconv.Atoi(value); err == nil {
+			polls = d
+		}
+	}
+	for i := 0; i < polls; i++ {
+		var status C.ODBST
+		if ret := C.cnc_statinfo(libh, &status); ret != C.EW_OK {
+			fmt.Printf("cnc_statinfo failed (%d)\n", ret)
+			return
+		}
+		fmt.Printf("%s run=%d alarm=%d\n", meta.machineID, status.run, status.alarm)
+		time.Sleep(time.Second)
+	}
+}
+
+// static machine data, read once per connection
+type metadata struct {
+	machineID string
+	series    string
+	version   string
+	axes      []string
+	spindles  []string
+	software  []string // "series version" of every installed software module
+}
+
+func readMetadata(libh C.ushort) (metadata, C.short) {
+	var meta metadata
+
 	var cnc_ids [4]uint32
 	if ret := C.cnc_rdcncid(libh, (*C.ulong)(unsafe.Pointer(&cnc_ids[0]))); ret != C.EW_OK {
-		fmt.Printf("cnc_rdcncid failed (%d)\n", ret)
-		return
+		return meta, ret
+	}
+	meta.machineID = fmt.Sprintf("%08x-%08x-%08x-%08x", cnc_ids[0], cnc_ids[1], cnc_ids[2], cnc_ids[3])
+
+	// only a lost connection fails the read, otherwise series and version stay empty
+	var sys C.ODBSYS
+	if ret := C.cnc_sysinfo(libh, &sys); ret == C.EW_SOCKET || ret == C.EW_HANDLE {
+		return meta, ret
+	} else if ret == C.EW_OK {
+		meta.series = C.GoStringN(&sys.series[0], 4)
+		meta.version = C.GoStringN(&sys.version[0], 4)
+	}
+
+	var soft C.ODBSYSS
+	if ret := C.cnc_rdsyssoft(libh, &soft); ret == C.EW_SOCKET || ret == C.EW_HANDLE {
+		return meta, ret
+	} else if ret == C.EW_OK {
+		for i := 0; i < int(soft.soft_inst) && i < len(soft.soft_series); i++ {
+			meta.software = append(meta.software, C.GoStringN(&soft.soft_series[i][0], 4)+" "+C.GoStringN(&soft.soft_version[i][0], 4))
+		}
+	}
+
+	// names are optional, not every controller supports reading them
+	var axes [C.MAX_AXIS]C.ODBAXISNAME
+	naxes := C.short(C.MAX_AXIS)
+	if ret := C.cnc_rdaxisname(libh, &naxes, &axes[0]); ret == C.EW_OK {
+		for i := 0; i < int(naxes); i++ {
+			meta.axes = append(meta.axes, strings.TrimRight(C.GoStringN(&axes[i].name, 2), " \x00"))
+		}
+	}
+	var spindles [C.MAX_SPINDLE]C.ODBSPDLNAME
+	nspindles := C.short(C.MAX_SPINDLE)
+	if ret := C.cnc_rdspdlname(libh, &nspindles, &spindles[0]); ret == C.EW_OK {
+		for i := 0; i < int(nspindles); i++ {
+			meta.spindles = append(meta.spindles, strings.TrimRight(C.GoStringN(&spindles[i].name, 4), " \x00"))
+		}
 	}
-	machine_id := fmt.Sprintf("%08x-%08x-%08x-%08x", cnc_ids[0], cnc_ids[1], cnc_ids[2], cnc_ids[3])
 
-	fmt.Printf("machine_id: %s\n", machine_id)
+	return meta, C.EW_OK
 }
@@ -8,17 +8,70 @@ typedef struct {
     PyObject_HEAD
     unsigned short libh;
     int connected;
+    int acquired;
+    /* FOCAS calls run without the GIL, one thread at a time per handle */
+    PyThread_type_lock lock;
 } Context;
 
+/*
+ * cnc_startupprocess/cnc_exitprocess set up and tear down library wide state,
+ * so they run once per process: the first Context starts the library, every
+ * Context holds a reference and the library is shut down at interpreter exit.
+ * Dropping to zero references does not shut it down, opening the next Context
+ * stays as cheap as the first.
+ */
+static PyThread_type_lock focas_lock = NULL;
+static long focas_refs = 0;
+static int focas_started = 0;
+
+static int focas_acquire(void) {
+    int ret = 0;
+
+    PyThread_acquire_lock(focas_lock, WAIT_LOCK);
 #ifndef _WIN32
-int cnc_startup() {
-    return cnc_startupprocess(0, "focas.log");
+    if (!focas_started) {
+        if (cnc_startupprocess(0, "focas.log") != EW_OK) {
+            ret = -1;
+        } else {
+            focas_started = 1;
+        }
+    }
+#endif
+    if (ret == 0) {
+        focas_refs++;
+    }
+    PyThread_release_lock(focas_lock);
+    return ret;
 }
 
-void cnc_shutdown() {
-    cnc_exitprocess();
+static void focas_release(void) {
+    PyThread_acquire_lock(focas_lock, WAIT_LOCK);
+    /* every release pairs with an acquire; the count is checked, never acted on */
+    assert(focas_refs > 0);
+    focas_refs--;
+    PyThread_release_lock(focas_lock);
 }
+
+static void focas_atexit(void) {
+#ifndef _WIN32
+    if (focas_started) {
+        cnc_exitprocess();
+        focas_started = 0;
+    }
 #endif
+}
+
+/* Free the handle and drop the library reference, safe to call repeatedly. */
+static void Context_close(Context* self) {
+    if (self->connected) {
+        cnc_freelibhndl(self->libh);
+        self->connected = 0;
+    }
+    if (self->acquired) {
+        focas_release();
+        self->acquired = 0;
+    }
+}
 
 static PyObject* Context_new(PyTypeObject* type, PyObject* args, PyObject* kwds) {
     Context* self;
@@ -26,6 +79,12 @@ static PyObject* Context_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
     if (self != NULL) {
         self->libh = 0;
         self->connected = 0;
+        self->acquired = 0;
+        self->lock = PyThread_allocate_lock();
+        if (self->lock == NULL) {
+            Py_DECREF(self);
+            return PyErr_NoMemory();
+        }
     }
     return (PyObject*) self;
 }
@@ -41,33 +100,36 @@ static int Context_init(Context* self, PyObject* args, PyObject* kwds) {
         return -1;
     }
 
-#ifndef _WIN32
-    if (cnc_startup() != EW_OK) {
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    Context_close(self);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (focas_acquire() < 0) {
         PyErr_SetString(PyExc_RuntimeError, "Failed to start FANUC process.");
         return -1;
     }
-#endif
+    self->acquired = 1;
 
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
     ret = cnc_allclibhndl3(host, port, timeout, &self->libh);
+    self->connected = ret == EW_OK;
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
     if (ret != EW_OK) {
         PyErr_Format(PyExc_ConnectionError, "Failed to connect to CNC: %d", ret);
         return -1;
     }
-    self->connected = 1;
 
     return 0;
 }
 
 static void Context_dealloc(Context* self) {
-    if (self->connected) {
-        cnc_freelibhndl(self->libh);
-        self->connected = 0;
+    Context_close(self);
+    if (self->lock != NULL) {
+        PyThread_free_lock(self->lock);
     }
-
-#ifndef _WIN32
-    cnc_shutdown();
-#endif
-
     Py_TYPE(self)->tp_free((PyObject*) self);
 }
 
@@ -76,7 +138,11 @@ static PyObject* Context_read_id(Context* self, PyObject* Py_UNUSED(ignored)) {
     char cnc_id[40] = "";
     int ret;
 
-    ret = cnc_rdcncid(self->libh, (unsigned long*) cnc_ids);
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    ret = self->connected ? cnc_rdcncid(self->libh, (unsigned long*) cnc_ids) : EW_HANDLE;
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
     if (ret != EW_OK) {
         PyErr_Format(PyExc_RuntimeError, "Failed to read CNC ID: %d", ret);
         return NULL;
@@ -94,15 +160,11 @@ static PyObject* Context_enter(PyObject* self) {
 }
 
 static PyObject* Context_exit(Context* self, PyObject* exc_type, PyObject* exc_value, PyObject* traceback) {
-    if (self->connected) {
-        cnc_freelibhndl(self->libh);
-        self->connected = 0;
-    }
-
-#ifndef _WIN32
-    cnc_shutdown();
-#endif
-
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    Context_close(self);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
     Py_RETURN_NONE;
 }
 
@@ -138,6 +200,15 @@ PyMODINIT_FUNC PyInit_fwlib(void) {
     if (PyType_Ready(&ContextType) < 0)
         return NULL;
 
+    if (focas_lock == NULL) {
+        focas_lock = PyThread_allocate_lock();
+        if (focas_lock == NULL) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+        Py_AtExit(focas_atexit);
+    }
+
     m = PyModule_Create(&fwlibmodule);
     if (m == NULL)
         return NULL;
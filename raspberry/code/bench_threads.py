@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Aggregate FOCAS reads per second against the thread count.
+
+Every Context releases the GIL while it waits on the network, so threads
+polling different machines overlap their waits and the aggregate rate grows
+with the thread count until the controllers (or the link) are the limit.
+
+With --asyncio the same reads are awaited from one event loop through
+AsyncContext instead, the thread counts then size its worker pool.
+
+Machines are expected on port, port + 1, ... like `fanuc_sim --count=N` from
+examples/c serves them.
+"""
+import asyncio
+import threading
+import time
+
+import click
+import fwlib
+from fwlib import AsyncContext, Context
+
+
+def run(contexts, threads, seconds, read):
+    counts = [0] * threads
+    errors = [0] * threads
+    stop = threading.Event()
+
+    def worker(i):
+        # 스레드마다 장비를 나눠 맡음, 한 Context는 한 스레드만 사용
+        mine = contexts[i::threads]
+        while not stop.is_set():
+            for cnc in mine:
+                try:
+                    getattr(cnc, read)()
+                    counts[i] += 1
+                except Exception:
+                    errors[i] += 1
+
+    workers = [threading.Thread(target=worker, args=(i,)) for i in range(threads)]
+    start = time.perf_counter()
+    for w in workers:
+        w.start()
+    time.sleep(seconds)
+    stop.set()
+    for w in workers:
+        w.join()
+    elapsed = time.perf_counter() - start
+    return sum(counts) / elapsed, sum(errors)
+
+
+def run_async(contexts, seconds, read):
+    async def poll(cnc, deadline, counts):
+        # 장비마다 코루틴 하나, 이벤트 루프 스레드는 FOCAS 호출을 기다리지 않음
+        while time.perf_counter() < deadline:
+            try:
+                await getattr(cnc, read)()
+                counts[0] += 1
+            except Exception:
+                counts[1] += 1
+
+    async def main():
+        counts = [0, 0]
+        start = time.perf_counter()
+        await asyncio.gather(*(poll(cnc, start + seconds, counts) for cnc in contexts))
+        return counts[0] / (time.perf_counter() - start), counts[1]
+
+    return asyncio.run(main())
+
+
+@click.command()
+@click.option("--ip", default="127.0.0.1", help="CNC Machine IP Address")
+@click.option("--port", type=int, default=8193, help="Port of the first machine")
+@click.option("--machines", type=int, default=16, help="Number of machines")
+@click.option("--threads", default="1,2,4,8,16", help="Thread counts to measure")
+@click.option("--seconds", type=float, default=3.0, help="Duration of every run")
+@click.option(
+    "--read",
+    type=click.Choice(["rddynamic2", "statinfo", "rdblkcount", "acts", "actf"]),
+    default="rddynamic2",
+    help="Context method to call",
+)
+@click.option("--asyncio", "use_asyncio", is_flag=True, default=False,
+              help="Await the reads from one event loop, threads size the worker pool")
+def main(ip, port, machines, threads, seconds, read, use_asyncio):
+    factory = AsyncContext if use_asyncio else Context
+    contexts = [factory(host=ip, port=port + i) for i in range(machines)]
+    base = None
+    click.echo(f"{machines} machines, {read}, {seconds:g} s per run"
+               + (", asyncio" if use_asyncio else ""))
+    click.echo(f"{'threads':>7} {'reads/s':>10} {'speedup':>8} {'errors':>7}")
+    for n in [int(t) for t in threads.split(",")]:
+        n = max(1, min(n, machines))
+        if use_asyncio:
+            # 작업 스레드는 늘기만 하므로 오름차순으로 측정
+            fwlib.set_async_workers(n)
+            rate, errors = run_async(contexts, seconds, read)
+        else:
+            rate, errors = run(contexts, n, seconds, read)
+        base = base or rate
+        click.echo(f"{n:>7} {rate:>10.0f} {rate / base:>7.1f}x {errors:>7}")
+    for cnc in contexts:
+        cnc.__exit__(None, None, None)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,11 +1,20 @@
 from fwlib import Context
 
+# Position buffers reused by read_positions(), rows of up to 8 axes
+POSITION_SLOTS = 4
+POSITION_AXES = 8
+
 
 class CNCDevice:
     def __init__(self, ip="192.168.0.11", port=8193):
         self.ip = ip
         self.port = port
         self.context = None
+        self._positions = [
+            memoryview(bytearray(4 * POSITION_AXES * 8)).cast("q", (4, POSITION_AXES))
+            for _ in range(POSITION_SLOTS)
+        ]
+        self._position_slot = 0
 
     def __enter__(self):
         self.context = Context(host=self.ip, port=self.port)
@@ -17,8 +26,29 @@ class CNCDevice:
             self.context = None
 
     def read_id(self):
+        # Cached by the Context, only read again after a reconnect
         return self.context.read_id()
 
+    def read_metadata(self):
+        """Static machine data, read once per connection.
+
+        Returns:
+            dict: {'id': str, 'sysinfo': dict, 'software': [(str, str)] or None,
+                   'axes': [str], 'spindles': [str], 'decimals': [int]}
+
+            'software' is the (series, version) of every installed software
+            module, None when the controller does not report them. 'decimals'
+            holds the decimal places of each axis position, empty when unknown.
+        """
+        return self.context.metadata()
+
+    def set_path(self, path):
+        # Selected path is restored automatically after a reconnect
+        return self.context.setpath(path)
+
+    def reconnect_stats(self):
+        return self.context.reconnect_stats()
+
     def read_speed(self):
         return self.context.acts()
 
@@ -28,6 +58,105 @@ class CNCDevice:
     def read_feed_rate(self):
         return self.context.actf()
 
+    def snapshot(self, spec):
+        """Run several reads in one call, the GIL is released while they run.
+
+        Args:
+            spec (list): read names or (name, *args) tuples, e.g.
+                ["statinfo", ("rddynamic2", -1), ("rdgcode", -1, 1)]
+
+        Returns:
+            list: one result per read, the exception of a read that failed
+                takes its place instead of being raised.
+        """
+        return self.context.snapshot(spec)
+
+    def read_status(self):
+        """Read the CNC status.
+
+        Returns:
+            fwlib.Status: hdck, tmmode, aut, run, motion, mstb, emergency,
+                alarm, edit as int
+        """
+        return self.context.statinfo()
+
+    def read_block_count(self):
+        # Number of executed blocks, moves with every block the CNC reads
+        return self.context.rdblkcount()
+
+    def read_dynamic(self, axis=-1):
+        """Read alarm, program, sequence, feed rate, spindle speed and positions at once.
+
+        Args:
+            axis (int, optional): Axis number, -1 for all axes. Defaults to -1.
+
+        Returns:
+            fwlib.Dynamic, fields as in fwlib.asdict() of it: {
+                'axis': int, 'alarm': int, 'prgnum': int, 'prgmnum': int,
+                'seqnum': int, 'actf': int, 'acts': int,
+                'pos': {
+                    'absolute': [int] or int,   # one value per axis
+                    'machine': [int] or int,
+                    'relative': [int] or int,
+                    'distance': [int] or int,   # distance to go
+                }
+            }
+        """
+        return self.context.rddynamic2(axis)
+
+    def read_positions(self, out=None, scale=None):
+        """Read the positions of all axes into a buffer, no int object per axis.
+
+        Args:
+            out (buffer, optional): int32/int64 buffer of shape (4, n), e.g. a
+                NumPy array, or float32/float64 to get mm or inch (converted
+                in C with SIMD, no division per axis in Python). Defaults to
+                the next of POSITION_SLOTS int64 buffers owned by the device,
+                overwritten again POSITION_SLOTS reads later.
+            scale (buffer, optional): float64 buffer filled with 10 ** -decimals
+                per axis.
+
+        Returns:
+            tuple: (number of axes, out). Rows of out are absolute, machine,
+                relative and distance to go, one column per axis.
+
+        Example:
+            >>> pos = numpy.zeros((4, 8))
+            >>> n, _ = cnc.read_positions(pos)
+            >>> absolute = pos[0, :n]  # mm
+
+            Raw values kept for later are converted in bulk with
+            fwlib.to_float(values, decimals, out).
+        """
+        if out is None:
+            out = self._positions[self._position_slot]
+            self._position_slot = (self._position_slot + 1) % POSITION_SLOTS
+        return self.context.rdpositions(out, scale), out
+
+    def read_axis_data(self, kinds=("absolute", "machine", "relative", "distance")):
+        """Read several kinds of axis data in the fewest FOCAS calls.
+
+        Args:
+            kinds (sequence, optional): Kind names. Position: absolute, machine,
+                relative, distance, handle_input, handle_output. Servo:
+                servo_load, servo_current. Spindle: spindle_load, spindle_speed.
+                Defaults to the four positions (one call).
+
+        Returns:
+            dict: kind -> fwlib.AxisColumn, fields as in fwlib.asdict() of it:
+                {
+                    'names': (str, ...),  # Axis or spindle names, cached
+                    'data': [float],      # Value per axis, scaled by dec
+                    'dec': [int],         # Decimal places per axis
+                    'unit': [int],        # Unit per axis
+                }
+
+        Example:
+            >>> loads = cnc.read_axis_data(["servo_load"])["servo_load"]
+            >>> dict(zip(loads.names, loads.data))
+        """
+        return self.context.rdaxisdata(kinds)
+
     def read_feed_rate_and_speed(self, type=-1):
         """Read CNC feed rate and spindle speed data.
 
@@ -38,7 +167,8 @@ class CNCDevice:
                 -1: Both feed rate and spindle speed. Defaults to -1.
 
         Returns:
-            dict: Dictionary containing feed rate and/or spindle speed data.
+            fwlib.Speed: Feed rate and spindle speed data, fields as in
+                fwlib.asdict() of it:
                 {
                     'feed_rate': {
                         'data': int,    # Actual feed rate value (raw)
@@ -60,8 +190,8 @@ class CNCDevice:
 
         Example:
             >>> data = cnc.read_feed_rate_and_speed()
-            >>> feed_rate = data['feed_rate']['data'] / (10 ** data['feed_rate']['dec'])
-            >>> spindle_speed = data['spindle_speed']['data'] / (10 ** data['spindle_speed']['dec'])
+            >>> feed_rate = data.feed_rate.data / (10 ** data.feed_rate.dec)
+            >>> spindle_speed = data.spindle_speed.data / (10 ** data.spindle_speed.dec)
         """
         return self.context.rdspeed(type)
 
@@ -89,7 +219,7 @@ class CNCDevice:
                 2: next block
 
         Returns:
-            List: List of Gcode data.
+            List: List of fwlib.GCode, fields as in fwlib.asdict() of it.
                 [
                     {
                         'group': int,    # Group number
@@ -148,7 +278,8 @@ class CNCDevice:
                 2: next block
 
         Returns:
-            Dict: Dictionary of modal data.
+            fwlib.Modal: Modal data, fields as in fwlib.asdict() of it
+                (union members that were not read are None and left out).
                 {
                     'datano': int,    # Kind of modal data
                     'type': int,      # Objective block
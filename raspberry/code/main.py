@@ -2,6 +2,8 @@
 import logging
 import click
 from cnc import CNCDevice
+from fwlib import asdict
+from plan import compile_plan
 import paho.mqtt.client as mqtt
 import time
 import json
@@ -50,8 +52,31 @@ def setup_mqtt(name, mqtt_ip, mqtt_port) -> mqtt.Client:
     default=1.0,
     help="Time Interval to read data(seconds)",
 )
+@click.option(
+    "--slow_factor",
+    type=int,
+    default=1,
+    help="Read modal data, G codes and feed rate/speed units every slow_factor intervals",
+)
+@click.option(
+    "--gate",
+    is_flag=True,
+    default=False,
+    help="Read modal data and G codes every interval, only when status, "
+    "block count, program or sequence number changed",
+)
 @click.option("--print_log", is_flag=True, default=False, help="Print log to console")
-def main(ip, port, mqtt_ip, mqtt_port, mqtt_topic, time_interval, print_log):
+def main(
+    ip,
+    port,
+    mqtt_ip,
+    mqtt_port,
+    mqtt_topic,
+    time_interval,
+    slow_factor,
+    gate,
+    print_log,
+):
     if print_log:
         logging.getLogger().setLevel(logging.DEBUG)
     else:
@@ -64,114 +89,89 @@ def main(ip, port, mqtt_ip, mqtt_port, mqtt_topic, time_interval, print_log):
         logging.error(f"Failed to connect to MQTT Broker: {e}")
         raise click.ClickException(str(e))
 
+    # 모달 정보는 gate 모드에서는 매 주기, 변화 지표가 움직였을 때만 읽음
+    modal = [
+        "modal_gcode",
+        "one_shot_gcode",
+        "modal_data",
+        "one_shot_data",
+        "axis_data",
+        "other_data",
+    ]
+    modal_interval = time_interval if gate else time_interval * slow_factor
+
+    # 읽을 값과 주기를 선언하면 최소한의 FOCAS 호출로 묶어서 읽음
+    plan = compile_plan(
+        {
+            "speed": time_interval,
+            "feed_rate": time_interval,
+            "speeds": time_interval,
+            "alarm": time_interval,
+            "program": time_interval,
+            "sequence": time_interval,
+            "position": time_interval,
+            # 단위, 소수점 위치는 자주 바뀌지 않음
+            "feed_rate_speed": time_interval * slow_factor,
+            **{signal: modal_interval for signal in modal},
+        },
+        interval=time_interval,
+        gate=modal if gate else (),
+    )
+    click.echo(plan.describe())
+
     # CNC Machine에 연결 후, time interval 주기마다 데이터 읽어옴
     try:
-        start_time = time.perf_counter()
+        tick = 0
+        missed = 0
+        next_time = time.monotonic()
         with CNCDevice(ip, port) as cnc:
             while True:
                 message = {}
                 try:
-                    # 머신 ID 읽어옴
+                    # 머신 ID 읽어옴 (접속당 한 번만 CNC에서 읽고 이후에는 캐시)
                     id = cnc.read_id()
                     message["id"] = id
                     logging.info(f"[CNC Machine ID]\n{id}")
                 except Exception as e:
                     logging.error(f"Failed to read machine id: {e}")
 
-                try:
-                    # 스핀들 속도 하나 읽어옴
-                    speed = cnc.read_speed()
-                    message["speed"] = speed
-                    logging.info(f"[CNC Machine Speed]\n{speed}")
-                except Exception as e:
-                    logging.error(f"Failed to read speed: {e}")
-
-                try:
-                    # 모든 스핀들의 속도를 읽어옴
-                    speeds = cnc.read_speeds(-1)
-                    message["speeds"] = speeds
-                    logging.info(f"[CNC Machine Speeds]\n{speeds}")
-                except Exception as e:
-                    logging.error(f"Failed to read speeds: {e}")
-
-                try:
-                    # 이송 속도 읽어옴
-                    feed_rate = cnc.read_feed_rate()
-                    message["feed_rate"] = feed_rate
-                    logging.info(f"[CNC Machine Feed Rate]\n{feed_rate}")
-                except Exception as e:
-                    logging.error(f"Failed to read feed rate: {e}")
-
-                try:
-                    # 이송 속도와 스핀들 속도를 읽어옴
-                    feed_rate_speed = cnc.read_feed_rate_and_speed(-1)
-                    message["feed_rate_speed"] = feed_rate_speed
-                    logging.info(
-                        f"[CNC Machine Feed Rate and Speed]\n{feed_rate_speed}"
-                    )
-                except Exception as e:
-                    logging.error(f"Failed to read feed rate and speed: {e}")
-
-                """cnc_rdgcode"""
-                try:
-                    # 현재 활성화된 블럭의 modal Gcode를 한 번에 읽어옴
-                    gcode = cnc.read_all_active_modal_g_codes()
-                    message["modal_gcode"] = gcode
-                    logging.info(f"[CNC Machine Modal GCode]\n{gcode}")
-                except Exception as e:
-                    logging.error(f"Failed to read modal gcode: {e}")
-
-                try:
-                    # 현재 활성화된 블럭의 one shot Gcode를 한 번에 읽어옴
-                    gcode = cnc.read_all_active_one_shot_g_codes()
-                    message["one_shot_gcode"] = gcode
-                    logging.info(f"[CNC Machine One shot GCode]\n{gcode}")
-                except Exception as e:
-                    logging.error(f"Failed to read one shot gcode: {e}")
-
-                """cnc_modal"""
-                try:
-                    # 현재 활성화된 블럭의 modal data를 한 번에 읽어옴
-                    modal_data = cnc.read_all_active_modal_data()
-                    message["modal_data"] = modal_data
-                    logging.info(f"[CNC Machine Modal Data]\n{modal_data}")
-                except Exception as e:
-                    logging.error(f"Failed to read modal data: {e}")
-
-                try:
-                    # 현재 활성화된 블럭의 1 shot data를 한 번에 읽어옴
-                    one_shot_data = cnc.read_all_active_one_shot_data()
-                    message["one_shot_data"] = one_shot_data
-                    logging.info(f"[CNC Machine One shot Data]\n{one_shot_data}")
-                except Exception as e:
-                    logging.error(f"Failed to read one shot data: {e}")
-
-                try:
-                    # 현재 활성화된 블럭의 axis data를 한 번에 읽어옴
-                    axis_data = cnc.read_all_active_axis_data()
-                    message["axis_data"] = axis_data
-                    logging.info(f"[CNC Machine Axis Data]\n{axis_data}")
-                except Exception as e:
-                    logging.error(f"Failed to read axis data: {e}")
-
-                try:
-                    # 현재 활성화된 블럭의 Gcode 외 data를 한 번에 읽어옴
-                    other_data = cnc.read_all_active_other_data()
-                    message["other_data"] = other_data
-                    logging.info(f"[CNC Machine Other Data]\n{other_data}")
-                except Exception as e:
-                    logging.error(f"Failed to read other data: {e}")
+                # 이번 사이클에 읽을 호출만 실행, 나머지는 마지막 값을 그대로 보냄
+                values, errors = plan.poll(cnc.context, tick)
+                for signal, e in errors.items():
+                    logging.error(f"Failed to read {signal}: {e}")
+                for signal, value in values.items():
+                    # 결과 타입(struct sequence)은 JSON에서 리스트가 되므로 dict로 변환
+                    message[signal] = asdict(value)
+                    logging.info(f"[CNC Machine {signal}]\n{value}")
+
+                # 끊겼던 연결은 Context가 자동으로 재접속, 상태만 함께 전송
+                connection = cnc.reconnect_stats()
+                message["connection"] = connection
+                if not connection["connected"]:
+                    logging.error(f"CNC Machine disconnected: {connection}")
 
                 timestamp = dt.datetime.now(ZoneInfo("Asia/Seoul")).strftime(
                     "%Y-%m-%d %H:%M:%S"
                 )
                 message["timestamp"] = timestamp
-                end_time = time.perf_counter()
-                remaining_time = time_interval - (end_time - start_time)
-                if remaining_time > 0:
-                    time.sleep(remaining_time)
+                message["missed_cycles"] = missed
+                if gate:
+                    message["skipped_reads"] = plan.skipped_ratio()
                 mqtt_client.publish(mqtt_topic, json.dumps(message))
-                start_time = time.perf_counter()
+
+                # 다음 주기는 첫 주기 기준의 고정 시각, 읽기/전송 시간만큼 밀리지 않음
+                tick += 1
+                next_time += time_interval
+                now = time.monotonic()
+                if now >= next_time:
+                    # 주기를 넘기면 밀린 주기는 건너뛰고 다음 시각에 맞춤
+                    skipped = int((now - next_time) // time_interval) + 1
+                    missed += skipped
+                    # tick도 같이 넘겨야 느린/위상 읽기가 고정 격자를 유지
+                    tick += skipped
+                    next_time += skipped * time_interval
+                    logging.error(f"Cycle overran, skipped {skipped} cycle(s)")
+                time.sleep(next_time - now)
 
     except Exception as e:
         logging.error(f"Failed to connect cnc machine: {e}")
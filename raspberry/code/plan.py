@@ -0,0 +1,270 @@
+"""Poll plan: declare the signals to read and how often, get the fewest FOCAS calls.
+
+Several FOCAS functions return overlapping data. cnc_rddynamic2 alone covers the
+spindle speed, the feed rate, the alarm status, the program and sequence numbers
+and every position, so reading acts and actf separately costs round trips for
+nothing. compile_plan() picks the calls that cover the requested signals, gives
+each call the rate of the fastest signal it serves and spreads slow calls over
+different cycles so they do not all land on the same one.
+
+Gated signals are only read again when one of the cheap change indicators
+(cnc_statinfo, cnc_rdblkcount, program and sequence number) moved since their
+last read, the modal state can not change while the controller does not
+execute a block or change its mode.
+
+Example:
+    >>> plan = compile_plan({"speed": 1.0, "modal_gcode": 10.0}, interval=1.0)
+    >>> print(plan.describe())
+    >>> values, errors = plan.poll(cnc.context, tick)
+"""
+import math
+
+
+class Call:
+    """One FOCAS call of the Context and the signals that can be taken from it."""
+
+    def __init__(self, name, method, provides, *args, **kwargs):
+        self.name = name
+        self.method = method
+        self.args = args
+        self.kwargs = kwargs
+        # signal -> function extracting it from the call result
+        self.provides = provides
+
+    @property
+    def spec(self):
+        """The read as an item of Context.snapshot()."""
+        return (self.method, *self.args, *self.kwargs.values())
+
+    def __repr__(self):
+        return self.name
+
+
+def _same(value):
+    return value
+
+
+def _field(name):
+    return lambda value: getattr(value, name)
+
+
+# Catalog of calls, the order breaks ties (wider calls first)
+CALLS = [
+    Call(
+        "cnc_rddynamic2",
+        "rddynamic2",
+        {
+            "speed": _field("acts"),
+            "feed_rate": _field("actf"),
+            "alarm": _field("alarm"),
+            "program": _field("prgnum"),
+            "main_program": _field("prgmnum"),
+            "sequence": _field("seqnum"),
+            "position": _field("pos"),
+        },
+        -1,
+    ),
+    Call("cnc_acts", "acts", {"speed": _same}),
+    Call("cnc_actf", "actf", {"feed_rate": _same}),
+    Call("cnc_statinfo", "statinfo", {"status": _same}),
+    Call("cnc_rdblkcount", "rdblkcount", {"block_count": _same}),
+    Call("cnc_acts2", "acts2", {"speeds": _same}, -1),
+    Call("cnc_rdspeed", "rdspeed", {"feed_rate_speed": _same}, -1),
+    Call("cnc_rdgcode(-1)", "rdgcode", {"modal_gcode": _same}, type=-1, block=1),
+    Call("cnc_rdgcode(-2)", "rdgcode", {"one_shot_gcode": _same}, type=-2, block=1),
+    Call("cnc_modal(-1)", "rdmodal", {"modal_data": _same}, type=-1, block=1),
+    Call("cnc_modal(-4)", "rdmodal", {"one_shot_data": _same}, type=-4, block=1),
+    Call("cnc_modal(-3)", "rdmodal", {"axis_data": _same}, type=-3, block=1),
+    Call("cnc_modal(-2)", "rdmodal", {"other_data": _same}, type=-2, block=1),
+]
+
+# Read every cycle when some signals are gated
+INDICATORS = ("status", "block_count", "program", "sequence")
+
+
+class Scheduled:
+    """A call of the plan, run on the cycles where tick % period == phase."""
+
+    def __init__(self, call, period, phase, signals, gated=False):
+        self.call = call
+        self.period = period
+        self.phase = phase
+        self.signals = signals
+        self.gated = gated
+        # indicator values at the last read of a gated call
+        self.seen = None
+
+    def due(self, tick):
+        # 첫 사이클에는 모든 값을 한 번씩 읽음
+        return tick == 0 or tick % self.period == self.phase
+
+
+class Plan:
+    def __init__(self, interval, periods, scheduled):
+        self.interval = interval
+        # signal -> period in cycles
+        self.periods = periods
+        # gated calls after the indicators they depend on
+        self.scheduled = sorted(scheduled, key=lambda s: s.gated)
+        self.values = {}
+        # gated reads that were due, and the ones skipped as nothing moved
+        self.gated_due = 0
+        self.gated_skipped = 0
+
+    def round_trips(self, tick):
+        return sum(1 for s in self.scheduled if s.due(tick))
+
+    @property
+    def hyperperiod(self):
+        return math.lcm(*(s.period for s in self.scheduled)) if self.scheduled else 1
+
+    def naive_per_cycle(self):
+        """Average round trips with one dedicated call per signal."""
+        return sum(1 / period for period in self.periods.values())
+
+    def planned_per_cycle(self, gated=False):
+        return sum(1 / s.period for s in self.scheduled if s.gated == gated)
+
+    def skipped_ratio(self):
+        return self.gated_skipped / self.gated_due if self.gated_due else 0.0
+
+    def peak_per_cycle(self):
+        return max(
+            (self.round_trips(tick) for tick in range(1, self.hyperperiod + 1)),
+            default=0,
+        )
+
+    def describe(self):
+        lines = []
+        for s in sorted(self.scheduled, key=lambda s: (s.period, s.phase)):
+            every = s.period * self.interval
+            lines.append(
+                f"  every {every:g}s (phase {s.phase}) {s.call.name}"
+                + (" if indicators moved" if s.gated else "")
+                + ": "
+                + ", ".join(s.signals)
+            )
+        naive = self.naive_per_cycle()
+        planned = self.planned_per_cycle()
+        lines.append(
+            f"  round trips per cycle: {naive:.1f} with one call per signal, "
+            f"{planned:.1f} planned "
+            f"(peak {self.peak_per_cycle()}), {naive - planned:.1f} saved"
+        )
+        if any(s.gated for s in self.scheduled):
+            lines.append(
+                f"  plus up to {self.planned_per_cycle(gated=True):.1f} gated, "
+                f"{self.skipped_ratio():.0%} of them skipped so far"
+            )
+        return "\n".join(
+            [f"Poll plan: {len(self.periods)} signals in {len(self.scheduled)} calls"]
+            + lines
+        )
+
+    def poll(self, context, tick):
+        """Run the calls due on this cycle.
+
+        The calls go out as one Context.snapshot(), a second one for the gated
+        calls whose indicators moved.
+
+        Returns:
+            (values, errors): values of every signal read so far (the latest
+            value of signals that were not due this cycle), and the exception of
+            every call that failed keyed by the signals it was reading.
+        """
+        errors = {}
+        due = [s for s in self.scheduled if s.due(tick)]
+        self._read(context, [s for s in due if not s.gated], errors)
+
+        gated = []
+        for s in due:
+            if not s.gated:
+                continue
+            self.gated_due += 1
+            seen = [self.values.get(signal) for signal in INDICATORS]
+            # 지표가 하나라도 읽히지 않았으면 변화 여부를 알 수 없으므로 읽음
+            if (
+                None not in seen
+                and seen == s.seen
+                and all(signal in self.values for signal in s.signals)
+            ):
+                self.gated_skipped += 1
+                continue
+            s.seen = seen
+            gated.append(s)
+        self._read(context, gated, errors)
+        return self.values, errors
+
+    def _read(self, context, scheduled, errors):
+        if not scheduled:
+            return
+        results = context.snapshot([s.call.spec for s in scheduled])
+        for s, result in zip(scheduled, results):
+            if isinstance(result, Exception):
+                for signal in s.signals:
+                    # 실패한 값은 오래된 값으로 보내지 않음
+                    self.values.pop(signal, None)
+                    errors[signal] = result
+                s.seen = None
+                continue
+            for signal in s.signals:
+                self.values[signal] = s.call.provides[signal](result)
+
+
+def compile_plan(rates, interval=1.0, gate=(), calls=CALLS):
+    """Compile {signal: period in seconds} into a Plan.
+
+    Every period is rounded to a whole number of cycles of interval seconds.
+    Signals are covered from the fastest rate up: a call already chosen for a
+    faster rate is reused, the remaining signals are covered greedily by the
+    call that serves most of them. Calls slower than every cycle get the phase
+    where the fewest other calls run.
+
+    Calls serving only signals listed in gate are skipped while the INDICATORS,
+    added to the plan at every cycle, keep their values.
+    """
+    if interval <= 0:
+        raise ValueError("interval should be positive")
+
+    periods = {}
+    for signal, period in rates.items():
+        if not any(signal in call.provides for call in calls):
+            raise ValueError(f"Unknown signal: {signal}")
+        periods[signal] = max(1, round(period / interval))
+    gate = set(gate)
+    if gate - periods.keys():
+        raise ValueError(f"Gated signals without a rate: {sorted(gate - periods.keys())}")
+    if gate:
+        for signal in INDICATORS:
+            if signal in gate:
+                raise ValueError(f"Indicator can not be gated: {signal}")
+            periods[signal] = 1
+
+    chosen = []  # [call, period, signals]
+    for period in sorted(set(periods.values())):
+        wanted = {s for s, p in periods.items() if p == period}
+        # 더 빠른 주기로 이미 읽는 호출이 있으면 그대로 사용
+        for entry in chosen:
+            covered = wanted & entry[0].provides.keys()
+            entry[2].extend(sorted(covered))
+            wanted -= covered
+        while wanted:
+            best = max(calls, key=lambda call: len(wanted & call.provides.keys()))
+            covered = wanted & best.provides.keys()
+            chosen.append([best, period, sorted(covered)])
+            wanted -= covered
+
+    hyperperiod = math.lcm(*(entry[1] for entry in chosen)) if chosen else 1
+    load = [0] * hyperperiod
+    scheduled = []
+    for call, period, signals in sorted(chosen, key=lambda e: e[1]):
+        phase = min(
+            range(period),
+            key=lambda p: (max(load[t] for t in range(p, hyperperiod, period)), p),
+        )
+        for t in range(phase, hyperperiod, period):
+            load[t] += 1
+        gated = bool(gate) and all(signal in gate for signal in signals)
+        scheduled.append(Scheduled(call, period, phase, signals, gated))
+
+    return Plan(interval, periods, scheduled)
@@ -0,0 +1,25 @@
+"""Import check of the fwlib extension against the installed FOCAS library.
+
+Run after installing the wheel: the optional entry points the extension finds
+at import time must match what the library actually exports.
+"""
+import ctypes
+import ctypes.util
+import sys
+
+import fwlib
+
+
+def main():
+    name = ctypes.util.find_library("fwlib32") or "libfwlib32.so.1"
+    lib = ctypes.CDLL(name)
+    exported = hasattr(lib, "cnc_rdaxisdata64")
+    print(f"{name}: cnc_rdaxisdata64 exported={exported}, found by fwlib={fwlib.HAS_RDAXISDATA64}")
+    if exported != fwlib.HAS_RDAXISDATA64:
+        print("fwlib did not find cnc_rdaxisdata64 in the library it is linked to", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,15 +1,76 @@
+#define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
 #include "fwlib32.h"
 #include "code_map.h"
+#include "fixed_point.h"
 
 #define MACHINE_PORT_DEFAULT 8193
 #define TIMEOUT_DEFAULT 10
 #define MAX_AXIS 8
 
+// 재접속 대기 시간 (지수 증가, 최대값까지)
+#define BACKOFF_MIN_MS 250
+#define BACKOFF_MAX_MS 30000
+// cnc_rdaxisdata 한 번에 읽을 수 있는 종류 수
+#define AXISDATA_TYPES 4
+// AsyncContext 작업 스레드 기본 개수, set_async_workers로 늘릴 수 있음
+#define ASYNC_WORKERS_DEFAULT 16
+
+// 핸들을 다시 열어야 하는 에러 (네트워크 끊김 등)
+#define FOCAS_TRANSPORT(ret) ((ret) == EW_SOCKET || (ret) == EW_HANDLE)
+
 typedef struct {
     PyObject_HEAD
     unsigned short libh;
     int connected;
+    int acquired;
+    /* 재접속에 필요한 접속 정보와 세션 설정 */
+    char host[256];
+    int port;
+    int timeout;
+    short path;
+    int path_set;
+    /* FOCAS 호출은 GIL 없이 실행되므로 핸들 사용은 이 lock으로 직렬화 */
+    PyThread_type_lock lock;
+    /* 재접속 상태 */
+    uint64_t backoff_ms;
+    uint64_t retry_at_ms;
+    uint32_t jitter;
+    unsigned long reconnects;
+    unsigned long reconnect_failures;
+    unsigned long transport_errors;
+    /* 접속마다 한 번만 읽는 정적 정보, 재접속하면 다시 읽음 */
+    int meta_loaded;
+    char cnc_id[40];
+    ODBSYS sysinfo;
+    int has_syssoft;  // 0 when cnc_rdsyssoft is not supported
+    ODBSYSS syssoft;
+    short naxes;
+    ODBAXISNAME axes[MAX_AXIS];
+    short nspindles;
+    ODBSPDLNAME spindles[MAX_SPINDLE];
+    short ndecimals;  // 0 when cnc_getfigure is not supported
+    short decimals[MAX_AXIS];
+    /* rdaxisdata: -1 not probed, 0 cnc_rdaxisdata, 1 cnc_rdaxisdata64 (per connection) */
+    int axisdata_wide;
+    /* names tuple per class (axis, servo, spindle) and the raw names it was made from */
+    PyObject* axisdata_names[3];
+    short axisdata_nraw[3];
+    char axisdata_raw[3][MAX_AXIS * 4];
 } Context;
 
 struct aux_data {
@@ -18,15 +79,54 @@ struct aux_data {
     char flag2;
 };
 
+/*
+FOCAS library lifecycle
+cnc_startupprocess is process wide, restarting it per Context resets the state
+of every other open handle. It is started by the first Context, each Context
+keeps a reference and cnc_exitprocess runs once at interpreter exit. The
+count is bookkeeping only: closing the last Context keeps the library up, so
+a reconnect or a with-block per cycle does not restart it.
+*/
+static PyThread_type_lock focas_lock = NULL;
+static long focas_refs = 0;
+static int focas_started = 0;
+
+static int focas_acquire(void) {
+    int ret = 0;
+
+    PyThread_acquire_lock(focas_lock, WAIT_LOCK);
 #ifndef _WIN32
-int cnc_startup() {
-    return cnc_startupprocess(0, "focas.log");
+    if (!focas_started) {
+        if (cnc_startupprocess(0, "focas.log") != EW_OK) {
+            ret = -1;
+        } else {
+            focas_started = 1;
+        }
+    }
+#endif
+    if (ret == 0) {
+        focas_refs++;
+    }
+    PyThread_release_lock(focas_lock);
+    return ret;
 }
 
-void cnc_shutdown() {
-    cnc_exitprocess();
+static void focas_release(void) {
+    PyThread_acquire_lock(focas_lock, WAIT_LOCK);
+    // releases must pair with acquires, the count is only checked, teardown stays at exit
+    assert(focas_refs > 0);
+    focas_refs--;
+    PyThread_release_lock(focas_lock);
 }
+
+static void focas_atexit(void) {
+#ifndef _WIN32
+    if (focas_started) {
+        cnc_exitprocess();
+        focas_started = 0;
+    }
 #endif
+}
 
 
 static PyObject* parse_gdata(int type, unsigned char g_data, int is_one_shot);
@@ -35,40 +135,209 @@ static PyObject* parse_flag1(unsigned char flag1);
 static PyObject* parse_flag2(unsigned char flag2);
 
 
+// Release the handle and the library reference (idempotent)
+static void Context_close(Context* self) {
+    if (self->connected) {
+        cnc_freelibhndl(self->libh);
+        self->connected = 0;
+    }
+    if (self->acquired) {
+        focas_release();
+        self->acquired = 0;
+    }
+}
+
+static uint64_t monotonic_ms(void) {
+#ifdef _WIN32
+    return (uint64_t) GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+#endif
+}
+
+// Raise the FOCAS error, transport errors as ConnectionError
+static void focas_error(short ret) {
+    PyErr_Format(FOCAS_TRANSPORT(ret) ? PyExc_ConnectionError : PyExc_RuntimeError,
+                 "FWLIB32[%d]", ret);
+}
+
+/*
+Open the handle and replay the session setup (selected path).
+While a previous attempt is backing off this fails right away with EW_SOCKET,
+so a dead machine costs one connect timeout per backoff period, not per call.
+*/
+static short Context_connect(Context* self) {
+    uint64_t now = monotonic_ms();
+    uint64_t delay;
+    short ret;
+
+    if (self->connected) {
+        return EW_OK;
+    }
+    if (!self->acquired) {
+        return EW_HANDLE;  // closed by __exit__
+    }
+    if (now < self->retry_at_ms) {
+        return EW_SOCKET;
+    }
+
+    ret = cnc_allclibhndl3(self->host, self->port, self->timeout, &self->libh);
+    if (ret == EW_OK && self->path_set) {
+        ret = cnc_setpath(self->libh, self->path);
+        if (ret != EW_OK) {
+            cnc_freelibhndl(self->libh);
+        }
+    }
+    if (ret != EW_OK) {
+        // 지수 백오프 + jitter: 여러 장비가 동시에 재접속하지 않도록 절반은 무작위
+        self->backoff_ms = self->backoff_ms ? self->backoff_ms * 2 : BACKOFF_MIN_MS;
+        if (self->backoff_ms > BACKOFF_MAX_MS) {
+            self->backoff_ms = BACKOFF_MAX_MS;
+        }
+        self->jitter ^= self->jitter << 13;
+        self->jitter ^= self->jitter >> 17;
+        self->jitter ^= self->jitter << 5;
+        delay = self->backoff_ms / 2 + self->jitter % (self->backoff_ms / 2 + 1);
+        self->retry_at_ms = monotonic_ms() + delay;
+        self->reconnect_failures++;
+        return ret;
+    }
+
+    self->connected = 1;
+    self->meta_loaded = 0;  // may be another controller behind the same address
+    self->axisdata_wide = -1;
+    self->backoff_ms = 0;
+    self->retry_at_ms = 0;
+    return EW_OK;
+}
+
+// Forget a handle that returned a transport error, the next call reconnects
+static void Context_drop(Context* self) {
+    if (self->connected) {
+        cnc_freelibhndl(self->libh);
+        self->connected = 0;
+    }
+    self->transport_errors++;
+}
+
+/*
+Run a FOCAS call with handle resurrection: when the call fails with a transport
+error the handle is reopened once and the call repeated, so a short network
+blip costs one sample. `call` is evaluated again and must use self->libh.
+The caller holds self->lock.
+*/
+#define FOCAS_RETRY(self, ret, call)                                 \
+    do {                                                             \
+        int was_connected = (self)->connected;                       \
+        if (((ret) = Context_connect(self)) == EW_OK) {              \
+            if (!was_connected) (self)->reconnects++;                \
+            (ret) = (call);                                          \
+            if (FOCAS_TRANSPORT(ret)) {                              \
+                Context_drop(self);                                  \
+                if (Context_connect(self) == EW_OK) {                \
+                    (self)->reconnects++;                            \
+                    (ret) = (call);                                  \
+                    if (FOCAS_TRANSPORT(ret)) Context_drop(self);    \
+                }                                                    \
+            }                                                        \
+        }                                                            \
+    } while (0)
+
+/*
+FOCAS_RETRY for a method called with the GIL: the GIL is released for the
+network wait, other Python threads keep running and only threads using the
+same Context queue on its lock. `call` must not touch Python objects.
+*/
+#define FOCAS_CALL(self, ret, call)                      \
+    do {                                                 \
+        Py_BEGIN_ALLOW_THREADS                           \
+        PyThread_acquire_lock((self)->lock, WAIT_LOCK);  \
+        FOCAS_RETRY(self, ret, call);                    \
+        PyThread_release_lock((self)->lock);             \
+        Py_END_ALLOW_THREADS                             \
+    } while (0)
+
 static PyObject* Context_new(PyTypeObject* type, PyObject* args, PyObject* kwds) {
     Context* self;
     self = (Context*) type->tp_alloc(type, 0);
     if (self != NULL) {
+        self->lock = PyThread_allocate_lock();
+        if (!self->lock) {
+            Py_DECREF(self);
+            return PyErr_NoMemory();
+        }
         self->libh = 0;
         self->connected = 0;
+        self->acquired = 0;
+        self->host[0] = '\0';
+        self->path_set = 0;
+        self->backoff_ms = 0;
+        self->retry_at_ms = 0;
+        self->jitter = (uint32_t) (uintptr_t) self ^ (uint32_t) monotonic_ms();
+        if (self->jitter == 0) {
+            self->jitter = 1;
+        }
+        self->reconnects = 0;
+        self->reconnect_failures = 0;
+        self->transport_errors = 0;
+        self->meta_loaded = 0;
+        self->axisdata_wide = -1;
     }
     return (PyObject*) self;
 }
 
-static int Context_init(Context* self, PyObject* args, PyObject* kwds) {
+// Store the connection parameters and take the library reference, no network
+static int Context_setup(Context* self, PyObject* args, PyObject* kwds) {
     const char* host = "127.0.0.1";
     int port = MACHINE_PORT_DEFAULT;
     int timeout = TIMEOUT_DEFAULT;
-    int ret;
 
     static char* kwlist[] = {"host", "port", "timeout", NULL};
     if (!PyArg_ParseTupleAndKeywords(args, kwds, "|sii", kwlist, &host, &port, &timeout)) {
         return -1;
     }
 
-#ifndef _WIN32
-    if (cnc_startup() != EW_OK) {
+    Context_close(self);
+    if (focas_acquire() < 0) {
         PyErr_SetString(PyExc_RuntimeError, "Cannot start FANUC process.");
         return -1;
     }
-#endif
+    self->acquired = 1;
+
+    if (strlen(host) >= sizeof(self->host)) {
+        PyErr_SetString(PyExc_ValueError, "host is too long");
+        return -1;
+    }
+    strcpy(self->host, host);
+    self->port = port;
+    self->timeout = timeout;
+    self->path_set = 0;
+    self->backoff_ms = 0;
+    self->retry_at_ms = 0;
+    self->reconnects = 0;
+    self->reconnect_failures = 0;
+    self->transport_errors = 0;
+    return 0;
+}
+
+static int Context_init(Context* self, PyObject* args, PyObject* kwds) {
+    int ret;
+
+    if (Context_setup(self, args, kwds) < 0) {
+        return -1;
+    }
 
-    ret = cnc_allclibhndl3(host, port, timeout, &self->libh);
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    ret = Context_connect(self);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
     if (ret != EW_OK) {
         PyErr_Format(PyExc_ConnectionError, "FWLIB32[%d]", ret);
         return -1;
     }
-    self->connected = 1;
 
     return 0;
 }
@@ -79,822 +348,2538 @@ static PyObject* Context_enter(PyObject* self) {
 }
 
 static PyObject* Context_exit(Context* self, PyObject* exc_type, PyObject* exc_value, PyObject* traceback) {
-    if (self->connected) {
-        cnc_freelibhndl(self->libh);
-        self->connected = 0;
-    }
-
-#ifndef _WIN32
-    cnc_shutdown();
-#endif
-
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    Context_close(self);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
     Py_RETURN_NONE;
 }
 
 static void Context_dealloc(Context* self) {
-    if (self->connected) {
-        cnc_freelibhndl(self->libh);
-        self->connected = 0;
-    }
-
-#ifndef _WIN32
-    cnc_shutdown();
-#endif
+    int i;
 
+    Context_close(self);
+    for (i = 0; i < 3; i++) {
+        Py_CLEAR(self->axisdata_names[i]);
+    }
+    if (self->lock) {
+        PyThread_free_lock(self->lock);
+    }
     Py_TYPE(self)->tp_free((PyObject*) self);
 }
 
-/* 
+/*
 ===============================================================================
-Get data from the CNC machine 
+Result types
 ===============================================================================
+Reads return struct sequences instead of dictionaries: the field names live in
+the type, so a result is one allocation with no key hashing, and the fields are
+read as attributes (speed.feed_rate.data). fwlib.asdict() turns a result back
+into dictionaries and lists, e.g. for JSON.
 */
+static PyStructSequence_Field speed_element_fields[] = {
+    {"data", "Actual value (raw)"},
+    {"dec", "Decimal point position"},
+    {"unit", "Unit type (0:mm/min, 1:inch/min, 2:rpm, 3:mm/rev, 4:inch/rev)"},
+    {"reserve", "Reserved value"},
+    {"name", "Data identifier ('F' or 'S')"},
+    {"suff", "Suffix, the spindle number in ASCII for 'S'"},
+    {NULL}
+};
 
-/*
-Read CNC Machine ID [cnc_rdcncid]
-Returns the unique identifier of the CNC machine
-Reference: https://www.inventcom.net/fanuc-focas-library/misc/cnc_rdcncid
-*/
-static PyObject* Context_read_id(Context* self, PyObject* Py_UNUSED(ignored)) {
-    uint32_t cnc_ids[4] = {0};
-    char cnc_id[40] = "";
-    int ret;
+static PyStructSequence_Field speed_fields[] = {
+    {"feed_rate", "SpeedElement of the feed rate"},
+    {"spindle_speed", "SpeedElement of the spindle speed"},
+    {NULL}
+};
 
-    ret = cnc_rdcncid(self->libh, (unsigned long*) cnc_ids);
-    if (ret != EW_OK) {
-        PyErr_Format(PyExc_RuntimeError, "FWLIB32[%d]", ret);
-        return NULL;
+static PyStructSequence_Field speeds_fields[] = {
+    {"datano", "Number of spindles"},
+    {"data", "List of spindle speeds"},
+    {NULL}
+};
+
+static PyStructSequence_Field status_fields[] = {
+    {"hdck", NULL}, {"tmmode", NULL}, {"aut", NULL}, {"run", NULL}, {"motion", NULL},
+    {"mstb", NULL}, {"emergency", NULL}, {"alarm", NULL}, {"edit", NULL},
+    {NULL}
+};
+
+static PyStructSequence_Field dynamic_fields[] = {
+    {"axis", "Axis number read, -1 for all"},
+    {"alarm", "Alarm status"},
+    {"prgnum", "Running program number"},
+    {"prgmnum", "Main program number"},
+    {"seqnum", "Sequence number"},
+    {"actf", "Actual feed rate"},
+    {"acts", "Actual spindle speed"},
+    {"pos", "Position"},
+    {NULL}
+};
+
+static PyStructSequence_Field position_fields[] = {
+    {"absolute", NULL}, {"machine", NULL}, {"relative", NULL}, {"distance", "Distance to go"},
+    {NULL}
+};
+
+static PyStructSequence_Field gcode_fields[] = {
+    {"group", "Group number"},
+    {"flag", "Additional information"},
+    {"code", "G code"},
+    {NULL}
+};
+
+// Only the member of the cnc_modal union that was read is set, the others are None
+static PyStructSequence_Field modal_fields[] = {
+    {"datano", "Kind of modal data"},
+    {"type", "Objective block"},
+    {"g_data", NULL}, {"g_rdata", NULL}, {"g_1shot", NULL},
+    {"aux", NULL}, {"raux1", NULL}, {"raux2", NULL},
+    {NULL}
+};
+
+static PyStructSequence_Field gdata_fields[] = {
+    {"code", "G code"},
+    {"commanded", "Commanded in the block"},
+    {NULL}
+};
+
+static PyStructSequence_Field aux_fields[] = {
+    {"type", "Address, or the axis number for axis data"},
+    {"aux_data", NULL},
+    {"flag1", NULL},
+    {"flag2", NULL},
+    {NULL}
+};
+
+static PyStructSequence_Field flag1_fields[] = {
+    {"inputs", NULL}, {"is_negative", NULL}, {"has_decimal", NULL}, {"has_command", NULL},
+    {"flag1", "Raw value"},
+    {NULL}
+};
+
+static PyStructSequence_Field flag2_fields[] = {
+    {"decimal", "Number of decimal places"},
+    {"flag2", "Raw value"},
+    {NULL}
+};
+
+static PyStructSequence_Field axis_column_fields[] = {
+    {"names", "Axis or spindle names, the same tuple while they do not change"},
+    {"data", "Value of every axis, scaled by dec"},
+    {"dec", "Decimal places of every axis"},
+    {"unit", "Unit of every axis"},
+    {NULL}
+};
+
+static PyTypeObject SpeedElementType, SpeedType, SpeedsType, StatusType, DynamicType, PositionType,
+    GCodeType, ModalType, GDataType, AuxType, Flag1Type, Flag2Type, AxisColumnType;
+
+static struct {
+    PyTypeObject* type;
+    PyStructSequence_Desc desc;
+    PyObject* keys;  // interned field names, the dictionary keys of asdict()
+} result_types[] = {
+    {&SpeedElementType, {"fwlib.SpeedElement", "cnc_rdspeed feed rate or spindle speed", speed_element_fields, 6}},
+    {&SpeedType, {"fwlib.Speed", "cnc_rdspeed result", speed_fields, 2}},
+    {&SpeedsType, {"fwlib.Speeds", "cnc_acts2 result", speeds_fields, 2}},
+    {&StatusType, {"fwlib.Status", "cnc_statinfo result", status_fields, 9}},
+    {&DynamicType, {"fwlib.Dynamic", "cnc_rddynamic2 result", dynamic_fields, 8}},
+    {&PositionType, {"fwlib.Position", "Positions, one value per axis when all axes were read", position_fields, 4}},
+    {&GCodeType, {"fwlib.GCode", "cnc_rdgcode item", gcode_fields, 3}},
+    {&ModalType, {"fwlib.Modal", "cnc_modal result", modal_fields, 8}},
+    {&GDataType, {"fwlib.GData", "Modal G code", gdata_fields, 2}},
+    {&AuxType, {"fwlib.Aux", "Modal data other than G code", aux_fields, 4}},
+    {&Flag1Type, {"fwlib.Flag1", "Modal data flag1", flag1_fields, 5}},
+    {&Flag2Type, {"fwlib.Flag2", "Modal data flag2", flag2_fields, 2}},
+    {&AxisColumnType, {"fwlib.AxisColumn", "cnc_rdaxisdata item, one value per axis", axis_column_fields, 4}},
+};
+
+#define RESULT_TYPES ((int) (sizeof(result_types) / sizeof(result_types[0])))
+
+// Store a new reference in a struct sequence, fails on a NULL value
+static int result_set(PyObject* result, Py_ssize_t i, PyObject* value) {
+    if (!value) {
+        return -1;
     }
+    PyStructSequence_SET_ITEM(result, i, value);
+    return 0;
+}
 
-    snprintf(cnc_id, sizeof(cnc_id), "%08x-%08x-%08x-%08x",
-             cnc_ids[0], cnc_ids[1], cnc_ids[2], cnc_ids[3]);
+// One-character field, the interpreter keeps these strings cached
+static PyObject* char_string(char c) {
+    return PyUnicode_FromOrdinal((unsigned char) c);
+}
+
+static PyObject* asdict(PyObject* obj) {
+    PyObject* result;
+    PyObject* value;
+    Py_ssize_t i, n;
+    int t;
+
+    for (t = 0; t < RESULT_TYPES; t++) {
+        if (Py_TYPE(obj) != result_types[t].type) {
+            continue;
+        }
+        if (!(result = PyDict_New())) {
+            return NULL;
+        }
+        for (i = 0; i < result_types[t].desc.n_in_sequence; i++) {
+            value = PyStructSequence_GET_ITEM(obj, i);
+            if (value == Py_None) {
+                continue;  // cnc_modal union members that were not read
+            }
+            if (!(value = asdict(value)) || PyDict_SetItem(result, PyTuple_GET_ITEM(result_types[t].keys, i), value) < 0) {
+                Py_XDECREF(value);
+                Py_DECREF(result);
+                return NULL;
+            }
+            Py_DECREF(value);
+        }
+        return result;
+    }
+
+    if (PyList_CheckExact(obj)) {
+        n = PyList_GET_SIZE(obj);
+        if (!(result = PyList_New(n))) {
+            return NULL;
+        }
+        for (i = 0; i < n; i++) {
+            if (!(value = asdict(PyList_GET_ITEM(obj, i)))) {
+                Py_DECREF(result);
+                return NULL;
+            }
+            PyList_SET_ITEM(result, i, value);
+        }
+        return result;
+    }
 
-    return PyUnicode_FromString(cnc_id);
+    Py_INCREF(obj);
+    return obj;
 }
 
 /*
-Read Single Spindle Speed [cnc_acts]
-Returns the actual speed of a single spindle
-Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_acts
+Convert a result to dictionaries [asdict]
+Struct sequences become dictionaries keyed by field name (None union members of
+Modal are left out), lists are converted item by item, anything else is
+returned as is.
 */
-static PyObject* Context_acts(Context* self, PyObject* Py_UNUSED(ignored)) {
-    ODBACT actualspeed;
-    int ret;
+static PyObject* fwlib_asdict(PyObject* module, PyObject* obj) {
+    return asdict(obj);
+}
 
-    ret = cnc_acts(self->libh, &actualspeed);
-    if (ret != EW_OK) {
-        PyErr_Format(PyExc_RuntimeError, "FWLIB32[%d]", ret);
-        return NULL;
-    }
+static int result_types_init(PyObject* m) {
+    PyObject* key;
+    int t, i;
 
-    return PyLong_FromLong(actualspeed.data);
+    for (t = 0; t < RESULT_TYPES; t++) {
+        PyStructSequence_Desc* desc = &result_types[t].desc;
+
+        if (!result_types[t].keys) {
+            if (PyStructSequence_InitType2(result_types[t].type, desc) < 0) {
+                return -1;
+            }
+            if (!(result_types[t].keys = PyTuple_New(desc->n_in_sequence))) {
+                return -1;
+            }
+            for (i = 0; i < desc->n_in_sequence; i++) {
+                if (!(key = PyUnicode_InternFromString(desc->fields[i].name))) {
+                    return -1;
+                }
+                PyTuple_SET_ITEM(result_types[t].keys, i, key);
+            }
+        }
+        Py_INCREF(result_types[t].type);
+        // "fwlib.Speed" -> Speed
+        if (PyModule_AddObject(m, desc->name + 6, (PyObject*) result_types[t].type) < 0) {
+            Py_DECREF(result_types[t].type);
+            return -1;
+        }
+    }
+    return 0;
 }
 
+/* 
+===============================================================================
+Get data from the CNC machine 
+===============================================================================
+*/
+
 /*
-Read Multiple Spindle Speeds [cnc_acts2]
-Returns speeds for multiple spindles
-Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_acts2
-Parameters:
-    sp_no: Spindle number (-1: all spindles)
-Returns:
-    Dictionary containing:
-    - datano: Number of spindles
-    - data: List of spindle speeds
+Load the static metadata of the connection (ID, system info, software series,
+axis and spindle names) unless it is already cached. Axis and spindle names are optional, some
+controllers reject them without it being a connection problem.
+Runs without the GIL, the caller holds self->lock.
 */
-static PyObject* Context_acts2(Context* self, PyObject* args) {
-    short sp_no;
-    // 인자로 Spindle 번호를 받음 (-1: 모든 Spindle)
-    if (!PyArg_ParseTuple(args, "h", &sp_no)) {
-        return NULL;
-    }
+static short Context_read_metadata(Context* self) {
+    uint32_t cnc_ids[4] = {0};
+    short ret;
 
+    if (self->meta_loaded) {
+        return EW_OK;
+    }
 
-    ODBACT2 actualspeed;
-    int ret;
+    FOCAS_RETRY(self, ret, cnc_rdcncid(self->libh, (unsigned long*) cnc_ids));
+    if (ret != EW_OK) {
+        return ret;
+    }
+    snprintf(self->cnc_id, sizeof(self->cnc_id), "%08x-%08x-%08x-%08x",
+             cnc_ids[0], cnc_ids[1], cnc_ids[2], cnc_ids[3]);
 
-    ret = cnc_acts2(self->libh, sp_no, &actualspeed);
+    FOCAS_RETRY(self, ret, cnc_sysinfo(self->libh, &self->sysinfo));
     if (ret != EW_OK) {
-        PyErr_Format(PyExc_RuntimeError, "FWLIB32[%d]", ret);
-        return NULL;
+        return ret;
     }
 
-    PyObject* dict = PyDict_New();
-    if (!dict) {
-        return NULL;
+    FOCAS_RETRY(self, ret, cnc_rdsyssoft(self->libh, &self->syssoft));
+    if (FOCAS_TRANSPORT(ret)) {
+        return ret;
     }
+    self->has_syssoft = ret == EW_OK;
 
-    if (PyDict_SetItemString(dict, "datano", PyLong_FromLong(actualspeed.datano)) < 0) {
-        Py_DECREF(dict);
-        return NULL;
+    FOCAS_RETRY(self, ret, (self->naxes = MAX_AXIS, cnc_rdaxisname(self->libh, &self->naxes, self->axes)));
+    if (FOCAS_TRANSPORT(ret)) {
+        return ret;
+    } else if (ret != EW_OK) {
+        self->naxes = 0;
     }
 
-    // 스핀들 데이터 추가
-    PyObject* data_list = PyList_New(0);
-    if (!data_list) {
-        Py_DECREF(dict);
-        return NULL;
+    FOCAS_RETRY(self, ret, (self->nspindles = MAX_SPINDLE, cnc_rdspdlname(self->libh, &self->nspindles, self->spindles)));
+    if (FOCAS_TRANSPORT(ret)) {
+        return ret;
+    } else if (ret != EW_OK) {
+        self->nspindles = 0;
     }
-    
-    long* data = actualspeed.data;
-    for (int i = 0; i < actualspeed.datano; i++) {
-        PyList_Append(data_list, PyLong_FromLong(data[i]));
+
+    // 위치 데이터의 소수점 자릿수, 라이브러리는 제어 축 수(최대 32)만큼 채움
+    {
+        short valid = 0;
+        short dec_in[32] = {0};
+        short dec_out[32] = {0};
+        FOCAS_RETRY(self, ret, cnc_getfigure(self->libh, 0, &valid, dec_in, dec_out));
+        if (FOCAS_TRANSPORT(ret)) {
+            return ret;
+        }
+        self->ndecimals = ret == EW_OK ? (valid < MAX_AXIS ? valid : MAX_AXIS) : 0;
+        if (self->ndecimals < 0) {
+            self->ndecimals = 0;
+        }
+        memcpy(self->decimals, dec_in, sizeof(self->decimals));
     }
 
-    if (PyDict_SetItemString(dict, "data", data_list) < 0) {
-        Py_DECREF(dict);
-        Py_DECREF(data_list);
-        return NULL;
+    self->meta_loaded = 1;
+    return EW_OK;
+}
+
+static short Context_load_metadata(Context* self) {
+    short ret;
+
+    if (self->meta_loaded) {
+        return EW_OK;
     }
-    Py_DECREF(data_list);
 
-    return dict;
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    ret = Context_read_metadata(self);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    return ret;
 }
 
 /*
-Read CNC Axis Feedrate [cnc_actf]
-Returns the actual feedrate of the CNC machine axis
-Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_actf
+Read CNC Machine ID [cnc_rdcncid]
+Returns the unique identifier of the CNC machine
+Reference: https://www.inventcom.net/fanuc-focas-library/misc/cnc_rdcncid
 */
-static PyObject* Context_actf(Context* self, PyObject* Py_UNUSED(ignored)) {
-    ODBACT actualfeed;
-    int ret;
+static PyObject* Context_read_id(Context* self, PyObject* Py_UNUSED(ignored)) {
+    short ret;
 
-    ret = cnc_actf(self->libh, &actualfeed);
+    // CNC ID는 바뀌지 않으므로 접속 후 처음 한 번만 읽음
+    ret = Context_load_metadata(self);
     if (ret != EW_OK) {
-        PyErr_Format(PyExc_RuntimeError, "FWLIB32[%d]", ret);
+        focas_error(ret);
         return NULL;
     }
 
-    return PyLong_FromLong(actualfeed.data);
+    return PyUnicode_FromString(self->cnc_id);
+}
+
+// Name of an axis or spindle without the blank / NUL suffixes
+static PyObject* name_string(const char* chars, int len) {
+    while (len > 1 && (chars[len - 1] == ' ' || chars[len - 1] == '\0')) {
+        len--;
+    }
+    return PyUnicode_FromStringAndSize(chars, len);
 }
 
 /*
-Read CNC Feed Rate and Spindle Speed [cnc_rdspeed]
-Parameters:
-   type    : Data type to read
-             0      : Feed rate only
-             1      : Spindle speed only
-             -1     : Both feed rate and spindle speed
+Cached connection metadata [cnc_rdcncid, cnc_sysinfo, cnc_rdsyssoft, cnc_rdaxisname, cnc_rdspdlname, cnc_getfigure]
 Returns:
-   Dictionary containing:
-   - feed_rate      : Dictionary of feed rate data
-     - data        : Actual feed rate value (raw)
-     - dec         : Decimal point position
-     - unit        : Unit type (0:mm/min, 1:inch/min, 2:rpm, 3:mm/rev, 4:inch/rev)
-     - reserve     : Reserved value
-     - name        : Data identifier ('F')
-     - suff        : Suffix for identification
-   - spindle_speed : Dictionary of spindle speed data
-     - data        : Actual spindle speed value (raw)
-     - dec         : Decimal point position
-     - unit        : Unit type (2:rpm)
-     - reserve     : Reserved value
-     - name        : Data identifier ('S')
-     - suff        : Spindle number in ASCII
-Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_rdspeed
+    Dictionary containing:
+    - id       : CNC ID
+    - sysinfo  : Dictionary of cnc_sysinfo (addinfo, max_axis, cnc_type, mt_type, series, version, axes)
+    - software : List of (series, version) of the installed software modules (None when unknown)
+    - axes     : List of axis names
+    - spindles : List of spindle names
+    - decimals : Decimal places of the position of every axis (empty when unknown)
 */
-static PyObject* Context_rdspeed(Context* self, PyObject* args) {
-    short type = -1;
-    if (!PyArg_ParseTuple(args, "h", &type)) {
+static PyObject* Context_metadata(Context* self, PyObject* Py_UNUSED(ignored)) {
+    PyObject* dict = NULL;
+    PyObject* list = NULL;
+    PyObject* name;
+    PyObject* item;
+    short ret;
+    int i;
+
+    ret = Context_load_metadata(self);
+    if (ret != EW_OK) {
+        focas_error(ret);
         return NULL;
     }
 
-    ODBSPEED speed;
-    int ret;
-
-    ret = cnc_rdspeed(self->libh, type, &speed);
-    if (ret != EW_OK) {
-        PyErr_Format(PyExc_RuntimeError, "FWLIB32[%d]", ret);
-        return NULL;
-    }
-
-    SPEEDELM feed_rate = speed.actf;
-    SPEEDELM spindle_speed = speed.acts;
-
-    PyObject* dict = PyDict_New();
+    dict = Py_BuildValue("{s:s,s:{s:h,s:h,s:s#,s:s#,s:s#,s:s#,s:s#}}",
+                         "id", self->cnc_id,
+                         "sysinfo",
+                         "addinfo", self->sysinfo.addinfo,
+                         "max_axis", self->sysinfo.max_axis,
+                         "cnc_type", self->sysinfo.cnc_type, (Py_ssize_t) 2,
+                         "mt_type", self->sysinfo.mt_type, (Py_ssize_t) 2,
+                         "series", self->sysinfo.series, (Py_ssize_t) 4,
+                         "version", self->sysinfo.version, (Py_ssize_t) 4,
+                         "axes", self->sysinfo.axes, (Py_ssize_t) 2);
     if (!dict) {
         return NULL;
     }
 
-    /*
-    ------------------------------------------------
-    Feed Rate
-    ------------------------------------------------
-    */
-    // Create feed rate dictionary
-    PyObject* feed_rate_dict = PyDict_New();
-    if (!feed_rate_dict) {
-        Py_DECREF(dict);
-        return NULL;
+    if (!(list = PyList_New(self->naxes))) {
+        goto error;
     }
-    // Add feed rate data
-    PyObject* temp_obj;
-    
-    // Data
-    temp_obj = PyLong_FromLong(feed_rate.data);
-    if (!temp_obj) goto error;
-    if (PyDict_SetItemString(feed_rate_dict, "data", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
+    for (i = 0; i < self->naxes; i++) {
+        if (!(name = name_string(&self->axes[i].name, 2))) {
+            goto error;
+        }
+        PyList_SET_ITEM(list, i, name);
+    }
+    if (PyDict_SetItemString(dict, "axes", list) < 0) {
         goto error;
     }
-    Py_DECREF(temp_obj);
+    Py_DECREF(list);
 
-    // Dec
-    temp_obj = PyLong_FromLong(feed_rate.dec);
-    if (!temp_obj) goto error;
-    if (PyDict_SetItemString(feed_rate_dict, "dec", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
+    if (!(list = PyList_New(self->nspindles))) {
         goto error;
     }
-    Py_DECREF(temp_obj);
-
-    // Unit
-    temp_obj = PyLong_FromLong(feed_rate.unit);
-    if (!temp_obj) goto error;
-    if (PyDict_SetItemString(feed_rate_dict, "unit", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
+    for (i = 0; i < self->nspindles; i++) {
+        if (!(name = name_string(&self->spindles[i].name, 4))) {
+            goto error;
+        }
+        PyList_SET_ITEM(list, i, name);
+    }
+    if (PyDict_SetItemString(dict, "spindles", list) < 0) {
         goto error;
     }
-    Py_DECREF(temp_obj);
+    Py_DECREF(list);
 
-    // Reserve
-    temp_obj = PyLong_FromLong(feed_rate.reserve);
-    if (!temp_obj) goto error;
-    if (PyDict_SetItemString(feed_rate_dict, "reserve", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
+    if (!(list = PyList_New(self->ndecimals))) {
         goto error;
     }
-    Py_DECREF(temp_obj);
-
-    // Name
-    temp_obj = PyUnicode_FromFormat("%c", feed_rate.name);
-    if (!temp_obj) goto error;
-    if (PyDict_SetItemString(feed_rate_dict, "name", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
+    for (i = 0; i < self->ndecimals; i++) {
+        if (!(item = PyLong_FromLong(self->decimals[i]))) {
+            goto error;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    if (PyDict_SetItemString(dict, "decimals", list) < 0) {
         goto error;
     }
-    Py_DECREF(temp_obj);
+    Py_DECREF(list);
 
-    // Suffix
-    temp_obj = PyUnicode_FromFormat("%c", feed_rate.suff);
-    if (!temp_obj) goto error;
-    if (PyDict_SetItemString(feed_rate_dict, "suff", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
+    if (self->has_syssoft) {
+        int count = self->syssoft.soft_inst < 16 ? self->syssoft.soft_inst : 16;
+        if (!(list = PyList_New(count < 0 ? 0 : count))) {
+            goto error;
+        }
+        for (i = 0; i < count; i++) {
+            if (!(item = Py_BuildValue("(NN)", name_string(self->syssoft.soft_series[i], 4),
+                                       name_string(self->syssoft.soft_version[i], 4)))) {
+                goto error;
+            }
+            PyList_SET_ITEM(list, i, item);
+        }
+    } else {
+        Py_INCREF(Py_None);
+        list = Py_None;
+    }
+    if (PyDict_SetItemString(dict, "software", list) < 0) {
         goto error;
     }
-    Py_DECREF(temp_obj);
+    Py_DECREF(list);
+
+    return dict;
+
+error:
+    Py_XDECREF(list);
+    Py_DECREF(dict);
+    return NULL;
+}
+
+/*
+Read Single Spindle Speed [cnc_acts]
+Returns the actual speed of a single spindle
+Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_acts
+*/
+static PyObject* Context_acts(Context* self, PyObject* Py_UNUSED(ignored)) {
+    ODBACT actualspeed;
+    int ret;
+
+    FOCAS_CALL(self, ret, cnc_acts(self->libh, &actualspeed));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
+    }
+
+    return PyLong_FromLong(actualspeed.data);
+}
+
+// cnc_acts2 result, shared by Context.acts2 and Context.snapshot
+static PyObject* build_acts2(ODBACT2* actualspeed) {
+    PyObject* result;
+    PyObject* data;
+    int i;
+
+    if (!(result = PyStructSequence_New(&SpeedsType))) {
+        return NULL;
+    }
+    if (result_set(result, 0, PyLong_FromLong(actualspeed->datano)) < 0 ||
+        result_set(result, 1, data = PyList_New(actualspeed->datano)) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    // 스핀들 데이터 추가
+    for (i = 0; i < actualspeed->datano; i++) {
+        PyObject* value = PyLong_FromLong(actualspeed->data[i]);
+        if (!value) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        PyList_SET_ITEM(data, i, value);
+    }
+
+    return result;
+}
+
+/*
+Read Multiple Spindle Speeds [cnc_acts2]
+Returns speeds for multiple spindles
+Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_acts2
+Parameters:
+    sp_no: Spindle number (-1: all spindles)
+Returns:
+    Speeds:
+    - datano: Number of spindles
+    - data: List of spindle speeds
+*/
+static PyObject* Context_acts2(Context* self, PyObject* args) {
+    short sp_no;
+    // 인자로 Spindle 번호를 받음 (-1: 모든 Spindle)
+    if (!PyArg_ParseTuple(args, "h", &sp_no)) {
+        return NULL;
+    }
+
+
+    ODBACT2 actualspeed;
+    int ret;
+
+    FOCAS_CALL(self, ret, cnc_acts2(self->libh, sp_no, &actualspeed));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
+    }
+
+    return build_acts2(&actualspeed);
+}
+
+/*
+Read CNC Axis Feedrate [cnc_actf]
+Returns the actual feedrate of the CNC machine axis
+Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_actf
+*/
+static PyObject* Context_actf(Context* self, PyObject* Py_UNUSED(ignored)) {
+    ODBACT actualfeed;
+    int ret;
+
+    FOCAS_CALL(self, ret, cnc_actf(self->libh, &actualfeed));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
+    }
+
+    return PyLong_FromLong(actualfeed.data);
+}
+
+static PyObject* build_speed_element(SPEEDELM* e) {
+    PyObject* result = PyStructSequence_New(&SpeedElementType);
+
+    if (!result) {
+        return NULL;
+    }
+    if (result_set(result, 0, PyLong_FromLong(e->data)) < 0 ||
+        result_set(result, 1, PyLong_FromLong(e->dec)) < 0 ||
+        result_set(result, 2, PyLong_FromLong(e->unit)) < 0 ||
+        result_set(result, 3, PyLong_FromLong(e->reserve)) < 0 ||
+        result_set(result, 4, char_string(e->name)) < 0 ||
+        result_set(result, 5, char_string(e->suff)) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
 
+// cnc_rdspeed result as feed_rate / spindle_speed elements
+static PyObject* build_rdspeed(ODBSPEED* speed) {
+    PyObject* result = PyStructSequence_New(&SpeedType);
 
-    /*
-    ------------------------------------------------
-    Spindle Speed
-    ------------------------------------------------
-    */
-    // Create spindle speed dictionary
-    PyObject* spindle_speed_dict = PyDict_New();
-    if (!spindle_speed_dict) {
-        Py_DECREF(dict);
-        Py_DECREF(feed_rate_dict);
+    if (!result) {
+        return NULL;
+    }
+    if (result_set(result, 0, build_speed_element(&speed->actf)) < 0 ||
+        result_set(result, 1, build_speed_element(&speed->acts)) < 0) {
+        Py_DECREF(result);
         return NULL;
     }
+    return result;
+}
 
-    // Data
-    temp_obj = PyLong_FromLong(spindle_speed.data);
-    if (!temp_obj) goto error_with_spindle;
-    if (PyDict_SetItemString(spindle_speed_dict, "data", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
-        goto error_with_spindle;
+/*
+Read CNC Feed Rate and Spindle Speed [cnc_rdspeed]
+Parameters:
+   type    : Data type to read
+             0      : Feed rate only
+             1      : Spindle speed only
+             -1     : Both feed rate and spindle speed
+Returns:
+   Speed:
+   - feed_rate      : SpeedElement of the feed rate
+     - data        : Actual feed rate value (raw)
+     - dec         : Decimal point position
+     - unit        : Unit type (0:mm/min, 1:inch/min, 2:rpm, 3:mm/rev, 4:inch/rev)
+     - reserve     : Reserved value
+     - name        : Data identifier ('F')
+     - suff        : Suffix for identification
+   - spindle_speed : SpeedElement of the spindle speed
+     - data        : Actual spindle speed value (raw)
+     - dec         : Decimal point position
+     - unit        : Unit type (2:rpm)
+     - reserve     : Reserved value
+     - name        : Data identifier ('S')
+     - suff        : Spindle number in ASCII
+Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_rdspeed
+*/
+static PyObject* Context_rdspeed(Context* self, PyObject* args) {
+    short type = -1;
+    if (!PyArg_ParseTuple(args, "h", &type)) {
+        return NULL;
     }
-    Py_DECREF(temp_obj);
 
-    // Dec
-    temp_obj = PyLong_FromLong(spindle_speed.dec);
-    if (!temp_obj) goto error_with_spindle;
-    if(PyDict_SetItemString(spindle_speed_dict, "dec", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
-        goto error_with_spindle;
+    ODBSPEED speed;
+    int ret;
+
+    FOCAS_CALL(self, ret, cnc_rdspeed(self->libh, type, &speed));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
     }
-    Py_DECREF(temp_obj);
 
-    // Unit
-    temp_obj = PyLong_FromLong(spindle_speed.unit);
-    if (!temp_obj) goto error_with_spindle;
-    if (PyDict_SetItemString(spindle_speed_dict, "unit", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
-        goto error_with_spindle;
+    return build_rdspeed(&speed);
+}
+
+// cnc_statinfo result
+static PyObject* build_statinfo(ODBST* st) {
+    PyObject* result = PyStructSequence_New(&StatusType);
+
+    if (!result) {
+        return NULL;
+    }
+    if (result_set(result, 0, PyLong_FromLong(st->hdck)) < 0 ||
+        result_set(result, 1, PyLong_FromLong(st->tmmode)) < 0 ||
+        result_set(result, 2, PyLong_FromLong(st->aut)) < 0 ||
+        result_set(result, 3, PyLong_FromLong(st->run)) < 0 ||
+        result_set(result, 4, PyLong_FromLong(st->motion)) < 0 ||
+        result_set(result, 5, PyLong_FromLong(st->mstb)) < 0 ||
+        result_set(result, 6, PyLong_FromLong(st->emergency)) < 0 ||
+        result_set(result, 7, PyLong_FromLong(st->alarm)) < 0 ||
+        result_set(result, 8, PyLong_FromLong(st->edit)) < 0) {
+        Py_DECREF(result);
+        return NULL;
     }
-    Py_DECREF(temp_obj);
+    return result;
+}
 
-    // Reserve
-    temp_obj = PyLong_FromLong(spindle_speed.reserve);
-    if (!temp_obj) goto error_with_spindle;
-    if (PyDict_SetItemString(spindle_speed_dict, "reserve", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
-        goto error_with_spindle;
+/*
+Read CNC Status Information [cnc_statinfo]
+Returns the operation mode, running, motion, alarm and edit states
+Reference: https://www.inventcom.net/fanuc-focas-library/misc/cnc_statinfo
+Returns:
+    Status:
+    - hdck, tmmode, aut, run, motion, mstb, emergency, alarm, edit
+*/
+static PyObject* Context_statinfo(Context* self, PyObject* Py_UNUSED(ignored)) {
+    ODBST st;
+    short ret;
+
+    FOCAS_CALL(self, ret, cnc_statinfo(self->libh, &st));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
     }
-    Py_DECREF(temp_obj);
 
-    // Name
-    temp_obj = PyUnicode_FromFormat("%c", spindle_speed.name);
-    if (!temp_obj) goto error_with_spindle;
-    if (PyDict_SetItemString(spindle_speed_dict, "name", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
-        goto error_with_spindle;
+    return build_statinfo(&st);
+}
+
+/*
+Read Block Counter [cnc_rdblkcount]
+Returns the number of blocks executed, it moves whenever a block is read
+Reference: https://www.inventcom.net/fanuc-focas-library/program/cnc_rdblkcount
+*/
+static PyObject* Context_rdblkcount(Context* self, PyObject* Py_UNUSED(ignored)) {
+    long count;
+    short ret;
+
+    FOCAS_CALL(self, ret, cnc_rdblkcount(self->libh, &count));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
     }
-    Py_DECREF(temp_obj);
 
-    // Suffix
-    temp_obj = PyUnicode_FromFormat("%c", spindle_speed.suff);
-    if (!temp_obj) goto error_with_spindle;
-    if (PyDict_SetItemString(spindle_speed_dict, "suff", temp_obj) < 0) {
-        Py_DECREF(temp_obj);
-        goto error_with_spindle;
+    return PyLong_FromLong(count);
+}
+
+// 모든 축을 읽을 때는 캐시된 축 개수만큼만 변환
+static short Context_axis_count(Context* self, int* naxes) {
+    short ret = Context_load_metadata(self);
+
+    if (ret != EW_OK) {
+        return ret;
+    }
+    *naxes = self->naxes;
+    if (*naxes <= 0 || *naxes > MAX_AXIS) {
+        *naxes = MAX_AXIS;
     }
-    Py_DECREF(temp_obj);
+    return EW_OK;
+}
+
+// cnc_rddynamic2 result, position lists hold naxes values when all axes were read
+static PyObject* build_rddynamic2(ODBDY2* dy, short axis, int naxes) {
+    PyObject* result;
+    PyObject* pos;
+    PyObject* temp;
+    int i, t;
 
-    // Add dictionaries to main dict
-    if (PyDict_SetItemString(dict, "feed_rate", feed_rate_dict) < 0) {
-        goto error_with_spindle;
+    if (!(result = PyStructSequence_New(&DynamicType))) {
+        return NULL;
     }
-    if (PyDict_SetItemString(dict, "spindle_speed", spindle_speed_dict) < 0) {
-        goto error_with_spindle;
+    if (result_set(result, 0, PyLong_FromLong(dy->axis)) < 0 ||
+        result_set(result, 1, PyLong_FromLong(dy->alarm)) < 0 ||
+        result_set(result, 2, PyLong_FromLong(dy->prgnum)) < 0 ||
+        result_set(result, 3, PyLong_FromLong(dy->prgmnum)) < 0 ||
+        result_set(result, 4, PyLong_FromLong(dy->seqnum)) < 0 ||
+        result_set(result, 5, PyLong_FromLong(dy->actf)) < 0 ||
+        result_set(result, 6, PyLong_FromLong(dy->acts)) < 0 ||
+        result_set(result, 7, pos = PyStructSequence_New(&PositionType)) < 0) {
+        goto error;
     }
 
-    Py_DECREF(feed_rate_dict);
-    Py_DECREF(spindle_speed_dict);
+    for (t = 0; t < 4; t++) {
+        if (axis == ALL_AXES) {
+            long* values = t == 0 ? dy->pos.faxis.absolute
+                         : t == 1 ? dy->pos.faxis.machine
+                         : t == 2 ? dy->pos.faxis.relative
+                         : dy->pos.faxis.distance;
+            if (result_set(pos, t, temp = PyList_New(naxes)) < 0) {
+                goto error;
+            }
+            for (i = 0; i < naxes; i++) {
+                PyObject* value = PyLong_FromLong(values[i]);
+                if (!value) {
+                    goto error;
+                }
+                PyList_SET_ITEM(temp, i, value);
+            }
+        } else {
+            long value = t == 0 ? dy->pos.oaxis.absolute
+                       : t == 1 ? dy->pos.oaxis.machine
+                       : t == 2 ? dy->pos.oaxis.relative
+                       : dy->pos.oaxis.distance;
+            if (result_set(pos, t, PyLong_FromLong(value)) < 0) {
+                goto error;
+            }
+        }
+    }
 
-    return dict;
+    return result;
 
-error_with_spindle:
-    Py_DECREF(spindle_speed_dict);
 error:
-    Py_DECREF(dict);
-    Py_DECREF(feed_rate_dict);
+    Py_DECREF(result);
     return NULL;
 }
 
 /*
-Read G code [cnc_rdgcode]
-Returns the G code data of the CNC machine
-Reference: https://www.inventcom.net/fanuc-focas-library/Misc/cnc_rdgcode
+Read All Dynamic Data [cnc_rddynamic2]
+Alarm status, program and sequence numbers, actual feed rate, actual spindle
+speed and the four position sets in a single round trip
+Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_rddynamic2
+Parameters:
+    axis: Axis number (-1: all axes, default)
+Returns:
+    Dynamic:
+    - axis, alarm, prgnum, prgmnum, seqnum, actf, acts
+    - pos: Position with absolute, machine, relative and distance
+           (one value per axis, or a single value when one axis is read)
 */
-static PyObject* Context_rdgcode(Context* self, PyObject* args, PyObject* kwds) {
-    short type;
-    short block;
-    static char* kwlist[] = {"type", "block", NULL};
-    
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "hh", kwlist, &type, &block)) {
-        PyErr_SetString(PyExc_TypeError, "Invalid arguments");
+static PyObject* Context_rddynamic2(Context* self, PyObject* args) {
+    short axis = ALL_AXES;
+    ODBDY2 dy;
+    short ret;
+    int naxes = 1;
+
+    if (!PyArg_ParseTuple(args, "|h", &axis)) {
         return NULL;
     }
 
-    if (!(block >= 0 && block <= 2)) {
-        PyErr_SetString(PyExc_ValueError, "Invalid block number, block number should be 0, 1, 2");
+    if (axis == ALL_AXES && (ret = Context_axis_count(self, &naxes)) != EW_OK) {
+        focas_error(ret);
         return NULL;
     }
 
-    ODBGCD* gcode;
-    short num_gcd;
+    FOCAS_CALL(self, ret, cnc_rddynamic2(self->libh, axis, sizeof(dy), &dy));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
+    }
 
-    if (type == -1 || type == -2) {
-        // Allocate maximum size
-        num_gcd = 50;
-        gcode = (ODBGCD*) malloc(sizeof(ODBGCD) * num_gcd);
-    } else {
-        // Allocate single size
-        num_gcd = 1;
-        gcode = (ODBGCD*) malloc(sizeof(ODBGCD));
+    return build_rddynamic2(&dy, axis, naxes);
+}
+
+/*
+C-contiguous buffer of a numeric type code in codes, e.g. a NumPy array.
+flags adds PyBUF_WRITABLE for output buffers. Returns the type code or -1.
+*/
+static int numeric_buffer(PyObject* obj, Py_buffer* view, int flags, const char* codes, const char* what) {
+    const char* format;
+
+    if (PyObject_GetBuffer(obj, view, flags | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) {
+        return -1;
     }
+    format = view->format ? view->format : "B";
+    // 바이트 순서는 native만 (NumPy는 '<' 또는 '=' 를 붙이기도 함)
+    if (*format == '@' || *format == '=' || (*format == '<' && PY_LITTLE_ENDIAN)) {
+        format++;
+    }
+    if (format[0] == '\0' || format[1] != '\0' || !strchr(codes, format[0]) ||
+        (view->itemsize != 2 && view->itemsize != 4 && view->itemsize != 8)) {
+        PyErr_Format(PyExc_TypeError, "%s must be a buffer of %s, not '%s'", what,
+                     !strcmp(codes, "df") ? "float32/float64"
+                     : !strcmp(codes, "ilq") ? "int32/int64"
+                     : !strcmp(codes, "h") ? "int16"
+                     : "int32/int64/float32/float64",
+                     view->format ? view->format : "B");
+        PyBuffer_Release(view);
+        return -1;
+    }
+    return format[0];
+}
 
-    if (!gcode) {
-        PyErr_SetString(PyExc_MemoryError, "Cannot allocate memory for gcode");
+/*
+Read All Positions into a Buffer [cnc_rddynamic2]
+The positions of all axes are written to the caller's buffer instead of being
+returned as Python ints, so polling many axes at a high rate allocates nothing
+and NumPy can use the data as is.
+Parameters:
+    out   : Writable buffer of int32, int64, float32 or float64, either 2-D of
+            shape (4, n) with n >= number of axes, or 1-D with at least
+            4 * axes items (rows packed one after the other). Rows: absolute,
+            machine, relative, distance to go. Columns past the number of
+            axes are not touched. Float buffers get the positions in mm or
+            inch, divided by 10 ** decimals (NaN where cnc_getfigure is not
+            supported).
+    scale : Optional writable float32/float64 buffer, one item per axis,
+            filled with 10 ** -decimals so that out * scale is in mm or inch
+            (NaN where cnc_getfigure is not supported)
+Returns:
+    Number of axes written
+Example:
+    pos = numpy.zeros((4, 8))
+    n = cnc.rdpositions(pos)
+    absolute = pos[0, :n]
+*/
+static PyObject* Context_rdpositions(Context* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"out", "scale", NULL};
+    PyObject* out_obj;
+    PyObject* scale_obj = Py_None;
+    Py_buffer out, scale;
+    Py_ssize_t stride;
+    ODBDY2 dy;
+    int32_t raw[MAX_AXIS];
+    int naxes, known;
+    int code;
+    short ret;
+    int i, t;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &out_obj, &scale_obj)) {
+        return NULL;
+    }
+    if ((ret = Context_axis_count(self, &naxes)) != EW_OK) {
+        focas_error(ret);
         return NULL;
     }
+    if ((code = numeric_buffer(out_obj, &out, PyBUF_WRITABLE, "ilqdf", "out")) < 0) {
+        return NULL;
+    }
+    stride = out.ndim == 2 && out.shape[0] == 4 ? out.shape[1] : naxes;
+    if (stride < naxes || out.len / out.itemsize < 4 * stride) {
+        PyErr_Format(PyExc_ValueError, "out holds %zd items, %d axes need 4 x %d", out.len / out.itemsize, naxes, naxes);
+        PyBuffer_Release(&out);
+        return NULL;
+    }
+    if (scale_obj != Py_None) {
+        if (numeric_buffer(scale_obj, &scale, PyBUF_WRITABLE, "df", "scale") < 0) {
+            PyBuffer_Release(&out);
+            return NULL;
+        }
+        if (scale.len / scale.itemsize < naxes) {
+            PyErr_Format(PyExc_ValueError, "scale holds %zd items, %d axes", scale.len / scale.itemsize, naxes);
+            PyBuffer_Release(&scale);
+            PyBuffer_Release(&out);
+            return NULL;
+        }
+    }
+
+    FOCAS_CALL(self, ret, cnc_rddynamic2(self->libh, ALL_AXES, sizeof(dy), &dy));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        goto done;
+    }
 
+    for (t = 0; t < 4; t++) {
+        long* values = t == 0 ? dy.pos.faxis.absolute
+                     : t == 1 ? dy.pos.faxis.machine
+                     : t == 2 ? dy.pos.faxis.relative
+                     : dy.pos.faxis.distance;
+        if (code == 'd' || code == 'f') {
+            known = naxes < self->ndecimals ? naxes : self->ndecimals;
+            for (i = 0; i < naxes; i++) {
+                raw[i] = (int32_t) values[i];
+            }
+            if (out.itemsize == 4) {
+                float* row = (float*) out.buf + t * stride;
+                fixed_to_f32(raw, self->decimals, known, row);
+                for (i = known; i < naxes; i++) {
+                    row[i] = (float) Py_NAN;
+                }
+            } else {
+                double* row = (double*) out.buf + t * stride;
+                fixed_to_f64(raw, self->decimals, known, row);
+                for (i = known; i < naxes; i++) {
+                    row[i] = Py_NAN;
+                }
+            }
+        } else if (out.itemsize == 4) {
+            int32_t* row = (int32_t*) out.buf + t * stride;
+            for (i = 0; i < naxes; i++) {
+                row[i] = (int32_t) values[i];
+            }
+        } else {
+            int64_t* row = (int64_t*) out.buf + t * stride;
+            for (i = 0; i < naxes; i++) {
+                row[i] = (int64_t) values[i];
+            }
+        }
+    }
+    if (scale_obj != Py_None) {
+        for (i = 0; i < naxes; i++) {
+            double value = i < self->ndecimals ? 1.0 : Py_NAN;
+            for (t = 0; i < self->ndecimals && t < self->decimals[i]; t++) {
+                value /= 10;
+            }
+            if (scale.itemsize == 4) {
+                ((float*) scale.buf)[i] = (float) value;
+            } else {
+                ((double*) scale.buf)[i] = value;
+            }
+        }
+    }
+
+done:
+    if (scale_obj != Py_None) {
+        PyBuffer_Release(&scale);
+    }
+    PyBuffer_Release(&out);
+    return ret == EW_OK ? PyLong_FromLong(naxes) : NULL;
+}
+
+/*
+===============================================================================
+Axis data of several kinds [cnc_rdaxisdata, cnc_rdaxisdata64]
+===============================================================================
+*/
+
+typedef short (*rdaxisdata64_fn)(unsigned short, short, short*, short, short*, ODBAXDT64*);
+
+// 라이브러리 버전에 따라 없을 수 있음 (Linux 1.0.5는 미지원), 모듈 초기화 때 찾음
+static rdaxisdata64_fn rdaxisdata64 = NULL;
+
+/*
+Look cnc_rdaxisdata64 up in the FOCAS library itself. Python loads extension
+modules RTLD_LOCAL, so libfwlib32 is not in the global scope and
+dlsym(RTLD_DEFAULT) never finds it; the library is found through a symbol this
+module is linked against instead.
+*/
+static rdaxisdata64_fn find_rdaxisdata64(void) {
+#ifdef _WIN32
+    HMODULE lib = GetModuleHandleA("Fwlib32.dll");
+    return lib ? (rdaxisdata64_fn) GetProcAddress(lib, "cnc_rdaxisdata64") : NULL;
+#else
+    Dl_info info;
+    void* lib;
+    rdaxisdata64_fn fn = NULL;
+
+    if (!dladdr((void*) cnc_rdaxisdata, &info) || info.dli_fname == NULL) {
+        return NULL;
+    }
+    if ((lib = dlopen(info.dli_fname, RTLD_NOW | RTLD_NOLOAD)) == NULL) {
+        return NULL;
+    }
+    fn = (rdaxisdata64_fn) dlsym(lib, "cnc_rdaxisdata64");
+    dlclose(lib);  // only drops the reference NOLOAD took, the library stays loaded
+    return fn;
+#endif
+}
+
+// Kind names of rdaxisdata() and their (class, type) of cnc_rdaxisdata
+static const struct {
+    const char* name;
+    short cls;
+    short type;
+} axisdata_kinds[] = {
+    {"absolute", 1, 0},
+    {"machine", 1, 1},
+    {"relative", 1, 2},
+    {"distance", 1, 3},
+    {"handle_input", 1, 4},
+    {"handle_output", 1, 5},
+    {"servo_load", 2, 0},
+    {"servo_current", 2, 1},
+    {"spindle_load", 3, 0},
+    {"spindle_speed", 3, 1},
+};
+
+#define AXISDATA_KINDS ((int) (sizeof(axisdata_kinds) / sizeof(axisdata_kinds[0])))
+// 종류가 모두 요청되면 위치 2번, 서보 1번, 스핀들 1번
+#define AXISDATA_BATCHES 4
+
+// One cnc_rdaxisdata call: a class and up to AXISDATA_TYPES of its types
+typedef struct {
+    short cls;
+    short num;
+    short types[AXISDATA_TYPES];
+    int kinds[AXISDATA_TYPES];  // index in axisdata_kinds
+    short stride;               // axes asked for, the row length of data
+    short len;                  // axes read
+    int wide;
+    union {
+        ODBAXDT d32[AXISDATA_TYPES * MAX_AXIS];
+        ODBAXDT64 d64[AXISDATA_TYPES * MAX_AXIS];
+    } data;
+} AxisBatch;
+
+/*
+One batch, cnc_rdaxisdata64 first while the connection has not refused it.
+Used as the call of FOCAS_RETRY, so every attempt starts from the full length.
+*/
+static short axisdata_call(Context* self, AxisBatch* b) {
+    short ret;
+
+    b->stride = b->cls == 3 ? MAX_SPINDLE : MAX_AXIS;
+    if (self->axisdata_wide != 0 && rdaxisdata64) {
+        b->len = b->stride;
+        ret = rdaxisdata64(self->libh, b->cls, b->types, b->num, &b->len, b->data.d64);
+        if (ret == EW_OK) {
+            self->axisdata_wide = b->wide = 1;
+            return ret;
+        }
+        // 64비트 호출을 거부한 경우만 32비트로 (통신 에러 등은 그대로 반환)
+        if (self->axisdata_wide == 1 || (ret != EW_FUNC && ret != EW_NOOPT && ret != EW_VERSION)) {
+            return ret;
+        }
+    }
+    self->axisdata_wide = b->wide = 0;
+    b->len = b->stride;
+    return cnc_rdaxisdata(self->libh, b->cls, b->types, b->num, &b->len, b->data.d32);
+}
+
+// Index in axisdata_kinds of a kind name, -1 with an exception set
+static int axisdata_kind(PyObject* obj) {
+    const char* name;
+    int k;
+
+    if (!PyUnicode_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, "axis data kind must be str, not %s", Py_TYPE(obj)->tp_name);
+        return -1;
+    }
+    if (!(name = PyUnicode_AsUTF8(obj))) {
+        return -1;
+    }
+    for (k = 0; k < AXISDATA_KINDS; k++) {
+        if (strcmp(name, axisdata_kinds[k].name) == 0) {
+            return k;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Unknown axis data kind: %s", name);
+    return -1;
+}
+
+// Group the requested kinds by class, returns the number of batches or -1
+static int axisdata_batches(PyObject* kinds, AxisBatch* batches) {
+    PyObject* seq;
+    int wanted[AXISDATA_KINDS] = {0};
+    int order[AXISDATA_KINDS];
+    int nkinds = 0;
+    int n = 0;
+    int i, k, cls;
+
+    if (!(seq = PySequence_Fast(kinds, "kinds must be a sequence of kind names"))) {
+        return -1;
+    }
+    for (i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+        if ((k = axisdata_kind(PySequence_Fast_GET_ITEM(seq, i))) < 0) {
+            Py_DECREF(seq);
+            return -1;
+        }
+        if (!wanted[k]) {
+            wanted[k] = 1;
+            order[nkinds++] = k;
+        }
+    }
+    Py_DECREF(seq);
+
+    // 같은 클래스는 한 번에, 4종류가 넘으면 나눠서 읽음
+    for (cls = 1; cls <= 3; cls++) {
+        for (i = 0; i < nkinds; i++) {
+            k = order[i];
+            if (axisdata_kinds[k].cls != cls) {
+                continue;
+            }
+            if (n == 0 || batches[n - 1].cls != cls || batches[n - 1].num == AXISDATA_TYPES) {
+                batches[n].cls = cls;
+                batches[n].num = 0;
+                n++;
+            }
+            batches[n - 1].types[batches[n - 1].num] = axisdata_kinds[k].type;
+            batches[n - 1].kinds[batches[n - 1].num++] = k;
+        }
+    }
+    return n;
+}
+
+// Cached names tuple of the class, rebuilt only when the controller reports other names
+static PyObject* axisdata_names(Context* self, AxisBatch* b) {
+    char raw[MAX_AXIS * 4];
+    PyObject* names;
+    PyObject* name;
+    int c = b->cls - 1;
+    int i;
+
+    for (i = 0; i < b->len; i++) {
+        memcpy(raw + 4 * i, b->wide ? b->data.d64[i].name : b->data.d32[i].name, 4);
+    }
+    if (self->axisdata_names[c] && self->axisdata_nraw[c] == b->len && !memcmp(self->axisdata_raw[c], raw, 4 * b->len)) {
+        Py_INCREF(self->axisdata_names[c]);
+        return self->axisdata_names[c];
+    }
+
+    if (!(names = PyTuple_New(b->len))) {
+        return NULL;
+    }
+    for (i = 0; i < b->len; i++) {
+        if (!(name = name_string(raw + 4 * i, (int) strnlen(raw + 4 * i, 4)))) {
+            Py_DECREF(names);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(names, i, name);
+    }
+    Py_XSETREF(self->axisdata_names[c], names);
+    self->axisdata_nraw[c] = b->len;
+    memcpy(self->axisdata_raw[c], raw, 4 * b->len);
+    Py_INCREF(names);
+    return names;
+}
+
+// AxisColumn of type t of the batch
+static PyObject* build_axis_column(AxisBatch* b, int t, PyObject* names) {
+    PyObject* column;
+    PyObject* data;
+    PyObject* dec;
+    PyObject* unit;
+    PyObject* item;
+    double values[MAX_AXIS];
+    int32_t raw[MAX_AXIS];
+    short decs[MAX_AXIS];
+    int i;
+
+    if (!(column = PyStructSequence_New(&AxisColumnType))) {
+        Py_DECREF(names);
+        return NULL;
+    }
+    PyStructSequence_SET_ITEM(column, 0, names);
+    if (result_set(column, 1, data = PyList_New(b->len)) < 0 ||
+        result_set(column, 2, dec = PyList_New(b->len)) < 0 ||
+        result_set(column, 3, unit = PyList_New(b->len)) < 0) {
+        Py_DECREF(column);
+        return NULL;
+    }
+    for (i = 0; i < b->len; i++) {
+        if (b->wide) {
+            values[i] = b->data.d64[t * b->stride + i].data;
+            decs[i] = b->data.d64[t * b->stride + i].dec;
+        } else {
+            raw[i] = (int32_t) b->data.d32[t * b->stride + i].data;  // 32비트 값, long은 확장만 함
+            decs[i] = b->data.d32[t * b->stride + i].dec;
+        }
+    }
+    if (!b->wide) {
+        fixed_to_f64(raw, decs, b->len, values);
+    }
+
+    for (i = 0; i < b->len; i++) {
+        if (!(item = PyFloat_FromDouble(values[i]))) {
+            Py_DECREF(column);
+            return NULL;
+        }
+        PyList_SET_ITEM(data, i, item);
+        if (!(item = PyLong_FromLong(decs[i]))) {
+            Py_DECREF(column);
+            return NULL;
+        }
+        PyList_SET_ITEM(dec, i, item);
+        if (!(item = PyLong_FromLong(b->wide ? b->data.d64[t * b->stride + i].unit : b->data.d32[t * b->stride + i].unit))) {
+            Py_DECREF(column);
+            return NULL;
+        }
+        PyList_SET_ITEM(unit, i, item);
+    }
+    return column;
+}
+
+/*
+Read Axis Data of Several Kinds [cnc_rdaxisdata]
+The kinds are grouped into the fewest calls (one per class, at most 4 types per
+call) made under one hold of the handle, the 64-bit variant being used when the
+library exports it and the controller accepts it.
+Parameters:
+    kinds : Sequence of kind names, position: absolute, machine, relative,
+            distance, handle_input, handle_output, servo: servo_load,
+            servo_current (%), spindle: spindle_load, spindle_speed
+Returns:
+    Dictionary of kind name -> fwlib.AxisColumn (names, data, dec, unit), one
+    item per axis or spindle. data is scaled by dec, names is the same tuple
+    for every read while the controller reports the same names.
+Example:
+    columns = cnc.rdaxisdata(["absolute", "servo_load"])
+    dict(zip(columns["absolute"].names, columns["absolute"].data))
+Reference: https://www.inventcom.net/fanuc-focas-library/position/cnc_rdaxisdata
+*/
+static PyObject* Context_rdaxisdata(Context* self, PyObject* args) {
+    AxisBatch batches[AXISDATA_BATCHES];
+    PyObject* kinds;
+    PyObject* result;
+    PyObject* names;
+    PyObject* column;
+    short ret = EW_OK;
+    int n, i, t;
+
+    if (!PyArg_ParseTuple(args, "O", &kinds)) {
+        return NULL;
+    }
+    if ((n = axisdata_batches(kinds, batches)) < 0) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    for (i = 0; i < n && ret == EW_OK; i++) {
+        FOCAS_RETRY(self, ret, axisdata_call(self, &batches[i]));
+    }
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
+    }
+
+    if (!(result = PyDict_New())) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        if (batches[i].len > batches[i].stride) {
+            batches[i].len = batches[i].stride;
+        }
+        for (t = 0; t < batches[i].num; t++) {
+            if (!(names = axisdata_names(self, &batches[i])) ||
+                !(column = build_axis_column(&batches[i], t, names))) {
+                Py_DECREF(result);
+                return NULL;
+            }
+            if (PyDict_SetItemString(result, axisdata_kinds[batches[i].kinds[t]].name, column) < 0) {
+                Py_DECREF(column);
+                Py_DECREF(result);
+                return NULL;
+            }
+            Py_DECREF(column);
+        }
+    }
+    return result;
+}
+
+// List of the num_gcd G codes read by cnc_rdgcode
+static PyObject* build_rdgcode(ODBGCD* gcode, short num_gcd) {
+    PyObject* return_list = PyList_New(num_gcd);
+    PyObject* item;
+    if (!return_list) {
+        return NULL;
+    }
+
+    for (int i = 0; i < num_gcd; i++) {
+        if (!(item = PyStructSequence_New(&GCodeType))) {
+            Py_DECREF(return_list);
+            return NULL;
+        }
+        PyList_SET_ITEM(return_list, i, item);
+        // code는 NUL로 끝나지 않을 수 있음 (8자)
+        if (result_set(item, 0, PyLong_FromLong(gcode[i].group)) < 0 ||
+            result_set(item, 1, PyLong_FromLong(gcode[i].flag)) < 0 ||
+            result_set(item, 2, PyUnicode_FromStringAndSize(gcode[i].code, strnlen(gcode[i].code, sizeof(gcode[i].code)))) < 0) {
+            Py_DECREF(return_list);
+            return NULL;
+        }
+    }
+
+    return return_list;
+}
+
+// rdgcode 인자 검증, blocking/snapshot/async 읽기가 같은 ValueError를 낸다
+static int check_gcode_args(short type, short block) {
+    if (!(block >= 0 && block <= 2)) {
+        PyErr_SetString(PyExc_ValueError, "Invalid block number, block number should be 0, 1, 2");
+        return -1;
+    }
+    return 0;
+}
+
+// rdmodal 인자 검증, rdgcode와 같이 세 경로가 공유한다
+static int check_modal_args(short type, short block) {
+    // Series 0i-D/F에서 지원하는 type 값 검증
+    if (!((type >= 0 && type <= 20) ||      // Modal G code one by one
+          (type >= 100 && type <= 126) ||   // Other than G code one by one
+          (type >= 200 && type <= 207) ||   // Axis data one by one
+          type == -4 ||                     // All 1 shot G code
+          type == -3 ||                     // All axis data
+          type == -2 ||                     // All other than G code
+          type == -1 ||                     // All G code
+          type == 300)) {                   // 1 shot G code one by one
+        PyErr_SetString(PyExc_ValueError, "Invalid type value for Series 0i-D/F");
+        return -1;
+    }
+
+    // block 값 검증
+    if (!((block == 0) ||                 // active block
+          (block == 1) ||                 // next block
+          (block == 2)                    // block after next block
+    )) {
+        PyErr_SetString(PyExc_ValueError, "Invalid block value for Series 0i-D/F");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+Read G code [cnc_rdgcode]
+Returns the G code data of the CNC machine
+Reference: https://www.inventcom.net/fanuc-focas-library/Misc/cnc_rdgcode
+*/
+static PyObject* Context_rdgcode(Context* self, PyObject* args, PyObject* kwds) {
+    short type;
+    short block;
+    static char* kwlist[] = {"type", "block", NULL};
+    
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "hh", kwlist, &type, &block)) {
+        PyErr_SetString(PyExc_TypeError, "Invalid arguments");
+        return NULL;
+    }
+
+    if (check_gcode_args(type, block) < 0) {
+        return NULL;
+    }
+
+    ODBGCD* gcode;
+    short num_gcd;
+
+    if (type == -1 || type == -2) {
+        // Allocate maximum size
+        num_gcd = 50;
+        gcode = (ODBGCD*) malloc(sizeof(ODBGCD) * num_gcd);
+    } else {
+        // Allocate single size
+        num_gcd = 1;
+        gcode = (ODBGCD*) malloc(sizeof(ODBGCD));
+    }
+
+    if (!gcode) {
+        PyErr_SetString(PyExc_MemoryError, "Cannot allocate memory for gcode");
+        return NULL;
+    }
+
+
+    short max_gcd = num_gcd;
+    int ret;
+    // num_gcd is in/out, reset it if the call is replayed after a reconnect
+    FOCAS_CALL(self, ret, (num_gcd = max_gcd, cnc_rdgcode(self->libh, type, block, &num_gcd, gcode)));
+    if (ret != EW_OK) {
+        free(gcode);
+        focas_error(ret);
+        return NULL;
+    }
+
+    PyObject* result = build_rdgcode(gcode, num_gcd);
+    free(gcode);
+    return result;
+}
+
+
+// cnc_modal result, the union member depends on the requested type
+static PyObject* build_modal(ODBMDL* modal, short type) {
+    enum { G_DATA = 2, G_RDATA, G_1SHOT, AUX, RAUX1, RAUX2 };
+    PyObject* result;
+    PyObject* data = NULL;
+    PyObject* temp;
+    int slot = -1;
+    int i;
+
+    if (!(result = PyStructSequence_New(&ModalType))) {
+        return NULL;
+    }
+    if (result_set(result, 0, PyLong_FromLong(modal->datano)) < 0 ||
+        result_set(result, 1, PyLong_FromLong(modal->type)) < 0) {
+        goto error;
+    }
+
+    // Process modal data based on type
+    if (type >= 0 && type <= 20) {  // Modal G code one by one
+        slot = G_DATA;
+        data = parse_gdata(type, (unsigned char)modal->modal.g_data, 0);
+    }
+    else if (type == -1) {  // All Modal G code data (0-20)
+        slot = G_RDATA;
+        data = PyList_New(21);  // 0 to 20 = 21 items
+        for (i = 0; data && i < 21; i++) {
+            if (!(temp = parse_gdata(i, (unsigned char)modal->modal.g_rdata[i], 0))) {
+                Py_CLEAR(data);
+                break;
+            }
+            PyList_SET_ITEM(data, i, temp);  // PyList_SET_ITEM steals reference
+        }
+    }
+    else if (type == 300) {  // 1 shot G code, single data
+        slot = G_DATA;
+        data = parse_gdata(type, (unsigned char)modal->modal.g_data, 1);
+    }
+    else if (type == -4) {  // 1 shot G code, all data
+        slot = G_1SHOT;
+        data = PyList_New(1);
+        if (data) {
+            if (!(temp = parse_gdata(300, (unsigned char)modal->modal.g_1shot[0], 1))) {
+                Py_CLEAR(data);
+            } else {
+                PyList_SET_ITEM(data, 0, temp);
+            }
+        }
+    }
+    else if (type >= 100 && type <= 126) {  // Other than G code, single data
+        slot = AUX;
+        data = parse_aux(type, &modal->modal.aux, 0);
+    }
+    else if (type == -2) {  // Other than G code, all data
+        slot = RAUX1;
+        data = PyList_New(27);
+        for (i = 0; data && i < 27; i++) {
+            if (!(temp = parse_aux(100+i, &modal->modal.raux1[i], 0))) {
+                Py_CLEAR(data);
+                break;
+            }
+            PyList_SET_ITEM(data, i, temp);
+        }
+    }
+    else if (type >= 200 && type <= 207) {  // Single axis data
+        slot = AUX;
+        data = parse_aux(type, &modal->modal.aux, 1);
+    }
+    else if (type == -3) {  // All axis data
+        slot = RAUX2;
+        data = PyList_New(MAX_AXIS);
+        for (i = 0; data && i < MAX_AXIS; i++) {
+            if (!(temp = parse_aux(i+200, &modal->modal.raux2[i], 1))) {
+                Py_CLEAR(data);
+                break;
+            }
+            PyList_SET_ITEM(data, i, temp);
+        }
+    }
+    if (slot >= 0 && !data) {
+        goto error;
+    }
+
+    // 읽지 않은 union 멤버는 None
+    for (i = G_DATA; i <= RAUX2; i++) {
+        if (i == slot) {
+            PyStructSequence_SET_ITEM(result, i, data);
+        } else {
+            Py_INCREF(Py_None);
+            PyStructSequence_SET_ITEM(result, i, Py_None);
+        }
+    }
+
+    return result;
+
+error:
+    Py_DECREF(result);
+    return NULL;
+}
+
+/*
+Read modal information [cnc_modal]
+Returns the modal data of the CNC machine
+The moddal data are G code or commanded data such as M,S,T,F
+P.S this function cannot be used for Series 15i, so use cnc_rdgcode and cnc_rdcommand instead.
+Reference: https://www.inventcom.net/fanuc-focas-library/misc/cnc_modal
+*/
+static PyObject* Context_modal(Context* self, PyObject* args, PyObject* kwds) {
+    short type;
+    short block;
+    static char* kwlist[] = {"type", "block", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "hh", kwlist, &type, &block)) {
+        PyErr_SetString(PyExc_TypeError, "Failed to read CNC modal: Invalid arguments");
+        return NULL;
+    }
+
+    if (check_modal_args(type, block) < 0) {
+        return NULL;
+    }
+
+    ODBMDL modal;
+    int ret;
+
+    FOCAS_CALL(self, ret, cnc_modal(self->libh, type, block, &modal));
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
+    }
+
+    return build_modal(&modal, type);
+}
+
+// Parse Gcode data (8 bit)
+static PyObject* parse_gdata(int type, unsigned char g_data, int is_one_shot) {
+    PyObject* result = PyStructSequence_New(&GDataType);
+    if (!result) return NULL;
+
+    // G code number (bit 0-6)
+    unsigned char g_code = g_data & 0x7F;  // 0x7F = 0111 1111
+    const char* code = is_one_shot ? map_one_shot_gcode(300, g_code) : map_modal_gcode(type, g_code);
+
+    // Command flag (bit 7)
+    int is_commanded = (g_data & 0x80) >> 7;  // 0x80 = 1000 0000
+
+    if (result_set(result, 0, PyUnicode_FromString(code)) < 0 ||
+        result_set(result, 1, PyBool_FromLong(is_commanded)) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+// Parse auxiliary data
+static PyObject* parse_aux(int type, void* aux_data_ptr, int is_axis) {
+    struct aux_data* data = (struct aux_data*)aux_data_ptr;
+    PyObject* result = PyStructSequence_New(&AuxType);
+    if (!result) return NULL;
+
+    if (result_set(result, 0, is_axis ? PyLong_FromLong(type-200+1) : PyUnicode_FromString(map_other_code(type))) < 0 ||
+        result_set(result, 1, PyLong_FromLong(data->aux_data)) < 0 ||
+        result_set(result, 2, parse_flag1((unsigned char)data->flag1)) < 0 ||
+        result_set(result, 3, parse_flag2((unsigned char)data->flag2)) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+static PyObject* parse_flag1(unsigned char flag1) {
+    PyObject* result = PyStructSequence_New(&Flag1Type);
+    if (!result) return NULL;
+
+    if (result_set(result, 0, PyLong_FromLong(flag1 & 0x0F)) < 0 ||         // 입력 값 (bit 3-0)
+        result_set(result, 1, PyBool_FromLong((flag1 >> 5) & 0x01)) < 0 ||   // 부호 (bit 5)
+        result_set(result, 2, PyBool_FromLong((flag1 >> 6) & 0x01)) < 0 ||   // 소수점 명령 존재 여부 (bit 6)
+        result_set(result, 3, PyBool_FromLong((flag1 >> 7) & 0x01)) < 0 ||   // 현재 블록 명령 존재 여부 (bit 7)
+        result_set(result, 4, PyLong_FromUnsignedLong(flag1)) < 0) {         // 원본 flag1 값
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+static PyObject* parse_flag2(unsigned char flag2) {
+    PyObject* result = PyStructSequence_New(&Flag2Type);
+    if (!result) return NULL;
+
+    if (result_set(result, 0, PyLong_FromLong(flag2 & 0x07)) < 0 ||  // 소수점 자릿수 (bit 2-0)
+        result_set(result, 1, PyLong_FromUnsignedLong(flag2)) < 0) {  // 원본 flag2 값
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+/*
+Snapshot: a whole list of reads in one call
+The spec is parsed and the reads are made with the GIL released and the
+Context lock held, so threads polling other machines keep running during the
+network waits. The Python objects are built at the end, once the GIL is back.
+*/
+enum {
+    SNAP_ACTS,
+    SNAP_ACTF,
+    SNAP_ACTS2,
+    SNAP_RDSPEED,
+    SNAP_STATINFO,
+    SNAP_RDBLKCOUNT,
+    SNAP_RDDYNAMIC2,
+    SNAP_RDGCODE,
+    SNAP_RDMODAL,
+};
+
+// Read names as in the Context methods, number of arguments and their defaults
+static const struct {
+    const char* name;
+    int nargs;
+    short a;
+    short b;
+} snapshot_reads[] = {
+    [SNAP_ACTS] = {"acts", 0, 0, 0},
+    [SNAP_ACTF] = {"actf", 0, 0, 0},
+    [SNAP_ACTS2] = {"acts2", 1, -1, 0},
+    [SNAP_RDSPEED] = {"rdspeed", 1, -1, 0},
+    [SNAP_STATINFO] = {"statinfo", 0, 0, 0},
+    [SNAP_RDBLKCOUNT] = {"rdblkcount", 0, 0, 0},
+    [SNAP_RDDYNAMIC2] = {"rddynamic2", 1, ALL_AXES, 0},
+    [SNAP_RDGCODE] = {"rdgcode", 2, -1, 1},
+    [SNAP_RDMODAL] = {"rdmodal", 2, -1, 1},
+};
+
+#define SNAPSHOT_GCODES 50
+
+typedef struct {
+    int op;
+    short a;
+    short b;
+    short ret;
+    short num;  // G codes read, or axes converted for rddynamic2
+    union {
+        ODBACT act;
+        ODBACT2 act2;
+        ODBSPEED speed;
+        ODBST st;
+        long count;
+        ODBDY2 dy;
+        ODBMDL modal;
+        ODBGCD gcode[SNAPSHOT_GCODES];
+    } u;
+} SnapshotRead;
+
+// "name" or ("name", arg, ...) into a read, arguments not given keep the defaults
+// The range checks of the blocking rdgcode/rdmodal, a bad argument fails before anything is read
+static int snapshot_check(const SnapshotRead* read) {
+    switch (read->op) {
+    case SNAP_RDGCODE:
+        return check_gcode_args(read->a, read->b);
+    case SNAP_RDMODAL:
+        return check_modal_args(read->a, read->b);
+    default:
+        return 0;
+    }
+}
+
+static int snapshot_parse(PyObject* item, SnapshotRead* read) {
+    PyObject* name = item;
+    Py_ssize_t nargs = 0;
+    size_t op;
+
+    if (PyTuple_Check(item)) {
+        nargs = PyTuple_GET_SIZE(item) - 1;
+        if (nargs < 0) {
+            PyErr_SetString(PyExc_ValueError, "Empty read in snapshot spec");
+            return -1;
+        }
+        name = PyTuple_GET_ITEM(item, 0);
+    }
+    if (!PyUnicode_Check(name)) {
+        PyErr_SetString(PyExc_TypeError, "Snapshot reads are a name or a (name, args...) tuple");
+        return -1;
+    }
+
+    for (op = 0; op < sizeof(snapshot_reads) / sizeof(snapshot_reads[0]); op++) {
+        if (PyUnicode_CompareWithASCIIString(name, snapshot_reads[op].name) == 0) {
+            break;
+        }
+    }
+    if (op == sizeof(snapshot_reads) / sizeof(snapshot_reads[0])) {
+        PyErr_Format(PyExc_ValueError, "Unknown snapshot read: %U", name);
+        return -1;
+    }
+    if (nargs > snapshot_reads[op].nargs) {
+        PyErr_Format(PyExc_TypeError, "%s takes %d argument(s)", snapshot_reads[op].name,
+                     snapshot_reads[op].nargs);
+        return -1;
+    }
+
+    read->op = (int) op;
+    read->a = snapshot_reads[op].a;
+    read->b = snapshot_reads[op].b;
+    if (nargs >= 1 && (read->a = (short) PyLong_AsLong(PyTuple_GET_ITEM(item, 1))) == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (nargs >= 2 && (read->b = (short) PyLong_AsLong(PyTuple_GET_ITEM(item, 2))) == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    return snapshot_check(read);
+}
+
+// Runs without the GIL, self->lock held
+static void snapshot_read(Context* self, SnapshotRead* r) {
+    short max_gcd = SNAPSHOT_GCODES;
+
+    switch (r->op) {
+    case SNAP_ACTS:
+        FOCAS_RETRY(self, r->ret, cnc_acts(self->libh, &r->u.act));
+        break;
+    case SNAP_ACTF:
+        FOCAS_RETRY(self, r->ret, cnc_actf(self->libh, &r->u.act));
+        break;
+    case SNAP_ACTS2:
+        FOCAS_RETRY(self, r->ret, cnc_acts2(self->libh, r->a, &r->u.act2));
+        break;
+    case SNAP_RDSPEED:
+        FOCAS_RETRY(self, r->ret, cnc_rdspeed(self->libh, r->a, &r->u.speed));
+        break;
+    case SNAP_STATINFO:
+        FOCAS_RETRY(self, r->ret, cnc_statinfo(self->libh, &r->u.st));
+        break;
+    case SNAP_RDBLKCOUNT:
+        FOCAS_RETRY(self, r->ret, cnc_rdblkcount(self->libh, &r->u.count));
+        break;
+    case SNAP_RDDYNAMIC2:
+        // 축 개수는 캐시된 메타데이터에서, 필요할 때 한 번만 읽음
+        r->num = 1;
+        if (r->a == ALL_AXES) {
+            if ((r->ret = Context_read_metadata(self)) != EW_OK) {
+                break;
+            }
+            r->num = self->naxes > 0 && self->naxes <= MAX_AXIS ? self->naxes : MAX_AXIS;
+        }
+        FOCAS_RETRY(self, r->ret, cnc_rddynamic2(self->libh, r->a, sizeof(r->u.dy), &r->u.dy));
+        break;
+    case SNAP_RDGCODE:
+        if (r->a != -1 && r->a != -2) {
+            max_gcd = 1;
+        }
+        FOCAS_RETRY(self, r->ret, (r->num = max_gcd, cnc_rdgcode(self->libh, r->a, r->b, &r->num, r->u.gcode)));
+        break;
+    case SNAP_RDMODAL:
+        FOCAS_RETRY(self, r->ret, cnc_modal(self->libh, r->a, r->b, &r->u.modal));
+        break;
+    }
+}
+
+static PyObject* snapshot_build(SnapshotRead* r) {
+    if (r->ret != EW_OK) {
+        // 실패한 항목은 예외 객체로 돌려줌, 나머지 결과는 그대로 사용 가능
+        return PyObject_CallFunction(FOCAS_TRANSPORT(r->ret) ? PyExc_ConnectionError : PyExc_RuntimeError,
+                                     "N", PyUnicode_FromFormat("FWLIB32[%d]", r->ret));
+    }
+    switch (r->op) {
+    case SNAP_ACTS:
+    case SNAP_ACTF:
+        return PyLong_FromLong(r->u.act.data);
+    case SNAP_ACTS2:
+        return build_acts2(&r->u.act2);
+    case SNAP_RDSPEED:
+        return build_rdspeed(&r->u.speed);
+    case SNAP_STATINFO:
+        return build_statinfo(&r->u.st);
+    case SNAP_RDBLKCOUNT:
+        return PyLong_FromLong(r->u.count);
+    case SNAP_RDDYNAMIC2:
+        return build_rddynamic2(&r->u.dy, r->a, r->num);
+    case SNAP_RDGCODE:
+        return build_rdgcode(r->u.gcode, r->num);
+    case SNAP_RDMODAL:
+        return build_modal(&r->u.modal, r->a);
+    }
+    Py_RETURN_NONE;
+}
+
+// Parse a whole spec, the array is freed with PyMem_Free
+static SnapshotRead* snapshot_parse_spec(PyObject* spec, Py_ssize_t* n) {
+    PyObject* seq;
+    SnapshotRead* reads;
+    Py_ssize_t i;
+
+    if (!(seq = PySequence_Fast(spec, "snapshot spec must be a sequence"))) {
+        return NULL;
+    }
+    *n = PySequence_Fast_GET_SIZE(seq);
+    if (!(reads = PyMem_Calloc(*n > 0 ? *n : 1, sizeof(SnapshotRead)))) {
+        Py_DECREF(seq);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    for (i = 0; i < *n; i++) {
+        if (snapshot_parse(PySequence_Fast_GET_ITEM(seq, i), &reads[i]) < 0) {
+            PyMem_Free(reads);
+            Py_DECREF(seq);
+            return NULL;
+        }
+    }
+    Py_DECREF(seq);
+    return reads;
+}
+
+static PyObject* snapshot_results(SnapshotRead* reads, Py_ssize_t n) {
+    PyObject* results;
+    PyObject* value;
+    Py_ssize_t i;
+
+    if (!(results = PyList_New(n))) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        if (!(value = snapshot_build(&reads[i]))) {
+            Py_DECREF(results);
+            return NULL;
+        }
+        PyList_SET_ITEM(results, i, value);
+    }
+    return results;
+}
+
+/*
+Run a list of reads in one call [snapshot]
+Parameters:
+    spec: List of reads, each a method name ("statinfo", "rddynamic2", ...) or a
+          tuple of the name and its arguments (("rdgcode", -1, 1), ("acts2", -1))
+          Supported: acts, actf, acts2, rdspeed, statinfo, rdblkcount,
+                     rddynamic2, rdgcode, rdmodal
+Returns:
+    List with the result of every read in spec order, as the method would have
+    returned it. A read that failed holds its exception (RuntimeError or
+    ConnectionError) instead of raising, the other results stay usable.
+*/
+static PyObject* Context_snapshot(Context* self, PyObject* args) {
+    PyObject* spec;
+    PyObject* results = NULL;
+    SnapshotRead* reads;
+    Py_ssize_t n, i;
+
+    if (!PyArg_ParseTuple(args, "O", &spec)) {
+        return NULL;
+    }
+    if (!(reads = snapshot_parse_spec(spec, &n))) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    for (i = 0; i < n; i++) {
+        snapshot_read(self, &reads[i]);
+    }
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+
+    results = snapshot_results(reads, n);
+    PyMem_Free(reads);
+    return results;
+}
+
+/*
+Select the path [cnc_setpath]
+The path is remembered and selected again after every reconnect.
+Reference: https://www.inventcom.net/fanuc-focas-library/misc/cnc_setpath
+*/
+static PyObject* Context_setpath(Context* self, PyObject* args) {
+    short path;
+    int ret;
+
+    if (!PyArg_ParseTuple(args, "h", &path)) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    FOCAS_RETRY(self, ret, cnc_setpath(self->libh, path));
+    if (ret == EW_OK) {
+        self->path = path;
+        self->path_set = 1;
+    }
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (ret != EW_OK) {
+        focas_error(ret);
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+/*
+Reconnect counters
+Returns:
+    Dictionary containing:
+    - connected          : Whether a handle is currently open
+    - reconnects         : Handles reopened after a transport error
+    - reconnect_failures : Failed connect attempts
+    - transport_errors   : Calls that failed with EW_SOCKET / EW_HANDLE
+    - backoff_ms         : Current reconnect backoff (0 while healthy)
+*/
+static PyObject* Context_reconnect_stats(Context* self, PyObject* Py_UNUSED(ignored)) {
+    return Py_BuildValue("{s:O,s:k,s:k,s:k,s:K}",
+                         "connected", self->connected ? Py_True : Py_False,
+                         "reconnects", self->reconnects,
+                         "reconnect_failures", self->reconnect_failures,
+                         "transport_errors", self->transport_errors,
+                         "backoff_ms", (unsigned long long) self->backoff_ms);
+}
+
+// Python Method Definition
+static PyMethodDef Context_methods[] = {
+    {"read_id", (PyCFunction) Context_read_id, METH_NOARGS, "Reads the CNC ID (cached per connection)."},
+    {"metadata", (PyCFunction) Context_metadata, METH_NOARGS, "Returns the cached ID, system info, axis and spindle names."},
+    {"acts", (PyCFunction) Context_acts, METH_NOARGS, "Reads the actual spindle speed."},
+    {"acts2", (PyCFunction) Context_acts2, METH_VARARGS, "Reads actual speeds for multiple spindles."},
+    {"actf", (PyCFunction) Context_actf, METH_NOARGS, "Reads the actual feed rate."},
+    {"rdspeed", (PyCFunction) Context_rdspeed, METH_VARARGS, "Reads the feed rate and spindle speed."},
+    {"statinfo", (PyCFunction) Context_statinfo, METH_NOARGS, "Reads the CNC status information."},
+    {"rdblkcount", (PyCFunction) Context_rdblkcount, METH_NOARGS, "Reads the executed block counter."},
+    {"rddynamic2", (PyCFunction) Context_rddynamic2, METH_VARARGS, "Reads alarm, program, speeds and positions in one call."},
+    {"rdpositions", (PyCFunction) Context_rdpositions, METH_VARARGS | METH_KEYWORDS, "Reads the positions of all axes into a buffer."},
+    {"rdaxisdata", (PyCFunction) Context_rdaxisdata, METH_VARARGS, "Reads several kinds of axis data in the fewest calls."},
+    {"rdgcode", (PyCFunction) Context_rdgcode, METH_VARARGS | METH_KEYWORDS, "Reads the G code."},
+    {"rdmodal", (PyCFunction) Context_modal, METH_VARARGS | METH_KEYWORDS, "Reads the modal information."},
+    {"snapshot", (PyCFunction) Context_snapshot, METH_VARARGS, "Runs a list of reads in one call without holding the GIL."},
+    {"setpath", (PyCFunction) Context_setpath, METH_VARARGS, "Selects the path, kept across reconnects."},
+    {"reconnect_stats", (PyCFunction) Context_reconnect_stats, METH_NOARGS, "Returns the reconnect counters."},
+    {"__enter__", (PyCFunction) Context_enter, METH_NOARGS, "Enter the context."},
+    {"__exit__", (PyCFunction) Context_exit, METH_VARARGS, "Exit the context."},
+    {NULL}  /* Sentinel */
+};
+
+static PyTypeObject ContextType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "fwlib.Context",
+    .tp_doc = "FANUC Context Manager",
+    .tp_basicsize = sizeof(Context),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = Context_new,
+    .tp_init = (initproc) Context_init,
+    .tp_dealloc = (destructor) Context_dealloc,
+    .tp_methods = Context_methods,
+};
 
-    int ret;
-    ret = cnc_rdgcode(self->libh, type, block, &num_gcd, gcode);
-    if (ret != EW_OK) {
-        free(gcode);
-        PyErr_Format(PyExc_RuntimeError, "FWLIB32[%d]", ret);
-        return NULL;
-    }
+#ifndef _WIN32
+/*
+===============================================================================
+AsyncContext: awaitable reads for asyncio
+===============================================================================
+Every read is queued to a pool of C threads that make the FOCAS call without the
+GIL. Finished jobs are put on a done list and signalled through a wakeup fd
+(eventfd, or a pipe outside Linux) that the event loop watches with add_reader,
+the callback completes the futures on the loop thread. One loop can keep as
+many machines busy as there are workers, with no executor and no Python thread
+per call.
+
+    async with AsyncContext(host="192.168.0.11") as cnc:
+        speed = await cnc.rdspeed(-1)
+*/
+typedef struct {
+    Context base;
+    int busy;  // a worker is running one of its jobs, guarded by pool.mutex
+} AsyncContext;
+
+enum {
+    ASYNC_READS,    // SnapshotRead list, result is a list or the single value
+    ASYNC_CONNECT,  // open the handle and load the metadata, result is the context
+    ASYNC_CLOSE,    // release the handle, result is None
+};
 
-    PyObject* return_list = PyList_New(num_gcd);
-    if (!return_list) {
-        free(gcode);
-        return NULL;
+typedef struct AsyncJob {
+    struct AsyncJob* next;
+    AsyncContext* ctx;
+    PyObject* future;
+    int kind;
+    int single;
+    short ret;
+    Py_ssize_t n;
+    SnapshotRead* reads;
+} AsyncJob;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    AsyncJob* queue;
+    AsyncJob** queue_tail;
+    AsyncJob* done;
+    AsyncJob** done_tail;
+    int workers;
+    int wake_r;            // read end watched by the loop
+    int wake_w;            // same fd as wake_r for an eventfd
+    long pending;          // submitted and not completed yet, GIL held
+    PyObject* loop;        // loop the read end is registered on
+    PyObject* drain;       // callback given to add_reader
+    PyObject* get_running_loop;
+} pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, &pool.queue, NULL, &pool.done, 0, -1, -1};
+
+// Runs without the GIL
+static void async_run(AsyncJob* job) {
+    Context* self = (Context*) job->ctx;
+    Py_ssize_t i;
+
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    switch (job->kind) {
+    case ASYNC_READS:
+        for (i = 0; i < job->n; i++) {
+            snapshot_read(self, &job->reads[i]);
+        }
+        break;
+    case ASYNC_CONNECT:
+        // read_id()/metadata() are served from the cache afterwards
+        if ((job->ret = Context_connect(self)) == EW_OK) {
+            job->ret = Context_read_metadata(self);
+        }
+        break;
+    case ASYNC_CLOSE:
+        Context_close(self);
+        break;
     }
+    PyThread_release_lock(self->lock);
+}
 
-    for (int i = 0; i < num_gcd; i++) {
-        PyObject* dict = PyDict_New();
-        if (!dict) {
-            Py_DECREF(return_list);
-            free(gcode);
-            return NULL;
-        }
+static void* async_worker(void* arg) {
+    AsyncJob** link;
+    AsyncJob* job;
+    uint64_t one = 1;
 
-        // Add gcode data
-        PyObject* py_group = PyLong_FromLong(gcode[i].group);
-        if (!py_group) {
-            Py_DECREF(dict);
-            Py_DECREF(return_list);
-            free(gcode);
-            return NULL;
+    pthread_mutex_lock(&pool.mutex);
+    for (;;) {
+        // 다른 작업이 실행 중인 장비는 건너뜀, 장비별 요청 순서는 유지
+        for (link = &pool.queue; *link && (*link)->ctx->busy; link = &(*link)->next) {
         }
-        if (PyDict_SetItemString(dict, "group", py_group) < 0) {
-            Py_DECREF(py_group);
-            Py_DECREF(dict);
-            Py_DECREF(return_list);
-            free(gcode);
-            return NULL;
+        if (!*link) {
+            pthread_cond_wait(&pool.cond, &pool.mutex);
+            continue;
         }
-        Py_DECREF(py_group);
-
-        // Add flag
-        PyObject* py_flag = PyLong_FromLong(gcode[i].flag);
-        if (!py_flag) {
-            Py_DECREF(dict);
-            Py_DECREF(return_list);
-            free(gcode);
-            return NULL;
+        job = *link;
+        if (!(*link = job->next)) {
+            pool.queue_tail = link;
         }
-        if (PyDict_SetItemString(dict, "flag", py_flag) < 0) {
-            Py_DECREF(py_flag);
-            Py_DECREF(dict);
-            Py_DECREF(return_list);
-            free(gcode);
-            return NULL;
+        job->ctx->busy = 1;
+        pthread_mutex_unlock(&pool.mutex);
+
+        async_run(job);
+
+        pthread_mutex_lock(&pool.mutex);
+        job->ctx->busy = 0;
+        job->next = NULL;
+        *pool.done_tail = job;
+        pool.done_tail = &job->next;
+        // the next job of this machine may be waiting behind it
+        pthread_cond_broadcast(&pool.cond);
+        pthread_mutex_unlock(&pool.mutex);
+        // 가득 찬 pipe는 이미 깨울 예정이므로 실패해도 무시
+        if (pool.wake_w == pool.wake_r) {
+            (void) !write(pool.wake_w, &one, sizeof(one));
+        } else {
+            (void) !write(pool.wake_w, "", 1);
         }
-        Py_DECREF(py_flag);
+        pthread_mutex_lock(&pool.mutex);
+    }
+    return arg;
+}
 
-        // Add code
-        PyObject* py_code = PyUnicode_FromString(gcode[i].code);
-        if (!py_code) {
-            Py_DECREF(dict);
-            Py_DECREF(return_list);
-            free(gcode);
-            return NULL;
+// Start workers until there are n, GIL held
+static int async_start(int n) {
+    pthread_t thread;
+    int fds[2];
+
+    if (pool.wake_r < 0) {
+#ifdef __linux__
+        if ((fds[0] = fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+#else
+        if (pipe(fds) < 0 || fcntl(fds[0], F_SETFL, O_NONBLOCK) < 0 || fcntl(fds[1], F_SETFL, O_NONBLOCK) < 0) {
+#endif
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
         }
-        if (PyDict_SetItemString(dict, "code", py_code) < 0) {
-            Py_DECREF(py_code);
-            Py_DECREF(dict);
-            Py_DECREF(return_list);
-            free(gcode);
-            return NULL;
+        pool.wake_r = fds[0];
+        pool.wake_w = fds[1];
+    }
+    while (pool.workers < n) {
+        if ((errno = pthread_create(&thread, NULL, async_worker, NULL)) != 0) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
         }
-        Py_DECREF(py_code);
-
-        PyList_SET_ITEM(return_list, i, dict);
+        pthread_detach(thread);
+        pool.workers++;
     }
-
-    free(gcode);
-    return return_list;
+    return 0;
 }
 
+// Exception for a failed job, same types as the blocking methods raise
+static PyObject* async_error(short ret) {
+    return PyObject_CallFunction(FOCAS_TRANSPORT(ret) ? PyExc_ConnectionError : PyExc_RuntimeError,
+                                 "N", PyUnicode_FromFormat("FWLIB32[%d]", ret));
+}
 
-/*
-Read modal information [cnc_modal]
-Returns the modal data of the CNC machine
-The moddal data are G code or commanded data such as M,S,T,F
-P.S this function cannot be used for Series 15i, so use cnc_rdgcode and cnc_rdcommand instead.
-Reference: https://www.inventcom.net/fanuc-focas-library/misc/cnc_modal
-*/
-static PyObject* Context_modal(Context* self, PyObject* args, PyObject* kwds) {
-    short type;
-    short block;
-    static char* kwlist[] = {"type", "block", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "hh", kwlist, &type, &block)) {
-        PyErr_SetString(PyExc_TypeError, "Failed to read CNC modal: Invalid arguments");
-        return NULL;
+static PyObject* async_result(AsyncJob* job) {
+    switch (job->kind) {
+    case ASYNC_READS:
+        return job->single ? snapshot_build(&job->reads[0]) : snapshot_results(job->reads, job->n);
+    case ASYNC_CONNECT:
+        if (job->ret != EW_OK) {
+            return async_error(job->ret);
+        }
+        Py_INCREF(job->ctx);
+        return (PyObject*) job->ctx;
     }
+    Py_RETURN_NONE;
+}
 
-    // Series 0i-D/F에서 지원하는 type 값 검증
-    if (!((type >= 0 && type <= 20) ||      // Modal G code one by one
-          (type >= 100 && type <= 126) ||   // Other than G code one by one
-          (type >= 200 && type <= 207) ||   // Axis data one by one
-          type == -4 ||                     // All 1 shot G code
-          type == -3 ||                     // All axis data
-          type == -2 ||                     // All other than G code
-          type == -1 ||                     // All G code
-          type == 300)) {                   // 1 shot G code one by one
-        PyErr_SetString(PyExc_ValueError, "Invalid type value for Series 0i-D/F");
-        return NULL;
-    }
+// add_reader callback, completes the futures of the finished jobs on the loop thread
+static PyObject* async_drain(PyObject* module, PyObject* Py_UNUSED(ignored)) {
+    char buf[64];
+    AsyncJob* job;
+    AsyncJob* next;
+    PyObject* value;
+    PyObject* ret;
+    PyObject *type, *tb;
 
-    // block 값 검증
-    if (!((block == 0) ||                 // active block
-          (block == 1) ||                 // next block
-          (block == 2)                    // block after next block
-    )) {
-        PyErr_SetString(PyExc_ValueError, "Invalid block value for Series 0i-D/F");
-        return NULL;
+    while (read(pool.wake_r, buf, sizeof(buf)) > 0) {
+    }
+    pthread_mutex_lock(&pool.mutex);
+    job = pool.done;
+    pool.done = NULL;
+    pool.done_tail = &pool.done;
+    pthread_mutex_unlock(&pool.mutex);
+
+    for (; job; job = next) {
+        next = job->next;
+        pool.pending--;
+        // 취소된 future는 결과를 버림, FOCAS 호출 자체는 중간에 끊을 수 없음
+        ret = PyObject_CallMethod(job->future, "cancelled", NULL);
+        if (ret && !PyObject_IsTrue(ret)) {
+            if ((value = async_result(job)) == NULL) {
+                PyErr_Fetch(&type, &value, &tb);
+                PyErr_NormalizeException(&type, &value, &tb);
+                Py_XDECREF(type);
+                Py_XDECREF(tb);
+            }
+            Py_XDECREF(ret);
+            // "(O)", a tuple result would otherwise be spread over the arguments
+            ret = PyObject_CallMethod(job->future, PyExceptionInstance_Check(value) ? "set_exception" : "set_result",
+                                      "(O)", value);
+            Py_DECREF(value);
+        }
+        if (!ret) {
+            PyErr_WriteUnraisable(job->future);
+        }
+        Py_XDECREF(ret);
+        Py_DECREF(job->future);
+        Py_DECREF(job->ctx);
+        PyMem_Free(job->reads);
+        PyMem_Free(job);
     }
+    Py_RETURN_NONE;
+}
 
-    ODBMDL modal;
-    int ret;
+static PyMethodDef async_drain_def = {"_async_drain", (PyCFunction) async_drain, METH_NOARGS, NULL};
 
-    ret = cnc_modal(self->libh, type, block, &modal);
-    if (ret != EW_OK) {
-        PyErr_Format(PyExc_RuntimeError, "FWLIB32[%d]", ret);
-        return NULL;
+/*
+Watch the wakeup fd from the running loop. Only one loop at a time: it moves to
+another loop once the previous one is closed or has nothing in flight.
+*/
+static PyObject* async_loop(void) {
+    PyObject* asyncio;
+    PyObject* loop;
+    PyObject* ret;
+    int closed = 1;
+
+    if (!pool.get_running_loop) {
+        if (!(asyncio = PyImport_ImportModule("asyncio"))) {
+            return NULL;
+        }
+        pool.get_running_loop = PyObject_GetAttrString(asyncio, "get_running_loop");
+        Py_DECREF(asyncio);
+        if (!pool.get_running_loop) {
+            return NULL;
+        }
     }
-
-    PyObject* dict = PyDict_New();
-    if (!dict) {
+    if (!(loop = PyObject_CallNoArgs(pool.get_running_loop))) {
         return NULL;
     }
+    if (loop == pool.loop) {
+        return loop;
+    }
 
-    // Add basic modal information
-    PyObject* temp;
-    temp = PyLong_FromLong(modal.datano);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "datano", temp) < 0) goto error;
-    Py_DECREF(temp);
-
-    temp = PyLong_FromLong(modal.type);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "type", temp) < 0) goto error;
-    Py_DECREF(temp);
-
-    // Process modal data based on type
-    if (type >= 0 && type <= 20) {  // Modal G code one by one
-        temp =  parse_gdata(type, (unsigned char)modal.modal.g_data, 0);
-        if (!temp) goto error;
-        if (PyDict_SetItemString(dict, "g_data", temp) < 0) goto error;
-        Py_DECREF(temp);
+    if (async_start(pool.workers > 0 ? pool.workers : ASYNC_WORKERS_DEFAULT) < 0) {
+        goto error;
     }
-    else if (type == -1) {  // All Modal G code data (0-20)
-        PyObject* g_list = PyList_New(21);  // 0 to 20 = 21 items
-        if (!g_list) goto error;
-        for (int i = 0; i < 21; i++) {
-            temp = parse_gdata(i, (unsigned char)modal.modal.g_rdata[i], 0);
-            if (!temp) {
-                Py_DECREF(g_list);
-                goto error;
-            }
-            PyList_SET_ITEM(g_list, i, temp);  // PyList_SET_ITEM steals reference
-        }
-        if (PyDict_SetItemString(dict, "g_rdata", g_list) < 0) {
-            Py_DECREF(g_list);
+    if (!pool.drain && !(pool.drain = PyCFunction_New(&async_drain_def, NULL))) {
+        goto error;
+    }
+    if (pool.loop) {
+        if (!(ret = PyObject_CallMethod(pool.loop, "is_closed", NULL))) {
             goto error;
         }
-        Py_DECREF(g_list);
-    }
-    else if (type == -4 || type == 300) {  // 1 shot G code
-        if (type == 300) { // Single data
-            temp = parse_gdata(type, (unsigned char)modal.modal.g_data, 1);
-            if (!temp) goto error;
-            if (PyDict_SetItemString(dict, "g_data", temp) < 0) goto error;
-            Py_DECREF(temp);
-        } else { // All data
-            PyObject* g_shot_list = PyList_New(1);
-            if (!g_shot_list) goto error;
-            temp = parse_gdata(300, (unsigned char)modal.modal.g_1shot[0], 1);
-            if (!temp) {
-                Py_DECREF(g_shot_list);
-                goto error;
-            }
-            PyList_SET_ITEM(g_shot_list, 0, temp);
-            // for (int i = 0; i < 4; i++) {
-            //     temp = parse_gdata(i, (unsigned char)modal.modal.g_1shot[i]);
-            //     if (!temp) {
-            //         Py_DECREF(g_shot_list);
-            //         goto error;
-            //     }
-            //     PyList_SET_ITEM(g_shot_list, i, temp);
-            // }
-            if (PyDict_SetItemString(dict, "g_1shot", g_shot_list) < 0) {
-                Py_DECREF(g_shot_list);
-                goto error;
-            }
-            Py_DECREF(g_shot_list);
-        }
-    }
-    else if ((type >= 100 && type <= 126) || type == -2) {  // Other than G code
-        PyObject* aux_data;
-        if (type >= 100) {  // Single data
-            aux_data = parse_aux(type, &modal.modal.aux, 0);
-        } else {  // All data
-            aux_data = PyList_New(27);
-            if (!aux_data) goto error;
-            for (int i = 0; i < 27; i++) {
-                temp = parse_aux(100+i, &modal.modal.raux1[i], 0);
-                if (!temp) {
-                    Py_DECREF(aux_data);
-                    goto error;
-                }
-                PyList_SET_ITEM(aux_data, i, temp);
-            }
-        }
-        if (!aux_data) goto error;
-        if (PyDict_SetItemString(dict, type >= 100 ? "aux" : "raux1", aux_data) < 0) {
-            Py_DECREF(aux_data);
+        closed = PyObject_IsTrue(ret);
+        Py_DECREF(ret);
+        if (!closed && pool.pending > 0) {
+            PyErr_SetString(PyExc_RuntimeError, "AsyncContext reads are in flight on another event loop");
             goto error;
         }
-        Py_DECREF(aux_data);
-    }
-    else if (type == -3 || (type >= 200 && type <= 207)) {  // Axis data
-        PyObject* axis_data;
-        if (type >= 200) {  // Single axis data
-            axis_data = parse_aux(type, &modal.modal.aux, 1);
-        } else {  // All axis data
-            axis_data = PyList_New(MAX_AXIS);
-            if (!axis_data) goto error;
-            for (int i = 0; i < MAX_AXIS; i++) {
-                temp = parse_aux(i+200, &modal.modal.raux2[i], 1);
-                if (!temp) {
-                    Py_DECREF(axis_data);
-                    goto error;
-                }
-                PyList_SET_ITEM(axis_data, i, temp);
-            }
-        }
-        if (!axis_data) goto error;
-        if (PyDict_SetItemString(dict, type >= 200 ? "aux" : "raux2", axis_data) < 0) {
-            Py_DECREF(axis_data);
+        if (!closed && !(ret = PyObject_CallMethod(pool.loop, "remove_reader", "i", pool.wake_r))) {
             goto error;
         }
-        Py_DECREF(axis_data);
+        if (!closed) {
+            Py_DECREF(ret);
+        }
+        Py_CLEAR(pool.loop);
     }
-
-    return dict;
+    if (!(ret = PyObject_CallMethod(loop, "add_reader", "iO", pool.wake_r, pool.drain))) {
+        goto error;
+    }
+    Py_DECREF(ret);
+    Py_INCREF(loop);
+    pool.loop = loop;
+    return loop;
 
 error:
-    Py_XDECREF(dict);
+    Py_DECREF(loop);
     return NULL;
 }
 
-// Parse Gcode data (8 bit)
-static PyObject* parse_gdata(int type, unsigned char g_data, int is_one_shot) {
-    PyObject* dict = PyDict_New();
-    if (!dict) return NULL;
+// Queue a job on the pool and return its future, takes ownership of reads
+static PyObject* async_submit(AsyncContext* self, int kind, SnapshotRead* reads, Py_ssize_t n, int single) {
+    PyObject* loop;
+    AsyncJob* job;
 
-    // G code number (bit 0-6)
-    unsigned char g_code = g_data & 0x7F;  // 0x7F = 0111 1111
-    PyObject* code;
-    if (is_one_shot) {
-        code = PyUnicode_FromString(map_one_shot_gcode(300, g_code));
-    }
-    else {
-        code = PyUnicode_FromString(map_modal_gcode(type, g_code));
-    } 
-    if (PyDict_SetItemString(dict, "code", code) < 0) {
-        Py_DECREF(code);
-        Py_DECREF(dict);
+    if (!(loop = async_loop())) {
+        PyMem_Free(reads);
         return NULL;
     }
-    Py_DECREF(code);
-
-    // Command flag (bit 7)
-    int is_commanded = (g_data & 0x80) >> 7;  // 0x80 = 1000 0000
-    PyObject* commanded = PyBool_FromLong(is_commanded);
-    if (PyDict_SetItemString(dict, "commanded", commanded) < 0) {
-        Py_DECREF(commanded);
-        Py_DECREF(dict);
+    if (!(job = PyMem_Calloc(1, sizeof(AsyncJob)))) {
+        Py_DECREF(loop);
+        PyMem_Free(reads);
+        return PyErr_NoMemory();
+    }
+    job->future = PyObject_CallMethod(loop, "create_future", NULL);
+    Py_DECREF(loop);
+    if (!job->future) {
+        PyMem_Free(job);
+        PyMem_Free(reads);
         return NULL;
     }
-    Py_DECREF(commanded);
-
-    return dict;
+    Py_INCREF(self);
+    job->ctx = self;
+    job->kind = kind;
+    job->single = single;
+    job->reads = reads;
+    job->n = n;
+    pool.pending++;
+
+    pthread_mutex_lock(&pool.mutex);
+    *pool.queue_tail = job;
+    pool.queue_tail = &job->next;
+    pthread_cond_signal(&pool.cond);
+    pthread_mutex_unlock(&pool.mutex);
+
+    Py_INCREF(job->future);
+    return job->future;
 }
 
-// Parse auxiliary data
-static PyObject* parse_aux(int type, void* aux_data_ptr, int is_axis) {
-    struct aux_data* data = (struct aux_data*)aux_data_ptr;
-    PyObject* aux_dict = PyDict_New();
-    if (!aux_dict) return NULL;
-
-    PyObject* temp;
-    
-    if (is_axis){
-        temp = PyLong_FromLong(type-200+1);
-    } else {
-        temp = PyUnicode_FromString(map_other_code(type));
+// One read with the arguments of the blocking method, only rdgcode/rdmodal take keywords
+static PyObject* async_read(AsyncContext* self, int op, PyObject* args, PyObject* kwds) {
+    // 이름 없는 항목("")은 positional 전용, blocking 메서드와 같다
+    static char* kwlist_none[] = {NULL};
+    static char* kwlist_acts2[] = {"", NULL};
+    static char* kwlist_rdspeed[] = {"", NULL};
+    static char* kwlist_rddynamic2[] = {"", NULL};
+    static char* kwlist_rdgcode[] = {"type", "block", NULL};
+    static char* kwlist_rdmodal[] = {"type", "block", NULL};
+    const char* format = "";
+    char** kwlist = kwlist_none;
+    SnapshotRead* read;
+
+    switch (op) {
+    case SNAP_ACTS2:
+        format = "|h";
+        kwlist = kwlist_acts2;
+        break;
+    case SNAP_RDSPEED:
+        format = "|h";
+        kwlist = kwlist_rdspeed;
+        break;
+    case SNAP_RDDYNAMIC2:
+        format = "|h";
+        kwlist = kwlist_rddynamic2;
+        break;
+    case SNAP_RDGCODE:
+        format = "|hh";
+        kwlist = kwlist_rdgcode;
+        break;
+    case SNAP_RDMODAL:
+        format = "|hh";
+        kwlist = kwlist_rdmodal;
+        break;
     }
-    
-    if (!temp) goto error;
-    if (PyDict_SetItemString(aux_dict, "type", temp) < 0) goto error;
-    Py_DECREF(temp);
 
-    temp = PyLong_FromLong(data->aux_data);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(aux_dict, "aux_data", temp) < 0) goto error;
+    if (!(read = PyMem_Calloc(1, sizeof(SnapshotRead)))) {
+        return PyErr_NoMemory();
+    }
+    read->op = op;
+    read->a = snapshot_reads[op].a;
+    read->b = snapshot_reads[op].b;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, format, kwlist, &read->a, &read->b) || snapshot_check(read) < 0) {
+        goto error;
+    }
+    return async_submit(self, ASYNC_READS, read, 1, 1);
 
-    temp = parse_flag1((unsigned char)data->flag1);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(aux_dict, "flag1", temp) < 0) goto error;
-    Py_DECREF(temp);
+error:
+    PyMem_Free(read);
+    return NULL;
+}
 
-    temp = parse_flag2((unsigned char)data->flag2);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(aux_dict, "flag2", temp) < 0) goto error;
-    Py_DECREF(temp);
+#define ASYNC_READ(name, op)                                                                  \
+    static PyObject* AsyncContext_##name(AsyncContext* self, PyObject* args, PyObject* kwds) { \
+        return async_read(self, op, args, kwds);                                              \
+    }
 
-    return aux_dict;
+ASYNC_READ(acts, SNAP_ACTS)
+ASYNC_READ(actf, SNAP_ACTF)
+ASYNC_READ(acts2, SNAP_ACTS2)
+ASYNC_READ(rdspeed, SNAP_RDSPEED)
+ASYNC_READ(statinfo, SNAP_STATINFO)
+ASYNC_READ(rdblkcount, SNAP_RDBLKCOUNT)
+ASYNC_READ(rddynamic2, SNAP_RDDYNAMIC2)
+ASYNC_READ(rdgcode, SNAP_RDGCODE)
+ASYNC_READ(rdmodal, SNAP_RDMODAL)
+
+static PyObject* AsyncContext_snapshot(AsyncContext* self, PyObject* args) {
+    PyObject* spec;
+    SnapshotRead* reads;
+    Py_ssize_t n;
+
+    if (!PyArg_ParseTuple(args, "O", &spec)) {
+        return NULL;
+    }
+    if (!(reads = snapshot_parse_spec(spec, &n))) {
+        return NULL;
+    }
+    return async_submit(self, ASYNC_READS, reads, n, 0);
+}
 
-error:
-    Py_XDECREF(aux_dict);
-    return NULL;
+static PyObject* AsyncContext_connect(AsyncContext* self, PyObject* Py_UNUSED(ignored)) {
+    return async_submit(self, ASYNC_CONNECT, NULL, 0, 0);
 }
 
-static PyObject* parse_flag1(unsigned char flag1) {
-    PyObject* dict = PyDict_New();
-    if (!dict) return NULL;
+static PyObject* AsyncContext_close(AsyncContext* self, PyObject* Py_UNUSED(ignored)) {
+    return async_submit(self, ASYNC_CLOSE, NULL, 0, 0);
+}
 
-    PyObject* temp;
+static PyObject* AsyncContext_aexit(AsyncContext* self, PyObject* args) {
+    return async_submit(self, ASYNC_CLOSE, NULL, 0, 0);
+}
 
-    // 입력 값 (bit 3-0)
-    int value = flag1 & 0x0F;
-    temp = PyLong_FromLong(value);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "inputs", temp) < 0) goto error;
-    Py_DECREF(temp);
-
-    // 부호 (bit 5)
-    int is_negative = (flag1 >> 5) & 0x01;
-    temp = PyBool_FromLong(is_negative);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "is_negative", temp) < 0) goto error;
-    Py_DECREF(temp);
-
-    // 소수점 명령 존재 여부 (bit 6)
-    int has_decimal = (flag1 >> 6) & 0x01;
-    temp = PyBool_FromLong(has_decimal);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "has_decimal", temp) < 0) goto error;
-    Py_DECREF(temp);
-
-    // 현재 블록 명령 존재 여부 (bit 7)
-    int has_command = (flag1 >> 7) & 0x01;
-    temp = PyBool_FromLong(has_command);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "has_command", temp) < 0) goto error;
-    Py_DECREF(temp);
-
-    // 원본 flag1 값도 저장
-    temp = PyLong_FromUnsignedLong(flag1);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "flag1", temp) < 0) goto error;
-    Py_DECREF(temp);
+// Unlike Context the handle is not opened here, see connect() / async with
+static int AsyncContext_init(AsyncContext* self, PyObject* args, PyObject* kwds) {
+    return Context_setup((Context*) self, args, kwds);
+}
 
-    return dict;
+/*
+Grow the AsyncContext worker pool [set_async_workers]
+Every worker runs one FOCAS call at a time, so this is the number of machines
+read concurrently. Workers are never stopped, the pool only grows.
+Returns:
+    The number of workers
+*/
+static PyObject* fwlib_set_async_workers(PyObject* module, PyObject* args) {
+    int n;
 
-error:
-    Py_XDECREF(dict);
-    return NULL;
+    if (!PyArg_ParseTuple(args, "i", &n)) {
+        return NULL;
+    }
+    if (async_start(n) < 0) {
+        return NULL;
+    }
+    return PyLong_FromLong(pool.workers);
 }
 
-static PyObject* parse_flag2(unsigned char flag2) {
-    PyObject* dict = PyDict_New();
-    if (!dict) return NULL;
+static PyMethodDef AsyncContext_methods[] = {
+    {"connect", (PyCFunction) AsyncContext_connect, METH_NOARGS, "Opens the handle and loads the metadata, awaitable."},
+    {"close", (PyCFunction) AsyncContext_close, METH_NOARGS, "Releases the handle, awaitable."},
+    {"acts", (PyCFunction) AsyncContext_acts, METH_VARARGS | METH_KEYWORDS, "Awaitable acts()."},
+    {"acts2", (PyCFunction) AsyncContext_acts2, METH_VARARGS | METH_KEYWORDS, "Awaitable acts2()."},
+    {"actf", (PyCFunction) AsyncContext_actf, METH_VARARGS | METH_KEYWORDS, "Awaitable actf()."},
+    {"rdspeed", (PyCFunction) AsyncContext_rdspeed, METH_VARARGS | METH_KEYWORDS, "Awaitable rdspeed()."},
+    {"statinfo", (PyCFunction) AsyncContext_statinfo, METH_VARARGS | METH_KEYWORDS, "Awaitable statinfo()."},
+    {"rdblkcount", (PyCFunction) AsyncContext_rdblkcount, METH_VARARGS | METH_KEYWORDS, "Awaitable rdblkcount()."},
+    {"rddynamic2", (PyCFunction) AsyncContext_rddynamic2, METH_VARARGS | METH_KEYWORDS, "Awaitable rddynamic2()."},
+    {"rdgcode", (PyCFunction) AsyncContext_rdgcode, METH_VARARGS | METH_KEYWORDS, "Awaitable rdgcode()."},
+    {"rdmodal", (PyCFunction) AsyncContext_rdmodal, METH_VARARGS | METH_KEYWORDS, "Awaitable rdmodal()."},
+    {"snapshot", (PyCFunction) AsyncContext_snapshot, METH_VARARGS, "Awaitable snapshot(), the list of reads runs as one job."},
+    {"__aenter__", (PyCFunction) AsyncContext_connect, METH_NOARGS, "Connect, awaitable."},
+    {"__aexit__", (PyCFunction) AsyncContext_aexit, METH_VARARGS, "Close, awaitable."},
+    {NULL}  /* Sentinel */
+};
 
-    PyObject* temp;
+static PyTypeObject AsyncContextType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "fwlib.AsyncContext",
+    .tp_doc = "FANUC Context with awaitable reads",
+    .tp_basicsize = sizeof(AsyncContext),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_base = &ContextType,
+    .tp_init = (initproc) AsyncContext_init,
+    .tp_methods = AsyncContext_methods,
+};
+#endif
 
-    // 소수점 자릿수 (bit 2-0)
-    int decimal = flag2 & 0x07; // 0x07 = 0000 0111
-    temp = PyLong_FromLong(decimal);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "decimal", temp) < 0) goto error;
-    Py_DECREF(temp);
+/*
+Convert FOCAS fixed point values to floating point [fixed_to_f64, fixed_to_f32]
+out[i] = values[i] / 10 ** dec[i] for whole arrays at once, with the SIMD kernel
+of the cpu (fwlib.fixed_kernel() names it), e.g. for a history of rdpositions()
+buffers.
+Parameters:
+    values : int32/int64 buffer, the 32-bit values FOCAS sends
+    dec    : Decimal places, an int for every value or an int16 buffer of one
+             per value
+    out    : Writable float64/float32 buffer of at least as many items.
+             float32 is multiplied by 10 ** -dec and can be 1 ulp off.
+Returns:
+    Number of values converted
+Example:
+    fwlib.to_float(history, numpy.array(decimals * rows, numpy.int16), mm)
+*/
+static PyObject* fwlib_to_float(PyObject* module, PyObject* args) {
+    PyObject* values_obj;
+    PyObject* dec_obj;
+    PyObject* out_obj;
+    Py_buffer values, decs, out;
+    int32_t chunk[256];
+    Py_ssize_t n, i, k, m;
+    int per_value;
+    short dec = 0;
+    int code;
+
+    if (!PyArg_ParseTuple(args, "OOO", &values_obj, &dec_obj, &out_obj)) {
+        return NULL;
+    }
+    per_value = !PyLong_Check(dec_obj);
+    if (!per_value && (dec = (short) PyLong_AsLong(dec_obj)) == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    if (numeric_buffer(values_obj, &values, 0, "ilq", "values") < 0) {
+        return NULL;
+    }
+    n = values.len / values.itemsize;
+    if ((code = numeric_buffer(out_obj, &out, PyBUF_WRITABLE, "df", "out")) < 0) {
+        PyBuffer_Release(&values);
+        return NULL;
+    }
+    if (out.len / out.itemsize < n) {
+        PyErr_Format(PyExc_ValueError, "out holds %zd items, %zd values", out.len / out.itemsize, n);
+        goto fail;
+    }
+    if (per_value) {
+        if (numeric_buffer(dec_obj, &decs, 0, "h", "dec") < 0) {
+            goto fail;
+        }
+        if (decs.len / decs.itemsize < n) {
+            PyErr_Format(PyExc_ValueError, "dec holds %zd items, %zd values", decs.len / decs.itemsize, n);
+            PyBuffer_Release(&decs);
+            goto fail;
+        }
+    }
 
-    // 원본 flag2 값도 저장
-    temp = PyLong_FromUnsignedLong(flag2);
-    if (!temp) goto error;
-    if (PyDict_SetItemString(dict, "flag2", temp) < 0) goto error;
-    Py_DECREF(temp);
+    // 버퍼는 잡아 두었으므로 큰 배열은 GIL 없이 변환
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < n; i += m) {
+        const int32_t* v = (const int32_t*) values.buf + i;
+        const short* d = per_value ? (const short*) decs.buf + i : NULL;
+        m = n - i;
+        if (values.itemsize == 8) {
+            // int64는 잘라서 (FOCAS 값은 32비트) 조각 단위로 변환
+            m = m < 256 ? m : 256;
+            for (k = 0; k < m; k++) {
+                chunk[k] = (int32_t) ((const int64_t*) values.buf)[i + k];
+            }
+            v = chunk;
+        }
+        if (code == 'd') {
+            if (per_value) {
+                fixed_to_f64(v, d, m, (double*) out.buf + i);
+            } else {
+                fixed_to_f64_uniform(v, dec, m, (double*) out.buf + i);
+            }
+        } else if (per_value) {
+            fixed_to_f32(v, d, m, (float*) out.buf + i);
+        } else {
+            fixed_to_f32_uniform(v, dec, m, (float*) out.buf + i);
+        }
+    }
+    Py_END_ALLOW_THREADS
 
-    return dict;
+    if (per_value) {
+        PyBuffer_Release(&decs);
+    }
+    PyBuffer_Release(&out);
+    PyBuffer_Release(&values);
+    return PyLong_FromSsize_t(n);
 
-error:
-    Py_XDECREF(dict);
+fail:
+    PyBuffer_Release(&out);
+    PyBuffer_Release(&values);
     return NULL;
 }
 
-// Python Method Definition
-static PyMethodDef Context_methods[] = {
-    {"read_id", (PyCFunction) Context_read_id, METH_NOARGS, "Reads the CNC ID."},
-    {"acts", (PyCFunction) Context_acts, METH_NOARGS, "Reads the actual spindle speed."},
-    {"acts2", (PyCFunction) Context_acts2, METH_VARARGS, "Reads actual speeds for multiple spindles."},
-    {"actf", (PyCFunction) Context_actf, METH_NOARGS, "Reads the actual feed rate."},
-    {"rdspeed", (PyCFunction) Context_rdspeed, METH_VARARGS, "Reads the feed rate and spindle speed."},
-    {"rdgcode", (PyCFunction) Context_rdgcode, METH_VARARGS | METH_KEYWORDS, "Reads the G code."},
-    {"rdmodal", (PyCFunction) Context_modal, METH_VARARGS | METH_KEYWORDS, "Reads the modal information."},
-    {"__enter__", (PyCFunction) Context_enter, METH_NOARGS, "Enter the context."},
-    {"__exit__", (PyCFunction) Context_exit, METH_VARARGS, "Exit the context."},
-    {NULL}  /* Sentinel */
-};
+static PyObject* fwlib_fixed_kernel(PyObject* module, PyObject* Py_UNUSED(ignored)) {
+    return PyUnicode_FromString(fixed_kernel());
+}
 
-static PyTypeObject ContextType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "fwlib.Context",
-    .tp_doc = "FANUC Context Manager",
-    .tp_basicsize = sizeof(Context),
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = Context_new,
-    .tp_init = (initproc) Context_init,
-    .tp_dealloc = (destructor) Context_dealloc,
-    .tp_methods = Context_methods,
+static PyMethodDef fwlib_methods[] = {
+    {"asdict", (PyCFunction) fwlib_asdict, METH_O, "Converts a read result to dictionaries and lists."},
+    {"to_float", (PyCFunction) fwlib_to_float, METH_VARARGS, "Converts fixed point values to floating point in bulk."},
+    {"fixed_kernel", (PyCFunction) fwlib_fixed_kernel, METH_NOARGS, "Names the SIMD kernel used by to_float."},
+#ifndef _WIN32
+    {"set_async_workers", (PyCFunction) fwlib_set_async_workers, METH_VARARGS, "Grows the AsyncContext worker pool."},
+#endif
+    {NULL}  /* Sentinel */
 };
 
 static PyModuleDef fwlibmodule = {
@@ -902,13 +2887,25 @@ static PyModuleDef fwlibmodule = {
     "fwlib",
     "Python wrapper for FANUC fwlib32 library",
     -1,
-    NULL, NULL, NULL, NULL, NULL
+    fwlib_methods, NULL, NULL, NULL, NULL
 };
 
 PyMODINIT_FUNC PyInit_fwlib(void) {
     PyObject* m;
     if (PyType_Ready(&ContextType) < 0)
         return NULL;
+#ifndef _WIN32
+    if (PyType_Ready(&AsyncContextType) < 0)
+        return NULL;
+#endif
+
+    if (focas_lock == NULL) {
+        if ((focas_lock = PyThread_allocate_lock()) == NULL) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+        Py_AtExit(focas_atexit);
+    }
 
     m = PyModule_Create(&fwlibmodule);
     if (m == NULL)
@@ -920,6 +2917,24 @@ PyMODINIT_FUNC PyInit_fwlib(void) {
         Py_DECREF(m);
         return NULL;
     }
+    if (result_types_init(m) < 0) {
+        Py_DECREF(m);
+        return NULL;
+    }
+    rdaxisdata64 = find_rdaxisdata64();
+    // 어느 경로를 쓰는지 확인용 (smoke_fwlib.py)
+    if (PyModule_AddObject(m, "HAS_RDAXISDATA64", PyBool_FromLong(rdaxisdata64 != NULL)) < 0) {
+        Py_DECREF(m);
+        return NULL;
+    }
+#ifndef _WIN32
+    Py_INCREF(&AsyncContextType);
+    if (PyModule_AddObject(m, "AsyncContext", (PyObject*) &AsyncContextType) < 0) {
+        Py_DECREF(&AsyncContextType);
+        Py_DECREF(m);
+        return NULL;
+    }
+#endif
 
     return m;
 }
@@ -1,9 +1,14 @@
+import os
+
 from setuptools import setup, Extension
 
+# fixed_point.c is shared with examples/c, the Docker build copies it next to this file
+shared = "." if os.path.exists("fixed_point.c") else os.path.join("..", "examples", "c", "src")
+
 module = Extension(
     "fwlib",
-    sources=["fwlib.c", "code_map.c"],
-    include_dirs=["."],
+    sources=["fwlib.c", "code_map.c", os.path.join(shared, "fixed_point.c")],
+    include_dirs=[".", shared],
     libraries=["fwlib32"],
 )
 